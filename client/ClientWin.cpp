@@ -178,7 +178,8 @@ void ClientWin::drawFrame(Frame *f)
 	if(!f->isXV)
 	{
 		CompressedFrame *c = (CompressedFrame *)f;
-		if((c->rhdr.flags == RR_RIGHT || c->hdr.flags == RR_LEFT) && !stereo)
+		if((c->rhdr.flags == RR_RIGHT || c->rhdr.flags == RR_RIGHTDELTA
+			|| c->hdr.flags == RR_LEFT) && !stereo)
 		{
 			stereo = true;
 			if(drawMethod != RR_DRAWOGL)
@@ -199,10 +200,20 @@ void ClientWin::drawFrame(Frame *f)
 }
 
 
+// Stages of the image pipeline whose latency is measured on the client
+enum { STAGE_RECEIVE = 0, STAGE_DECOMPRESS, STAGE_BLIT, STAGE_ENDTOEND,
+	NSTAGES };
+static const char *stageNames[NSTAGES] =
+{
+	"Receive", "Decompress", "Blit", "End-to-end"
+};
+
+
 void ClientWin::run(void)
 {
 	Profiler pt("Total     "), pb("Blit      "), pd("Decompress");
-	Frame *f = NULL;  long bytes = 0;
+	LatencyProfiler pl("Latency   ", NSTAGES, stageNames);
+	Frame *f = NULL;  long bytes = 0;  double decompressTime = 0.;
 
 	try
 	{
@@ -219,12 +230,21 @@ void ClientWin::run(void)
 				if(f->hdr.flags != RR_EOF)
 				{
 					pb.startFrame();
+					double blitStart = getTime();
 					((XVFrame *)f)->redraw();
+					pl.addSample(STAGE_BLIT, getTime() - blitStart);
 					pb.endFrame(f->hdr.width * f->hdr.height, 0, 1);
 					pt.endFrame(f->hdr.width * f->hdr.height, bytes, 1);
 					bytes = 0;
 					pt.startFrame();
 				}
+				else
+				{
+					pl.addSample(STAGE_RECEIVE, f->recvTime);
+					if(f->captureTime > 0.)
+						pl.addSample(STAGE_ENDTOEND, getTime() - f->captureTime);
+					pl.endFrame();
+				}
 			}
 			else
 			#endif
@@ -232,10 +252,19 @@ void ClientWin::run(void)
 				if(f->hdr.flags == RR_EOF)
 				{
 					pb.startFrame();
+					double blitStart = getTime();
 					if(fb->isGL) ((GLFrame *)fb)->init(f->hdr, stereo);
 					else ((FBXFrame *)fb)->init(f->hdr);
 					if(fb->isGL) ((GLFrame *)fb)->redraw();
 					else ((FBXFrame *)fb)->redraw();
+					double now = getTime();
+					pl.addSample(STAGE_RECEIVE, f->recvTime);
+					pl.addSample(STAGE_DECOMPRESS, decompressTime);
+					pl.addSample(STAGE_BLIT, now - blitStart);
+					if(f->captureTime > 0.)
+						pl.addSample(STAGE_ENDTOEND, now - f->captureTime);
+					pl.endFrame();
+					decompressTime = 0.;
 					pb.endFrame(fb->hdr.framew * fb->hdr.frameh, 0, 1);
 					pt.endFrame(fb->hdr.framew * fb->hdr.frameh, bytes, 1);
 					bytes = 0;
@@ -244,8 +273,10 @@ void ClientWin::run(void)
 				else
 				{
 					pd.startFrame();
+					double decompressStart = getTime();
 					if(fb->isGL) *((GLFrame *)fb) = *((CompressedFrame *)f);
 					else *((FBXFrame *)fb) = *((CompressedFrame *)f);
+					decompressTime += getTime() - decompressStart;
 					pd.endFrame(f->hdr.width * f->hdr.height, 0,
 						(double)(f->hdr.width * f->hdr.height) /
 							(double)(f->hdr.framew * f->hdr.frameh));
@@ -30,8 +30,28 @@ static int tjpf[PIXELFORMATS] =
 };
 
 
+// OpenGL functions used by the texture streaming path.  These are loaded at
+// run time, since the OpenGL library on the client may not export them.
+
+static PFNGLGENBUFFERSPROC __glGenBuffers = NULL;
+static PFNGLBINDBUFFERPROC __glBindBuffer = NULL;
+static PFNGLBUFFERDATAPROC __glBufferData = NULL;
+static PFNGLMAPBUFFERRANGEPROC __glMapBufferRange = NULL;
+static PFNGLUNMAPBUFFERPROC __glUnmapBuffer = NULL;
+static PFNGLFENCESYNCPROC __glFenceSync = NULL;
+static PFNGLCLIENTWAITSYNCPROC __glClientWaitSync = NULL;
+static PFNGLDELETESYNCPROC __glDeleteSync = NULL;
+
+#define LOADSYM(s, type) \
+{ \
+	if(!(__##s = (type)glXGetProcAddressARB((const GLubyte *)#s))) \
+		return false; \
+}
+
+
 GLFrame::GLFrame(char *dpystring, Window win_) : Frame(), dpy(NULL), win(win_),
-	ctx(0), tjhnd(NULL), newdpy(false)
+	ctx(0), tjhnd(NULL), newdpy(false), useTexture(-1), texWidth(0),
+	texHeight(0), texStereo(false), pboIndex(0)
 {
 	if(!dpystring || !win)
 		throw(Error("GLFrame::GLFrame", "Invalid argument"));
@@ -44,7 +64,8 @@ GLFrame::GLFrame(char *dpystring, Window win_) : Frame(), dpy(NULL), win(win_),
 
 
 GLFrame::GLFrame(Display *dpy_, Window win_) : Frame(), dpy(NULL), win(win_),
-	ctx(0), tjhnd(NULL), newdpy(false)
+	ctx(0), tjhnd(NULL), newdpy(false), useTexture(-1), texWidth(0),
+	texHeight(0), texStereo(false), pboIndex(0)
 {
 	if(!dpy_ || !win_) throw(Error("GLFrame::GLFrame", "Invalid argument"));
 
@@ -58,6 +79,11 @@ void GLFrame::init(void)
 {
 	XVisualInfo *v = NULL;
 
+	memset(tex, 0, sizeof(GLuint) * 2);
+	memset(pbo, 0, sizeof(GLuint) * NPBOS);
+	memset(fence, 0, sizeof(GLsync) * NPBOS);
+	memset(pboSize, 0, sizeof(long) * NPBOS);
+
 	try
 	{
 		pf = pf_get(PF_RGB);
@@ -118,6 +144,10 @@ void GLFrame::init(rrframeheader &h, bool stereo_)
 {
 	int format = PF_RGB;
 	if(littleendian() && h.compress != RRCOMP_RGB) format = PF_BGR;
+	// A frame can contain tiles with different encodings, so don't change the
+	// pixel format of the existing frame buffer unless it is being resized.
+	if(bits && h.framew == hdr.framew && h.frameh == hdr.frameh)
+		format = pf->id;
 	Frame::init(h, format, FRAME_BOTTOMUP, stereo_);
 }
 
@@ -140,6 +170,17 @@ GLFrame &GLFrame::operator= (CompressedFrame &cf)
 			if(stereo && cf.rbits && rbits)
 				decompressRGB(cf, width, height, true);
 		}
+		else if(cf.hdr.compress == RRCOMP_LOSSLESS)
+		{
+			decompressLossless(cf, width, height, false);
+			if(stereo && cf.rbits && rbits)
+				decompressLossless(cf, width, height, true);
+		}
+		else if(cf.hdr.compress == RRCOMP_SOLID
+			|| cf.hdr.compress == RRCOMP_PALETTE)
+			decompressPalette(cf, width, height);
+		else if(cf.hdr.compress == RRCOMP_COPYRECT)
+			copyRect(cf, width, height);
 		else
 		{
 			if(!tjhnd)
@@ -158,6 +199,9 @@ GLFrame &GLFrame::operator= (CompressedFrame &cf)
 					width, pitch, height, tjpf[pf->id], tjflags));
 			}
 		}
+		if(stereo && cf.rbits && rbits && cf.rhdr.flags == RR_RIGHTDELTA)
+			addStereoDelta(cf, width, height);
+		addDirtyRect(cf.hdr.x, cf.hdr.y, width, height);
 	}
 	return *this;
 }
@@ -165,11 +209,203 @@ GLFrame &GLFrame::operator= (CompressedFrame &cf)
 
 void GLFrame::redraw(void)
 {
-	drawTile(0, 0, hdr.framew, hdr.frameh);
+	if(!glXMakeCurrent(dpy, win, ctx))
+		_throw("Could not bind OpenGL context to window (window may have disappeared)");
+
+	int e = glGetError();
+	while(e != GL_NO_ERROR) e = glGetError();  // Clear previous error
+	if(useTexture < 0)
+	{
+		useTexture = initTexture();
+		char *env = NULL;
+		if((env = getenv("VGL_VERBOSE")) != NULL && strlen(env) > 0
+			&& !strncmp(env, "1", 1))
+			vglout.println("[VGL] Using %s to draw images",
+				useTexture ? "OpenGL texture streaming" : "glDrawPixels()");
+	}
+	if(useTexture)
+	{
+		try
+		{
+			uploadTiles();
+			drawTexture();
+		}
+		catch(Error &e)
+		{
+			vglout.println("OpenGL error-- %s\nUsing glDrawPixels() instead",
+				e.getMessage());
+			useTexture = 0;
+		}
+	}
+	if(!useTexture) drawTile(0, 0, hdr.framew, hdr.frameh);
+	nDirty = 0;  allDirty = false;
 	sync();
 }
 
 
+// The texture streaming path requires pixel buffer objects,
+// glMapBufferRange(), and sync objects, which are all core features in OpenGL
+// 3.2 and later.
+
+bool GLFrame::initTexture(void)
+{
+	const char *version = (const char *)glGetString(GL_VERSION),
+		*ext = (const char *)glGetString(GL_EXTENSIONS);
+	int major = 0, minor = 0;
+
+	if(!version || sscanf(version, "%d.%d", &major, &minor) < 2 || major < 2)
+		return false;
+	if(major == 2 || (major == 3 && minor < 2))
+	{
+		if(!ext || !strstr(ext, "GL_ARB_pixel_buffer_object")
+			|| !strstr(ext, "GL_ARB_map_buffer_range")
+			|| !strstr(ext, "GL_ARB_sync"))
+			return false;
+	}
+	LOADSYM(glGenBuffers, PFNGLGENBUFFERSPROC);
+	LOADSYM(glBindBuffer, PFNGLBINDBUFFERPROC);
+	LOADSYM(glBufferData, PFNGLBUFFERDATAPROC);
+	LOADSYM(glMapBufferRange, PFNGLMAPBUFFERRANGEPROC);
+	LOADSYM(glUnmapBuffer, PFNGLUNMAPBUFFERPROC);
+	LOADSYM(glFenceSync, PFNGLFENCESYNCPROC);
+	LOADSYM(glClientWaitSync, PFNGLCLIENTWAITSYNCPROC);
+	LOADSYM(glDeleteSync, PFNGLDELETESYNCPROC);
+	return true;
+}
+
+
+// Copy the tiles that have been updated since the last frame into the next
+// pixel buffer object in the ring, and use that PBO to update the
+// corresponding regions of the texture.  A fence is inserted after the
+// texture update, so the PBO is not reused until the GPU has finished reading
+// from it.
+
+void GLFrame::uploadTiles(void)
+{
+	int glFormat = (pf->id == PF_BGR ? GL_BGR : GL_RGB);
+	int nEyes = (stereo && rbits) ? 2 : 1, eye, i, j;
+
+	if(!tex[0] || texWidth != hdr.framew || texHeight != hdr.frameh
+		|| texStereo != (nEyes == 2))
+	{
+		if(!tex[0]) glGenTextures(2, tex);
+		for(eye = 0; eye < nEyes; eye++)
+		{
+			glBindTexture(GL_TEXTURE_2D, tex[eye]);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+			glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB8, hdr.framew, hdr.frameh, 0,
+				glFormat, GL_UNSIGNED_BYTE, NULL);
+		}
+		texWidth = hdr.framew;  texHeight = hdr.frameh;  texStereo = (nEyes == 2);
+		allDirty = true;
+	}
+	if(allDirty)
+	{
+		nDirty = 0;  allDirty = false;
+		addDirtyRect(0, 0, hdr.framew, hdr.frameh);
+	}
+	if(nDirty < 1) return;
+	mergeDirtyRects();
+
+	long size = 0, offset = 0;
+	for(i = 0; i < nDirty; i++)
+		size += (long)dirty[i].width * dirty[i].height * pf->size;
+	size *= nEyes;
+
+	if(fence[pboIndex])
+	{
+		GLenum ret;
+		do
+		{
+			ret = __glClientWaitSync(fence[pboIndex], GL_SYNC_FLUSH_COMMANDS_BIT,
+				1000000000);
+		} while(ret == GL_TIMEOUT_EXPIRED);
+		__glDeleteSync(fence[pboIndex]);  fence[pboIndex] = 0;
+		if(ret == GL_WAIT_FAILED) _throw("Could not wait for OpenGL fence");
+	}
+	if(!pbo[pboIndex]) __glGenBuffers(1, &pbo[pboIndex]);
+	__glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pbo[pboIndex]);
+	if(size > pboSize[pboIndex])
+	{
+		__glBufferData(GL_PIXEL_UNPACK_BUFFER, size, NULL, GL_STREAM_DRAW);
+		pboSize[pboIndex] = size;
+	}
+	unsigned char *ptr = (unsigned char *)__glMapBufferRange(
+		GL_PIXEL_UNPACK_BUFFER, 0, size, GL_MAP_WRITE_BIT
+			| GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+	if(!ptr)
+	{
+		__glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+		_throw("Could not map pixel buffer object");
+	}
+	for(eye = 0; eye < nEyes; eye++)
+	{
+		unsigned char *srcBits = eye ? rbits : bits;
+		for(i = 0; i < nDirty; i++)
+		{
+			Rect &r = dirty[i];
+			int rowSize = r.width * pf->size, y = hdr.frameh - r.y - r.height;
+			for(j = 0; j < r.height; j++, offset += rowSize)
+				memcpy(&ptr[offset], &srcBits[pitch * (y + j) + r.x * pf->size],
+					rowSize);
+		}
+	}
+	__glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+	offset = 0;
+	for(eye = 0; eye < nEyes; eye++)
+	{
+		glBindTexture(GL_TEXTURE_2D, tex[eye]);
+		for(i = 0; i < nDirty; i++)
+		{
+			Rect &r = dirty[i];
+			glTexSubImage2D(GL_TEXTURE_2D, 0, r.x, hdr.frameh - r.y - r.height,
+				r.width, r.height, glFormat, GL_UNSIGNED_BYTE, (GLvoid *)offset);
+			offset += (long)r.width * r.height * pf->size;
+		}
+	}
+	__glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+	fence[pboIndex] = __glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	pboIndex = (pboIndex + 1) % NPBOS;
+	if(glError()) _throw("Could not upload pixels to texture");
+}
+
+
+void GLFrame::drawTexture(void)
+{
+	int oldbuf = -1;
+
+	glViewport(0, 0, hdr.framew, hdr.frameh);
+	glMatrixMode(GL_PROJECTION);  glLoadIdentity();
+	glMatrixMode(GL_MODELVIEW);  glLoadIdentity();
+	glEnable(GL_TEXTURE_2D);
+	glTexEnvi(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_REPLACE);
+	if(texStereo) glGetIntegerv(GL_DRAW_BUFFER, &oldbuf);
+	for(int eye = 0; eye < (texStereo ? 2 : 1); eye++)
+	{
+		if(texStereo) glDrawBuffer(eye ? GL_BACK_RIGHT : GL_BACK_LEFT);
+		glBindTexture(GL_TEXTURE_2D, tex[eye]);
+		glBegin(GL_QUADS);
+		glTexCoord2f(0.0f, 0.0f);  glVertex2f(-1.0f, -1.0f);
+		glTexCoord2f(1.0f, 0.0f);  glVertex2f(1.0f, -1.0f);
+		glTexCoord2f(1.0f, 1.0f);  glVertex2f(1.0f, 1.0f);
+		glTexCoord2f(0.0f, 1.0f);  glVertex2f(-1.0f, 1.0f);
+		glEnd();
+	}
+	if(texStereo) glDrawBuffer(oldbuf);
+	glBindTexture(GL_TEXTURE_2D, 0);
+	glDisable(GL_TEXTURE_2D);
+	if(glError()) _throw("Could not draw texture");
+}
+
+
+// The OpenGL context must be current when this is called.
+
 void GLFrame::drawTile(int x, int y, int width, int height)
 {
 	if(x < 0 || width < 1 || (x + width) > hdr.framew || y < 0 || height < 1
@@ -177,12 +413,6 @@ void GLFrame::drawTile(int x, int y, int width, int height)
 		return;
 	int glFormat = (pf->id == PF_BGR ? GL_BGR : GL_RGB);
 
-	if(!glXMakeCurrent(dpy, win, ctx))
-		_throw("Could not bind OpenGL context to window (window may have disappeared)");
-
-	int e;
-	e = glGetError();
-	while(e != GL_NO_ERROR) e = glGetError();  // Clear previous error
 	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
 	glPixelStorei(GL_UNPACK_ROW_LENGTH, pitch / pf->size);
 	int oldbuf = -1;
@@ -207,9 +437,12 @@ void GLFrame::drawTile(int x, int y, int width, int height)
 }
 
 
+// glDrawPixels() consumes the pixels before returning, and the texture
+// streaming path uses fences to synchronize access to its pixel buffer
+// objects, so there is no need to call glFinish() before swapping buffers.
+
 void GLFrame::sync(void)
 {
-	glFinish();
 	glXSwapBuffers(dpy, win);
 	glXMakeCurrent(dpy, 0, 0);
 }
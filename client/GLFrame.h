@@ -38,13 +38,23 @@ namespace vglcommon
 
 		private:
 
+			// Number of pixel buffer objects used to stream tiles into the texture
+			static const int NPBOS = 3;
+
 			void init(void);
 			int glError(void);
+			bool initTexture(void);
+			void uploadTiles(void);
+			void drawTexture(void);
 
 			Display *dpy;  Window win;
 			GLXContext ctx;
 			tjhandle tjhnd;
 			bool newdpy;
+			int useTexture;
+			GLuint tex[2];  int texWidth, texHeight;  bool texStereo;
+			GLuint pbo[NPBOS];  GLsync fence[NPBOS];  long pboSize[NPBOS];
+			int pboIndex;
 	};
 }
 
@@ -15,6 +15,7 @@
 
 #include "VGLTransReceiver.h"
 #include "vglutil.h"
+#include "Timer.h"
 
 using namespace vglutil;
 using namespace vglcommon;
@@ -161,7 +162,8 @@ void VGLTransReceiver::Listener::run(void)
 	ClientWin *w = NULL;
 	Frame *f = NULL;
 	rrframeheader h;  rrframeheader_v1 h1;  bool haveHeader = false;
-	rrversion v;
+	rrversion v;  bool timing = false;  long long clockOffset = 0;
+	double frameStart = 0.;
 
 	try
 	{
@@ -182,10 +184,19 @@ void VGLTransReceiver::Listener::run(void)
 				_throw("Error reading server version");
 		}
 
-		char *env = NULL;
+		char *env = NULL;  bool verbose = false;
 		if((env = getenv("VGL_VERBOSE")) != NULL && strlen(env) > 0
 			&& !strncmp(env, "1", 1))
+			verbose = true;
+		if(verbose)
 			vglout.println("Server version: %d.%d", v.major, v.minor);
+		if(v.major > 2 || (v.major == 2 && v.minor >= 3))
+		{
+			timing = true;
+			clockOffset = syncClock();
+			if(verbose)
+				vglout.println("Clock offset: %lld us", clockOffset);
+		}
 		vglout.flush();
 
 		while(1)
@@ -207,7 +218,9 @@ void VGLTransReceiver::Listener::run(void)
 					recv((char *)&h, sizeof_rrframeheader);
 					ENDIANIZE(h);
 				}
-				bool stereo = (h.flags == RR_LEFT || h.flags == RR_RIGHT);
+				if(frameStart == 0.) frameStart = getTime();
+				bool stereo = (h.flags == RR_LEFT || h.flags == RR_RIGHT
+					|| h.flags == RR_RIGHTDELTA);
 				unsigned short dpynum =
 					(v.major < 2 || (v.major == 2 && v.minor < 1)) ?
 					h.dpynum : DisplayNumber(maindpy);
@@ -232,7 +245,23 @@ void VGLTransReceiver::Listener::run(void)
 				#endif
 				((CompressedFrame *)f)->init(h, h.flags);
 				if(h.flags != RR_EOF)
-					recv((char *)(h.flags == RR_RIGHT ? f->rbits : f->bits), h.size);
+					recv((char *)(h.flags == RR_RIGHT || h.flags == RR_RIGHTDELTA ?
+						f->rbits : f->bits), h.size);
+				else
+				{
+					f->seq = 0;  f->captureTime = 0.;
+					if(timing)
+					{
+						rreofinfo info;
+						recv((char *)&info, sizeof_rreofinfo);
+						long long capture = UNPACK_TIME(info.capture);
+						f->seq = littleendian() ? info.seq : byteswap(info.seq);
+						if(f->seq != 0 && capture != 0)
+							f->captureTime = (double)(capture + clockOffset) / 1000000.;
+					}
+					f->recvTime = getTime() - frameStart;
+					frameStart = 0.;
+				}
 
 				if(!stereo || h.flags != RR_LEFT)
 				{
@@ -261,6 +290,24 @@ void VGLTransReceiver::Listener::run(void)
 }
 
 
+// Respond to the server's clock synchronization probes, and return the offset
+// (in microseconds) between the client's clock and the server's clock
+
+long long VGLTransReceiver::Listener::syncClock(void)
+{
+	rrtime t;
+
+	for(int i = 0; i < RR_CLOCKPROBES; i++)
+	{
+		recv((char *)&t, sizeof_rrtime);
+		PACK_TIME(t, USEC(getTime()));
+		send((char *)&t, sizeof_rrtime);
+	}
+	recv((char *)&t, sizeof_rrtime);
+	return UNPACK_TIME(t);
+}
+
+
 void VGLTransReceiver::Listener::deleteWindow(ClientWin *w)
 {
 	int i, j;
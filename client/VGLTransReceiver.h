@@ -85,6 +85,7 @@ namespace vglclient
 			private:
 
 				void run(void);
+				long long syncClock(void);
 
 				int drawMethod;
 				ClientWin *windows[MAXWIN];
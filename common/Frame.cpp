@@ -37,10 +37,30 @@ static int tjpf[PIXELFORMATS] =
 };
 
 
+// An RRCOMP_PALETTE tile consists of a byte containing the number of colors
+// minus 1, followed by the palette (RGB triplets), followed by the color
+// indices for each row of the tile (bottom-up, with each row padded to a byte
+// boundary, and with the leftmost pixel in the most significant bits.)  An
+// RRCOMP_SOLID tile consists of a single RGB triplet.
+
+static inline int paletteBPP(int nColors)
+{
+	return nColors <= 2 ? 1 : (nColors <= 4 ? 2 : 4);
+}
+
+static inline unsigned long paletteSize(int width, int height, int nColors)
+{
+	return 1 + nColors * 3 +
+		(unsigned long)((width * paletteBPP(nColors) + 7) / 8) * height;
+}
+
+
 // Uncompressed frame
 
 Frame::Frame(bool primary_) : bits(NULL), rbits(NULL), pitch(0), flags(0),
-	pf(pf_get(-1)), isGL(false), isXV(false), stereo(false), primary(primary_)
+	pf(pf_get(-1)), isGL(false), isXV(false), stereo(false), ref(NULL),
+	dirty(NULL), nDirty(0), allDirty(true), seq(0), captureTime(0.), readbackTime(0.),
+	queueTime(0.), recvTime(0.), primary(primary_)
 {
 	memset(&hdr, 0, sizeof(rrframeheader));
 	ready.wait();
@@ -50,6 +70,7 @@ Frame::Frame(bool primary_) : bits(NULL), rbits(NULL), pitch(0), flags(0),
 Frame::~Frame(void)
 {
 	deInit();
+	if(dirty) { delete [] dirty;  dirty = NULL; }
 }
 
 
@@ -152,11 +173,22 @@ Frame *Frame::getTile(int x, int y, int width, int height)
 
 
 bool Frame::tileEquals(Frame *last, int x, int y, int width, int height)
+{
+	return tileEquals(last, x, y, width, height, x, y);
+}
+
+
+// Compare a tile in this frame with the tile at (srcX, srcY) in the last
+// frame.  This is used to detect content that has moved between frames.
+
+bool Frame::tileEquals(Frame *last, int x, int y, int width, int height,
+	int srcX, int srcY)
 {
 	bool bu = (flags & FRAME_BOTTOMUP);
 
 	if(x < 0 || y < 0 || width < 1 || height < 1 || (x + width) > hdr.width
-		|| (y + height) > hdr.height)
+		|| (y + height) > hdr.height || srcX < 0 || srcY < 0
+		|| (srcX + width) > hdr.width || (srcY + height) > hdr.height)
 		throw Error("Frame::tileEquals", "Argument out of range");
 
 	if(last && hdr.width == last->hdr.width && hdr.height == last->hdr.height
@@ -170,8 +202,8 @@ bool Frame::tileEquals(Frame *last, int x, int y, int width, int height)
 			unsigned char *newBits =
 				&bits[pitch * (bu ? hdr.height - y - height : y) + pf->size * x];
 			unsigned char *oldBits =
-				&last->bits[last->pitch * (bu ? hdr.height - y - height : y) +
-					pf->size * x];
+				&last->bits[last->pitch * (bu ? hdr.height - srcY - height : srcY) +
+					pf->size * srcX];
 			for(int i = 0; i < height; i++)
 			{
 				if(memcmp(&newBits[pitch * i], &oldBits[last->pitch * i],
@@ -184,8 +216,8 @@ bool Frame::tileEquals(Frame *last, int x, int y, int width, int height)
 			unsigned char *newBits =
 				&rbits[pitch * (bu ? hdr.height - y - height : y) + pf->size * x];
 			unsigned char *oldBits =
-				&last->rbits[last->pitch * (bu ? hdr.height - y - height : y) +
-					pf->size * x];
+				&last->rbits[last->pitch * (bu ? hdr.height - srcY - height : srcY) +
+					pf->size * srcX];
 			for(int i = 0; i < height; i++)
 			{
 				if(memcmp(&newBits[pitch * i], &oldBits[last->pitch * i],
@@ -307,6 +339,260 @@ void Frame::decompressRGB(Frame &f, int width, int height, bool rightEye)
 }
 
 
+void Frame::decompressLossless(CompressedFrame &cf, int width, int height,
+	bool rightEye)
+{
+	if(!cf.bits || cf.hdr.size < 1 || !bits || !hdr.size)
+		_throw("Frame not initialized");
+	if(pf->bpc < 8)
+		throw(Error("Lossless decompressor",
+			"Destination frame has the wrong pixel format"));
+	if(width != cf.hdr.width || height != cf.hdr.height)
+		throw(Error("Lossless decompressor", "Tile exceeds frame boundaries"));
+
+	// The encoded rows are always in bottom-up order.
+	bool dstbu = (flags & FRAME_BOTTOMUP);
+	int dstStride = dstbu ? pitch : -pitch;
+	int startLine = dstbu ? max(0, hdr.frameh - cf.hdr.y - height) :
+		cf.hdr.y + height - 1;
+	unsigned char *dstptr = rightEye ?
+		&rbits[pitch * startLine + cf.hdr.x * pf->size] :
+		&bits[pitch * startLine + cf.hdr.x * pf->size];
+
+	if(ll_decode(rightEye ? cf.rbits : cf.bits,
+		rightEye ? cf.rhdr.size : cf.hdr.size, width, height, dstptr, dstStride,
+		pf) == -1)
+		throw(Error("Lossless decompressor", ll_geterr()));
+}
+
+
+void Frame::decompressPalette(CompressedFrame &cf, int width, int height)
+{
+	unsigned char rgb[RR_MAXPALETTE * 3], pixels[RR_MAXPALETTE * 4];
+	int nColors = 1;
+
+	if(!cf.bits || cf.hdr.size < 1 || !bits || !hdr.size)
+		_throw("Frame not initialized");
+	if(pf->bpc < 8)
+		throw(Error("Palette decompressor",
+			"Destination frame has the wrong pixel format"));
+	if(width != cf.hdr.width || height != cf.hdr.height)
+		throw(Error("Palette decompressor", "Tile exceeds frame boundaries"));
+
+	if(cf.hdr.compress == RRCOMP_SOLID)
+	{
+		if(cf.hdr.size != 3)
+			throw(Error("Palette decompressor", "Corrupt solid tile"));
+		memcpy(rgb, cf.bits, 3);
+	}
+	else
+	{
+		nColors = cf.bits[0] + 1;
+		if(nColors > RR_MAXPALETTE
+			|| cf.hdr.size != paletteSize(width, height, nColors))
+			throw(Error("Palette decompressor", "Corrupt palette tile"));
+		memcpy(rgb, &cf.bits[1], nColors * 3);
+	}
+	pf_get(PF_RGB)->convert(rgb, nColors, nColors * 3, 1, pixels,
+		nColors * pf->size, pf);
+
+	// The rows are always in bottom-up order.
+	bool dstbu = (flags & FRAME_BOTTOMUP);
+	int dstStride = dstbu ? pitch : -pitch;
+	int startLine = dstbu ? max(0, hdr.frameh - cf.hdr.y - height) :
+		cf.hdr.y + height - 1;
+	unsigned char *dstptr = &bits[pitch * startLine + cf.hdr.x * pf->size];
+
+	if(nColors == 1)
+	{
+		for(int j = 0; j < height; j++, dstptr += dstStride)
+		{
+			unsigned char *dstPixel = dstptr;
+			for(int i = 0; i < width; i++, dstPixel += pf->size)
+				memcpy(dstPixel, pixels, pf->size);
+		}
+		return;
+	}
+
+	int bpp = paletteBPP(nColors), mask = (1 << bpp) - 1;
+	int rowSize = (width * bpp + 7) / 8;
+	unsigned char *srcptr = &cf.bits[1 + nColors * 3];
+	for(int j = 0; j < height; j++, srcptr += rowSize, dstptr += dstStride)
+	{
+		unsigned char *dstPixel = dstptr;
+		for(int i = 0, shift = 8 - bpp; i < width;
+			i++, dstPixel += pf->size, shift -= bpp)
+		{
+			if(shift < 0) shift = 8 - bpp;
+			int index = (srcptr[i * bpp / 8] >> shift) & mask;
+			if(index >= nColors)
+				throw(Error("Palette decompressor", "Corrupt palette tile"));
+			memcpy(dstPixel, &pixels[index * pf->size], pf->size);
+		}
+	}
+}
+
+
+// Reconstruct the right eye of an RR_RIGHTDELTA tile, which has already been
+// decoded into the right eye buffer, by adding the co-located pixels from the
+// left eye buffer.
+
+void Frame::addStereoDelta(CompressedFrame &cf, int width, int height)
+{
+	if(!bits || !rbits || !hdr.size) _throw("Frame not initialized");
+	if(pf->bpc != 8)
+		throw(Error("Stereo delta decoder",
+			"Destination frame has the wrong pixel format"));
+
+	// The residual is lossless only if the tile was losslessly compressed, in
+	// which case it may have wrapped around.  Otherwise, the server ensured
+	// that it did not.
+	bool wrap = (cf.rhdr.compress == RRCOMP_LOSSLESS);
+	bool bu = (flags & FRAME_BOTTOMUP);
+	int startLine = bu ? max(0, hdr.frameh - cf.hdr.y - height) : cf.hdr.y;
+	int ri = pf->rindex, gi = pf->gindex, bi = pf->bindex;
+
+	for(int j = startLine; j < startLine + height; j++)
+	{
+		unsigned char *lptr = &bits[pitch * j + cf.hdr.x * pf->size],
+			*rptr = &rbits[pitch * j + cf.hdr.x * pf->size];
+		for(int i = 0; i < width; i++, lptr += pf->size, rptr += pf->size)
+		{
+			int r = rptr[ri] + lptr[ri] - 128, g = rptr[gi] + lptr[gi] - 128,
+				b = rptr[bi] + lptr[bi] - 128;
+			if(!wrap)
+			{
+				r = min(max(r, 0), 255);  g = min(max(g, 0), 255);
+				b = min(max(b, 0), 255);
+			}
+			rptr[ri] = (unsigned char)r;  rptr[gi] = (unsigned char)g;
+			rptr[bi] = (unsigned char)b;
+		}
+	}
+}
+
+
+// Copy a rectangle of pixels from (srcX, srcY) to (x, y) within this frame.
+// The source and destination rectangles may overlap.
+
+void Frame::copyRect(int srcX, int srcY, int x, int y, int width, int height)
+{
+	if(!bits) _throw("Frame not initialized");
+	if(srcX < 0 || srcY < 0 || x < 0 || y < 0 || width < 1 || height < 1
+		|| srcX + width > hdr.framew || srcY + height > hdr.frameh
+		|| x + width > hdr.framew || y + height > hdr.frameh)
+		throw(Error("Frame::copyRect", "Argument out of range"));
+
+	// Copy the rows in an order that does not overwrite any source rows before
+	// they are copied.
+	bool bu = (flags & FRAME_BOTTOMUP);
+	for(int i = 0; i < height; i++)
+	{
+		int j = srcY < y ? height - i - 1 : i;
+		int srcLine = srcY + j, dstLine = y + j;
+		if(bu)
+		{
+			srcLine = hdr.frameh - srcLine - 1;  dstLine = hdr.frameh - dstLine - 1;
+		}
+		memmove(&bits[pitch * dstLine + x * pf->size],
+			&bits[pitch * srcLine + srcX * pf->size], width * pf->size);
+	}
+}
+
+
+// An RRCOMP_COPYRECT tile instructs the receiver to copy a rectangle of pixels
+// that it already has (from the previous frame) to the location of the tile.
+// This is used to transmit content that has been scrolled or panned.
+
+void Frame::copyRect(CompressedFrame &cf, int width, int height)
+{
+	if(!cf.bits || cf.hdr.size < 1 || !bits || !hdr.size)
+		_throw("Frame not initialized");
+	if(cf.hdr.size != RR_COPYRECTSIZE || width != cf.hdr.width
+		|| height != cf.hdr.height)
+		throw(Error("Copy-rect decoder", "Corrupt copy-rect tile"));
+
+	int srcX = cf.bits[0] | (cf.bits[1] << 8);
+	int srcY = cf.bits[2] | (cf.bits[3] << 8);
+	if(srcX + width > hdr.framew || srcY + height > hdr.frameh)
+		throw(Error("Copy-rect decoder",
+			"Source rectangle exceeds frame boundaries"));
+	copyRect(srcX, srcY, cf.hdr.x, cf.hdr.y, width, height);
+}
+
+
+// Receivers use these functions to keep track of the regions of the frame that
+// have been updated since the frame was last drawn, so that only those regions
+// need to be drawn.  If too many regions have been updated, then the whole
+// frame is drawn.
+
+void Frame::addDirtyRect(int x, int y, int width, int height)
+{
+	if(allDirty) return;
+	if(nDirty >= MAXDIRTY) { allDirty = true;  return; }
+	if(!dirty) { _newcheck(dirty = new Rect[MAXDIRTY]); }
+	dirty[nDirty].x = x;  dirty[nDirty].y = y;
+	dirty[nDirty].width = width;  dirty[nDirty].height = height;
+	nDirty++;
+}
+
+
+static int compareRows(const void *arg1, const void *arg2)
+{
+	const int *r1 = (const int *)arg1, *r2 = (const int *)arg2;
+
+	// Sort by y, height, then x
+	if(r1[1] != r2[1]) return r1[1] - r2[1];
+	if(r1[3] != r2[3]) return r1[3] - r2[3];
+	return r1[0] - r2[0];
+}
+
+
+static int compareColumns(const void *arg1, const void *arg2)
+{
+	const int *r1 = (const int *)arg1, *r2 = (const int *)arg2;
+
+	// Sort by x, width, then y
+	if(r1[0] != r2[0]) return r1[0] - r2[0];
+	if(r1[2] != r2[2]) return r1[2] - r2[2];
+	return r1[1] - r2[1];
+}
+
+
+// Merge updated rectangles that are adjacent and share an edge, first
+// horizontally (which combines the tiles in a row) and then vertically (which
+// combines the resulting rows.)
+
+void Frame::mergeDirtyRects(void)
+{
+	int i, n;
+
+	if(allDirty || nDirty < 2) return;
+
+	qsort(dirty, nDirty, sizeof(Rect), compareRows);
+	for(i = 1, n = 0; i < nDirty; i++)
+	{
+		Rect &r = dirty[n];
+		if(dirty[i].y == r.y && dirty[i].height == r.height
+			&& dirty[i].x == r.x + r.width)
+			r.width += dirty[i].width;
+		else dirty[++n] = dirty[i];
+	}
+	nDirty = n + 1;
+
+	qsort(dirty, nDirty, sizeof(Rect), compareColumns);
+	for(i = 1, n = 0; i < nDirty; i++)
+	{
+		Rect &r = dirty[n];
+		if(dirty[i].x == r.x && dirty[i].width == r.width
+			&& dirty[i].y == r.y + r.height)
+			r.height += dirty[i].height;
+		else dirty[++n] = dirty[i];
+	}
+	nDirty = n + 1;
+}
+
+
 #define DRAWLOGO() \
 switch(pf->size) \
 { \
@@ -408,7 +694,8 @@ void Frame::checkHeader(rrframeheader &h)
 
 // Compressed frame
 
-CompressedFrame::CompressedFrame(void) : Frame(), tjhnd(NULL)
+CompressedFrame::CompressedFrame(void) : Frame(), tjhnd(NULL), tjdhnd(NULL),
+	deltaBits(NULL), deltaSize(0)
 {
 	if(!(tjhnd = tjInitCompress())) _throw(tjGetErrorStr());
 	pf = pf_get(PF_RGB);
@@ -419,19 +706,119 @@ CompressedFrame::CompressedFrame(void) : Frame(), tjhnd(NULL)
 CompressedFrame::~CompressedFrame(void)
 {
 	if(tjhnd) tjDestroy(tjhnd);
+	if(tjdhnd) tjDestroy(tjdhnd);
+	delete [] deltaBits;
+}
+
+// Returns the number of unique colors in the frame, or 0 if there are more
+// than maxColors.  The colors are stored in the palette array as native pixel
+// values (with the padding bits masked off.)
+
+static int getPalette(Frame &f, unsigned int *palette, int maxColors)
+{
+	unsigned int mask = f.pf->rmask | f.pf->gmask | f.pf->bmask;
+	int nColors = 0, last = 0;
+
+	for(int j = 0; j < f.hdr.height; j++)
+	{
+		unsigned char *pixel = &f.bits[f.pitch * j];
+		for(int i = 0; i < f.hdr.width; i++, pixel += f.pf->size)
+		{
+			unsigned int value;
+			if(f.pf->size == 4) value = *(unsigned int *)pixel & mask;
+			else value = pixel[0] | (pixel[1] << 8) | (pixel[2] << 16);
+			if(nColors > 0 && value == palette[last]) continue;
+			for(last = 0; last < nColors; last++)
+				if(palette[last] == value) break;
+			if(last == nColors)
+			{
+				if(nColors == maxColors) return 0;
+				palette[nColors++] = value;
+			}
+		}
+	}
+	return nColors;
 }
 
+
+// Most of the scene is usually at (or near) the same position in both eyes of
+// a stereo frame, so the difference between the right eye and the co-located
+// pixels in the left eye compresses much better than the right eye itself.
+// The difference (right - left + 128, for each color component) is stored in
+// delta, which has the same pixel format and row order as f and a pitch of
+// f.hdr.width * f.pf->size.  delta can be the same buffer as left, in which
+// case the left eye is replaced in place.  If wrap is false, then returns false
+// if the difference for any component falls outside of -128..127 (which would
+// otherwise introduce visible artifacts when the residual is JPEG-compressed.)
+
+static bool makeStereoDelta(Frame &f, unsigned char *left, int leftPitch,
+	unsigned char *delta, bool wrap)
+{
+	int ps = f.pf->size, deltaPitch = f.hdr.width * ps, outOfRange = 0;
+	int ri = f.pf->rindex, gi = f.pf->gindex, bi = f.pf->bindex;
+
+	for(int j = 0; j < f.hdr.height; j++)
+	{
+		unsigned char *lptr = &left[leftPitch * j],
+			*rptr = &f.rbits[f.pitch * j], *dptr = &delta[deltaPitch * j];
+		for(int i = 0; i < f.hdr.width; i++, lptr += ps, rptr += ps, dptr += ps)
+		{
+			int r = rptr[ri] - lptr[ri] + 128, g = rptr[gi] - lptr[gi] + 128,
+				b = rptr[bi] - lptr[bi] + 128;
+			outOfRange |= (r | g | b) & ~0xFF;
+			dptr[ri] = (unsigned char)r;  dptr[gi] = (unsigned char)g;
+			dptr[bi] = (unsigned char)b;
+		}
+	}
+	return wrap || !outOfRange;
+}
+
+
+unsigned char *CompressedFrame::getDeltaBuffer(Frame &f)
+{
+	unsigned long size = (unsigned long)f.hdr.width * f.hdr.height * f.pf->size;
+	if(size > deltaSize || !deltaBits)
+	{
+		delete [] deltaBits;  deltaBits = NULL;  deltaSize = 0;
+		_newcheck(deltaBits = new unsigned char[size]);
+		deltaSize = size;
+	}
+	return deltaBits;
+}
+
+
 CompressedFrame &CompressedFrame::operator= (Frame &f)
 {
 	if(!f.bits) _throw("Frame not initialized");
 	if(f.pf->size < 3 || f.pf->size > 4)
 		_throw("Only true color frames are supported");
 
+	// Solid and low-color tiles (backgrounds, UI elements, etc.) can be encoded
+	// losslessly using far fewer bytes and CPU cycles than JPEG.
+	if((f.flags & FRAME_ADAPTIVE) && !f.stereo && f.pf->bpc == 8
+		&& (f.hdr.compress == RRCOMP_JPEG || f.hdr.compress == RRCOMP_LOSSLESS))
+	{
+		unsigned int palette[RR_MAXPALETTE];
+		int nColors = getPalette(f, palette, RR_MAXPALETTE);
+		if(nColors > 0)
+		{
+			if(nColors > 1 && f.hdr.compress == RRCOMP_LOSSLESS)
+			{
+				compressLossless(f);
+				if(hdr.size <= paletteSize(f.hdr.width, f.hdr.height, nColors))
+					return *this;
+			}
+			compressPalette(f, palette, nColors);
+			return *this;
+		}
+	}
+
 	switch(f.hdr.compress)
 	{
 		case RRCOMP_RGB:  compressRGB(f);  break;
 		case RRCOMP_JPEG:  compressJPEG(f);  break;
 		case RRCOMP_YUV:  compressYUV(f);  break;
+		case RRCOMP_LOSSLESS:  compressLossless(f);  break;
 		default:  _throw("Invalid compression type");
 	}
 	return *this;
@@ -474,6 +861,27 @@ void CompressedFrame::compressJPEG(Frame &f)
 	hdr.size = (unsigned int)size;
 	if(f.stereo && f.rbits)
 	{
+		if(f.flags & FRAME_STEREODELTA)
+		{
+			// Predict the right eye from the left eye as the client will see it
+			// (that is, after it has been JPEG-compressed and decompressed), so
+			// that the client can reconstruct the right eye with no more error
+			// than if it had been sent in full.
+			unsigned char *delta = getDeltaBuffer(f);
+			int deltaPitch = f.hdr.width * f.pf->size;
+			if(!tjdhnd && !(tjdhnd = tjInitDecompress())) _throw(tjGetErrorStr());
+			_tj(tjDecompress2(tjdhnd, bits, hdr.size, delta, f.hdr.width,
+				deltaPitch, f.hdr.height, tjpf[f.pf->id], tjflags));
+			if(makeStereoDelta(f, delta, deltaPitch, delta, false))
+			{
+				init(f.hdr, RR_RIGHTDELTA);
+				_tj(tjCompress2(tjhnd, delta, f.hdr.width, deltaPitch, f.hdr.height,
+					tjpf[f.pf->id], &rbits, &size, TJSUBSAMP(f.hdr.subsamp),
+					f.hdr.qual, tjflags | TJFLAG_NOREALLOC));
+				rhdr.size = (unsigned int)size;
+				return;
+			}
+		}
 		init(f.hdr, RR_RIGHT);
 		if(rbits)
 			_tj(tjCompress2(tjhnd, f.rbits, f.hdr.width, f.pitch, f.hdr.height,
@@ -515,6 +923,142 @@ void CompressedFrame::compressRGB(Frame &f)
 }
 
 
+void CompressedFrame::compressLossless(Frame &f)
+{
+	unsigned char *srcptr;
+	bool bu = (f.flags & FRAME_BOTTOMUP);
+	unsigned long size = 0;
+
+	if(f.hdr.qual > LL_MAXEFFORT)
+		throw(Error("Lossless compressor", "Invalid argument"));
+	if(f.pf->bpc != 8)
+		throw(Error("Lossless compressor",
+			"Lossless compression requires 8 bits per component"));
+
+	// As with RGB encoding, the rows are always encoded in bottom-up order.
+	int srcStride = bu ? f.pitch : -f.pitch;
+	init(f.hdr, f.stereo ? RR_LEFT : 0);
+	srcptr = bu ? f.bits : &f.bits[f.pitch * (f.hdr.height - 1)];
+	unsigned char *refptr = NULL;  int refStride = 0;
+	if(f.ref && !f.stereo && f.ref->bits && f.ref->pf->id == f.pf->id
+		&& f.ref->hdr.width == f.hdr.width && f.ref->hdr.height == f.hdr.height)
+	{
+		bool refbu = (f.ref->flags & FRAME_BOTTOMUP);
+		refStride = refbu ? f.ref->pitch : -f.ref->pitch;
+		refptr = refbu ? f.ref->bits :
+			&f.ref->bits[f.ref->pitch * (f.hdr.height - 1)];
+	}
+	if(ll_encode(srcptr, f.hdr.width, srcStride, f.hdr.height, refptr,
+		refStride, f.pf, bits, &size, f.hdr.qual) == -1)
+		throw(Error("Lossless compressor", ll_geterr()));
+	hdr.size = (unsigned int)size;
+
+	// If the tile is incompressible (noise, for instance), then sending it as
+	// raw RGB is both smaller and cheaper to decode.
+	if(!f.stereo && size >= (unsigned long)f.hdr.width * f.hdr.height * 3)
+	{
+		f.hdr.compress = RRCOMP_RGB;
+		compressRGB(f);
+		f.hdr.compress = RRCOMP_LOSSLESS;
+		return;
+	}
+
+	if(f.stereo && f.rbits)
+	{
+		int buffer = RR_RIGHT;
+		srcptr = bu ? f.rbits : &f.rbits[f.pitch * (f.hdr.height - 1)];
+		if(f.flags & FRAME_STEREODELTA)
+		{
+			// The client will have the exact left eye, so the residual can be
+			// allowed to wrap around.
+			unsigned char *delta = getDeltaBuffer(f);
+			int deltaPitch = f.hdr.width * f.pf->size;
+			makeStereoDelta(f, f.bits, f.pitch, delta, true);
+			srcStride = bu ? deltaPitch : -deltaPitch;
+			srcptr = bu ? delta : &delta[deltaPitch * (f.hdr.height - 1)];
+			buffer = RR_RIGHTDELTA;
+		}
+		init(f.hdr, buffer);
+		if(rbits)
+		{
+			if(ll_encode(srcptr, f.hdr.width, srcStride, f.hdr.height, NULL, 0,
+				f.pf, rbits, &size, f.hdr.qual) == -1)
+				throw(Error("Lossless compressor", ll_geterr()));
+			rhdr.size = (unsigned int)size;
+		}
+	}
+}
+
+
+void CompressedFrame::compressPalette(Frame &f, unsigned int *palette,
+	int nColors)
+{
+	unsigned char *dstptr;
+	bool bu = (f.flags & FRAME_BOTTOMUP);
+	rrframeheader h = f.hdr;
+
+	h.compress = nColors == 1 ? RRCOMP_SOLID : RRCOMP_PALETTE;
+	init(h, 0);
+	if(nColors == 1) dstptr = bits;
+	else
+	{
+		bits[0] = (unsigned char)(nColors - 1);
+		dstptr = &bits[1];
+	}
+	for(int i = 0; i < nColors; i++, dstptr += 3)
+	{
+		unsigned char pixel[4];
+		if(f.pf->size == 4) memcpy(pixel, &palette[i], 4);
+		else
+		{
+			pixel[0] = palette[i] & 0xFF;  pixel[1] = (palette[i] >> 8) & 0xFF;
+			pixel[2] = (palette[i] >> 16) & 0xFF;
+		}
+		dstptr[0] = pixel[f.pf->rindex];
+		dstptr[1] = pixel[f.pf->gindex];
+		dstptr[2] = pixel[f.pf->bindex];
+	}
+	if(nColors == 1) { hdr.size = 3;  return; }
+
+	// As with RGB encoding, the rows are always encoded in bottom-up order.
+	unsigned int mask = f.pf->rmask | f.pf->gmask | f.pf->bmask;
+	int bpp = paletteBPP(nColors), rowSize = (f.hdr.width * bpp + 7) / 8;
+	int srcStride = bu ? f.pitch : -f.pitch, last = 0;
+	unsigned char *srcptr = bu ? f.bits : &f.bits[f.pitch * (f.hdr.height - 1)];
+	for(int j = 0; j < f.hdr.height; j++, srcptr += srcStride, dstptr += rowSize)
+	{
+		unsigned char *srcPixel = srcptr;
+		memset(dstptr, 0, rowSize);
+		for(int i = 0, shift = 8 - bpp; i < f.hdr.width;
+			i++, srcPixel += f.pf->size, shift -= bpp)
+		{
+			unsigned int value;
+			if(f.pf->size == 4) value = *(unsigned int *)srcPixel & mask;
+			else value = srcPixel[0] | (srcPixel[1] << 8) | (srcPixel[2] << 16);
+			if(value != palette[last])
+			{
+				for(last = 0; last < nColors - 1; last++)
+					if(palette[last] == value) break;
+			}
+			if(shift < 0) shift = 8 - bpp;
+			dstptr[i * bpp / 8] |= (unsigned char)(last << shift);
+		}
+	}
+	hdr.size = (unsigned int)paletteSize(f.hdr.width, f.hdr.height, nColors);
+}
+
+
+unsigned long CompressedFrame::bufSize(rrframeheader &h)
+{
+	unsigned long size = tjBufSize(h.width, h.height, h.subsamp);
+	if(h.compress == RRCOMP_LOSSLESS)
+		size = max(size, ll_bufsize(h.width, h.height));
+	else if(h.compress == RRCOMP_PALETTE)
+		size = max(size, paletteSize(h.width, h.height, RR_MAXPALETTE));
+	return size;
+}
+
+
 void CompressedFrame::init(rrframeheader &h, int buffer)
 {
 	checkHeader(h);
@@ -522,29 +1066,30 @@ void CompressedFrame::init(rrframeheader &h, int buffer)
 	switch(buffer)
 	{
 		case RR_LEFT:
-			if(h.width != hdr.width || h.height != hdr.height || !bits)
+			if(h.width != hdr.width || h.height != hdr.height
+				|| bufSize(h) > bufSize(hdr) || !bits)
 			{
 				if(bits) delete [] bits;
-				_newcheck(bits = new unsigned char[tjBufSize(h.width, h.height,
-					h.subsamp)]);
+				_newcheck(bits = new unsigned char[bufSize(h)]);
 			}
 			hdr = h;  hdr.flags = RR_LEFT;  stereo = true;
 			break;
 		case RR_RIGHT:
-			if(h.width != rhdr.width || h.height != rhdr.height || !rbits)
+		case RR_RIGHTDELTA:
+			if(h.width != rhdr.width || h.height != rhdr.height
+				|| bufSize(h) > bufSize(rhdr) || !rbits)
 			{
 				if(rbits) delete [] rbits;
-				_newcheck(rbits = new unsigned char[tjBufSize(h.width, h.height,
-					h.subsamp)]);
+				_newcheck(rbits = new unsigned char[bufSize(h)]);
 			}
-			rhdr = h;  rhdr.flags = RR_RIGHT;  stereo = true;
+			rhdr = h;  rhdr.flags = buffer;  stereo = true;
 			break;
 		default:
-			if(h.width != hdr.width || h.height != hdr.height || !bits)
+			if(h.width != hdr.width || h.height != hdr.height
+				|| bufSize(h) > bufSize(hdr) || !bits)
 			{
 				if(bits) delete [] bits;
-				_newcheck(bits = new unsigned char[tjBufSize(h.width, h.height,
-					h.subsamp)]);
+				_newcheck(bits = new unsigned char[bufSize(h)]);
 			}
 			hdr = h;  hdr.flags = 0;  stereo = false;
 			break;
@@ -574,6 +1119,9 @@ FBXFrame::FBXFrame(Display *dpy, Drawable draw, Visual *vis,
 FBXFrame::FBXFrame(char *dpystring, Window win) : Frame()
 {
 	init(dpystring, win);
+	// redraw() normally draws only the regions of the frame that have been
+	// updated, so it needs to know when the rest of the window must be redrawn.
+	XSelectInput(wh.dpy, win, ExposureMask);
 }
 
 
@@ -614,16 +1162,24 @@ FBXFrame::~FBXFrame(void)
 void FBXFrame::init(rrframeheader &h)
 {
 	checkHeader(h);
-	int usexshm = 1;  char *env = NULL;
+	// If we have our own display connection, then nothing else will process
+	// (and discard) the MIT-SHM completion events, so we can blit
+	// asynchronously.
+	int usexshm = reuseConn ? FBX_SHM : FBX_ASYNCSHM;  char *env = NULL;
 	if((env = getenv("VGL_USEXSHM")) != NULL && strlen(env) > 0
 		&& !strcmp(env, "0"))
-		usexshm = 0;
+		usexshm = FBX_NOSHM;
+	// Don't modify the buffer until the X server has finished reading it.
+	_fbx(fbx_wait(&fb));
+	char *oldBits = fb.bits;  int oldWidth = fb.width, oldHeight = fb.height;
 	_fbx(fbx_init(&fb, wh, h.framew, h.frameh, usexshm));
 	if(h.framew > fb.width || h.frameh > fb.height)
 	{
 		XSync(wh.dpy, False);
 		_fbx(fbx_init(&fb, wh, h.framew, h.frameh, usexshm));
 	}
+	if(fb.bits != oldBits || fb.width != oldWidth || fb.height != oldHeight)
+		allDirty = true;
 	hdr = h;
 	if(hdr.framew > fb.width) hdr.framew = fb.width;
 	if(hdr.frameh > fb.height) hdr.frameh = fb.height;
@@ -648,6 +1204,13 @@ FBXFrame &FBXFrame::operator= (CompressedFrame &cf)
 		&& cf.hdr.height <= height)
 	{
 		if(cf.hdr.compress == RRCOMP_RGB) decompressRGB(cf, width, height, false);
+		else if(cf.hdr.compress == RRCOMP_LOSSLESS)
+			decompressLossless(cf, width, height, false);
+		else if(cf.hdr.compress == RRCOMP_SOLID
+			|| cf.hdr.compress == RRCOMP_PALETTE)
+			decompressPalette(cf, width, height);
+		else if(cf.hdr.compress == RRCOMP_COPYRECT)
+			copyRect(cf, width, height);
 		else
 		{
 			if(pf->bpc != 8)
@@ -662,15 +1225,53 @@ FBXFrame &FBXFrame::operator= (CompressedFrame &cf)
 				(unsigned char *)&fb.bits[fb.pitch * cf.hdr.y + cf.hdr.x * pf->size],
 				width, fb.pitch, height, tjpf[pf->id], tjflags));
 		}
+		addDirtyRect(cf.hdr.x, cf.hdr.y, width, height);
 	}
 	return *this;
 }
 
 
+// If the frame was populated using operator=(), then only the regions that
+// were updated since the last call to redraw() are drawn (unless the window
+// was exposed or the frame buffer was reallocated.)  Otherwise, the entire
+// frame is drawn.  If MIT-SHM is in use, then this may return before the X
+// server has finished drawing the frame.  Use sync() to wait for it.
+
 void FBXFrame::redraw(void)
 {
+	XEvent event;
+
 	if(flags & FRAME_BOTTOMUP) _fbx(fbx_flip(&fb, 0, 0, 0, 0));
-	_fbx(fbx_write(&fb, 0, 0, 0, 0, fb.width, fb.height));
+	while(XCheckTypedWindowEvent(wh.dpy, wh.d, Expose, &event)) allDirty = true;
+	if(!dirty || allDirty || (flags & FRAME_BOTTOMUP))
+	{
+		_fbx(fbx_awrite(&fb, 0, 0, 0, 0, fb.width, fb.height));
+		_fbx(fbx_flush(&fb));
+	}
+	else if(nDirty > 0)
+	{
+		mergeDirtyRects();
+		for(int i = 0; i < nDirty; i++)
+			_fbx(fbx_awrite(&fb, dirty[i].x, dirty[i].y, dirty[i].x, dirty[i].y,
+				dirty[i].width, dirty[i].height));
+		_fbx(fbx_flush(&fb));
+	}
+	nDirty = 0;  allDirty = false;
+}
+
+
+void FBXFrame::sync(void)
+{
+	_fbx(fbx_wait(&fb));
+}
+
+
+bool FBXFrame::isBusy(void)
+{
+	int ret;
+
+	_fbx(ret = fbx_busy(&fb));
+	return ret == 1;
 }
 
 
@@ -24,16 +24,23 @@
 #include "fbxv.h"
 #endif
 #include "pf.h"
+#include "lossless.h"
 
 
 // Flags
 #define FRAME_BOTTOMUP  1  // Bottom-up bitmap (as opposed to top-down)
+#define FRAME_ADAPTIVE  2  // Encode solid/low-color tiles using RRCOMP_SOLID or
+                           // RRCOMP_PALETTE
+#define FRAME_STEREODELTA  4  // Encode the right eye of stereo tiles as the
+                              // difference between the right and left eyes
 
 
 // Uncompressed frame
 
 namespace vglcommon
 {
+	class CompressedFrame;
+
 	class Frame
 	{
 		public:
@@ -47,6 +54,8 @@ namespace vglcommon
 			void deInit(void);
 			Frame *getTile(int x, int y, int width, int height);
 			bool tileEquals(Frame *last, int x, int y, int width, int height);
+			bool tileEquals(Frame *last, int x, int y, int width, int height,
+				int srcX, int srcY);
 			void makeAnaglyph(Frame &r, Frame &g, Frame &b);
 			void makePassive(Frame &stf, int mode);
 			void signalReady(void) { ready.signal(); }
@@ -55,14 +64,44 @@ namespace vglcommon
 			void waitUntilComplete(void) { complete.wait(); }
 			bool isComplete(void) { return !complete.isLocked(); }
 			void decompressRGB(Frame &f, int width, int height, bool rightEye);
+			void decompressLossless(CompressedFrame &cf, int width, int height,
+				bool rightEye);
+			void decompressPalette(CompressedFrame &cf, int width, int height);
+			void addStereoDelta(CompressedFrame &cf, int width, int height);
+			void copyRect(int srcX, int srcY, int x, int y, int width, int height);
+			void copyRect(CompressedFrame &cf, int width, int height);
 			void addLogo(void);
 
+			// Maximum number of updated rectangles that are tracked individually
+			static const int MAXDIRTY = 1024;
+
+			typedef struct { int x, y, width, height; } Rect;
+
+			void addDirtyRect(int x, int y, int width, int height);
+			void mergeDirtyRects(void);
+
 			rrframeheader hdr;
 			unsigned char *bits;
 			unsigned char *rbits;
 			int pitch, flags;
 			PF *pf;
 			bool isGL, isXV, stereo;
+			// The tile as the receiver currently has it (NULL = unknown.)  The
+			// lossless codec uses this as the reference image for its previous-frame
+			// filter.
+			Frame *ref;
+			// Regions of the frame that have been updated (if allDirty is true,
+			// then the entire frame should be considered updated)
+			Rect *dirty;  int nDirty;  bool allDirty;
+			// Used to measure the latency of each stage of the image pipeline.
+			// captureTime and readbackTime are the times at which VirtualGL began
+			// and finished reading back the frame, and queueTime is the time at
+			// which the frame was queued for transport (all relative to the local
+			// clock, 0 = unknown.)  seq and captureTime are passed from the server
+			// to the client after the End-of-Frame header, and recvTime is the
+			// amount of time that the client spent receiving the frame.
+			unsigned int seq;
+			double captureTime, readbackTime, queueTime, recvTime;
 
 		protected:
 
@@ -91,13 +130,20 @@ namespace vglcommon
 			void compressYUV(Frame &f);
 			void compressJPEG(Frame &f);
 			void compressRGB(Frame &f);
+			void compressLossless(Frame &f);
+			void compressPalette(Frame &f, unsigned int *palette, int nColors);
 			void init(rrframeheader &h, int buffer);
 
 			rrframeheader rhdr;
 
 		private:
 
-			tjhandle tjhnd;
+			unsigned long bufSize(rrframeheader &h);
+			unsigned char *getDeltaBuffer(Frame &f);
+
+			tjhandle tjhnd, tjdhnd;
+			// Scratch buffer used to compute the right eye residual
+			unsigned char *deltaBits;  unsigned long deltaSize;
 			friend class FBXFrame;
 	};
 }
@@ -120,6 +166,8 @@ namespace vglcommon
 			void init(rrframeheader &h);
 			FBXFrame &operator= (CompressedFrame &cf);
 			void redraw(void);
+			void sync(void);
+			bool isBusy(void);
 
 		private:
 
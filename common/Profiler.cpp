@@ -14,21 +14,248 @@
  */
 
 #include "Profiler.h"
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #ifdef _MSC_VER
 #define snprintf  _snprintf
 #define strdup  _strdup
+#include <process.h>
+#define getpid  _getpid
+#else
+#include <unistd.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #endif
 #include "Timer.h"
 #include "Log.h"
+#include "Mutex.h"
 
+using namespace vglutil;
 using namespace vglcommon;
 
 
+// Process-wide state for exporting metrics.  The mutex protects only the
+// registration of metrics and the metrics file.  Samples are recorded without
+// locking.
+
+static CriticalSection metricsMutex;
+static bool metricsInit = false;
+static FILE *metricsFile = NULL;
+static VGLStatsHeader *statsSeg = NULL;
+static char statsName[64];
+static int statsPid = 0, nProfilers = 0;
+
+
+#ifndef _WIN32
+
+static void removeStatsSegment(void)
+{
+	if(statsSeg && getpid() == statsPid) shm_unlink(statsName);
+}
+
+
+// A child process inherits the mapping of the parent's stats segment.  Replace
+// it with private memory, so the child's profilers don't corrupt the parent's
+// metrics.
+
+static void detachStatsSegment(void)
+{
+	if(statsSeg)
+		mmap(statsSeg, sizeof(VGLStatsHeader), PROT_READ | PROT_WRITE,
+			MAP_PRIVATE | MAP_ANON | MAP_FIXED, -1, 0);
+}
+
+
+static void createStatsSegment(void)
+{
+	int fd;  void *ptr;
+
+	statsPid = getpid();
+	snprintf(statsName, 64, "/vgl-stats-%d", statsPid);
+	shm_unlink(statsName);
+	if((fd = shm_open(statsName, O_RDWR | O_CREAT | O_EXCL, 0600)) == -1)
+	{
+		vglout.println("[VGL] WARNING: Could not create stats segment %s",
+			statsName);
+		return;
+	}
+	if(ftruncate(fd, sizeof(VGLStatsHeader)) == -1
+		|| (ptr = mmap(NULL, sizeof(VGLStatsHeader), PROT_READ | PROT_WRITE,
+			MAP_SHARED, fd, 0)) == MAP_FAILED)
+	{
+		vglout.println("[VGL] WARNING: Could not map stats segment %s",
+			statsName);
+		close(fd);  shm_unlink(statsName);
+		return;
+	}
+	close(fd);
+
+	statsSeg = (VGLStatsHeader *)ptr;
+	statsSeg->version = VGLSTATS_VERSION;
+	statsSeg->pid = statsPid;
+	statsSeg->startTime = getTime();
+	__sync_synchronize();
+	statsSeg->magic = VGLSTATS_MAGIC;
+	atexit(removeStatsSegment);
+	pthread_atfork(NULL, NULL, detachStatsSegment);
+}
+
+#endif
+
+
+// Returns true if either method of exporting metrics is enabled
+
+static bool initMetrics(void)
+{
+	CriticalSection::SafeLock l(metricsMutex);
+
+	if(!metricsInit)
+	{
+		char *env;
+		if((env = getenv("VGL_METRICS")) != NULL && strlen(env) > 0)
+		{
+			if(!strcmp(env, "-")) metricsFile = stderr;
+			else if((metricsFile = fopen(env, "a")) == NULL)
+				vglout.println("[VGL] WARNING: Could not open metrics file %s", env);
+		}
+		#ifndef _WIN32
+		if((env = getenv("VGL_STATS")) != NULL && !strncmp(env, "1", 1))
+			createStatsSegment();
+		#endif
+		metricsInit = true;
+	}
+	return metricsFile != NULL || statsSeg != NULL;
+}
+
+
+static int newProfilerID(void)
+{
+	CriticalSection::SafeLock l(metricsMutex);
+	return nProfilers++;
+}
+
+
+// The name of a metric is the name of the profiler (without padding),
+// optionally prefixed with the name of a LatencyProfiler
+
+static void getMetricName(char *temps, const char *prefix, const char *name)
+{
+	int i = 0;
+
+	if(prefix)
+	{
+		snprintf(temps, VGLSTATS_NAMELEN - 2, "%s", prefix);
+		for(i = strlen(temps); i > 0 && temps[i - 1] == ' '; i--) {}
+		temps[i++] = '/';
+	}
+	snprintf(&temps[i], VGLSTATS_NAMELEN - i, "%s", name);
+	for(i = strlen(temps); i > 0 && temps[i - 1] == ' '; i--) temps[i - 1] = 0;
+}
+
+
+// Assign a metric in the stats segment to a profiler.  A metric that belonged
+// to a profiler with the same name that no longer exists is reused, so the
+// metric accumulates the statistics of both profilers.
+
+static VGLStatsMetric *registerMetric(const char *prefix, const char *name)
+{
+	char temps[VGLSTATS_NAMELEN];
+	VGLStatsMetric *metric = NULL;
+
+	if(!statsSeg || !name) return NULL;
+	getMetricName(temps, prefix, name);
+
+	CriticalSection::SafeLock l(metricsMutex);
+
+	for(int i = 0; i < statsSeg->nMetrics; i++)
+	{
+		if(!statsSeg->metrics[i].active
+			&& !strcmp(statsSeg->metrics[i].name, temps))
+		{
+			metric = &statsSeg->metrics[i];  break;
+		}
+	}
+	if(!metric && statsSeg->nMetrics < VGLSTATS_MAXMETRICS)
+	{
+		metric = &statsSeg->metrics[statsSeg->nMetrics];
+		strncpy(metric->name, temps, VGLSTATS_NAMELEN);
+		__sync_synchronize();
+		statsSeg->nMetrics++;
+	}
+	if(metric) metric->active = 1;
+	return metric;
+}
+
+
+static void releaseMetric(VGLStatsMetric *metric)
+{
+	CriticalSection::SafeLock l(metricsMutex);
+	if(metric) metric->active = 0;
+}
+
+
+static void addToHist(VGLStatsHist &h, double seconds)
+{
+	if(seconds < 0.) seconds = 0.;
+	h.hist[vglstats_bucket(seconds * 1000000.)]++;
+	h.count++;  h.sum += seconds;
+	if(seconds > h.max) h.max = seconds;
+}
+
+
+// Update a metric in the stats segment.  nSamples is 0 if only the pixel and
+// byte counters should be updated.
+
+static void updateMetric(VGLStatsMetric *metric, int nSamples, double seconds,
+	long pixels, long bytes)
+{
+	if(!metric) return;
+	metric->seq++;
+	__sync_synchronize();
+	if(nSamples) addToHist(metric->hist, seconds);
+	metric->hist.pixels += pixels;  metric->hist.bytes += bytes;
+	__sync_synchronize();
+	metric->seq++;
+}
+
+
+// Write the statistics for one reporting interval to the metrics file as a
+// JSON object on a single line
+
+static void writeMetrics(const char *prefix, const char *name, int id,
+	double busyTime, double frames, double mpixels, double mbytes,
+	VGLStatsHist &h)
+{
+	char temps[VGLSTATS_NAMELEN];
+
+	if(!metricsFile || !name) return;
+	getMetricName(temps, prefix, name);
+
+	CriticalSection::SafeLock l(metricsMutex);
+
+	fprintf(metricsFile, "{\"time\": %.6f, \"pid\": %d, \"profiler\": %d, \"metric\": \"%s\"",
+		getTime(), (int)getpid(), id, temps);
+	if(busyTime > 0.)
+		fprintf(metricsFile, ", \"fps\": %.3f, \"mpixels_per_sec\": %.3f, \"mbits_per_sec\": %.3f",
+			frames / busyTime, mpixels / busyTime, mbytes * 8. / busyTime);
+	fprintf(metricsFile, ", \"frames\": %llu", h.count);
+	if(h.count)
+		fprintf(metricsFile, ", \"avg_ms\": %.3f, \"p50_ms\": %.3f, \"p95_ms\": %.3f, \"p99_ms\": %.3f, \"max_ms\": %.3f",
+			h.sum / (double)h.count * 1000.,
+			vglstats_percentile(&h, 0.5) * 1000.,
+			vglstats_percentile(&h, 0.95) * 1000.,
+			vglstats_percentile(&h, 0.99) * 1000., h.max * 1000.);
+	fprintf(metricsFile, "}\n");
+	fflush(metricsFile);
+}
+
+
 Profiler::Profiler(const char *name_, double interval_) : interval(interval_),
 	mbytes(0.0), mpixels(0.0), totalTime(0.0), start(0.0), frames(0),
-	lastFrame(0.0)
+	lastFrame(0.0), frameTime(0.0), frameFrac(0.0), metric(NULL), id(0)
 {
 	profile = false;  char *ev = NULL;
 	setName(name_);  freestr = false;
@@ -36,11 +263,14 @@ Profiler::Profiler(const char *name_, double interval_) : interval(interval_),
 		profile = true;
 	if((ev = getenv("VGL_PROFILE")) != NULL && !strncmp(ev, "1", 1))
 		profile = true;
+	if((exportMetrics = initMetrics()) == true) id = newProfilerID();
+	memset(&hist, 0, sizeof(VGLStatsHist));
 }
 
 
 Profiler::~Profiler(void)
 {
+	if(metric) releaseMetric(metric);
 	if(name && freestr) free(name);
 }
 
@@ -62,14 +292,32 @@ void Profiler::setName(const char *name_)
 
 void Profiler::startFrame(void)
 {
-	if(!profile) return;
+	if(!profile && !exportMetrics) return;
 	start = timer.time();
 }
 
 
+// Record the time that was spent processing one frame.  If the profiler
+// measures a fraction of a frame at a time (for instance, one tile or one eye),
+// then the times are accumulated until an entire frame has been processed.
+
+void Profiler::addSample(long pixels, long bytes)
+{
+	if(!metric && name) metric = registerMetric(NULL, name);
+	if(frameFrac < 0.999)
+	{
+		updateMetric(metric, 0, 0., pixels, bytes);
+		return;
+	}
+	addToHist(hist, frameTime);
+	updateMetric(metric, 1, frameTime, pixels, bytes);
+	frameTime = frameFrac = 0.;
+}
+
+
 void Profiler::endFrame(long pixels, long bytes, double incFrames)
 {
-	if(!profile) return;
+	if(!profile && !exportMetrics) return;
 	double now = timer.time();
 	if(start != 0.0)
 	{
@@ -77,10 +325,24 @@ void Profiler::endFrame(long pixels, long bytes, double incFrames)
 		if(pixels) mpixels += (double)pixels / 1000000.;
 		if(bytes) mbytes += (double)bytes / 1000000.;
 		if(incFrames != 0.0) frames += incFrames;
+		if(exportMetrics)
+		{
+			frameTime += now - start;  frameFrac += incFrames;
+			addSample(pixels, bytes);
+		}
 	}
 	if(lastFrame == 0.0) lastFrame = now;
 	if(totalTime > interval || (now - lastFrame) > interval)
 	{
+		if(exportMetrics)
+			writeMetrics(NULL, name, id, totalTime, frames, mpixels, mbytes, hist);
+		memset(&hist, 0, sizeof(VGLStatsHist));
+		if(!profile)
+		{
+			totalTime = 0.;  mpixels = 0.;  frames = 0.;  mbytes = 0.;
+			lastFrame = now;
+			return;
+		}
 		char temps[256];  size_t i = 0;
 		snprintf(&temps[i], 255 - i, "%s  ", name);  i = strlen(temps);
 		if(mpixels)
@@ -104,3 +366,66 @@ void Profiler::endFrame(long pixels, long bytes, double incFrames)
 		lastFrame = now;
 	}
 }
+
+
+LatencyProfiler::LatencyProfiler(const char *name_, int nStages_,
+	const char **stageNames_, double interval_) : name(name_), nStages(0),
+	interval(interval_), lastReport(0.), id(0)
+{
+	profile = false;  char *ev = NULL;
+	if((ev = getenv("RRPROFILE")) != NULL && !strncmp(ev, "1", 1))
+		profile = true;
+	if((ev = getenv("VGL_PROFILE")) != NULL && !strncmp(ev, "1", 1))
+		profile = true;
+	if((exportMetrics = initMetrics()) == true) id = newProfilerID();
+	if(nStages_ > MAXSTAGES) nStages_ = MAXSTAGES;
+	for(int i = 0; i < nStages_; i++) stageNames[i] = stageNames_[i];
+	nStages = nStages_;
+	memset(hist, 0, sizeof(hist));  memset(metrics, 0, sizeof(metrics));
+}
+
+
+LatencyProfiler::~LatencyProfiler(void)
+{
+	for(int i = 0; i < nStages; i++)
+		if(metrics[i]) releaseMetric(metrics[i]);
+}
+
+
+void LatencyProfiler::addSample(int stage, double seconds)
+{
+	if((!profile && !exportMetrics) || stage < 0 || stage >= nStages) return;
+
+	addToHist(hist[stage], seconds);
+	if(exportMetrics)
+	{
+		if(!metrics[stage])
+			metrics[stage] = registerMetric(name, stageNames[stage]);
+		updateMetric(metrics[stage], 1, seconds, 0, 0);
+	}
+}
+
+
+void LatencyProfiler::endFrame(void)
+{
+	if(!profile && !exportMetrics) return;
+	double now = getTime();
+	if(lastReport == 0.) lastReport = now;
+	if(now - lastReport < interval) return;
+
+	for(int i = 0; i < nStages; i++)
+	{
+		VGLStatsHist &h = hist[i];
+		if(!h.count) continue;
+		if(profile)
+			vglout.PRINT("%s - %-10s avg %8.3f - p50 %8.3f - p95 %8.3f - p99 %8.3f - max %8.3f ms\n",
+				name, stageNames[i], h.sum / (double)h.count * 1000.,
+				vglstats_percentile(&h, 0.5) * 1000.,
+				vglstats_percentile(&h, 0.95) * 1000.,
+				vglstats_percentile(&h, 0.99) * 1000., h.max * 1000.);
+		if(exportMetrics)
+			writeMetrics(name, stageNames[i], id, 0., 0., 0., 0., h);
+	}
+	memset(hist, 0, sizeof(hist));
+	lastReport = now;
+}
@@ -17,10 +17,17 @@
 #define __PROFILER_H__
 
 #include "Timer.h"
+#include "vglstats.h"
 
 
 namespace vglcommon
 {
+	// In addition to printing to the log when VGL_PROFILE=1, the profilers can
+	// export a histogram of the per-frame latency as JSON lines (VGL_METRICS) or
+	// into a shared memory segment that vglstat can read (VGL_STATS).  Each
+	// profiler is used by only one thread, so no locking is necessary when
+	// recording a sample.
+
 	class Profiler
 	{
 		public:
@@ -34,12 +41,50 @@ namespace vglcommon
 
 		private:
 
+			void addSample(long pixels, long bytes);
+
 			char *name;
 			double interval;
 			double mbytes, mpixels, totalTime, start, frames, lastFrame;
-			bool profile;
+			bool profile, exportMetrics;
 			vglutil::Timer timer;
 			bool freestr;
+			// Partial frames (tiles or eyes) that have been processed since the
+			// last sample
+			double frameTime, frameFrac;
+			VGLStatsHist hist;
+			VGLStatsMetric *metric;
+			int id;
+	};
+
+
+	// Tracks the distribution of the per-frame latency of each stage of the
+	// image pipeline and periodically reports the average, median, 95th
+	// percentile, 99th percentile, and maximum latency of each stage
+
+	class LatencyProfiler
+	{
+		public:
+
+			static const int MAXSTAGES = 8;
+
+			LatencyProfiler(const char *name, int nStages, const char **stageNames,
+				double interval = 2.0);
+			~LatencyProfiler(void);
+			bool isEnabled(void) { return profile || exportMetrics; }
+			void addSample(int stage, double seconds);
+			void endFrame(void);
+
+		private:
+
+			const char *name;
+			int nStages;
+			const char *stageNames[MAXSTAGES];
+			double interval, lastReport;
+			VGLStatsHist hist[MAXSTAGES];
+			VGLStatsMetric *metrics[MAXSTAGES];
+			int id;
+			bool profile, exportMetrics;
 	};
 }
 
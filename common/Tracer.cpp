@@ -0,0 +1,172 @@
+/* Copyright (C)2018 D. R. Commander
+ *
+ * This library is free software and may be redistributed and/or modified under
+ * the terms of the wxWindows Library License, Version 3.1 or (at your option)
+ * any later version.  The full license is in the LICENSE.txt file included
+ * with this distribution.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * wxWindows Library License for more details.
+ */
+
+#include "Tracer.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include "Log.h"
+#include "Mutex.h"
+
+using namespace vglutil;
+using namespace vglcommon;
+
+
+// The number of events kept for each thread (must be a power of 2)
+#define NEVENTS  65536
+
+
+typedef struct
+{
+	const char *name;
+	double start, end;
+	long arg;
+	bool instant;
+} TraceEvent;
+
+
+typedef struct _TraceBuffer
+{
+	TraceEvent events[NEVENTS];
+	// The total number of events that the thread has recorded.  Only the last
+	// NEVENTS of them are still in the buffer.
+	volatile unsigned long long count;
+	int tid;
+	char name[64];
+	struct _TraceBuffer *next;
+} TraceBuffer;
+
+
+bool Tracer::enabled = false;
+static CriticalSection traceMutex;
+static TraceBuffer *buffers = NULL;
+static int nBuffers = 0, tracePid = 0;
+static pthread_key_t bufferKey;
+static char traceFileName[1024];
+static double traceStart = 0.;
+
+
+void Tracer::init(const char *fileName)
+{
+	CriticalSection::SafeLock l(traceMutex);
+
+	if(enabled || !fileName || strlen(fileName) < 1) return;
+	if(pthread_key_create(&bufferKey, NULL))
+	{
+		vglout.println("[VGL] WARNING: Could not enable tracing");
+		return;
+	}
+	snprintf(traceFileName, 1024, "%s", fileName);
+	tracePid = getpid();
+	traceStart = getTime();
+	atexit(Tracer::write);
+	enabled = true;
+}
+
+
+// Each thread allocates its own buffer the first time it records an event.
+// The buffers are not freed when the threads exit, so that their events can be
+// written to the trace file.
+
+static TraceBuffer *getBuffer(void)
+{
+	TraceBuffer *buf = (TraceBuffer *)pthread_getspecific(bufferKey);
+
+	if(!buf)
+	{
+		if((buf = (TraceBuffer *)calloc(1, sizeof(TraceBuffer))) == NULL)
+			return NULL;
+		CriticalSection::SafeLock l(traceMutex);
+		buf->tid = ++nBuffers;
+		snprintf(buf->name, 64, "Thread %d", buf->tid);
+		buf->next = buffers;  buffers = buf;
+		pthread_setspecific(bufferKey, buf);
+	}
+	return buf;
+}
+
+
+void Tracer::recordEvent(const char *name, double start, double end,
+	long arg, bool instant)
+{
+	TraceBuffer *buf = getBuffer();
+	if(!buf) return;
+
+	TraceEvent *e = &buf->events[buf->count & (NEVENTS - 1)];
+	e->name = name;  e->start = start;  e->end = end;  e->arg = arg;
+	e->instant = instant;
+	__sync_synchronize();
+	buf->count++;
+}
+
+
+void Tracer::setThreadName(const char *name)
+{
+	if(!enabled || !name) return;
+	TraceBuffer *buf = getBuffer();
+	if(buf) snprintf(buf->name, 64, "%s", name);
+}
+
+
+void Tracer::write(void)
+{
+	CriticalSection::SafeLock l(traceMutex);
+	FILE *file;  unsigned long long nEvents = 0, nLost = 0;
+
+	// A child process inherits the parent's trace buffers, but only the parent
+	// writes the trace file.
+	if(!enabled || getpid() != tracePid) return;
+	enabled = false;
+
+	if((file = fopen(traceFileName, "w")) == NULL)
+	{
+		vglout.println("[VGL] WARNING: Could not open trace file %s",
+			traceFileName);
+		return;
+	}
+	fprintf(file, "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n");
+	fprintf(file, "{\"name\": \"process_name\", \"ph\": \"M\", \"pid\": %d, \"tid\": 0, \"args\": {\"name\": \"VirtualGL (%d)\"}}",
+		tracePid, tracePid);
+	for(TraceBuffer *buf = buffers; buf; buf = buf->next)
+	{
+		unsigned long long first = 0, count = buf->count;
+		if(count > NEVENTS)
+		{
+			first = count - NEVENTS;  nLost += first;
+		}
+		fprintf(file, ",\n{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": %d, \"tid\": %d, \"args\": {\"name\": \"%s\"}}",
+			tracePid, buf->tid, buf->name);
+		for(unsigned long long i = first; i < count; i++)
+		{
+			TraceEvent *e = &buf->events[i & (NEVENTS - 1)];
+			if(!e->name) continue;
+			fprintf(file, ",\n{\"name\": \"%s\", \"cat\": \"vgl\", \"pid\": %d, \"tid\": %d, \"ts\": %.3f",
+				e->name, tracePid, buf->tid, (e->start - traceStart) * 1000000.);
+			if(e->instant) fprintf(file, ", \"ph\": \"i\", \"s\": \"t\"");
+			else
+				fprintf(file, ", \"ph\": \"X\", \"dur\": %.3f",
+					(e->end - e->start) * 1000000.);
+			if(e->arg >= 0) fprintf(file, ", \"args\": {\"arg\": %ld}", e->arg);
+			fprintf(file, "}");
+			nEvents++;
+		}
+	}
+	fprintf(file, "\n]}\n");
+	fclose(file);
+	vglout.println("[VGL] Wrote %llu trace events to %s", nEvents,
+		traceFileName);
+	if(nLost)
+		vglout.println("[VGL]    (%llu older events were discarded)", nLost);
+}
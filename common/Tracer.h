@@ -0,0 +1,98 @@
+/* Copyright (C)2018 D. R. Commander
+ *
+ * This library is free software and may be redistributed and/or modified under
+ * the terms of the wxWindows Library License, Version 3.1 or (at your option)
+ * any later version.  The full license is in the LICENSE.txt file included
+ * with this distribution.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * wxWindows Library License for more details.
+ */
+
+#ifndef __TRACER_H__
+#define __TRACER_H__
+
+#include "Timer.h"
+
+
+namespace vglcommon
+{
+	// Records timed events (interposed calls and stages of the image pipeline)
+	// into a ring buffer for each thread and, when the process exits, writes
+	// them to a file in the Chrome trace event format, which can be viewed in
+	// chrome://tracing or the Perfetto UI.  Recording an event does not
+	// require a lock or any formatting, and only the most recent events for
+	// each thread are kept.  Event names must be string literals, since only
+	// the pointers are stored.
+
+	class Tracer
+	{
+		public:
+
+			// Enable tracing.  This should be called before the threads that are
+			// to be traced are created.
+			static void init(const char *fileName);
+
+			static bool isEnabled(void) { return enabled; }
+
+			// Record an event that started at the specified time (as returned by
+			// getTime()) and ended now.  arg (for instance, a frame or tile number)
+			// is included in the event if it is >= 0.
+			static void record(const char *name, double start, long arg = -1)
+			{
+				if(enabled) recordEvent(name, start, getTime(), arg);
+			}
+
+			// Record an instantaneous event (for instance, a spoiled frame)
+			static void instant(const char *name, long arg = -1)
+			{
+				if(enabled)
+				{
+					double now = getTime();
+					recordEvent(name, now, now, arg, true);
+				}
+			}
+
+			// Name the calling thread in the timeline
+			static void setThreadName(const char *name);
+
+			// Write the trace file.  This is called automatically when the process
+			// exits.
+			static void write(void);
+
+		private:
+
+			static void recordEvent(const char *name, double start, double end,
+				long arg, bool instant = false);
+
+			static bool enabled;
+	};
+
+
+	// Records an event that spans the lifetime of the object
+
+	class TraceScope
+	{
+		public:
+
+			TraceScope(const char *name_, long arg_ = -1) : name(name_), arg(arg_),
+				start(Tracer::isEnabled() ? getTime() : 0.)
+			{
+			}
+
+			~TraceScope(void)
+			{
+				if(start > 0.) Tracer::record(name, start, arg);
+			}
+
+		private:
+
+			const char *name;
+			long arg;
+			double start;
+	};
+}
+
+#endif  // __TRACER_H__
@@ -32,7 +32,7 @@ using namespace vglcommon;
 #define NUMWIN  1
 
 bool useGL = false, useXV = false, doRgbBench = false, useRGB = false,
-	addLogo = false, anaglyph = false, check = false;
+	useLossless = false, addLogo = false, anaglyph = false, check = false;
 
 
 void resizeWindow(Display *dpy, Window win, int width, int height, int myID)
@@ -325,6 +325,10 @@ class Compressor : public Runnable
 			hdr.qual = 80;
 			hdr.subsamp = 2;
 			hdr.compress = useRGB ? RRCOMP_RGB : RRCOMP_JPEG;
+			if(useLossless)
+			{
+				hdr.compress = RRCOMP_LOSSLESS;  hdr.qual = LL_MAXEFFORT;
+			}
 			if(useXV) hdr.compress = RRCOMP_YUV;
 			frame.init(hdr, pixelFormat, 0);
 			return frame;
@@ -583,6 +587,316 @@ void rgbBench(char *filename)
 }
 
 
+// Return a pointer to the pixel at (x, y), relative to the upper left corner
+// of the frame, in the given eye buffer of the frame
+
+static unsigned char *pixelPtr(Frame &f, unsigned char *buf, int x, int y)
+{
+	if(f.flags & FRAME_BOTTOMUP) y = f.hdr.frameh - y - 1;
+	return &buf[f.pitch * y + x * f.pf->size];
+}
+
+
+#define TILEX  5
+#define TILEY  3
+#define TILEW  37
+#define TILEH  23
+
+// Encode a tile with 1-17 colors using adaptive tile encoding, decode it the
+// way the VirtualGL Client does, and make sure that the result is
+// pixel-perfect.  This is done for every combination of source and
+// destination pixel format and row order.
+
+void checkAdaptive(void)
+{
+	static const int colors[] = { 1, 2, 3, 5, RR_MAXPALETTE, RR_MAXPALETTE + 1 };
+
+	for(int srcFormat = 0; srcFormat < PIXELFORMATS; srcFormat++)
+	{
+		PF *srcpf = pf_get(srcFormat);
+		if(srcpf->bpc != 8 || srcpf->size < 3) continue;
+		fprintf(stderr, "Adaptive tile encoding (%s): ", srcpf->name);
+
+		for(int dstFormat = 0; dstFormat < PIXELFORMATS; dstFormat++)
+		{
+			PF *dstpf = pf_get(dstFormat);
+			if(dstpf->bpc != 8 || dstpf->size < 3) continue;
+
+			for(int bu = 0; bu < 4; bu++)
+			{
+				for(int c = 0; c < (int)(sizeof(colors) / sizeof(int)); c++)
+				{
+					int nColors = colors[c], i, j, r, g, b;
+					Frame src, dst;  CompressedFrame cf;
+					rrframeheader hdr;
+
+					memset(&hdr, 0, sizeof(hdr));
+					hdr.width = hdr.framew = TILEX + TILEW + 4;
+					hdr.height = hdr.frameh = TILEY + TILEH + 2;
+					hdr.compress = RRCOMP_JPEG;  hdr.qual = 80;  hdr.subsamp = 1;
+					src.init(hdr, srcFormat,
+						FRAME_ADAPTIVE | (bu & 1 ? FRAME_BOTTOMUP : 0));
+					for(j = 0; j < src.hdr.frameh; j++)
+					{
+						for(i = 0; i < src.hdr.framew; i++)
+						{
+							int index = (i / 3 + j * 5) % nColors;
+							srcpf->setRGB(pixelPtr(src, src.bits, i, j), index * 37 % 256,
+								index * 91 % 256, (index * 151 + 11) % 256);
+						}
+					}
+
+					Frame *tile = src.getTile(TILEX, TILEY, TILEW, TILEH);
+					cf = *tile;
+					delete tile;
+					int compress = nColors == 1 ? RRCOMP_SOLID :
+						(nColors <= RR_MAXPALETTE ? RRCOMP_PALETTE : RRCOMP_JPEG);
+					if(cf.hdr.compress != compress)
+						_throw("Tile was encoded using the wrong encoding type");
+					if(compress == RRCOMP_JPEG) continue;
+
+					hdr = cf.hdr;
+					dst.init(hdr, dstFormat, bu & 2 ? FRAME_BOTTOMUP : 0);
+					dst.decompressPalette(cf, TILEW, TILEH);
+					for(j = 0; j < TILEH; j++)
+					{
+						for(i = 0; i < TILEW; i++)
+						{
+							int index = ((i + TILEX) / 3 + (j + TILEY) * 5) % nColors;
+							dstpf->getRGB(pixelPtr(dst, dst.bits, i + TILEX, j + TILEY),
+								&r, &g, &b);
+							if(r != index * 37 % 256 || g != index * 91 % 256
+								|| b != (index * 151 + 11) % 256)
+								_throw("Pixel data is bogus");
+						}
+					}
+				}
+			}
+		}
+		fprintf(stderr, "Passed.\n");
+	}
+	fprintf(stderr, "\n");
+}
+
+
+// Decode RRCOMP_COPYRECT tiles whose source and destination rectangles
+// overlap (as they do when content is scrolled or panned by less than the
+// size of the rectangle) the way that the VirtualGL Client does, and make
+// sure that every pixel ends up where it should.
+
+void checkCopyRect(void)
+{
+	static const int offsets[][2] =
+	{
+		{ -7, 0 }, { 7, 0 }, { 0, -5 }, { 0, 5 }, { 3, 4 }, { -3, -4 }, { 3, -4 },
+		{ -3, 4 }, { -1, -1 }, { 1, 1 }
+	};
+
+	for(int format = 0; format < PIXELFORMATS; format++)
+	{
+		PF *pf = pf_get(format);
+		if(pf->bpc != 8 || pf->size < 3) continue;
+		fprintf(stderr, "Copy-rect (%s): ", pf->name);
+
+		for(int bu = 0; bu < 2; bu++)
+		{
+			for(int o = 0; o < (int)(sizeof(offsets) / sizeof(offsets[0])); o++)
+			{
+				int dx = offsets[o][0], dy = offsets[o][1], i, j, r, g, b;
+				Frame dst;  CompressedFrame cf;
+				rrframeheader hdr;
+
+				memset(&hdr, 0, sizeof(hdr));
+				hdr.width = hdr.framew = TILEX + TILEW + 8;
+				hdr.height = hdr.frameh = TILEY + TILEH + 6;
+				dst.init(hdr, format, bu ? FRAME_BOTTOMUP : 0);
+				for(j = 0; j < dst.hdr.frameh; j++)
+					for(i = 0; i < dst.hdr.framew; i++)
+						pf->setRGB(pixelPtr(dst, dst.bits, i, j), i * 5, j * 5,
+							(i + j) % 256);
+
+				int srcX = TILEX, srcY = TILEY, x = srcX + dx, y = srcY + dy;
+				if(x < 0) { srcX -= x;  x = 0; }
+				if(y < 0) { srcY -= y;  y = 0; }
+				hdr.x = x;  hdr.y = y;  hdr.width = TILEW;  hdr.height = TILEH;
+				hdr.compress = RRCOMP_COPYRECT;  hdr.size = RR_COPYRECTSIZE;
+				cf.init(hdr, 0);
+				cf.bits[0] = srcX & 0xFF;  cf.bits[1] = (srcX >> 8) & 0xFF;
+				cf.bits[2] = srcY & 0xFF;  cf.bits[3] = (srcY >> 8) & 0xFF;
+				cf.hdr.size = RR_COPYRECTSIZE;
+				dst.copyRect(cf, TILEW, TILEH);
+
+				for(j = 0; j < dst.hdr.frameh; j++)
+				{
+					for(i = 0; i < dst.hdr.framew; i++)
+					{
+						int si = i, sj = j;
+						if(i >= x && i < x + TILEW && j >= y && j < y + TILEH)
+						{
+							si = i - x + srcX;  sj = j - y + srcY;
+						}
+						pf->getRGB(pixelPtr(dst, dst.bits, i, j), &r, &g, &b);
+						if(r != si * 5 || g != sj * 5 || b != (si + sj) % 256)
+							_throw("Pixel data is bogus");
+					}
+				}
+			}
+		}
+		fprintf(stderr, "Passed.\n");
+	}
+	fprintf(stderr, "\n");
+}
+
+
+static int tjPixelFormat(int format)
+{
+	switch(format)
+	{
+		case PF_RGB:  return TJPF_RGB;
+		case PF_RGBX:  return TJPF_RGBX;
+		case PF_BGR:  return TJPF_BGR;
+		case PF_BGRX:  return TJPF_BGRX;
+		case PF_XBGR:  return TJPF_XBGR;
+		case PF_XRGB:  return TJPF_XRGB;
+		default:  _throw("Unsupported pixel format");
+	}
+	return -1;
+}
+
+
+// The left and right eyes of the stereo test tile.  In the lossless test, the
+// right eye differs from the left eye by more than 127 in places, so the
+// residual wraps around.  In the JPEG test, the residual is within -128..127,
+// but the right eye is a checkerboard of saturated and dark squares, so JPEG
+// error can push the reconstructed pixels out of range.
+
+static void leftRGB(int i, int j, bool lossless, int &r, int &g, int &b)
+{
+	if(lossless)
+	{
+		r = i * 5;  g = j * 8;  b = 255 - i * 5;
+	}
+	else
+	{
+		r = 134 + i / 2;  g = 140 + j / 2;  b = 140;
+	}
+}
+
+
+static void rightRGB(int i, int j, bool lossless, int &r, int &g, int &b)
+{
+	if(lossless)
+	{
+		int delta = 100 + i * 4 + j * 2;
+		leftRGB(i, j, lossless, r, g, b);
+		r = (r + delta) & 0xFF;  g = (g + delta) & 0xFF;  b = (b + delta) & 0xFF;
+	}
+	else r = g = b = ((i / 4 + j / 4) & 1) ? 255 : 40;
+}
+
+
+// Encode a stereo tile using stereo delta encoding (both losslessly, in which
+// case the residual may wrap around, and with JPEG, in which case the
+// reconstructed pixels are clamped), decode it the way the VirtualGL Client
+// does, and make sure that both eyes survive the round trip.
+
+void checkStereoDelta(void)
+{
+	tjhandle tjhnd = NULL;
+
+	if((tjhnd = tjInitDecompress()) == NULL) _throw(tjGetErrorStr());
+
+	for(int srcFormat = 0; srcFormat < PIXELFORMATS; srcFormat++)
+	{
+		PF *srcpf = pf_get(srcFormat);
+		if(srcpf->bpc != 8 || srcpf->size < 3) continue;
+		fprintf(stderr, "Stereo delta encoding (%s): ", srcpf->name);
+
+		for(int dstFormat = 0; dstFormat < PIXELFORMATS; dstFormat++)
+		{
+			PF *dstpf = pf_get(dstFormat);
+			if(dstpf->bpc != 8 || dstpf->size < 3) continue;
+
+			for(int bu = 0; bu < 4; bu++)
+			{
+				for(int lossless = 0; lossless < 2; lossless++)
+				{
+					int i, j, r, g, b, er, eg, eb, tolerance = lossless ? 0 : 48;
+					Frame src, dst;  CompressedFrame cf;
+					rrframeheader hdr;
+
+					memset(&hdr, 0, sizeof(hdr));
+					hdr.width = hdr.framew = TILEX + TILEW + 4;
+					hdr.height = hdr.frameh = TILEY + TILEH + 2;
+					hdr.compress = lossless ? RRCOMP_LOSSLESS : RRCOMP_JPEG;
+					hdr.qual = lossless ? LL_MAXEFFORT : 80;  hdr.subsamp = 1;
+					src.init(hdr, srcFormat,
+						FRAME_STEREODELTA | (bu & 1 ? FRAME_BOTTOMUP : 0), true);
+					for(j = 0; j < src.hdr.frameh; j++)
+					{
+						for(i = 0; i < src.hdr.framew; i++)
+						{
+							leftRGB(i, j, lossless, r, g, b);
+							srcpf->setRGB(pixelPtr(src, src.bits, i, j), r, g, b);
+							rightRGB(i, j, lossless, r, g, b);
+							srcpf->setRGB(pixelPtr(src, src.rbits, i, j), r, g, b);
+						}
+					}
+
+					Frame *tile = src.getTile(TILEX, TILEY, TILEW, TILEH);
+					cf = *tile;
+					delete tile;
+					if(cf.rhdr.flags != RR_RIGHTDELTA)
+						_throw("Right eye was not encoded as a stereo delta");
+
+					hdr = cf.hdr;
+					dst.init(hdr, dstFormat, bu & 2 ? FRAME_BOTTOMUP : 0, true);
+					if(lossless)
+					{
+						dst.decompressLossless(cf, TILEW, TILEH, false);
+						dst.decompressLossless(cf, TILEW, TILEH, true);
+					}
+					else
+					{
+						int flags = bu & 2 ? TJFLAG_BOTTOMUP : 0;
+						int y = bu & 2 ? TILEY + TILEH - 1 : TILEY;
+						_tj(tjDecompress2(tjhnd, cf.bits, cf.hdr.size,
+							pixelPtr(dst, dst.bits, TILEX, y), TILEW, dst.pitch, TILEH,
+							tjPixelFormat(dstFormat), flags));
+						_tj(tjDecompress2(tjhnd, cf.rbits, cf.rhdr.size,
+							pixelPtr(dst, dst.rbits, TILEX, y), TILEW, dst.pitch, TILEH,
+							tjPixelFormat(dstFormat), flags));
+					}
+					dst.addStereoDelta(cf, TILEW, TILEH);
+
+					for(j = 0; j < TILEH; j++)
+					{
+						for(i = 0; i < TILEW; i++)
+						{
+							leftRGB(i + TILEX, j + TILEY, lossless, er, eg, eb);
+							dstpf->getRGB(pixelPtr(dst, dst.bits, i + TILEX, j + TILEY),
+								&r, &g, &b);
+							if(abs(r - er) > tolerance || abs(g - eg) > tolerance
+								|| abs(b - eb) > tolerance)
+								_throw("Left eye pixel data is bogus");
+							rightRGB(i + TILEX, j + TILEY, lossless, er, eg, eb);
+							dstpf->getRGB(pixelPtr(dst, dst.rbits, i + TILEX, j + TILEY),
+								&r, &g, &b);
+							if(abs(r - er) > tolerance || abs(g - eg) > tolerance
+								|| abs(b - eb) > tolerance)
+								_throw("Right eye pixel data is bogus");
+						}
+					}
+				}
+			}
+		}
+		fprintf(stderr, "Passed.\n");
+	}
+	fprintf(stderr, "\n");
+	tjDestroy(tjhnd);
+}
+
+
 void usage(char **argv)
 {
 	fprintf(stderr, "\nUSAGE: %s [options]\n\n", argv[0]);
@@ -590,12 +904,14 @@ void usage(char **argv)
 	fprintf(stderr, "-gl = Use OpenGL instead of X11 for blitting\n");
 	fprintf(stderr, "-xv = Test X Video encoding/display\n");
 	fprintf(stderr, "-rgb = Use RGB encoding instead of JPEG compression\n");
+	fprintf(stderr, "-lossless = Use lossless compression instead of JPEG compression\n");
 	fprintf(stderr, "-logo = Add VirtualGL logo\n");
 	fprintf(stderr, "-anaglyph = Test anaglyph creation\n");
 	fprintf(stderr, "-rgbbench <filename> = Benchmark the decoding of RGB-encoded images.\n");
 	fprintf(stderr, "                       <filename> should be a BMP or PPM file.\n");
 	fprintf(stderr, "-v = Verbose output (may affect benchmark results)\n");
-	fprintf(stderr, "-check = Check correctness of pixel paths (implies -rgb)\n\n");
+	fprintf(stderr, "-check = Check correctness of pixel paths (implies -rgb unless\n");
+	fprintf(stderr, "         -lossless is specified)\n\n");
 	exit(1);
 }
 
@@ -630,6 +946,11 @@ int main(int argc, char **argv)
 			fprintf(stderr, "Using RGB encoding ...\n");
 			useRGB = true;
 		}
+		else if(!stricmp(argv[i], "-lossless"))
+		{
+			fprintf(stderr, "Using lossless compression ...\n");
+			useLossless = true;
+		}
 		else if(!stricmp(argv[i], "-rgbbench") && i < argc - 1)
 		{
 			fileName = argv[++i];  doRgbBench = true;
@@ -642,6 +963,12 @@ int main(int argc, char **argv)
 	try
 	{
 		if(doRgbBench) { rgbBench(fileName);  exit(0); }
+		if(check)
+		{
+			checkAdaptive();
+			checkCopyRect();
+			checkStereoDelta();
+		}
 
 		_errifnot(XInitThreads());
 		if(!(dpy = XOpenDisplay(0)))
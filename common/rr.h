@@ -17,7 +17,7 @@
 #define __RR_H
 
 #define RR_MAJOR_VERSION  2
-#define RR_MINOR_VERSION  1
+#define RR_MINOR_VERSION  4
 
 /* Argh! */
 #if !defined(__SUNPRO_CC) && !defined(__SUNPRO_C)
@@ -58,6 +58,60 @@ typedef struct _rrversion
 } rrversion;
 #define sizeof_rrversion  5
 
+/* A time value, in microseconds, split into two 32-bit halves (protocol v2.3
+   and later.)  Time values are relative to an arbitrary (but fixed) point in
+   time, which may differ between the server and the client. */
+typedef struct _rrtime
+{
+  unsigned int hi;  /* Upper 32 bits of the time value */
+  unsigned int lo;  /* Lower 32 bits of the time value */
+} rrtime;
+
+#define sizeof_rrtime  8
+
+/* Convert a time value (in microseconds) to and from an rrtime structure.
+   These use littleendian() and byteswap() from vglutil.h. */
+#define PACK_TIME(t, usec) \
+{ \
+  (t).hi = (unsigned int)((unsigned long long)(usec) >> 32); \
+  (t).lo = (unsigned int)((unsigned long long)(usec) & 0xFFFFFFFF); \
+  if(!littleendian()) \
+  { \
+    (t).hi = byteswap((t).hi);  (t).lo = byteswap((t).lo); \
+  } \
+}
+
+#define UNPACK_TIME(t) \
+  ((long long)(((unsigned long long)(littleendian() ? (t).hi : \
+    byteswap((t).hi)) << 32) | (littleendian() ? (t).lo : byteswap((t).lo))))
+
+/* Convert a time value in seconds (as returned by vglutil::Timer) to
+   microseconds */
+#define USEC(t)  ((long long)((t) * 1000000.))
+
+/* Immediately after the version handshake, a v2.3 or later server estimates
+   the offset between its clock and the client's clock.  It sends
+   RR_CLOCKPROBES rrtime structures containing the server time, the client
+   responds to each with an rrtime structure containing the client time, and
+   the server then sends an rrtime structure containing the estimated offset
+   (client time - server time), which is accurate to within half of the
+   smallest round-trip time measured by the probes. */
+#define RR_CLOCKPROBES  8
+
+/* Sent by a v2.3 or later server immediately after each End-of-Frame
+   header */
+typedef struct _rreofinfo
+{
+  unsigned int seq;  /* Sequence number of the frame, or 0 if the frame does
+                        not correspond to a new frame from the 3D application
+                        (for instance, if it is a progressive refinement
+                        pass) */
+  rrtime capture;    /* The time (server clock) at which VirtualGL began
+                        reading back the frame, or 0 if unknown */
+} rreofinfo;
+
+#define sizeof_rreofinfo  12
+
 /* Header from version 1 of the VirtualGL protocol (used to communicate with
    older clients */
 typedef struct _rrframeheader_v1
@@ -90,7 +144,12 @@ enum
   RR_EOF = 1,  /* this tile is an End-of-Frame marker and contains no real
                   image data */
   RR_LEFT,     /* this tile goes to the left buffer of a stereo frame */
-  RR_RIGHT     /* this tile goes to the right buffer of a stereo frame */
+  RR_RIGHT,    /* this tile goes to the right buffer of a stereo frame */
+  RR_RIGHTDELTA  /* this tile goes to the right buffer of a stereo frame and
+                    contains the difference between the right and left eyes
+                    (right - left + 128, for each color component), which the
+                    client adds to the co-located pixels in the left buffer
+                    (protocol v2.4 and later) */
 };
 
 /* Transport types */
@@ -98,9 +157,22 @@ enum
 enum rrtrans { RRTRANS_X11 = 0, RRTRANS_VGL, RRTRANS_XV };
 
 /* Compression types */
-#define RR_COMPRESSOPT  5
+#define RR_COMPRESSOPT  6
 enum rrcomp { RRCOMP_PROXY = 0, RRCOMP_JPEG, RRCOMP_RGB, RRCOMP_XV,
-              RRCOMP_YUV };
+              RRCOMP_YUV, RRCOMP_LOSSLESS,
+              /* These are selected automatically for individual tiles (when
+                 adaptive tile encoding or copy-rect detection is enabled) and
+                 cannot be specified using VGL_COMPRESS */
+              RRCOMP_SOLID, RRCOMP_PALETTE, RRCOMP_COPYRECT };
+
+/* Maximum number of colors in an RRCOMP_PALETTE tile */
+#define RR_MAXPALETTE  16
+
+/* Size (in bytes) of the payload of an RRCOMP_COPYRECT tile, which contains
+   the X and Y offsets of the source rectangle as little-endian 16-bit
+   unsigned integers.  The header's x, y, width, and height fields describe
+   the destination rectangle. */
+#define RR_COPYRECTSIZE  4
 
 /* Readback types */
 #define RR_READBACKOPT  3
@@ -108,22 +180,22 @@ enum rrread { RRREAD_NONE = 0, RRREAD_SYNC, RRREAD_PBO };
 
 static const enum rrtrans _Trans[RR_COMPRESSOPT] =
 {
-  RRTRANS_X11, RRTRANS_VGL, RRTRANS_VGL, RRTRANS_XV, RRTRANS_VGL
+  RRTRANS_X11, RRTRANS_VGL, RRTRANS_VGL, RRTRANS_XV, RRTRANS_VGL, RRTRANS_VGL
 };
 
 static const int _Minsubsamp[RR_COMPRESSOPT] =
 {
-  -1, 0, -1, 4, 4
+  -1, 0, -1, 4, 4, -1
 };
 
 static const int _Defsubsamp[RR_COMPRESSOPT] =
 {
-  1, 1, 1, 4, 4
+  1, 1, 1, 4, 4, 1
 };
 
 static const int _Maxsubsamp[RR_COMPRESSOPT] =
 {
-  -1, 4, -1, 4, 4
+  -1, 4, -1, 4, 4, -1
 };
 
 /* Stereo options */
@@ -145,6 +217,7 @@ enum rrdrawable { RRDRAWABLE_PBUFFER = 0, RRDRAWABLE_PIXMAP };
 #define RR_DEFAULTSSLPORT  RR_DEFAULTPORT
 #endif
 #define RR_DEFAULTTILESIZE  256
+#define RR_DEFAULTMINTILESIZE  64
 
 /* Maximum CPUs that be can be used for parallel image compression */
 /* (the algorithms don't scale beyond 3) */
@@ -168,7 +241,9 @@ typedef struct _FakerConfig
   double fps;
   double gamma;
   unsigned char gamma_lut[256];
-  unsigned short gamma_lut10[1024], gamma_lut16[65536];
+  /* gamma_lut10 has an extra (unused) entry so that the last entry can be
+     read 32 bits at a time */
+  unsigned short gamma_lut10[1025], gamma_lut16[65536];
   char glflushtrigger;
   char gllib[MAXSTR];
   char glxvendor[MAXSTR];
@@ -209,6 +284,19 @@ typedef struct _FakerConfig
   char xcbkeysymslib[MAXSTR];
   char xcbx11lib[MAXSTR];
   char excludeddpys[MAXSTR];
+  double refine;
+  int refinequal;
+  int effort;
+  char adaptive;
+  int mintilesize;
+  char copyrect;
+  char tracefile[MAXSTR];
+  char gpucomposite;
+  char stereodelta;
+  char visualcache[MAXSTR];
+  char egl;
+  char egllib[MAXSTR];
+  char asyncreadback;
 } FakerConfig;
 
 #if !defined(__SUNPRO_CC) && !defined(__SUNPRO_C)
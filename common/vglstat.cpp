@@ -0,0 +1,357 @@
+/* Copyright (C)2018 D. R. Commander
+ *
+ * This library is free software and may be redistributed and/or modified under
+ * the terms of the wxWindows Library License, Version 3.1 or (at your option)
+ * any later version.  The full license is in the LICENSE.txt file included
+ * with this distribution.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * wxWindows Library License for more details.
+ */
+
+/* This program reads the profiling statistics that VirtualGL processes publish
+   in shared memory when VGL_STATS=1 (see vglstats.h) and prints the frame
+   rate, throughput, and latency percentiles of each profiler. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <signal.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "vglstats.h"
+#include "Error.h"
+#include "Timer.h"
+#include "vglutil.h"
+
+using namespace vglutil;
+
+
+#define MAXPROCS  256
+
+bool doJSON = false, doClean = false;
+double interval = 0.;
+int nReports = 0;
+
+
+// A snapshot of the statistics of one process.  Metrics with the same name
+// (which are recorded by different threads) are combined.
+
+typedef struct
+{
+	int pid;
+	double startTime;
+	int nMetrics;
+	char names[VGLSTATS_MAXMETRICS][VGLSTATS_NAMELEN];
+	VGLStatsHist hists[VGLSTATS_MAXMETRICS];
+} Snapshot;
+
+
+// Map the stats segment of the specified process.  Returns NULL if the segment
+// doesn't exist or is incompatible.
+
+VGLStatsHeader *openSegment(int pid)
+{
+	char name[64];  int fd;  struct stat st;  void *ptr;
+
+	snprintf(name, 64, "/vgl-stats-%d", pid);
+	if((fd = shm_open(name, O_RDONLY, 0)) == -1)
+	{
+		// Segments belonging to other users are not readable.
+		if(errno == ENOENT || errno == EACCES) return NULL;
+		_throwunix();
+	}
+	if(fstat(fd, &st) == -1 || st.st_size < (off_t)sizeof(VGLStatsHeader))
+	{
+		close(fd);  return NULL;
+	}
+	ptr = mmap(NULL, sizeof(VGLStatsHeader), PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+	if(ptr == MAP_FAILED) _throwunix();
+
+	VGLStatsHeader *hdr = (VGLStatsHeader *)ptr;
+	if(hdr->magic != VGLSTATS_MAGIC || hdr->version != VGLSTATS_VERSION)
+	{
+		munmap(ptr, sizeof(VGLStatsHeader));  return NULL;
+	}
+	return hdr;
+}
+
+
+// Copy a metric, retrying if the writer updates it while we are copying it
+
+void readMetric(VGLStatsMetric *metric, VGLStatsHist *hist)
+{
+	while(true)
+	{
+		unsigned int seq = metric->seq;
+		if(seq & 1) { sched_yield();  continue; }
+		__sync_synchronize();
+		memcpy(hist, (const void *)&metric->hist, sizeof(VGLStatsHist));
+		__sync_synchronize();
+		if(metric->seq == seq) return;
+	}
+}
+
+
+void addHist(VGLStatsHist *dst, const VGLStatsHist *src)
+{
+	dst->count += src->count;
+	dst->sum += src->sum;
+	if(src->max > dst->max) dst->max = src->max;
+	dst->pixels += src->pixels;
+	dst->bytes += src->bytes;
+	for(int i = 0; i < VGLSTATS_NBUCKETS; i++) dst->hist[i] += src->hist[i];
+}
+
+
+void subtractHist(VGLStatsHist *dst, const VGLStatsHist *src)
+{
+	dst->count -= src->count;
+	dst->sum -= src->sum;
+	dst->pixels -= src->pixels;
+	dst->bytes -= src->bytes;
+	for(int i = 0; i < VGLSTATS_NBUCKETS; i++) dst->hist[i] -= src->hist[i];
+}
+
+
+void takeSnapshot(VGLStatsHeader *hdr, Snapshot *snap)
+{
+	VGLStatsHist hist;
+
+	memset(snap, 0, sizeof(Snapshot));
+	snap->pid = hdr->pid;
+	snap->startTime = hdr->startTime;
+	int nMetrics = hdr->nMetrics;
+	__sync_synchronize();
+	for(int i = 0; i < nMetrics && i < VGLSTATS_MAXMETRICS; i++)
+	{
+		VGLStatsMetric *metric = &hdr->metrics[i];
+		int j;
+		readMetric(metric, &hist);
+		for(j = 0; j < snap->nMetrics; j++)
+			if(!strncmp(snap->names[j], metric->name, VGLSTATS_NAMELEN)) break;
+		if(j == snap->nMetrics)
+		{
+			strncpy(snap->names[j], metric->name, VGLSTATS_NAMELEN - 1);
+			snap->nMetrics++;
+		}
+		addHist(&snap->hists[j], &hist);
+	}
+}
+
+
+// Print the statistics for one process.  If prev is non-NULL, then only the
+// frames that were processed since the previous snapshot are included.
+
+void printSnapshot(Snapshot *snap, Snapshot *prev, double now, double elapsed)
+{
+	if(doJSON)
+	{
+		for(int i = 0; i < snap->nMetrics; i++)
+		{
+			VGLStatsHist *h = &snap->hists[i];
+			printf("{\"time\": %.6f, \"pid\": %d, \"metric\": \"%s\", \"frames\": %llu",
+				now, snap->pid, snap->names[i], h->count);
+			if(elapsed > 0.)
+				printf(", \"fps\": %.3f, \"mpixels_per_sec\": %.3f, \"mbits_per_sec\": %.3f",
+					(double)h->count / elapsed,
+					(double)h->pixels / 1000000. / elapsed,
+					(double)h->bytes * 8. / 1000000. / elapsed);
+			if(h->count)
+				printf(", \"avg_ms\": %.3f, \"p50_ms\": %.3f, \"p95_ms\": %.3f, \"p99_ms\": %.3f, \"max_ms\": %.3f",
+					h->sum / (double)h->count * 1000.,
+					vglstats_percentile(h, 0.5) * 1000.,
+					vglstats_percentile(h, 0.95) * 1000.,
+					vglstats_percentile(h, 0.99) * 1000., h->max * 1000.);
+			printf("}\n");
+		}
+		fflush(stdout);
+		return;
+	}
+
+	printf("\nProcess %d (%s %.1f seconds)\n", snap->pid,
+		prev ? "last" : "running for", elapsed);
+	printf("%-24s %9s %9s %9s %9s %9s %9s %9s %9s\n", "Metric", "Frames",
+		"fps", "Mpix/s", "avg ms", "p50 ms", "p95 ms", "p99 ms", "max ms");
+	for(int i = 0; i < snap->nMetrics; i++)
+	{
+		VGLStatsHist *h = &snap->hists[i];
+		printf("%-24s %9llu %9.2f %9.2f", snap->names[i], h->count,
+			elapsed > 0. ? (double)h->count / elapsed : 0.,
+			elapsed > 0. ? (double)h->pixels / 1000000. / elapsed : 0.);
+		if(h->count)
+			printf(" %9.3f %9.3f %9.3f %9.3f %9.3f\n",
+				h->sum / (double)h->count * 1000.,
+				vglstats_percentile(h, 0.5) * 1000.,
+				vglstats_percentile(h, 0.95) * 1000.,
+				vglstats_percentile(h, 0.99) * 1000., h->max * 1000.);
+		else printf(" %9s %9s %9s %9s %9s\n", "-", "-", "-", "-", "-");
+	}
+	fflush(stdout);
+}
+
+
+// Subtract the previous snapshot from the current one, so the current one
+// contains only the frames that were processed during the interval.  The
+// maximum cannot be computed from the cumulative statistics, so it is
+// estimated from the histogram.
+
+void diffSnapshot(Snapshot *snap, Snapshot *prev)
+{
+	for(int i = 0; i < snap->nMetrics; i++)
+	{
+		VGLStatsHist *h = &snap->hists[i];
+		for(int j = 0; j < prev->nMetrics; j++)
+		{
+			if(strncmp(snap->names[i], prev->names[j], VGLSTATS_NAMELEN)) continue;
+			subtractHist(h, &prev->hists[j]);
+			break;
+		}
+		h->max = 0.;
+		for(int b = VGLSTATS_NBUCKETS - 1; b >= 0; b--)
+		{
+			if(h->hist[b])
+			{
+				h->max = vglstats_value(b);  break;
+			}
+		}
+	}
+}
+
+
+// Find the processes that have published stats segments.  POSIX doesn't
+// provide a way to list shared memory objects, but most systems expose them
+// in /dev/shm.
+
+int findProcesses(int *pids, int maxPids)
+{
+	DIR *dir;  struct dirent *ent;  int n = 0;
+
+	if((dir = opendir("/dev/shm")) == NULL) return 0;
+	while((ent = readdir(dir)) != NULL && n < maxPids)
+	{
+		int pid;
+		if(sscanf(ent->d_name, "vgl-stats-%d", &pid) == 1 && pid > 0)
+			pids[n++] = pid;
+	}
+	closedir(dir);
+	return n;
+}
+
+
+void usage(char **argv)
+{
+	fprintf(stderr, "\nUSAGE: %s [options] [pid ...]\n\n", argv[0]);
+	fprintf(stderr, "Print the statistics published by VirtualGL processes that were started\n");
+	fprintf(stderr, "with VGL_STATS=1 (by default, all such processes owned by the current user.)\n\n");
+	fprintf(stderr, "Options:\n");
+	fprintf(stderr, "-i <t> = Print the statistics for the last <t> seconds every <t> seconds\n");
+	fprintf(stderr, "         (default: print cumulative statistics once)\n");
+	fprintf(stderr, "-n <n> = Exit after printing <n> reports (with -i)\n");
+	fprintf(stderr, "-json = Print one JSON object per line for each metric\n");
+	fprintf(stderr, "-clean = Remove the stats segments of processes that no longer exist\n");
+	fprintf(stderr, "         (which can be left behind if a process crashes)\n\n");
+	exit(1);
+}
+
+
+int main(int argc, char **argv)
+{
+	int pids[MAXPROCS], nPids = 0, retval = 0;
+	VGLStatsHeader *hdrs[MAXPROCS];
+	Snapshot *snaps = NULL, *prevSnaps = NULL;
+
+	for(int i = 1; i < argc; i++)
+	{
+		if(!stricmp(argv[i], "-h") || !strcmp(argv[i], "-?")) usage(argv);
+		else if(!stricmp(argv[i], "-json")) doJSON = true;
+		else if(!stricmp(argv[i], "-clean")) doClean = true;
+		else if(!stricmp(argv[i], "-i") && i < argc - 1)
+		{
+			interval = atof(argv[++i]);
+			if(interval <= 0.) usage(argv);
+		}
+		else if(!stricmp(argv[i], "-n") && i < argc - 1)
+		{
+			nReports = atoi(argv[++i]);
+			if(nReports < 1) usage(argv);
+		}
+		else if(argv[i][0] != '-' && nPids < MAXPROCS)
+		{
+			if((pids[nPids] = atoi(argv[i])) < 1) usage(argv);
+			nPids++;
+		}
+		else usage(argv);
+	}
+
+	try
+	{
+		if(nPids == 0) nPids = findProcesses(pids, MAXPROCS);
+
+		int nOpen = 0;
+		for(int i = 0; i < nPids; i++)
+		{
+			if(kill(pids[i], 0) == -1 && errno == ESRCH)
+			{
+				// The process exited without removing its segment.
+				if(doClean)
+				{
+					char name[64];
+					snprintf(name, 64, "/vgl-stats-%d", pids[i]);
+					if(shm_unlink(name) == 0)
+						fprintf(stderr, "Removed %s\n", name);
+				}
+				hdrs[i] = NULL;  continue;
+			}
+			if((hdrs[i] = openSegment(pids[i])) != NULL) nOpen++;
+		}
+		if(doClean) return 0;
+		if(nOpen == 0)
+			_throw("No VirtualGL processes with VGL_STATS=1 were found");
+
+		_newcheck(snaps = new Snapshot[nPids]);
+		if(interval > 0.) _newcheck(prevSnaps = new Snapshot[nPids]);
+
+		for(int report = 0; ; report++)
+		{
+			double now = getTime();
+			for(int i = 0; i < nPids; i++)
+			{
+				if(!hdrs[i]) continue;
+				takeSnapshot(hdrs[i], &snaps[i]);
+				if(interval > 0. && report > 0)
+				{
+					Snapshot temp = snaps[i];
+					diffSnapshot(&snaps[i], &prevSnaps[i]);
+					printSnapshot(&snaps[i], &prevSnaps[i], now, interval);
+					prevSnaps[i] = temp;
+				}
+				else
+				{
+					if(interval <= 0.)
+						printSnapshot(&snaps[i], NULL, now, now - snaps[i].startTime);
+					if(prevSnaps) prevSnaps[i] = snaps[i];
+				}
+			}
+			if(interval <= 0. || (nReports > 0 && report >= nReports)) break;
+			usleep((useconds_t)(interval * 1000000.));
+		}
+	}
+	catch(Error &e)
+	{
+		fprintf(stderr, "ERROR in %s--\n%s\n", e.getMethod(), e.getMessage());
+		retval = -1;
+	}
+
+	delete [] snaps;
+	delete [] prevSnaps;
+	return retval;
+}
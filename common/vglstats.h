@@ -0,0 +1,140 @@
+/* Copyright (C)2018 D. R. Commander
+ *
+ * This library is free software and may be redistributed and/or modified under
+ * the terms of the wxWindows Library License, Version 3.1 or (at your option)
+ * any later version.  The full license is in the LICENSE.txt file included
+ * with this distribution.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * wxWindows Library License for more details.
+ */
+
+/* This describes the latency histograms used by the profilers and the layout
+   of the POSIX shared memory segment (/vgl-stats-{pid}) into which a process
+   publishes its profiling statistics when VGL_STATS=1, so that vglstat can
+   read them while the process is running. */
+
+#ifndef __VGLSTATS_H__
+#define __VGLSTATS_H__
+
+#define VGLSTATS_MAGIC  0x54534C56  /* "VLST" */
+#define VGLSTATS_VERSION  1
+#define VGLSTATS_MAXMETRICS  64
+#define VGLSTATS_NAMELEN  32
+
+/* Latencies are measured in microseconds and sorted into buckets in the
+   style of an HDR histogram:  values below 2 * VGLSTATS_SUBBUCKETS
+   microseconds each have their own bucket, and each subsequent power of 2 is
+   divided into VGLSTATS_SUBBUCKETS linear buckets.  Thus, the values
+   represented by a bucket differ by no more than 1 / VGLSTATS_SUBBUCKETS
+   (6.25%), and the histogram can represent values up to about 18 minutes. */
+#define VGLSTATS_SUBBUCKETS  16
+#define VGLSTATS_NBUCKETS  (VGLSTATS_SUBBUCKETS * 28)
+
+
+typedef struct
+{
+	/* The number of samples, the sum and maximum of the samples (in seconds),
+	   and the number of pixels and bytes processed */
+	unsigned long long count;
+	double sum, max;
+	unsigned long long pixels, bytes;
+	unsigned int hist[VGLSTATS_NBUCKETS];
+} VGLStatsHist;
+
+
+typedef struct
+{
+	/* Sequence lock.  The writer increments this before and after it updates
+	   the metric, so the value is odd while an update is in progress.  Readers
+	   must retry if the value is odd or changes while they read the metric. */
+	volatile unsigned int seq;
+
+	/* Non-zero if the profiler that owns this metric still exists.  Each metric
+	   is updated by only one profiler (and thus only one thread), so a process
+	   may have several metrics with the same name (for instance, one
+	   "Readback" metric for each OpenGL window.)  Readers should combine them.
+	   When a profiler is destroyed, its metric can be reused by a new profiler
+	   with the same name. */
+	volatile int active;
+
+	/* The name of the profiler (for instance, "Readback" or
+	   "Latency/End-to-end") */
+	char name[VGLSTATS_NAMELEN];
+
+	/* Statistics accumulated since the process started */
+	VGLStatsHist hist;
+} VGLStatsMetric;
+
+
+typedef struct
+{
+	unsigned int magic, version;
+	int pid;
+
+	/* The number of metrics that have been registered.  A metric's name is
+	   written before this is incremented. */
+	volatile int nMetrics;
+
+	/* The time at which the segment was created (seconds since the epoch) */
+	double startTime;
+
+	VGLStatsMetric metrics[VGLSTATS_MAXMETRICS];
+} VGLStatsHeader;
+
+
+/* Return the index of the bucket that contains the specified value (in
+   microseconds) */
+static inline unsigned int vglstats_bucket(double usec)
+{
+	unsigned long long v = usec < 0. ? 0 : (unsigned long long)usec;
+	unsigned int e = 0, bucket;
+
+	while(v >= 2 * VGLSTATS_SUBBUCKETS) { v >>= 1;  e++; }
+	bucket = e * VGLSTATS_SUBBUCKETS + (unsigned int)v;
+	return bucket < VGLSTATS_NBUCKETS ? bucket : VGLSTATS_NBUCKETS - 1;
+}
+
+
+/* Return the value (in seconds) at the center of the specified bucket */
+static inline double vglstats_value(unsigned int bucket)
+{
+	unsigned int e = 0;
+	double v = (double)bucket;
+
+	if(bucket >= 2 * VGLSTATS_SUBBUCKETS)
+	{
+		e = bucket / VGLSTATS_SUBBUCKETS - 1;
+		v = (double)(bucket - e * VGLSTATS_SUBBUCKETS) *
+			(double)(1ULL << e) + (double)(1ULL << e) / 2.;
+	}
+	else v += 0.5;
+	return v / 1000000.;
+}
+
+
+/* Return the specified percentile (0.0 - 1.0) of the samples in a
+   histogram */
+static inline double vglstats_percentile(const VGLStatsHist *h, double p)
+{
+	unsigned long long target = (unsigned long long)(p * (double)h->count +
+		0.5), n = 0;
+	unsigned int i;
+
+	if(h->count == 0) return 0.;
+	if(target < 1) target = 1;
+	for(i = 0; i < VGLSTATS_NBUCKETS; i++)
+	{
+		n += h->hist[i];
+		if(n >= target)
+		{
+			double v = vglstats_value(i);
+			return v < h->max ? v : h->max;
+		}
+	}
+	return h->max;
+}
+
+#endif  /* __VGLSTATS_H__ */
@@ -0,0 +1,63 @@
+/* Copyright (C)2018 D. R. Commander
+ *
+ * This library is free software and may be redistributed and/or modified under
+ * the terms of the wxWindows Library License, Version 3.1 or (at your option)
+ * any later version.  The full license is in the LICENSE.txt file included
+ * with this distribution.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * wxWindows Library License for more details.
+ */
+
+// Frame pacing: limits the rate at which frames are delivered by scheduling
+// them on absolute deadlines
+
+#ifndef __FRAMEPACER_H__
+#define __FRAMEPACER_H__
+
+#include "Mutex.h"
+
+
+namespace vglutil
+{
+	class FramePacer
+	{
+		public:
+
+			FramePacer(void);
+
+			// Called by the consumer (the thread that delivers frames) after it has
+			// delivered a frame.  Sleeps until the next deadline, so that no more
+			// than one frame is delivered per interval (in seconds.)  Because the
+			// deadlines are absolute, oversleeping does not accumulate from frame to
+			// frame.  If the consumer falls more than one interval behind, then a new
+			// schedule is started rather than delivering a burst of frames to catch
+			// up.  If interval <= 0, then pacing is disabled, and this method
+			// returns immediately.
+			void wait(double interval);
+
+			// Called by the producer before it produces a frame that it is allowed
+			// to discard.  Returns true if, based on the measured interval between
+			// frames and the measured time required to produce a frame, a later
+			// frame is expected to be produced before the consumer's next deadline.
+			// In that case, the frame would be spoiled before it could be delivered,
+			// so it can be discarded without producing it.
+			bool isEarly(void);
+
+			// Called by the producer with the time (in seconds) that it took to
+			// produce a frame
+			void addLatency(double seconds);
+
+		private:
+
+			static double time(void);
+			static void sleepUntil(double t);
+
+			CriticalSection mutex;
+			double deadline, latency, arrivalInterval, lastArrival;
+	};
+}
+
+#endif  // __FRAMEPACER_H__
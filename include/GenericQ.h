@@ -27,13 +27,16 @@ namespace vglutil
 	{
 		public:
 
-			typedef void (*SpoilCallback)(void *);
+			// context is the argument that was passed to spoil()
+			typedef void (*SpoilCallback)(void *item, void *context);
 
 			GenericQ(void);
 			~GenericQ(void);
 			void add(void *item);
-			void spoil(void *item, SpoilCallback spoilCallback);
+			void spoil(void *item, SpoilCallback spoilCallback,
+				void *context = NULL);
 			void get(void **item, bool nonBlocking = false);
+			bool timedGet(void **item, double timeout);
 			void release(void);
 			int items(void);
 
@@ -93,6 +93,7 @@ namespace vglutil
 			~Semaphore(void);
 			void wait(void);
 			bool tryWait();
+			bool timedWait(double seconds);
 			void post(void);
 			long getValue(void);
 
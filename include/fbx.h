@@ -68,6 +68,7 @@ typedef struct _fbx_struct
 	#else
 	#ifdef USESHM
 	XShmSegmentInfo shminfo;  int xattach;
+	int async, completionType, pending;
 	#endif
 	GC xgc;
 	XImage *xi;
@@ -77,6 +78,12 @@ typedef struct _fbx_struct
 } fbx_struct;
 
 
+/* Values for the useShm argument to fbx_init() */
+#define FBX_NOSHM  0
+#define FBX_SHM  1
+#define FBX_ASYNCSHM  2
+
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -99,7 +106,12 @@ extern "C" {
           of window
   height = Height of buffer (in pixels) that you wish to create.  0 = use
            height of window
-  useShm = Use MIT-SHM extension, if available (Unix only.)
+  useShm = Use MIT-SHM extension, if available (Unix only.)  FBX_ASYNCSHM
+           additionally requests an XShmCompletionEvent for each MIT-SHM
+           blit, so that fbx_flush() can return without waiting for the X
+           server to read the buffer (see fbx_flush() and fbx_wait().)  This
+           should only be used if the X display connection is not shared with
+           code that processes X events indiscriminately.
 
   NOTES:
   -- fbx_init() is idempotent.  If you call it multiple times, it will
@@ -209,6 +221,42 @@ int fbx_flip(fbx_struct *fb, int srcX, int srcY, int width, int height);
 int fbx_sync(fbx_struct *fb);
 
 
+/*
+  fbx_flush
+  (fbx_struct *fb)
+
+  Same as fbx_sync(), except that, if the buffer was initialized with
+  FBX_ASYNCSHM and MIT-SHM is in use, this routine only sends the previous
+  asynchronous writes to the X server.  It does not wait for the X server to
+  process them.  In that case, fbx_wait() must be called before the contents
+  of fb->bits are modified again.
+*/
+int fbx_flush(fbx_struct *fb);
+
+
+/*
+  fbx_wait
+  (fbx_struct *fb)
+
+  Wait until the X server has finished reading fb->bits for all previous
+  writes.  This returns immediately if the X server has already acknowledged
+  all of the writes (or if the buffer was not initialized with FBX_ASYNCSHM.)
+  On Windows, this does nothing.
+*/
+int fbx_wait(fbx_struct *fb);
+
+
+/*
+  fbx_busy
+  (fbx_struct *fb)
+
+  Returns 1 if the X server may still be reading fb->bits (that is, if
+  fbx_wait() would block), 0 if not, or -1 on failure.  This routine never
+  blocks.  On Windows, this always returns 0.
+*/
+int fbx_busy(fbx_struct *fb);
+
+
 /*
   fbx_term
   (fbx_struct *fb)
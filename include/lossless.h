@@ -0,0 +1,79 @@
+/* Copyright (C)2018 D. R. Commander
+ *
+ * This library is free software and may be redistributed and/or modified under
+ * the terms of the wxWindows Library License, Version 3.1 or (at your option)
+ * any later version.  The full license is in the LICENSE.txt file included
+ * with this distribution.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * wxWindows Library License for more details.
+ */
+
+/* This implements a fast lossless image codec for RGB images.  Each row of
+   the image is first passed through a prediction filter (none, left, up,
+   average, or previous frame), and the filtered pixels are then run-length
+   encoded.  This is intended for synthetic images with large flat or
+   smoothly-shaded regions and for images that differ only slightly from the
+   previous frame, for which it typically achieves much better compression
+   ratios than uncompressed RGB at a fraction of the CPU cost of JPEG. */
+
+#ifndef __LOSSLESS_H__
+#define __LOSSLESS_H__
+
+#include "pf.h"
+
+
+/* Effort levels:
+   0 = run-length encoding only, except that rows that are unchanged from the
+       reference image use the previous-frame filter (fastest)
+   1 = best (per-row) of the left, up, and previous-frame prediction filters +
+       run-length encoding
+   2 = best (per-row) of all prediction filters + run-length encoding (best
+       compression) */
+#define LL_MAXEFFORT  2
+#define LL_DEFEFFORT  1
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Returns the maximum size of an encoded image with the specified width and
+   height. */
+
+unsigned long ll_bufsize(int width, int height);
+
+
+/* Encode an image with the specified width, height, pixel format (which must
+   have 8 bits per component), and stride (which can be negative in order to
+   traverse the rows in reverse order.)  Rows are encoded in the order in which
+   they are traversed.  If refBuf is not NULL, then it points to a reference
+   image (normally the previous frame) with the same dimensions, pixel format,
+   and row order as the source image, and the previous-frame filter predicts
+   each pixel from the pixel at the same position in the reference image.
+   dstBuf must be at least ll_bufsize(width, height) bytes in size, and the
+   size of the encoded image is returned in *dstSize. */
+
+int ll_encode(unsigned char *srcBuf, int width, int srcStride, int height,
+	unsigned char *refBuf, int refStride, PF *pf, unsigned char *dstBuf,
+	unsigned long *dstSize, int effort);
+
+
+/* Decode an encoded image with the specified width and height into dstBuf,
+   using the specified destination pixel format and stride (which can be
+   negative.)  If the image was encoded with a reference image, then dstBuf
+   must already contain the reference image. */
+
+int ll_decode(unsigned char *srcBuf, unsigned long srcSize, int width,
+	int height, unsigned char *dstBuf, int dstStride, PF *dstpf);
+
+
+const char *ll_geterr(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  /* __LOSSLESS_H__ */
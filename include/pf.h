@@ -43,6 +43,10 @@ extern "C" {
 
 PF *pf_get(int id);
 
+/* Returns the name of the SIMD instruction set that the convert() methods of
+   the pixel formats returned by pf_get() use, or "None" */
+const char *pf_getsimd(void);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,133 @@
+/* Copyright (C)2018 D. R. Commander
+ *
+ * This library is free software and may be redistributed and/or modified under
+ * the terms of the wxWindows Library License, Version 3.1 or (at your option)
+ * any later version.  The full license is in the LICENSE.txt file included
+ * with this distribution.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * wxWindows Library License for more details.
+ */
+
+#ifndef __CONTEXTHASHEGL_H__
+#define __CONTEXTHASHEGL_H__
+
+#include "FakePbuffer.h"
+#include "Hash.h"
+
+
+// The state that the EGL back end maintains for each context.  Since a
+// context can only be current in one thread at a time, the thread in which it
+// is current owns this structure.
+
+typedef struct
+{
+	GLXContext ctx;
+	GLXFBConfig config;
+	// Current drawables and the FBOs that emulate them in this context
+	GLXDrawable draw, read;
+	vglserver::FBConfigEGL *drawConfig, *readConfig;
+	GLuint drawFBO, readFBO, resolveFBO;
+	// Draw and read buffers, as the application sees them.  In GLX, these are
+	// context state rather than drawable state, so they are carried over when
+	// the context is bound to a different drawable.
+	GLenum drawBufs[4];  int nDrawBufs;
+	GLenum readBuf;
+	bool current, destroyed;
+} ContextStateEGL;
+
+
+#define HASH  Hash<GLXContext, void *, ContextStateEGL *>
+
+// This maps a GLXContext (which is really an EGLContext) to its state (EGL
+// back end only.)
+
+namespace vglserver
+{
+	class ContextHashEGL : public HASH
+	{
+		public:
+
+			static ContextHashEGL *getInstance(void)
+			{
+				if(instance == NULL)
+				{
+					vglutil::CriticalSection::SafeLock l(instanceMutex);
+					if(instance == NULL) instance = new ContextHashEGL;
+				}
+				return instance;
+			}
+
+			static bool isAlloc(void) { return instance != NULL; }
+
+			void add(GLXContext ctx, GLXFBConfig config)
+			{
+				if(!ctx) _throw("Invalid argument");
+				ContextStateEGL *state = NULL;
+				_newcheck(state = new ContextStateEGL);
+				memset(state, 0, sizeof(ContextStateEGL));
+				state->ctx = ctx;  state->config = config;
+				HASH::add(ctx, NULL, state);
+			}
+
+			ContextStateEGL *find(GLXContext ctx)
+			{
+				if(!ctx) return NULL;
+				return HASH::find(ctx, NULL);
+			}
+
+			// If the context is current in some thread, then its state is deleted
+			// when the context is released.
+			void remove(GLXContext ctx)
+			{
+				if(!ctx) return;
+				vglutil::CriticalSection::SafeLock l(mutex);
+				HashEntry *entry = findEntry(ctx, NULL);
+				if(!entry) return;
+				if(entry->value && entry->value->current)
+				{
+					entry->value->destroyed = true;  entry->value = NULL;
+				}
+				killEntry(entry);
+			}
+
+			void setCurrent(ContextStateEGL *state, bool current)
+			{
+				if(!state) return;
+				vglutil::CriticalSection::SafeLock l(mutex);
+				state->current = current;
+				if(!current && state->destroyed) delete state;
+			}
+
+		private:
+
+			~ContextHashEGL(void)
+			{
+				HASH::kill();
+			}
+
+			void detach(HashEntry *entry)
+			{
+				ContextStateEGL *state =
+					entry ? (ContextStateEGL *)entry->value : NULL;
+				if(state) delete state;
+			}
+
+			bool compare(GLXContext key1, void *key2, HashEntry *entry)
+			{
+				return false;
+			}
+
+			static ContextHashEGL *instance;
+			static vglutil::CriticalSection instanceMutex;
+	};
+}
+
+#undef HASH
+
+
+#define ctxhashegl  (*(ContextHashEGL::getInstance()))
+
+#endif  // __CONTEXTHASHEGL_H__
@@ -0,0 +1,453 @@
+/* Copyright (C)2018 D. R. Commander
+ *
+ * This library is free software and may be redistributed and/or modified under
+ * the terms of the wxWindows Library License, Version 3.1 or (at your option)
+ * any later version.  The full license is in the LICENSE.txt file included
+ * with this distribution.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * wxWindows Library License for more details.
+ */
+
+#include "FakePbuffer.h"
+#include <string.h>
+#include "Error.h"
+
+using namespace vglutil;
+using namespace vglserver;
+
+
+// X resource IDs are 29-bit values, so our Pbuffer IDs can never collide with
+// the IDs of windows or pixmaps.
+static GLXDrawable nextID = 0x20000000;
+
+
+typedef struct _Orphan
+{
+	GLXContext ctx;
+	GLuint fbo;
+	struct _Orphan *next;
+} Orphan;
+
+static Orphan *orphans = NULL;
+static int nOrphans = 0;
+static CriticalSection orphanMutex;
+
+
+static void orphanFBO(GLXContext ctx, GLuint fbo)
+{
+	if(!fbo) return;
+	Orphan *orphan = new Orphan;
+	if(!orphan) return;
+	CriticalSection::SafeLock l(orphanMutex);
+	orphan->ctx = ctx;  orphan->fbo = fbo;  orphan->next = orphans;
+	orphans = orphan;
+	__atomic_store_n(&nOrphans, nOrphans + 1, __ATOMIC_RELEASE);
+}
+
+
+// Renderbuffers that belonged to destroyed or resized Pbuffers are kept in a
+// pool, so that a Pbuffer with the same format and size (for instance, when a
+// window is resized back and forth or closed and reopened) can reuse them
+// rather than allocating new storage.  The pool holds at
+// most POOLSIZE renderbuffers and POOLBYTES bytes of storage, and the least
+// recently freed renderbuffers are deleted first.
+
+#define POOLSIZE  16
+#define POOLBYTES  (64 * 1024 * 1024)
+
+typedef struct
+{
+	GLuint rbo;
+	GLenum format;
+	int samples, width, height;
+	size_t bytes;
+} PooledRBO;
+
+static PooledRBO pool[POOLSIZE];
+static int nPooled = 0;
+static size_t pooledBytes = 0;
+static CriticalSection poolMutex;
+
+
+static size_t rboBytes(int samples, int width, int height)
+{
+	// All of the formats that we use occupy (at most) 4 bytes per sample.
+	return (size_t)width * (size_t)height * (size_t)(samples > 0 ? samples : 1)
+		* 4;
+}
+
+
+static void unpoolRBO(int index)
+{
+	pooledBytes -= pool[index].bytes;
+	memmove(&pool[index], &pool[index + 1],
+		sizeof(PooledRBO) * (nPooled - index - 1));
+	nPooled--;
+}
+
+
+static GLuint allocRBO(GLenum format, int samples, int width, int height)
+{
+	GLuint rbo = 0;
+
+	{
+		CriticalSection::SafeLock l(poolMutex);
+		for(int i = nPooled - 1; i >= 0; i--)
+		{
+			if(pool[i].format == format && pool[i].samples == samples
+				&& pool[i].width == width && pool[i].height == height)
+			{
+				rbo = pool[i].rbo;
+				unpoolRBO(i);
+				return rbo;
+			}
+		}
+	}
+
+	_glGenRenderbuffers(1, &rbo);
+	_glBindRenderbuffer(GL_RENDERBUFFER, rbo);
+	_glRenderbufferStorageMultisample(GL_RENDERBUFFER, samples, format, width,
+		height);
+	return rbo;
+}
+
+
+// If reuse is false, then the renderbuffer is deleted rather than pooled.
+
+static void freeRBO(GLuint rbo, GLenum format, int samples, int width,
+	int height, bool reuse = true)
+{
+	if(!rbo) return;
+
+	size_t bytes = rboBytes(samples, width, height);
+	CriticalSection::SafeLock l(poolMutex);
+	if(!reuse || bytes > POOLBYTES)
+	{
+		_glDeleteRenderbuffers(1, &rbo);  return;
+	}
+	while(nPooled > 0 && (nPooled >= POOLSIZE || pooledBytes + bytes > POOLBYTES))
+	{
+		_glDeleteRenderbuffers(1, &pool[0].rbo);
+		unpoolRBO(0);
+	}
+	PooledRBO *entry = &pool[nPooled++];
+	entry->rbo = rbo;  entry->format = format;  entry->samples = samples;
+	entry->width = width;  entry->height = height;  entry->bytes = bytes;
+	pooledBytes += bytes;
+}
+
+
+FakePbuffer::FakePbuffer(FBConfigEGL *config_, int width_, int height_) :
+	config(config_), width(width_), height(height_), depthRBO(0),
+	resolveRBO(0), generation(0), fbos(NULL)
+{
+	if(!config_ || width_ < 1 || height_ < 1) _throw("Invalid argument");
+
+	id = __atomic_add_fetch(&nextID, 1, __ATOMIC_SEQ_CST);
+	if(config->redSize > 8) colorFormat = GL_RGB10_A2;
+	else colorFormat = config->alphaSize ? GL_RGBA8 : GL_RGB8;
+	depthFormat = GL_DEPTH24_STENCIL8;
+	if(config->stencilSize == 0)
+		depthFormat = config->depthSize > 16 ?
+			GL_DEPTH_COMPONENT24 : GL_DEPTH_COMPONENT16;
+
+	GLint oldRBO = 0;
+	_glGetIntegerv(GL_RENDERBUFFER_BINDING, &oldRBO);
+
+	for(int i = 0; i < 4; i++)
+	{
+		rbo[i] = 0;
+		if((i & 1) && !config->doubleBuffer) continue;
+		if((i & 2) && !config->stereo) continue;
+		rbo[i] = allocRBO(colorFormat, config->samples, width, height);
+	}
+	if(config->depthSize > 0 || config->stencilSize > 0)
+		depthRBO = allocRBO(depthFormat, config->samples, width, height);
+
+	_glBindRenderbuffer(GL_RENDERBUFFER, oldRBO);
+	// Make sure that the storage is allocated before the renderbuffers are
+	// used in another context.
+	_glFlush();
+}
+
+
+FakePbuffer::~FakePbuffer(void)
+{
+	GLXContext ctx = (GLXContext)_eglGetCurrentContext();
+
+	mutex.lock(false);
+	while(fbos)
+	{
+		FBO *next = fbos->next;
+		if(fbos->ctx == ctx)
+		{
+			_glDeleteFramebuffers(1, &fbos->fbo);
+			if(fbos->resolveFBO) _glDeleteFramebuffers(1, &fbos->resolveFBO);
+		}
+		else
+		{
+			orphanFBO(fbos->ctx, fbos->fbo);
+			orphanFBO(fbos->ctx, fbos->resolveFBO);
+		}
+		delete fbos;
+		fbos = next;
+	}
+	mutex.unlock(false);
+	// Any orphaned FBOs that still refer to the renderbuffers are never bound
+	// again, so the renderbuffers can safely be reused by another Pbuffer.
+	for(int i = 0; i < 4; i++)
+		freeRBO(rbo[i], colorFormat, config->samples, width, height);
+	freeRBO(depthRBO, depthFormat, config->samples, width, height);
+	freeRBO(resolveRBO, colorFormat, 0, width, height);
+}
+
+
+void FakePbuffer::resize(int width_, int height_)
+{
+	if(width_ < 1 || height_ < 1) _throw("Invalid argument");
+	if(width_ == width && height_ == height) return;
+
+	CriticalSection::SafeLock l(mutex);
+	GLint oldRBO = 0;
+	_glGetIntegerv(GL_RENDERBUFFER_BINDING, &oldRBO);
+
+	// Reallocating the storage of a renderbuffer that was rendered to by a
+	// context that has since been destroyed crashes some versions of Mesa, so
+	// we replace the renderbuffers instead.  The old renderbuffers go into the
+	// pool, so resizing a window back and forth is cheap, and the FBOs are
+	// updated lazily (see getFBO().)  However, another context whose FBO has
+	// not yet been updated may still be rendering into the old renderbuffers,
+	// so in that case, they are deleted rather than pooled.  (OpenGL keeps the
+	// storage of a deleted renderbuffer until it is detached from all FBOs.)
+	GLXContext ctx = (GLXContext)_eglGetCurrentContext();
+	bool reuse = true;
+	for(FBO *entry = fbos; entry; entry = entry->next)
+	{
+		if(entry->ctx != ctx && entry->generation == generation)
+		{
+			reuse = false;  break;
+		}
+	}
+	for(int i = 0; i < 4; i++)
+	{
+		if(!rbo[i]) continue;
+		freeRBO(rbo[i], colorFormat, config->samples, width, height, reuse);
+		rbo[i] = allocRBO(colorFormat, config->samples, width_, height_);
+	}
+	if(depthRBO)
+	{
+		freeRBO(depthRBO, depthFormat, config->samples, width, height, reuse);
+		depthRBO = allocRBO(depthFormat, config->samples, width_, height_);
+	}
+	freeRBO(resolveRBO, colorFormat, 0, width, height, reuse);
+	resolveRBO = 0;
+
+	_glBindRenderbuffer(GL_RENDERBUFFER, oldRBO);
+	_glFlush();
+	width = width_;  height = height_;
+	generation++;
+}
+
+
+void FakePbuffer::attach(void)
+{
+	for(int i = 0; i < 4; i++)
+	{
+		if(rbo[i])
+			_glFramebufferRenderbuffer(GL_DRAW_FRAMEBUFFER, GL_COLOR_ATTACHMENT0 + i,
+				GL_RENDERBUFFER, rbo[i]);
+	}
+	if(depthRBO)
+		_glFramebufferRenderbuffer(GL_DRAW_FRAMEBUFFER,
+			config->stencilSize ? GL_DEPTH_STENCIL_ATTACHMENT : GL_DEPTH_ATTACHMENT,
+			GL_RENDERBUFFER, depthRBO);
+}
+
+
+FakePbuffer::FBO *FakePbuffer::findFBO(GLXContext ctx)
+{
+	for(FBO *entry = fbos; entry; entry = entry->next)
+		if(entry->ctx == ctx) return entry;
+	return NULL;
+}
+
+
+GLuint FakePbuffer::getFBO(GLXContext ctx)
+{
+	CriticalSection::SafeLock l(mutex);
+	FBO *entry = findFBO(ctx);
+	if(entry)
+	{
+		if(entry->generation != generation)
+		{
+			// The Pbuffer has been resized since this context last used it.
+			_glBindFramebuffer(GL_DRAW_FRAMEBUFFER, entry->fbo);
+			attach();
+			if(entry->resolveFBO)
+			{
+				_glDeleteFramebuffers(1, &entry->resolveFBO);
+				entry->resolveFBO = 0;
+			}
+			entry->generation = generation;
+		}
+		return entry->fbo;
+	}
+
+	GLuint fbo = 0;
+	_glGenFramebuffers(1, &fbo);
+	if(!fbo) _throw("Could not create framebuffer object");
+	_glBindFramebuffer(GL_DRAW_FRAMEBUFFER, fbo);
+	attach();
+	if(_glCheckFramebufferStatus(GL_DRAW_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+	{
+		_glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+		_glDeleteFramebuffers(1, &fbo);
+		_throw("Framebuffer object for Pbuffer is incomplete");
+	}
+
+	_newcheck(entry = new FBO);
+	entry->ctx = ctx;  entry->fbo = fbo;  entry->resolveFBO = 0;
+	entry->generation = generation;
+	entry->next = fbos;  fbos = entry;
+	return fbo;
+}
+
+
+GLuint FakePbuffer::resolve(GLXContext ctx, int attachment)
+{
+	GLint oldDrawFBO = 0, oldRBO = 0;
+
+	_glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &oldDrawFBO);
+	GLuint fbo = getFBO(ctx);
+
+	CriticalSection::SafeLock l(mutex);
+	FBO *entry = findFBO(ctx);
+	if(!resolveRBO)
+	{
+		_glGetIntegerv(GL_RENDERBUFFER_BINDING, &oldRBO);
+		resolveRBO = allocRBO(colorFormat, 0, width, height);
+		_glBindRenderbuffer(GL_RENDERBUFFER, oldRBO);
+	}
+	if(!entry->resolveFBO)
+	{
+		_glGenFramebuffers(1, &entry->resolveFBO);
+		_glBindFramebuffer(GL_DRAW_FRAMEBUFFER, entry->resolveFBO);
+		_glFramebufferRenderbuffer(GL_DRAW_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
+			GL_RENDERBUFFER, resolveRBO);
+	}
+
+	GLboolean scissor = _glIsEnabled(GL_SCISSOR_TEST);
+	if(scissor) _glDisable(GL_SCISSOR_TEST);
+	_glBindFramebuffer(GL_DRAW_FRAMEBUFFER, entry->resolveFBO);
+	_glBindFramebuffer(GL_READ_FRAMEBUFFER, fbo);
+	_glReadBuffer(GL_COLOR_ATTACHMENT0 + attachment);
+	_glBlitFramebuffer(0, 0, width, height, 0, 0, width, height,
+		GL_COLOR_BUFFER_BIT, GL_NEAREST);
+	if(scissor) _glEnable(GL_SCISSOR_TEST);
+
+	_glBindFramebuffer(GL_READ_FRAMEBUFFER, entry->resolveFBO);
+	_glReadBuffer(GL_COLOR_ATTACHMENT0);
+	_glBindFramebuffer(GL_DRAW_FRAMEBUFFER, oldDrawFBO);
+	return entry->resolveFBO;
+}
+
+
+void FakePbuffer::swap(GLXContext ctx)
+{
+	if(!config->doubleBuffer) return;
+
+	GLint oldDrawFBO = 0, oldReadFBO = 0, readBuf = GL_NONE,
+		drawBufs[4] = { GL_NONE, GL_NONE, GL_NONE, GL_NONE };
+	int nDrawBufs = 1;
+
+	_glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &oldDrawFBO);
+	_glGetIntegerv(GL_READ_FRAMEBUFFER_BINDING, &oldReadFBO);
+	GLboolean scissor = _glIsEnabled(GL_SCISSOR_TEST);
+	GLboolean discard = _glIsEnabled(GL_RASTERIZER_DISCARD);
+
+	GLuint fbo = getFBO(ctx);
+	_glBindFramebuffer(GL_DRAW_FRAMEBUFFER, fbo);
+	_glBindFramebuffer(GL_READ_FRAMEBUFFER, fbo);
+	// The draw and read buffers are part of the FBO's state, which the
+	// application may be able to see, so we have to restore them.
+	_glGetIntegerv(GL_READ_BUFFER, &readBuf);
+	for(int i = 0; i < 4; i++)
+	{
+		_glGetIntegerv(GL_DRAW_BUFFER0 + i, &drawBufs[i]);
+		if(drawBufs[i] != GL_NONE) nDrawBufs = i + 1;
+	}
+	if(scissor) _glDisable(GL_SCISSOR_TEST);
+	if(discard) _glDisable(GL_RASTERIZER_DISCARD);
+
+	for(int i = 0; i < (config->stereo ? 4 : 2); i += 2)
+	{
+		_glReadBuffer(GL_COLOR_ATTACHMENT0 + i + 1);
+		_glDrawBuffer(GL_COLOR_ATTACHMENT0 + i);
+		_glBlitFramebuffer(0, 0, width, height, 0, 0, width, height,
+			GL_COLOR_BUFFER_BIT, GL_NEAREST);
+	}
+
+	_glDrawBuffers(nDrawBufs, (GLenum *)drawBufs);
+	_glReadBuffer(readBuf);
+	if(scissor) _glEnable(GL_SCISSOR_TEST);
+	if(discard) _glEnable(GL_RASTERIZER_DISCARD);
+	_glBindFramebuffer(GL_DRAW_FRAMEBUFFER, oldDrawFBO);
+	_glBindFramebuffer(GL_READ_FRAMEBUFFER, oldReadFBO);
+}
+
+
+void FakePbuffer::removeContext(GLXContext ctx)
+{
+	CriticalSection::SafeLock l(mutex);
+	FBO **prev = &fbos;
+
+	while(*prev)
+	{
+		FBO *entry = *prev;
+		if(entry->ctx == ctx)
+		{
+			*prev = entry->next;  delete entry;
+		}
+		else prev = &entry->next;
+	}
+}
+
+
+void FakePbuffer::deleteOrphans(GLXContext ctx)
+{
+	if(!__atomic_load_n(&nOrphans, __ATOMIC_ACQUIRE)) return;
+
+	CriticalSection::SafeLock l(orphanMutex);
+	Orphan **prev = &orphans;
+	while(*prev)
+	{
+		Orphan *orphan = *prev;
+		if(orphan->ctx == ctx)
+		{
+			_glDeleteFramebuffers(1, &orphan->fbo);
+			*prev = orphan->next;  delete orphan;
+			__atomic_store_n(&nOrphans, nOrphans - 1, __ATOMIC_RELEASE);
+		}
+		else prev = &orphan->next;
+	}
+}
+
+
+void FakePbuffer::removeOrphans(GLXContext ctx)
+{
+	CriticalSection::SafeLock l(orphanMutex);
+	Orphan **prev = &orphans;
+	while(*prev)
+	{
+		Orphan *orphan = *prev;
+		if(orphan->ctx == ctx)
+		{
+			*prev = orphan->next;  delete orphan;
+			__atomic_store_n(&nOrphans, nOrphans - 1, __ATOMIC_RELEASE);
+		}
+		else prev = &orphan->next;
+	}
+}
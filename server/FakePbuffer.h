@@ -0,0 +1,117 @@
+/* Copyright (C)2018 D. R. Commander
+ *
+ * This library is free software and may be redistributed and/or modified under
+ * the terms of the wxWindows Library License, Version 3.1 or (at your option)
+ * any later version.  The full license is in the LICENSE.txt file included
+ * with this distribution.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * wxWindows Library License for more details.
+ */
+
+#ifndef __FAKEPBUFFER_H__
+#define __FAKEPBUFFER_H__
+
+#include "faker-sym.h"
+#include "Mutex.h"
+
+
+namespace vglserver
+{
+	// Attributes of an FB config synthesized by the EGL back end.  With the EGL
+	// back end, a GLXFBConfig handle is a pointer to one of these structures.
+
+	typedef struct
+	{
+		int id, redSize, greenSize, blueSize, alphaSize, depthSize, stencilSize,
+			samples;
+		bool doubleBuffer, stereo;
+	} FBConfigEGL;
+
+
+	// This class emulates a GLX Pbuffer on top of EGL using renderbuffer
+	// objects.  Color attachments 0-3 of the Pbuffer's framebuffer object (FBO)
+	// correspond to GL_FRONT_LEFT, GL_BACK_LEFT, GL_FRONT_RIGHT, and
+	// GL_BACK_RIGHT (only the attachments that the FB config calls for are
+	// created.)  The EGL back end creates all contexts in the same share group,
+	// so the renderbuffers are visible in every context, but FBOs cannot be
+	// shared, so an FBO is created on demand for each context in which the
+	// Pbuffer is used.
+	//
+	// All methods (including the constructor and destructor) must be called
+	// with a context from that share group current.
+
+	class FakePbuffer
+	{
+		public:
+
+			FakePbuffer(FBConfigEGL *config, int width, int height);
+			~FakePbuffer(void);
+
+			GLXDrawable getID(void) { return id; }
+			FBConfigEGL *getConfig(void) { return config; }
+			int getWidth(void) { return width; }
+			int getHeight(void) { return height; }
+
+			// Resize the Pbuffer by replacing its renderbuffers.  The Pbuffer keeps
+			// its ID, but its contents become undefined.  The FBOs of other
+			// contexts are updated the next time that getFBO() is called for those
+			// contexts (which happens when the Pbuffer is made current), so a
+			// context that is current in another thread continues to render into
+			// the old renderbuffers until then.  (For that reason, the old
+			// renderbuffers are only reused by other Pbuffers if no other
+			// context's FBO refers to them.)
+			void resize(int width, int height);
+
+			// Return the FBO for the specified (current) context, creating it (or
+			// updating it, if the Pbuffer has been resized) if necessary.  If the
+			// FBO is created or updated, then it is left bound to
+			// GL_DRAW_FRAMEBUFFER.
+			GLuint getFBO(GLXContext ctx);
+
+			// Resolve the specified color attachment of a multisampled Pbuffer into
+			// a single-sampled renderbuffer, and bind an FBO containing the result
+			// to GL_READ_FRAMEBUFFER.  Returns the FBO.
+			GLuint resolve(GLXContext ctx, int attachment);
+
+			// Copy the back buffer(s) to the front buffer(s), using the specified
+			// (current) context.  The context's state is not modified.
+			void swap(GLXContext ctx);
+
+			// Forget about the FBOs belonging to a context that has been destroyed
+			void removeContext(GLXContext ctx);
+
+			// FBOs can only be deleted in the context that owns them, so if a
+			// Pbuffer is destroyed while one of its FBOs belongs to a context that
+			// is not current, then the FBO is deleted the next time the context is
+			// made current.
+			static void deleteOrphans(GLXContext ctx);
+			static void removeOrphans(GLXContext ctx);
+
+		private:
+
+			typedef struct _FBO
+			{
+				GLXContext ctx;
+				GLuint fbo, resolveFBO;
+				int generation;
+				struct _FBO *next;
+			} FBO;
+
+			FBO *findFBO(GLXContext ctx);
+			void attach(void);
+
+			GLXDrawable id;
+			FBConfigEGL *config;
+			int width, height;
+			GLenum colorFormat, depthFormat;
+			GLuint rbo[4], depthRBO, resolveRBO;
+			int generation;
+			FBO *fbos;
+			vglutil::CriticalSection mutex;
+	};
+}
+
+#endif  // __FAKEPBUFFER_H__
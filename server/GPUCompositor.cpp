@@ -0,0 +1,351 @@
+/* Copyright (C)2018 D. R. Commander
+ *
+ * This library is free software and may be redistributed and/or modified under
+ * the terms of the wxWindows Library License, Version 3.1 or (at your option)
+ * any later version.  The full license is in the LICENSE.txt file included
+ * with this distribution.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * wxWindows Library License for more details.
+ */
+
+#include "GPUCompositor.h"
+#include <stdio.h>
+#include <string.h>
+#include "fakerconfig.h"
+#include "backend.h"
+
+using namespace vglserver;
+
+
+enum { TEX_LEFT = 0, TEX_RIGHT, TEX_LUT, TEX_OUTPUT };
+
+enum { MODE_MONO = 0, MODE_ANAGLYPH, MODE_INTERLEAVED, MODE_TOPBOTTOM,
+	MODE_SIDEBYSIDE };
+
+
+// The vertex shader passes through the corners of a quad that covers the whole
+// viewport.  The fragment shader reproduces the pixel selection performed by
+// Frame::makeAnaglyph() and Frame::makePassive() (the frame is bottom-up, as
+// is the FBO), samples the source textures at texel centers so that no
+// filtering occurs, and applies gamma correction using the same lookup table
+// as the software path, so the result is identical to that of the CPU path.
+
+static const char *vertexShaderSource =
+	"void main(void)\n"
+	"{\n"
+	"	gl_Position = gl_Vertex;\n"
+	"}\n";
+
+static const char *fragmentShaderSource =
+	"uniform sampler2D left, right, lut;\n"
+	"uniform vec2 size;\n"
+	"uniform int mode;\n"
+	"uniform vec3 leftMask;\n"
+	"uniform float lutMax;\n"
+	"\n"
+	"vec4 fetch(sampler2D tex, vec2 p)\n"
+	"{\n"
+	"	return texture2D(tex, (p + 0.5) / size);\n"
+	"}\n"
+	"\n"
+	"float correct(float c)\n"
+	"{\n"
+	"	return texture2D(lut,\n"
+	"		vec2((floor(c * lutMax + 0.5) + 0.5) / (lutMax + 1.0), 0.5)).r;\n"
+	"}\n"
+	"\n"
+	"void main(void)\n"
+	"{\n"
+	"	vec2 p = floor(gl_FragCoord.xy), h = floor((size + 1.0) / 2.0);\n"
+	"	vec4 c;\n"
+	"	if(mode == 1)\n"
+	"		c = mix(fetch(right, p), fetch(left, p), vec4(leftMask, 0.0));\n"
+	"	else if(mode == 2)\n"
+	"		c = mod(p.y, 2.0) < 0.5 ? fetch(left, p) : fetch(right, p);\n"
+	"	else if(mode == 3)\n"
+	"		c = p.y < h.y ? fetch(left, vec2(p.x, p.y * 2.0)) :\n"
+	"			fetch(right, vec2(p.x, (p.y - h.y) * 2.0 + 1.0));\n"
+	"	else if(mode == 4)\n"
+	"		c = p.x < h.x ? fetch(left, vec2(p.x * 2.0, p.y)) :\n"
+	"			fetch(right, vec2((p.x - h.x) * 2.0 + 1.0, p.y));\n"
+	"	else\n"
+	"		c = fetch(left, p);\n"
+	"	if(lutMax > 0.0)\n"
+	"		c.rgb = vec3(correct(c.r), correct(c.g), correct(c.b));\n"
+	"	gl_FragColor = vec4(c.rgb, 1.0);\n"
+	"}\n";
+
+
+void GPUCompositor::reset(void)
+{
+	supported = -1;
+	fbo = program = 0;
+	memset(tex, 0, sizeof(GLuint) * 4);
+	texWidth = texHeight = 0;  texTenBit = false;
+	lutGamma = 0.0;  lutSize = 0;
+	modeLoc = sizeLoc = leftMaskLoc = lutMaxLoc = -1;
+}
+
+
+#ifdef GL_VERSION_3_0
+
+static bool glError(void)
+{
+	bool ret = false;
+	GLenum e;
+
+	while((e = _glGetError()) != GL_NO_ERROR)
+	{
+		vglout.println("[VGL] ERROR: OpenGL error 0x%.4x", e);
+		ret = true;
+	}
+	return ret;
+}
+
+
+static GLuint compileShader(GLenum type, const char *source)
+{
+	GLuint shader = _glCreateShader(type);
+	GLint status = GL_FALSE;
+
+	if(!shader) return 0;
+	_glShaderSource(shader, 1, &source, NULL);
+	_glCompileShader(shader);
+	_glGetShaderiv(shader, GL_COMPILE_STATUS, &status);
+	if(status != GL_TRUE)
+	{
+		_glDeleteShader(shader);  return 0;
+	}
+	return shader;
+}
+
+
+bool GPUCompositor::buildProgram(void)
+{
+	GLuint vs = 0, fs = 0;
+	GLint status = GL_FALSE;
+
+	if(!(vs = compileShader(GL_VERTEX_SHADER, vertexShaderSource))
+		|| !(fs = compileShader(GL_FRAGMENT_SHADER, fragmentShaderSource))
+		|| !(program = _glCreateProgram()))
+	{
+		if(vs) _glDeleteShader(vs);
+		if(fs) _glDeleteShader(fs);
+		return false;
+	}
+	_glAttachShader(program, vs);
+	_glAttachShader(program, fs);
+	_glLinkProgram(program);
+	// The shaders are freed along with the program.
+	_glDeleteShader(vs);
+	_glDeleteShader(fs);
+	_glGetProgramiv(program, GL_LINK_STATUS, &status);
+	if(status != GL_TRUE) return false;
+
+	_glUseProgram(program);
+	_glUniform1i(_glGetUniformLocation(program, "left"), TEX_LEFT);
+	_glUniform1i(_glGetUniformLocation(program, "right"), TEX_RIGHT);
+	_glUniform1i(_glGetUniformLocation(program, "lut"), TEX_LUT);
+	modeLoc = _glGetUniformLocation(program, "mode");
+	sizeLoc = _glGetUniformLocation(program, "size");
+	leftMaskLoc = _glGetUniformLocation(program, "leftMask");
+	lutMaxLoc = _glGetUniformLocation(program, "lutMax");
+	_glUseProgram(0);
+	return true;
+}
+
+
+bool GPUCompositor::init(void)
+{
+	const char *version = (const char *)_glGetString(GL_VERSION),
+		*ext = (const char *)_glGetString(GL_EXTENSIONS);
+	int major = 0, minor = 0;
+
+	if(!version || sscanf(version, "%d.%d", &major, &minor) < 2
+		|| (major < 3 && (major < 2 || !ext
+			|| !strstr(ext, "GL_ARB_framebuffer_object"))))
+	{
+		vglout.println("[VGL] WARNING: GPU composition requires OpenGL 3.0 or OpenGL 2.0 with");
+		vglout.println("[VGL]    GL_ARB_framebuffer_object.  Composing images on the CPU.");
+		return false;
+	}
+
+	glError();  // Clear previous error
+	_glGenTextures(4, tex);
+	_glGenFramebuffers(1, &fbo);
+	for(int i = 0; i < 4; i++)
+	{
+		_glActiveTexture(GL_TEXTURE0 + (i == TEX_OUTPUT ? 0 : i));
+		_glBindTexture(GL_TEXTURE_2D, tex[i]);
+		_glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+		_glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+		_glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		_glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	}
+	_glActiveTexture(GL_TEXTURE0);
+	if(!fbo || !tex[TEX_OUTPUT] || !buildProgram() || glError())
+	{
+		vglout.println("[VGL] WARNING: Could not initialize GPU composition.  Composing images on");
+		vglout.println("[VGL]    the CPU.");
+		return false;
+	}
+	if(fconfig.verbose)
+		vglout.println("[VGL] Using the GPU to compose images before readback");
+	return true;
+}
+
+
+// Gamma correction is performed using the lookup table in fconfig, stored as a
+// 16-bit luminance texture with one texel per input value.  The table entries
+// are scaled such that they are converted back to the same 8-bit or 10-bit
+// values when the FBO is written.
+
+void GPUCompositor::uploadLUT(bool tenBit)
+{
+	int size = tenBit ? 1024 : 256, max = size - 1;
+	unsigned short lut[1024];
+
+	if(lutGamma == fconfig.gamma && lutSize == size) return;
+	for(int i = 0; i < size; i++)
+	{
+		int value = tenBit ? fconfig.gamma_lut10[i] : fconfig.gamma_lut[i];
+		lut[i] = (unsigned short)((value * 65535 + max / 2) / max);
+	}
+	_glActiveTexture(GL_TEXTURE0 + TEX_LUT);
+	_glBindTexture(GL_TEXTURE_2D, tex[TEX_LUT]);
+	_glTexImage2D(GL_TEXTURE_2D, 0, GL_LUMINANCE16, size, 1, 0, GL_LUMINANCE,
+		GL_UNSIGNED_SHORT, lut);
+	_glActiveTexture(GL_TEXTURE0);
+	lutGamma = fconfig.gamma;  lutSize = size;
+}
+
+
+bool GPUCompositor::compose(int width, int height, GLint leftBuf,
+	GLint rightBuf, int stereoMode, bool gamma, bool tenBit)
+{
+	if(supported < 0) supported = init() ? 1 : 0;
+	if(!supported) return false;
+
+	GLint format = tenBit ? GL_RGB10_A2 : GL_RGBA8;
+	bool stereo = (stereoMode >= 0);
+
+	glError();  // Clear previous error
+
+	if(width != texWidth || height != texHeight || tenBit != texTenBit)
+	{
+		for(int i = 0; i < 4; i++)
+		{
+			if(i == TEX_LUT) continue;
+			_glBindTexture(GL_TEXTURE_2D, tex[i]);
+			_glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, GL_RGBA,
+				GL_UNSIGNED_BYTE, NULL);
+		}
+		_glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+		_glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
+			GL_TEXTURE_2D, tex[TEX_OUTPUT], 0);
+		if(_glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+		{
+			vglout.println("[VGL] WARNING: GPU composition FBO is incomplete.  Composing images on the");
+			vglout.println("[VGL]    CPU.");
+			unbind();  supported = 0;
+			return false;
+		}
+		backend::bindFramebuffer(GL_FRAMEBUFFER, 0);
+		texWidth = width;  texHeight = height;  texTenBit = tenBit;
+	}
+	if(gamma) uploadLUT(tenBit);
+
+	// Copy the eye buffers into the source textures.  This happens entirely on
+	// the GPU.
+	_glActiveTexture(GL_TEXTURE0 + TEX_LEFT);
+	_glBindTexture(GL_TEXTURE_2D, tex[TEX_LEFT]);
+	backend::readBuffer(leftBuf, true);
+	_glCopyTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, 0, 0, width, height);
+	if(stereo)
+	{
+		_glActiveTexture(GL_TEXTURE0 + TEX_RIGHT);
+		_glBindTexture(GL_TEXTURE_2D, tex[TEX_RIGHT]);
+		backend::readBuffer(rightBuf, true);
+		_glCopyTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, 0, 0, width, height);
+	}
+	if(gamma)
+	{
+		_glActiveTexture(GL_TEXTURE0 + TEX_LUT);
+		_glBindTexture(GL_TEXTURE_2D, tex[TEX_LUT]);
+	}
+
+	int mode = MODE_MONO;
+	GLfloat leftMask[3] = { 1.0f, 0.0f, 0.0f };
+	switch(stereoMode)
+	{
+		case RRSTEREO_REDCYAN:
+			mode = MODE_ANAGLYPH;  break;
+		case RRSTEREO_GREENMAGENTA:
+			mode = MODE_ANAGLYPH;  leftMask[0] = 0.0f;  leftMask[1] = 1.0f;  break;
+		case RRSTEREO_BLUEYELLOW:
+			mode = MODE_ANAGLYPH;  leftMask[0] = 0.0f;  leftMask[2] = 1.0f;  break;
+		case RRSTEREO_INTERLEAVED:
+			mode = MODE_INTERLEAVED;  break;
+		case RRSTEREO_TOPBOTTOM:
+			mode = MODE_TOPBOTTOM;  break;
+		case RRSTEREO_SIDEBYSIDE:
+			mode = MODE_SIDEBYSIDE;  break;
+	}
+
+	_glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+	_glDisable(GL_DITHER);
+	_glViewport(0, 0, width, height);
+	_glUseProgram(program);
+	_glUniform1i(modeLoc, mode);
+	_glUniform2f(sizeLoc, (GLfloat)width, (GLfloat)height);
+	_glUniform3f(leftMaskLoc, leftMask[0], leftMask[1], leftMask[2]);
+	_glUniform1f(lutMaxLoc, gamma ? (GLfloat)(lutSize - 1) : 0.0f);
+	_glRecti(-1, -1, 1, 1);
+	_glUseProgram(0);
+	_glReadBuffer(GL_COLOR_ATTACHMENT0);
+
+	if(glError())
+	{
+		vglout.println("[VGL] WARNING: GPU composition failed.  Composing images on the CPU.");
+		unbind();  supported = 0;
+		return false;
+	}
+	return true;
+}
+
+
+void GPUCompositor::unbind(void)
+{
+	_glUseProgram(0);
+	backend::bindFramebuffer(GL_FRAMEBUFFER, 0);
+	for(int i = TEX_LUT; i >= TEX_LEFT; i--)
+	{
+		_glActiveTexture(GL_TEXTURE0 + i);
+		_glBindTexture(GL_TEXTURE_2D, 0);
+	}
+}
+
+
+#else
+
+bool GPUCompositor::compose(int width, int height, GLint leftBuf,
+	GLint rightBuf, int stereoMode, bool gamma, bool tenBit)
+{
+	if(supported < 0)
+	{
+		vglout.println("[VGL] WARNING: GPU composition support not compiled in.  Rebuild VGL on a");
+		vglout.println("[VGL]    system that has OpenGL 3.0 or later.");
+		supported = 0;
+	}
+	return false;
+}
+
+
+void GPUCompositor::unbind(void)
+{
+}
+
+#endif
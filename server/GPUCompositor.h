@@ -0,0 +1,74 @@
+/* Copyright (C)2018 D. R. Commander
+ *
+ * This library is free software and may be redistributed and/or modified under
+ * the terms of the wxWindows Library License, Version 3.1 or (at your option)
+ * any later version.  The full license is in the LICENSE.txt file included
+ * with this distribution.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * wxWindows Library License for more details.
+ */
+
+#ifndef __GPUCOMPOSITOR_H__
+#define __GPUCOMPOSITOR_H__
+
+#include "faker-sym.h"
+
+
+namespace vglserver
+{
+	// Composes the final image on the 3D X server's GPU, prior to readback.  The
+	// left and right eye buffers are combined into an anaglyphic or passive
+	// stereo image, and/or gamma correction is applied, in a single shader pass
+	// that renders into a framebuffer object (FBO.)  Thus, only one frame-sized
+	// readback is required, rather than one per eye (or, with anaglyphic stereo,
+	// one per color component), and the CPU never has to touch the pixels
+	// before they are compressed or sent.
+	//
+	// All methods must be called with the readback context current.  The GL
+	// objects belong to that context, so reset() must be called whenever the
+	// context is destroyed.
+
+	class GPUCompositor
+	{
+		public:
+
+			GPUCompositor(void) { reset(); }
+
+			// Forget about the GL objects (without deleting them) and re-probe
+			// the context the next time compose() is called
+			void reset(void);
+
+			// Copy the specified buffers of the current drawable into textures,
+			// compose the final image in the FBO, and leave the FBO bound as the
+			// read framebuffer.  stereoMode is an anaglyphic or passive stereo
+			// mode, or -1 if only gamma correction should be performed (in which
+			// case rightBuf is ignored.)  If tenBit is true, then the composition
+			// is performed with 10 bits per component.  Returns false if the
+			// context does not support GPU composition or an error occurred, in
+			// which case the caller should fall back to composing the image on the
+			// CPU.
+			bool compose(int width, int height, GLint leftBuf, GLint rightBuf,
+				int stereoMode, bool gamma, bool tenBit);
+
+			// Unbind the FBO, textures, and shader program, so that subsequent
+			// operations in the readback context are unaffected
+			void unbind(void);
+
+		private:
+
+			bool init(void);
+			bool buildProgram(void);
+			void uploadLUT(bool tenBit);
+
+			int supported;  // -1 = not yet probed
+			GLuint fbo, program, tex[4];
+			int texWidth, texHeight;  bool texTenBit;
+			double lutGamma;  int lutSize;
+			GLint modeLoc, sizeLoc, leftMaskLoc, lutMaxLoc;
+	};
+}
+
+#endif  // __GPUCOMPOSITOR_H__
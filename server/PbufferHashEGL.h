@@ -0,0 +1,97 @@
+/* Copyright (C)2018 D. R. Commander
+ *
+ * This library is free software and may be redistributed and/or modified under
+ * the terms of the wxWindows Library License, Version 3.1 or (at your option)
+ * any later version.  The full license is in the LICENSE.txt file included
+ * with this distribution.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * wxWindows Library License for more details.
+ */
+
+#ifndef __PBUFFERHASHEGL_H__
+#define __PBUFFERHASHEGL_H__
+
+#include "FakePbuffer.h"
+#include "Hash.h"
+
+
+#define HASH  Hash<GLXDrawable, void *, FakePbuffer *>
+
+// This maps a GLXDrawable ID to a FakePbuffer instance (EGL back end only.)
+// The FakePbuffer instances are deleted by the back end, since a context must
+// be current in order to delete them.
+
+namespace vglserver
+{
+	class PbufferHashEGL : public HASH
+	{
+		public:
+
+			static PbufferHashEGL *getInstance(void)
+			{
+				if(instance == NULL)
+				{
+					vglutil::CriticalSection::SafeLock l(instanceMutex);
+					if(instance == NULL) instance = new PbufferHashEGL;
+				}
+				return instance;
+			}
+
+			static bool isAlloc(void) { return instance != NULL; }
+
+			void add(FakePbuffer *pb)
+			{
+				if(!pb) _throw("Invalid argument");
+				HASH::add(pb->getID(), NULL, pb);
+			}
+
+			FakePbuffer *find(GLXDrawable draw)
+			{
+				if(!draw) return NULL;
+				return HASH::find(draw, NULL);
+			}
+
+			void remove(GLXDrawable draw)
+			{
+				if(!draw) _throw("Invalid argument");
+				HASH::remove(draw, NULL);
+			}
+
+			// Called when a context is destroyed
+			void removeContext(GLXContext ctx)
+			{
+				vglutil::CriticalSection::SafeLock l(mutex);
+				for(HashEntry *entry = start; entry; entry = entry->next)
+					if(entry->value) entry->value->removeContext(ctx);
+			}
+
+		private:
+
+			~PbufferHashEGL(void)
+			{
+				HASH::kill();
+			}
+
+			FakePbuffer *attach(GLXDrawable key1, void *key2) { return NULL; }
+
+			bool compare(GLXDrawable key1, void *key2, HashEntry *entry)
+			{
+				return false;
+			}
+
+			void detach(HashEntry *entry) {}
+
+			static PbufferHashEGL *instance;
+			static vglutil::CriticalSection instanceMutex;
+	};
+}
+
+#undef HASH
+
+
+#define pbhashegl  (*(PbufferHashEGL::getInstance()))
+
+#endif  // __PBUFFERHASHEGL_H__
@@ -20,7 +20,7 @@
 #ifndef __TEMPCONTEXT_H__
 #define __TEMPCONTEXT_H__
 
-#include "faker-sym.h"
+#include "backend.h"
 #include "ContextHash.h"
 
 
@@ -33,25 +33,21 @@ namespace vglserver
 	{
 		public:
 
-			TempContext(Display *dpy, GLXDrawable draw, GLXDrawable read,
-				GLXContext ctx = _glXGetCurrentContext(), GLXFBConfig config = NULL,
-				int renderType = 0) : olddpy(_glXGetCurrentDisplay()),
-				oldctx(_glXGetCurrentContext()), newctx(NULL),
-				oldread(_glXGetCurrentReadDrawable()),
-				olddraw(_glXGetCurrentDrawable()), ctxChanged(false)
+			TempContext(GLXDrawable draw, GLXDrawable read,
+				GLXContext ctx = backend::getCurrentContext(),
+				GLXFBConfig config = NULL, int renderType = 0) :
+				oldctx(backend::getCurrentContext()), newctx(NULL),
+				oldread(backend::getCurrentReadDrawable()),
+				olddraw(backend::getCurrentDrawable()), ctxChanged(false)
 			{
-				if(!dpy) return;
-				if(!olddpy) olddpy = dpy;
 				if(read == EXISTING_DRAWABLE) read = oldread;
 				if(draw == EXISTING_DRAWABLE) draw = olddraw;
 				if(draw && read && !ctx && config && renderType)
-					newctx = ctx =
-						_glXCreateNewContext(dpy, config, renderType, NULL, True);
-				if(((read || draw) && ctx && dpy)
-					&& (oldread != read  || olddraw != draw || oldctx != ctx
-						|| olddpy != dpy))
+					newctx = ctx = backend::createContext(config, NULL, True, NULL);
+				if(((read || draw) && ctx)
+					&& (oldread != read || olddraw != draw || oldctx != ctx))
 				{
-					if(!_glXMakeContextCurrent(dpy, draw, read, ctx))
+					if(!backend::makeCurrent(draw, read, ctx))
 						_throw("Could not bind OpenGL context to window (window may have disappeared)");
 					// If oldctx has already been destroyed, then we don't want to
 					// restore it.  This can happen if the application is rendering to
@@ -66,12 +62,12 @@ namespace vglserver
 			{
 				if(ctxChanged)
 				{
-					_glXMakeContextCurrent(olddpy, olddraw, oldread, oldctx);
+					backend::makeCurrent(olddraw, oldread, oldctx);
 					ctxChanged = false;
 				}
 				if(newctx)
 				{
-					_glXDestroyContext(olddpy, newctx);  newctx = NULL;
+					backend::destroyContext(newctx);  newctx = NULL;
 				}
 			}
 
@@ -82,7 +78,6 @@ namespace vglserver
 
 		private:
 
-			Display *olddpy;
 			GLXContext oldctx, newctx;
 			GLXDrawable oldread, olddraw;
 			bool ctxChanged;
@@ -39,7 +39,8 @@ static void *loadsym(void *dllhnd, const char *symbol)
 }
 
 
-TransPlugin::TransPlugin(Display *dpy, Window win, char *name)
+TransPlugin::TransPlugin(Display *dpy, Window win, char *name) :
+	_RRTransSetCallback(NULL), version(1), maxInFlight(1), inFlight(0), seq(0)
 {
 	if(!name || strlen(name) < 1) _throw("Transport name is empty or NULL!");
 	const char *err = NULL;
@@ -64,7 +65,36 @@ TransPlugin::TransPlugin(Display *dpy, Window win, char *name)
 		(_RRTransSendFrameType)loadsym(dllhnd, "RRTransSendFrame");
 	_RRTransDestroy = (_RRTransDestroyType)loadsym(dllhnd, "RRTransDestroy");
 	_RRTransGetError = (_RRTransGetErrorType)loadsym(dllhnd, "RRTransGetError");
+	// RRTransGetVersion() is optional.  Plugins that don't export it implement
+	// version 1 of the API.
+	_RRTransGetVersionType _RRTransGetVersion =
+		(_RRTransGetVersionType)dlsym(dllhnd, "RRTransGetVersion");
+	if(_RRTransGetVersion && (version = _RRTransGetVersion()) < 1)
+		_throw("Invalid plugin API version");
+	if(version >= 2)
+		_RRTransSetCallback =
+			(_RRTransSetCallbackType)loadsym(dllhnd, "RRTransSetCallback");
 	if(!(handle = _RRTransInit(dpy, win, &fconfig))) _throw(_RRTransGetError());
+	if(version >= 2)
+	{
+		if((maxInFlight = _RRTransSetCallback(handle, complete, this)) < 0)
+			_throw(_RRTransGetError());
+		if(maxInFlight < 1) maxInFlight = 1;
+	}
+}
+
+
+// Called by the plugin (possibly from another thread) when it has finished
+// processing a frame
+
+void TransPlugin::complete(void *context, unsigned int seq)
+{
+	TransPlugin *plugin = (TransPlugin *)context;
+	if(!plugin) return;
+
+	CriticalSection::SafeLock l(plugin->cbMutex);
+	if(plugin->inFlight > 0) plugin->inFlight--;
+	if(plugin->inFlight == 0) plugin->idle.signal();
 }
 
 
@@ -94,6 +124,11 @@ void TransPlugin::destroy(void)
 
 int TransPlugin::ready(void)
 {
+	if(version >= 2)
+	{
+		CriticalSection::SafeLock l(cbMutex);
+		return inFlight < maxInFlight;
+	}
 	CriticalSection::SafeLock l(mutex);
 	int ret = _RRTransReady(handle);
 	if(ret < 0) _throw(_RRTransGetError());
@@ -103,6 +138,17 @@ int TransPlugin::ready(void)
 
 void TransPlugin::synchronize(void)
 {
+	if(version >= 2)
+	{
+		while(true)
+		{
+			{
+				CriticalSection::SafeLock l(cbMutex);
+				if(inFlight < 1) return;
+			}
+			idle.wait();
+		}
+	}
 	CriticalSection::SafeLock l(mutex);
 	int ret = _RRTransSynchronize(handle);
 	if(ret < 0) _throw(_RRTransGetError());
@@ -121,6 +167,19 @@ RRFrame *TransPlugin::getFrame(int width, int height, int format, bool stereo)
 void TransPlugin::sendFrame(RRFrame *frame, bool sync)
 {
 	CriticalSection::SafeLock l(mutex);
+	unsigned int frameSeq = 0;
+	if(version >= 2)
+	{
+		CriticalSection::SafeLock l2(cbMutex);
+		frame->seq = frameSeq = ++seq;
+		inFlight++;
+	}
 	int ret = _RRTransSendFrame(handle, frame, sync);
-	if(ret < 0) _throw(_RRTransGetError());
+	if(ret < 0)
+	{
+		// The plugin won't call the completion callback for a frame that it
+		// failed to accept.
+		if(version >= 2) complete(this, frameSeq);
+		_throw(_RRTransGetError());
+	}
 }
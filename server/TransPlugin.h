@@ -27,6 +27,8 @@ typedef int (*_RRTransSynchronizeType)(void *);
 typedef int (*_RRTransSendFrameType)(void *, RRFrame *, int);
 typedef int (*_RRTransDestroyType)(void *);
 typedef const char *(*_RRTransGetErrorType)(void);
+typedef int (*_RRTransGetVersionType)(void);
+typedef int (*_RRTransSetCallbackType)(void *, RRTransCallback, void *);
 
 
 namespace vglserver
@@ -43,9 +45,12 @@ namespace vglserver
 			void synchronize(void);
 			RRFrame *getFrame(int width, int height, int format, bool stereo);
 			void sendFrame(RRFrame *frame, bool sync);
+			int getVersion(void) { return version; }
 
 		private:
 
+			static void complete(void *context, unsigned int seq);
+
 			_RRTransInitType _RRTransInit;
 			_RRTransConnectType _RRTransConnect;
 			_RRTransGetFrameType _RRTransGetFrame;
@@ -54,8 +59,15 @@ namespace vglserver
 			_RRTransSendFrameType _RRTransSendFrame;
 			_RRTransDestroyType _RRTransDestroy;
 			_RRTransGetErrorType _RRTransGetError;
+			_RRTransSetCallbackType _RRTransSetCallback;
 			vglutil::CriticalSection mutex;
 			void *dllhnd, *handle;
+			int version;
+			// Used only with version 2 and later of the plugin API
+			vglutil::CriticalSection cbMutex;
+			vglutil::Event idle;
+			int maxInFlight, inFlight;
+			unsigned int seq;
 	};
 }
 
@@ -18,6 +18,7 @@
 #include "fakerconfig.h"
 #include "vglutil.h"
 #include "Log.h"
+#include "Tracer.h"
 #include <fcntl.h>
 #include <sys/stat.h>
 
@@ -26,6 +27,23 @@ using namespace vglcommon;
 using namespace vglserver;
 
 
+// Maximum distance (in pixels) that the contents of a frame can move between
+// frames and still be detected by copy-rect detection
+#define MAXCOPYOFFSET  256
+
+// Size of the blocks that copy-rect detection compares
+#define COPYBLOCKSIZE  32
+
+
+// Stages of the image pipeline whose latency is measured on the server
+enum { STAGE_READBACK = 0, STAGE_QUEUE, STAGE_COMPRESS, STAGE_SEND,
+	STAGE_SERVER, NSTAGES };
+static const char *stageNames[NSTAGES] =
+{
+	"Readback", "Queue", "Compress", "Send", "Server"
+};
+
+
 #define ENDIANIZE(h) \
 { \
 	if(!littleendian()) \
@@ -106,11 +124,16 @@ void VGLTrans::sendHeader(rrframeheader h, bool eof)
 			if(fconfig.verbose)
 				vglout.println("[VGL] Client version: %d.%d", version.major,
 					version.minor);
+			if(version.major > 2 || (version.major == 2 && version.minor >= 3))
+				syncClock();
 		}
 	}
 	if((version.major < 2 || (version.major == 2 && version.minor < 1))
 		&& h.compress != RRCOMP_JPEG)
 		_throw("This compression mode requires VirtualGL Client v2.1 or later");
+	if((version.major < 2 || (version.major == 2 && version.minor < 2))
+		&& h.compress >= RRCOMP_LOSSLESS)
+		_throw("This compression mode requires VirtualGL Client v2.2 or later");
 	if(eof) h.flags = RR_EOF;
 	if(version.major == 1 && version.minor == 0)
 	{
@@ -137,24 +160,371 @@ void VGLTrans::sendHeader(rrframeheader h, bool eof)
 }
 
 
+// Send an End-of-Frame header, followed (if the client supports it) by the
+// sequence number and capture time of the frame, which the client uses to
+// measure end-to-end latency
+
+void VGLTrans::sendEOF(Frame *f, bool refinement)
+{
+	sendHeader(f->hdr, true);
+	if(version.major > 2 || (version.major == 2 && version.minor >= 3))
+	{
+		rreofinfo info;
+		memset(&info, 0, sizeof(rreofinfo));
+		if(!refinement)
+		{
+			info.seq = f->seq;
+			if(f->captureTime > 0.) PACK_TIME(info.capture, USEC(f->captureTime));
+			if(!littleendian()) info.seq = byteswap(info.seq);
+		}
+		send((char *)&info, sizeof_rreofinfo);
+	}
+}
+
+
+// Estimate the offset between the server's clock and the client's clock.
+// The probe with the shortest round-trip time gives the most accurate
+// estimate, since the client's reply was most likely sent halfway through
+// that round trip.
+
+void VGLTrans::syncClock(void)
+{
+	long long bestRTT = -1;
+	rrtime t;
+
+	clockOffset = 0;
+	for(int i = 0; i < RR_CLOCKPROBES; i++)
+	{
+		long long t1 = USEC(getTime()), t3;
+		PACK_TIME(t, t1);
+		send((char *)&t, sizeof_rrtime);
+		recv((char *)&t, sizeof_rrtime);
+		t3 = USEC(getTime());
+		if(bestRTT < 0 || t3 - t1 < bestRTT)
+		{
+			bestRTT = t3 - t1;
+			clockOffset = UNPACK_TIME(t) - (t1 + t3) / 2;
+		}
+	}
+	PACK_TIME(t, clockOffset);
+	send((char *)&t, sizeof_rrtime);
+	if(fconfig.verbose)
+		vglout.println("[VGL] Client clock offset: %lld us (round-trip time %lld us)",
+			clockOffset, bestRTT);
+}
+
+
 VGLTrans::VGLTrans(void) : nprocs(fconfig.np), socket(NULL), thread(NULL),
-	deadYet(false), dpynum(0)
+	deadYet(false), profLatency("Latency   ", NSTAGES, stageNames),
+	frameSeq(0), sendTime(0.), clockOffset(0), dpynum(0), tileState(NULL),
+	nTiles(0), tileStateW(0), tileStateH(0), tileSize(0), curTileSize(0),
+	lastFrameW(0), lastFrameH(0), changedPixels(0), losslessRef(NULL),
+	clientExact(false), projections(NULL),
+	rowSums(NULL), colSums(NULL), lastRowSums(NULL), lastColSums(NULL),
+	projW(0), projH(0), projValid(false), frameCallback(NULL),
+	frameContext(NULL)
 {
 	memset(&version, 0, sizeof(rrversion));
 	profTotal.setName("Total     ");
 }
 
 
+void VGLTrans::initTileState(Frame *f)
+{
+	int tilesizex = fconfig.tilesize ? fconfig.tilesize : f->hdr.width;
+	int tilesizey = fconfig.tilesize ? fconfig.tilesize : f->hdr.height;
+
+	if(tileState && f->hdr.width == tileStateW && f->hdr.height == tileStateH
+		&& fconfig.tilesize == tileSize)
+		return;
+
+	// This is an upper bound, since compressSend() merges partial tiles into
+	// their neighbors.
+	int n = ((f->hdr.width + tilesizex - 1) / tilesizex) *
+		((f->hdr.height + tilesizey - 1) / tilesizey);
+	if(n != nTiles || !tileState)
+	{
+		if(tileState) delete [] tileState;
+		_newcheck(tileState = new TileState[n]);
+		nTiles = n;
+	}
+	for(int i = 0; i < nTiles; i++)
+	{
+		tileState[i].changeTime = 0.;  tileState[i].refined = true;
+	}
+	tileStateW = f->hdr.width;  tileStateH = f->hdr.height;
+	tileSize = fconfig.tilesize;
+}
+
+
+bool VGLTrans::refinementPending(Frame *f)
+{
+	if(fconfig.refine <= 0. || !f || f->hdr.compress != RRCOMP_JPEG
+		|| !tileState)
+		return false;
+	for(int i = 0; i < nTiles; i++)
+		if(!tileState[i].refined) return true;
+	return false;
+}
+
+
+// Adaptive tile sizing: if (nearly) the whole frame changed last time, then
+// it will probably change again, so use tiles that are twice as large as
+// fconfig.tilesize in order to reduce the per-tile overhead.  Otherwise, use
+// fconfig.tilesize, and compressSend() will subdivide the changed tiles as
+// needed.  Returns 0 if adaptive tile sizing is disabled.
+
+int VGLTrans::adaptTileSize(Frame *f)
+{
+	if(fconfig.tilesize <= 0 || fconfig.mintilesize >= fconfig.tilesize
+		|| (fconfig.refine > 0. && f->hdr.compress == RRCOMP_JPEG))
+		return 0;
+
+	int newTileSize = fconfig.tilesize;
+	if(f->hdr.width == lastFrameW && f->hdr.height == lastFrameH
+		&& (double)changedPixels >= 0.9 * (double)(lastFrameW * lastFrameH))
+	{
+		// Make sure that there are still enough tiles to keep all of the
+		// compression threads busy.
+		int nx = f->hdr.width / (newTileSize * 2),
+			ny = f->hdr.height / (newTileSize * 2);
+		if(nprocs < 2 || max(nx, 1) * max(ny, 1) >= nprocs * 2)
+			newTileSize *= 2;
+	}
+	return newTileSize;
+}
+
+
+// Compute the sum of the color components in each row and each column of a
+// frame (the frame's projections.)  Rows are numbered from the top.
+
+static void getProjections(Frame *f, unsigned int *rowSums,
+	unsigned int *colSums)
+{
+	bool bu = (f->flags & FRAME_BOTTOMUP);
+	PF *pf = f->pf;
+
+	memset(colSums, 0, sizeof(unsigned int) * f->hdr.width);
+	for(int y = 0; y < f->hdr.height; y++)
+	{
+		unsigned char *pixel =
+			&f->bits[f->pitch * (bu ? f->hdr.height - y - 1 : y)];
+		unsigned int sum = 0;
+		for(int x = 0; x < f->hdr.width; x++, pixel += pf->size)
+		{
+			unsigned int value =
+				pixel[pf->rindex] + pixel[pf->gindex] + pixel[pf->bindex];
+			sum += value;  colSums[x] += value;
+		}
+		rowSums[y] = sum;
+	}
+}
+
+
+// Find the offset d that minimizes the mean absolute difference between
+// sums[i] and lastSums[i - d] in the region where the two overlap.  The
+// smallest such offset wins a tie.
+
+static int findOffset(unsigned int *sums, unsigned int *lastSums, int n)
+{
+	int maxOffset = min(MAXCOPYOFFSET, n / 2), bestOffset = 0;
+	double bestCost = -1.;
+
+	for(int d = -maxOffset; d <= maxOffset; d++)
+	{
+		int start = max(0, d), end = min(n, n + d);
+		double cost = 0.;
+		for(int i = start; i < end; i++)
+			cost += abs((int)sums[i] - (int)lastSums[i - d]);
+		cost /= (double)(end - start);
+		if(bestCost < 0. || cost < bestCost
+			|| (cost == bestCost && abs(d) < abs(bestOffset)))
+		{
+			bestCost = cost;  bestOffset = d;
+		}
+	}
+	return bestOffset;
+}
+
+
+// Copy-rect detection: if the contents of the frame have been scrolled or
+// panned, then the client can reproduce most of the new frame by copying
+// pixels that it already has.  The displacement is estimated by comparing the
+// projections of this frame with those of the last frame.  The region of the
+// frame that could have been copied is then divided into blocks, and each
+// block is compared with the displaced block in the last frame.  Each run of
+// matching blocks in a row is sent as an RRCOMP_COPYRECT tile, and the same
+// copies are applied to a reference frame (a copy of the last frame), so that
+// compressSend() can compare the new frame with the contents of the client's
+// frame buffer.  The copy tiles are ordered such that no copy tile overwrites
+// the source of a subsequent copy tile.  Returns the frame with which this
+// frame should be compared (the last frame if no copy tiles were sent.)
+
+Frame *VGLTrans::sendCopyRects(Frame *f, Frame *lastf, long &bytes)
+{
+	int width = f->hdr.width, height = f->hdr.height;
+	bool haveLast = (projValid && projW == width && projH == height);
+
+	projValid = false;
+	if(!fconfig.copyrect || !fconfig.interframe || f->stereo
+		|| f->pf->bpc != 8 || f->hdr.compress == RRCOMP_YUV
+		|| version.major < 2 || (version.major == 2 && version.minor < 2))
+		return lastf;
+
+	if(!projections || width != projW || height != projH)
+	{
+		if(projections) delete [] projections;
+		_newcheck(projections = new unsigned int[(width + height) * 2]);
+		rowSums = projections;  colSums = &rowSums[height];
+		lastRowSums = &colSums[width];  lastColSums = &lastRowSums[height];
+		projW = width;  projH = height;  haveLast = false;
+	}
+	getProjections(f, rowSums, colSums);
+
+	int dx = 0, dy = 0;
+	if(haveLast && lastf && lastf != f)
+	{
+		dx = findOffset(colSums, lastColSums, width);
+		dy = findOffset(rowSums, lastRowSums, height);
+	}
+	unsigned int *temp = rowSums;  rowSums = lastRowSums;  lastRowSums = temp;
+	temp = colSums;  colSums = lastColSums;  lastColSums = temp;
+	projValid = true;
+	if(dx == 0 && dy == 0) return lastf;
+
+	// The region of the frame whose source is within the last frame
+	int x0 = max(dx, 0), y0 = max(dy, 0);
+	int x1 = min(width, width + dx), y1 = min(height, height + dy);
+	int nx = (x1 - x0 + COPYBLOCKSIZE - 1) / COPYBLOCKSIZE;
+	int ny = (y1 - y0 + COPYBLOCKSIZE - 1) / COPYBLOCKSIZE;
+	bool refine = (fconfig.refine > 0. && f->hdr.compress == RRCOMP_JPEG
+		&& tileState);
+	double now = refine ? getTime() : 0.;
+	Frame *ref = NULL;
+
+	for(int r = 0; r < ny; r++)
+	{
+		int y = y0 + (dy > 0 ? ny - r - 1 : r) * COPYBLOCKSIZE;
+		int h = min(COPYBLOCKSIZE, y1 - y);
+		int runX0 = -1, runX1 = -1;  bool runChanged = false;
+
+		for(int c = 0; c <= nx; c++)
+		{
+			if(c < nx)
+			{
+				int x = x0 + (dx > 0 ? nx - c - 1 : c) * COPYBLOCKSIZE;
+				int w = min(COPYBLOCKSIZE, x1 - x);
+				if(f->tileEquals(lastf, x, y, w, h, x - dx, y - dy))
+				{
+					if(runX0 < 0) { runX0 = x;  runX1 = x + w; }
+					else { runX0 = min(runX0, x);  runX1 = max(runX1, x + w); }
+					if(!runChanged && !f->tileEquals(lastf, x, y, w, h))
+						runChanged = true;
+					continue;
+				}
+			}
+			if(runX0 < 0) continue;
+
+			// Send the run of matching blocks, unless none of them have changed.
+			if(runChanged)
+			{
+				int srcX = runX0 - dx, srcY = y - dy;
+				unsigned char src[RR_COPYRECTSIZE] = {
+					(unsigned char)(srcX & 0xff), (unsigned char)(srcX >> 8),
+					(unsigned char)(srcY & 0xff), (unsigned char)(srcY >> 8)
+				};
+				rrframeheader h1 = f->hdr;
+				h1.x += runX0;  h1.y += y;  h1.width = runX1 - runX0;  h1.height = h;
+				h1.compress = RRCOMP_COPYRECT;  h1.size = RR_COPYRECTSIZE;
+				sendHeader(h1);
+				send((char *)src, RR_COPYRECTSIZE);
+				bytes += RR_COPYRECTSIZE;
+
+				if(!ref)
+				{
+					rrframeheader h2 = lastf->hdr;
+					ref = &refFrame;
+					ref->init(h2, lastf->pf->id, lastf->flags);
+					for(int i = 0; i < height; i++)
+						memcpy(&ref->bits[ref->pitch * i], &lastf->bits[lastf->pitch * i],
+							width * lastf->pf->size);
+				}
+				ref->copyRect(srcX, srcY, runX0, y, runX1 - runX0, h);
+
+				// The pixels that were copied may not have been refined yet, so
+				// treat the tiles that contain them as having changed.
+				if(refine)
+				{
+					int tilesizex = fconfig.tilesize ? fconfig.tilesize : width;
+					int tilesizey = fconfig.tilesize ? fconfig.tilesize : height;
+					int ntx = 0, nty = 0, i;
+					for(i = 0; i < width; i += tilesizex, ntx++)
+						if(width - i < (3 * tilesizex / 2)) i += tilesizex;
+					for(i = 0; i < height; i += tilesizey, nty++)
+						if(height - i < (3 * tilesizey / 2)) i += tilesizey;
+					for(int ty = min(y / tilesizey, nty - 1);
+						ty <= min((y + h - 1) / tilesizey, nty - 1); ty++)
+					{
+						for(int tx = min(runX0 / tilesizex, ntx - 1);
+							tx <= min((runX1 - 1) / tilesizex, ntx - 1); tx++)
+						{
+							int n = ty * ntx + tx;
+							if(n < nTiles)
+							{
+								tileState[n].changeTime = now;  tileState[n].refined = false;
+							}
+						}
+					}
+				}
+			}
+			runX0 = -1;  runChanged = false;
+		}
+	}
+	return ref ? ref : lastf;
+}
+
+
+long VGLTrans::compressFrame(Compressor **comp, Thread **cthread, Frame *f,
+	Frame *lastf)
+{
+	long bytes = 0;
+	int i, np = nprocs;
+
+	if(f->hdr.compress == RRCOMP_YUV) np = 1;
+	if(np > 1)
+	{
+		for(i = 1; i < np; i++)
+		{
+			cthread[i]->checkError();  comp[i]->go(f, lastf);
+		}
+	}
+	comp[0]->compressSend(f, lastf);
+	bytes += comp[0]->bytes;
+	changedPixels = comp[0]->pixels;
+	if(np > 1)
+	{
+		for(i = 1; i < np; i++)
+		{
+			comp[i]->stop();  cthread[i]->checkError();  comp[i]->send();
+			bytes += comp[i]->bytes;
+			changedPixels += comp[i]->pixels;
+		}
+	}
+	return bytes;
+}
+
+
 void VGLTrans::run(void)
 {
-	Frame *lastf = NULL, *f = NULL;
+	Frame *lastf = NULL, *f = NULL, *unsent = NULL;
 	long bytes = 0;
-	Timer timer, sleepTimer;  double err = 0.;  bool first = true;
+	Timer refineTimer;
 	int i;
 
 	try
 	{
 		VGLTrans::Compressor *comp[MAXPROCS];  Thread *cthread[MAXPROCS];
+		Tracer::setThreadName("VGL Transport");
 		if(fconfig.verbose)
 			vglout.println("[VGL] Using %d / %d CPU's for compression", nprocs,
 				numprocs());
@@ -168,59 +538,71 @@ void VGLTrans::run(void)
 
 		while(!deadYet)
 		{
-			int np;
 			void *ftemp = NULL;
 
-			q.get(&ftemp);  f = (Frame *)ftemp;  if(deadYet) break;
-			if(!f) _throw("Queue has been shut down");
-			ready.signal();
-			np = nprocs;  if(f->hdr.compress == RRCOMP_YUV) np = 1;
-			if(np > 1)
+			if(refinementPending(lastf))
 			{
-				for(i = 1; i < np; i++)
+				// Wait until either a new frame arrives or the tiles that changed in
+				// the last frame have been static long enough to be refined, then
+				// re-send those tiles at the refinement quality.
+				if(!q.timedGet(&ftemp, fconfig.refine - refineTimer.elapsed()))
 				{
-					cthread[i]->checkError();  comp[i]->go(f, lastf);
+					if(compressFrame(comp, cthread, lastf, lastf) > 0)
+						sendEOF(lastf, true);
+					q.get(&ftemp);
 				}
 			}
-			comp[0]->compressSend(f, lastf);
-			bytes += comp[0]->bytes;
-			if(np > 1)
-			{
-				for(i = 1; i < np; i++)
-				{
-					comp[i]->stop();  cthread[i]->checkError();  comp[i]->send();
-					bytes += comp[i]->bytes;
-				}
-			}
-			sendHeader(f->hdr, true);
+			else q.get(&ftemp);
+
+			f = (Frame *)ftemp;  if(deadYet) break;
+			if(!f) _throw("Queue has been shut down");
+			unsent = f;
+			ready.signal();
+			double compressStart = getTime();
+			if(f->queueTime > 0.)
+				profLatency.addSample(STAGE_QUEUE, compressStart - f->queueTime);
+			if(f->captureTime > 0. && f->readbackTime > 0.)
+				profLatency.addSample(STAGE_READBACK,
+					f->readbackTime - f->captureTime);
+			sendTime = 0.;
+
+			if(fconfig.refine > 0. && f->hdr.compress == RRCOMP_JPEG)
+				initTileState(f);
+			curTileSize = adaptTileSize(f);
+			Frame *reff = sendCopyRects(f, lastf, bytes);
+			// Lossless tiles can be predicted from the previous frame only if the
+			// client's frame buffer contains exactly that frame.
+			bool exact = (f->hdr.compress == RRCOMP_LOSSLESS
+				|| f->hdr.compress == RRCOMP_RGB) && !f->stereo && f->pf->bpc == 8;
+			if(exact && clientExact && reff && f->hdr.compress == RRCOMP_LOSSLESS
+				&& reff->hdr.width == f->hdr.width
+				&& reff->hdr.height == f->hdr.height && reff->pf->id == f->pf->id)
+				losslessRef = reff;
+			bytes += compressFrame(comp, cthread, f, reff);
+			losslessRef = NULL;
+			// The tiles that were not sent are exact only if the client's frame
+			// buffer already was.
+			clientExact = exact && (clientExact
+				|| changedPixels >= (long)f->hdr.width * f->hdr.height);
+			lastFrameW = f->hdr.width;  lastFrameH = f->hdr.height;
+			profLatency.addSample(STAGE_COMPRESS,
+				getTime() - compressStart - sendTime);
+			sendEOF(f);
+			frameDone(f);  unsent = NULL;
+			double now = getTime();
+			profLatency.addSample(STAGE_SEND, sendTime);
+			if(f->captureTime > 0.)
+				profLatency.addSample(STAGE_SERVER, now - f->captureTime);
+			profLatency.endFrame();
+			refineTimer.start();
 
 			profTotal.endFrame(f->hdr.width * f->hdr.height, bytes, 1);
 			bytes = 0;
 			profTotal.startFrame();
 
-			if(fconfig.flushdelay > 0.)
-			{
-				long usec = (long)(fconfig.flushdelay * 1000000.);
-				if(usec > 0) usleep(usec);
-			}
-			if(fconfig.fps > 0.)
-			{
-				double elapsed = timer.elapsed();
-				if(first) first = false;
-				else
-				{
-					if(elapsed < 1. / fconfig.fps)
-					{
-						sleepTimer.start();
-						long usec = (long)((1. / fconfig.fps - elapsed - err) * 1000000.);
-						if(usec > 0) usleep(usec);
-						double sleepTime = sleepTimer.elapsed();
-						err = sleepTime - (1. / fconfig.fps - elapsed - err);
-						if(err < 0.) err = 0.;
-					}
-				}
-				timer.start();
-			}
+			double interval = fconfig.fps > 0. ? 1. / fconfig.fps : 0.;
+			if(fconfig.flushdelay > interval) interval = fconfig.flushdelay;
+			pacer.wait(interval);
 
 			if(lastf) lastf->signalComplete();
 			lastf = f;
@@ -239,6 +621,17 @@ void VGLTrans::run(void)
 	catch(Error &e)
 	{
 		if(thread) thread->setError(e);
+		if(frameCallback)
+		{
+			// The frames that will never be sent are finished as well.
+			void *ftemp = NULL;
+			if(unsent) frameDone(unsent);
+			do
+			{
+				ftemp = NULL;  q.get(&ftemp, true);
+				if(ftemp) frameDone((Frame *)ftemp);
+			} while(ftemp);
+		}
 		ready.signal();
 		throw;
 	}
@@ -268,6 +661,8 @@ Frame *VGLTrans::getFrame(int width, int height, int pixelFormat, int flags,
 	hdr.width = hdr.framew = width;
 	hdr.height = hdr.frameh = height;
 	f->init(hdr, pixelFormat, flags, stereo);
+	f->seq = 0;
+	f->captureTime = f->readbackTime = f->queueTime = 0.;
 	return f;
 }
 
@@ -285,9 +680,14 @@ void VGLTrans::synchronize(void)
 }
 
 
-static void _VGLTrans_spoilfct(void *f)
+void VGLTrans::spoilFrame(void *f, void *vglconn)
 {
-	if(f) ((Frame *)f)->signalComplete();
+	if(f)
+	{
+		Tracer::instant("Spoil", ((Frame *)f)->seq);
+		if(vglconn) ((VGLTrans *)vglconn)->frameDone((Frame *)f);
+		((Frame *)f)->signalComplete();
+	}
 }
 
 
@@ -295,7 +695,9 @@ void VGLTrans::sendFrame(Frame *f)
 {
 	if(thread) thread->checkError();
 	f->hdr.dpynum = dpynum;
-	q.spoil((void *)f, _VGLTrans_spoilfct);
+	f->seq = ++frameSeq;
+	f->queueTime = getTime();
+	q.spoil((void *)f, spoilFrame, this);
 }
 
 
@@ -304,21 +706,35 @@ void VGLTrans::Compressor::compressSend(Frame *f, Frame *lastf)
 	CompressedFrame cframe;
 
 	if(!f) return;
-	int tilesizex = fconfig.tilesize ? fconfig.tilesize : f->hdr.width;
-	int tilesizey = fconfig.tilesize ? fconfig.tilesize : f->hdr.height;
+	int tileSize = parent->curTileSize > 0 ? parent->curTileSize :
+		fconfig.tilesize;
+	int tilesizex = tileSize ? tileSize : f->hdr.width;
+	int tilesizey = tileSize ? tileSize : f->hdr.height;
 	int i, j, n = 0;
 
+	bytes = pixels = 0;
 	if(f->hdr.compress == RRCOMP_YUV)
 	{
 		profComp.startFrame();
-		cframe = *f;
+		{
+			TraceScope trace("Compress", f->seq);
+			cframe = *f;
+		}
 		profComp.endFrame(f->hdr.framew * f->hdr.frameh, 0, 1);
 		parent->sendHeader(cframe.hdr);
 		parent->send((char *)cframe.bits, cframe.hdr.size);
 		return;
 	}
 
-	bytes = 0;
+	// Progressive refinement: tiles that have changed are sent using the normal
+	// (motion) quality, and tiles that have remained static for fconfig.refine
+	// seconds are re-sent once using the refinement quality (or losslessly.)
+	// A refinement pass (f == lastf) sends only the tiles that are due.
+	bool refine = (fconfig.refine > 0. && f->hdr.compress == RRCOMP_JPEG
+		&& parent->tileState);
+	bool refinePass = (f == lastf);
+	double now = refine ? getTime() : 0.;
+
 	for(i = 0; i < f->hdr.height; i += tilesizey)
 	{
 		int height = tilesizey, y = i;
@@ -336,38 +752,136 @@ void VGLTrans::Compressor::compressSend(Frame *f, Frame *lastf)
 				width = f->hdr.width - j;  j += tilesizex;
 			}
 			if(n % nprocs != myRank) continue;
-			if(fconfig.interframe)
+			bool refineTile = false;
+			if(refine && n < parent->nTiles)
 			{
-				if(f->tileEquals(lastf, x, y, width, height)) continue;
+				TileState &ts = parent->tileState[n];
+				if(!f->tileEquals(lastf, x, y, width, height))
+				{
+					ts.changeTime = now;  ts.refined = false;
+				}
+				else if(!ts.refined && now - ts.changeTime >= fconfig.refine)
+					ts.refined = refineTile = true;
+				else if(fconfig.interframe || refinePass) continue;
+				else refineTile = ts.refined;
 			}
-			Frame *tile = f->getTile(x, y, width, height);
-			CompressedFrame *ctile = NULL;
-			if(myRank > 0) { _newcheck(ctile = new CompressedFrame()); }
-			else ctile = &cframe;
-			profComp.startFrame();
-			*ctile = *tile;
-			double frames = (double)(tile->hdr.width * tile->hdr.height) /
-				(double)(tile->hdr.framew * tile->hdr.frameh);
-			profComp.endFrame(tile->hdr.width * tile->hdr.height, 0, frames);
-			bytes += ctile->hdr.size;
-			if(ctile->stereo) bytes += ctile->rhdr.size;
-			delete tile;
-			if(myRank == 0)
+			else if(fconfig.interframe)
 			{
-				parent->sendHeader(ctile->hdr);
-				parent->send((char *)ctile->bits, ctile->hdr.size);
-				if(ctile->stereo && ctile->rbits)
+				if(f->tileEquals(lastf, x, y, width, height)) continue;
+				if(parent->curTileSize > 0)
 				{
-					parent->sendHeader(ctile->rhdr);
-					parent->send((char *)ctile->rbits, ctile->rhdr.size);
+					compressChanged(f, lastf, x, y, width, height, cframe);
+					continue;
 				}
 			}
-			else
+			compressTile(f, x, y, width, height, refineTile, refine ? n : -1,
+				cframe);
+		}
+	}
+}
+
+
+// Adaptive tile sizing: split a changed tile into quadrants and send only the
+// quadrants that have changed, recursing until the quadrants would be smaller
+// than fconfig.mintilesize.  If all four quadrants have changed, then the
+// tile is sent whole, since that is more efficient.
+
+void VGLTrans::Compressor::compressChanged(Frame *f, Frame *lastf, int x,
+	int y, int width, int height, CompressedFrame &cframe)
+{
+	if(width >= fconfig.mintilesize * 2 && height >= fconfig.mintilesize * 2)
+	{
+		// Keep the quadrant boundaries aligned with JPEG MCU boundaries.
+		int w0 = (width / 2 + 15) & (~15), h0 = (height / 2 + 15) & (~15);
+		if(w0 >= width) w0 = width / 2;
+		if(h0 >= height) h0 = height / 2;
+		int qx[4] = { x, x + w0, x, x + w0 }, qy[4] = { y, y, y + h0, y + h0 };
+		int qw[4] = { w0, width - w0, w0, width - w0 };
+		int qh[4] = { h0, h0, height - h0, height - h0 };
+		bool changed[4];  int nChanged = 0;
+
+		for(int q = 0; q < 4; q++)
+		{
+			changed[q] = !f->tileEquals(lastf, qx[q], qy[q], qw[q], qh[q]);
+			if(changed[q]) nChanged++;
+		}
+		if(nChanged < 4)
+		{
+			for(int q = 0; q < 4; q++)
 			{
-				store(ctile);
+				if(changed[q])
+					compressChanged(f, lastf, qx[q], qy[q], qw[q], qh[q], cframe);
 			}
+			return;
 		}
 	}
+	compressTile(f, x, y, width, height, false, -1, cframe);
+}
+
+
+void VGLTrans::Compressor::compressTile(Frame *f, int x, int y, int width,
+	int height, bool refineTile, int tileIndex, CompressedFrame &cframe)
+{
+	bool adaptive = (fconfig.adaptive && (parent->version.major > 2
+		|| (parent->version.major == 2 && parent->version.minor >= 2)));
+	bool stereoDelta = (fconfig.stereodelta && (parent->version.major > 2
+		|| (parent->version.major == 2 && parent->version.minor >= 4)));
+
+	Frame *tile = f->getTile(x, y, width, height);
+	if(adaptive) tile->flags |= FRAME_ADAPTIVE;
+	if(stereoDelta) tile->flags |= FRAME_STEREODELTA;
+	if(refineTile)
+	{
+		if(fconfig.refinequal > 0)
+			tile->hdr.qual = fconfig.refinequal;
+		else if(parent->version.major > 2
+			|| (parent->version.major == 2 && parent->version.minor >= 2))
+		{
+			tile->hdr.compress = RRCOMP_LOSSLESS;
+			tile->hdr.qual = fconfig.effort;
+		}
+		else if(parent->version.major == 2 && parent->version.minor == 1)
+			tile->hdr.compress = RRCOMP_RGB;
+		else tile->hdr.qual = 100;
+		tile->hdr.subsamp = 1;
+	}
+	else if(parent->losslessRef && tile->hdr.compress == RRCOMP_LOSSLESS)
+		tile->ref = parent->losslessRef->getTile(x, y, width, height);
+	CompressedFrame *ctile = NULL;
+	if(myRank > 0) { _newcheck(ctile = new CompressedFrame()); }
+	else ctile = &cframe;
+	profComp.startFrame();
+	{
+		TraceScope trace("Compress Tile", tileIndex);
+		*ctile = *tile;
+	}
+	double frames = (double)(tile->hdr.width * tile->hdr.height) /
+		(double)(tile->hdr.framew * tile->hdr.frameh);
+	profComp.endFrame(tile->hdr.width * tile->hdr.height, 0, frames);
+	// Solid and palette tiles are already lossless.
+	if(tileIndex >= 0 && tileIndex < parent->nTiles
+		&& (ctile->hdr.compress == RRCOMP_SOLID
+			|| ctile->hdr.compress == RRCOMP_PALETTE))
+		parent->tileState[tileIndex].refined = true;
+	bytes += ctile->hdr.size;
+	if(ctile->stereo) bytes += ctile->rhdr.size;
+	pixels += width * height;
+	if(tile->ref) delete tile->ref;
+	delete tile;
+	if(myRank == 0)
+	{
+		parent->sendHeader(ctile->hdr);
+		parent->send((char *)ctile->bits, ctile->hdr.size);
+		if(ctile->stereo && ctile->rbits)
+		{
+			parent->sendHeader(ctile->rhdr);
+			parent->send((char *)ctile->rbits, ctile->rhdr.size);
+		}
+	}
+	else
+	{
+		store(ctile);
+	}
 }
 
 
@@ -375,7 +889,17 @@ void VGLTrans::send(char *buf, int len)
 {
 	try
 	{
-		if(socket) socket->send(buf, len);
+		if(socket)
+		{
+			TraceScope trace("Send", len);
+			if(profLatency.isEnabled())
+			{
+				double start = getTime();
+				socket->send(buf, len);
+				sendTime += getTime() - start;
+			}
+			else socket->send(buf, len);
+		}
 	}
 	catch(...)
 	{
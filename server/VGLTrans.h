@@ -22,6 +22,8 @@
 #include "Frame.h"
 #include "GenericQ.h"
 #include "Profiler.h"
+#include "Tracer.h"
+#include "FramePacer.h"
 
 
 namespace vglserver
@@ -30,6 +32,12 @@ namespace vglserver
 	{
 		public:
 
+			// Called (possibly from the sender thread) when VGLTrans has finished
+			// with a frame passed to sendFrame(), that is, once the frame has
+			// been sent or spoiled.  The frame is not reused until the callback
+			// returns.
+			typedef void (*FrameCallback)(void *context, vglcommon::Frame *f);
+
 			VGLTrans(void);
 
 			virtual ~VGLTrans(void)
@@ -37,14 +45,26 @@ namespace vglserver
 				deadYet = true;  q.release();
 				if(thread) { thread->stop();  delete thread;  thread = NULL; }
 				if(socket) { delete socket;  socket = NULL; }
+				if(tileState) { delete [] tileState;  tileState = NULL; }
+				if(projections) { delete [] projections;  projections = NULL; }
 			}
 
 			vglcommon::Frame *getFrame(int, int, int, int, bool stereo);
 			bool isReady(void);
+			// These allow the caller to skip reading back a frame that would be
+			// spoiled before this transport is ready to send it (see
+			// vglutil::FramePacer.)
+			bool isEarly(void) { return pacer.isEarly(); }
+			void addReadbackTime(double seconds) { pacer.addLatency(seconds); }
 			void synchronize(void);
+			void setFrameCallback(FrameCallback callback, void *context)
+			{
+				frameCallback = callback;  frameContext = context;
+			}
 			void sendFrame(vglcommon::Frame *);
 			void run(void);
 			void sendHeader(rrframeheader h, bool eof = false);
+			void sendEOF(vglcommon::Frame *f, bool refinement = false);
 			void send(char *, int);
 			void save(char *, int);
 			void recv(char *, int);
@@ -54,6 +74,28 @@ namespace vglserver
 
 		private:
 
+			class Compressor;
+
+			// Used by progressive refinement to track the state of each tile
+			typedef struct
+			{
+				double changeTime;  bool refined;
+			} TileState;
+
+			long compressFrame(Compressor **comp, vglutil::Thread **cthread,
+				vglcommon::Frame *f, vglcommon::Frame *lastf);
+			void initTileState(vglcommon::Frame *f);
+			bool refinementPending(vglcommon::Frame *f);
+			int adaptTileSize(vglcommon::Frame *f);
+			void syncClock(void);
+			vglcommon::Frame *sendCopyRects(vglcommon::Frame *f,
+				vglcommon::Frame *lastf, long &bytes);
+			void frameDone(vglcommon::Frame *f)
+			{
+				if(frameCallback) frameCallback(frameContext, f);
+			}
+			static void spoilFrame(void *f, void *vglconn);
+
 			vglutil::Socket *socket;
 			static const int NFRAMES = 4;
 			vglutil::CriticalSection mutex;
@@ -62,14 +104,28 @@ namespace vglserver
 			vglutil::GenericQ q;
 			vglutil::Thread *thread;  bool deadYet;
 			vglcommon::Profiler profTotal;
+			vglcommon::LatencyProfiler profLatency;
+			vglutil::FramePacer pacer;
+			unsigned int frameSeq;  double sendTime;  long long clockOffset;
 			int dpynum;
 			rrversion version;
+			TileState *tileState;  int nTiles, tileStateW, tileStateH, tileSize;
+			int curTileSize, lastFrameW, lastFrameH;  long changedPixels;
+			vglcommon::Frame refFrame;
+			// The frame that the client's frame buffer is known to contain exactly
+			// (used as the reference image for lossless tiles), and whether the
+			// client's frame buffer matches the last frame that was sent
+			vglcommon::Frame *losslessRef;  bool clientExact;
+			unsigned int *projections, *rowSums, *colSums, *lastRowSums,
+				*lastColSums;
+			int projW, projH;  bool projValid;
+			FrameCallback frameCallback;  void *frameContext;
 
 		class Compressor : public vglutil::Runnable
 		{
 			public:
 
-				Compressor(int myRank_, VGLTrans *parent_) : bytes(0),
+				Compressor(int myRank_, VGLTrans *parent_) : bytes(0), pixels(0),
 					storedFrames(0), cframes(NULL), frame(NULL), lastFrame(NULL),
 					myRank(myRank_), deadYet(false), parent(parent_)
 				{
@@ -88,6 +144,9 @@ namespace vglserver
 
 				void run(void)
 				{
+					char temps[20];
+					snprintf(temps, 20, "Compressor %d", myRank);
+					vglcommon::Tracer::setThreadName(temps);
 					while(!deadYet)
 					{
 						try
@@ -119,10 +178,17 @@ namespace vglserver
 					vglcommon::Frame *lastFrame);
 				void send(void);
 
-				long bytes;
+				long bytes, pixels;
 
 			private:
 
+				void compressChanged(vglcommon::Frame *f, vglcommon::Frame *lastf,
+					int x, int y, int width, int height,
+					vglcommon::CompressedFrame &cframe);
+				void compressTile(vglcommon::Frame *f, int x, int y, int width,
+					int height, bool refineTile, int tileIndex,
+					vglcommon::CompressedFrame &cframe);
+
 				void store(vglcommon::CompressedFrame *cf)
 				{
 					storedFrames++;
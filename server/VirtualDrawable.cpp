@@ -22,6 +22,7 @@
 #include "TempContext.h"
 #include "vglutil.h"
 #include "faker.h"
+#include "gamma.h"
 #include "glpf.h"
 
 using namespace vglcommon;
@@ -80,7 +81,7 @@ VirtualDrawable::OGLDrawable::OGLDrawable(int width_, int height_,
 		GLX_PRESERVED_CONTENTS, True, None };
 
 	pbattribs[1] = width;  pbattribs[3] = height;
-	glxDraw = _glXCreatePbuffer(_dpy3D, config, pbattribs);
+	glxDraw = backend::createPbuffer(config, pbattribs);
 	if(!glxDraw) _throw("Could not create Pbuffer");
 
 	setVisAttribs();
@@ -97,6 +98,20 @@ VirtualDrawable::OGLDrawable::OGLDrawable(int width_, int height_, int depth_,
 	if(!config_ || width_ < 1 || height_ < 1 || depth_ < 0)
 		_throw("Invalid argument");
 
+	// With the EGL back end, there is no 3D X server on which to create the
+	// pixmap, so a Pbuffer is used instead.
+	if(fconfig.egl)
+	{
+		int pbattribs[] = { GLX_PBUFFER_WIDTH, width, GLX_PBUFFER_HEIGHT, height,
+			GLX_PRESERVED_CONTENTS, True, None };
+
+		glxDraw = backend::createPbuffer(config, pbattribs);
+		if(!glxDraw) _throw("Could not create Pbuffer");
+		isPixmap = false;
+		setVisAttribs();
+		return;
+	}
+
 	XVisualInfo *vis = NULL;
 	if((vis = _glXGetVisualFromFBConfig(_dpy3D, config)) == NULL)
 		goto bailout;
@@ -153,7 +168,7 @@ VirtualDrawable::OGLDrawable::~OGLDrawable(void)
 	}
 	else
 	{
-		_glXDestroyPbuffer(_dpy3D, glxDraw);
+		backend::destroyPbuffer(glxDraw);
 		glxDraw = 0;
 	}
 }
@@ -161,7 +176,7 @@ VirtualDrawable::OGLDrawable::~OGLDrawable(void)
 
 XVisualInfo *VirtualDrawable::OGLDrawable::getVisual(void)
 {
-	return _glXGetVisualFromFBConfig(_dpy3D, config);
+	return backend::getVisualFromFBConfig(config);
 }
 
 
@@ -179,7 +194,17 @@ void VirtualDrawable::OGLDrawable::clear(void)
 
 void VirtualDrawable::OGLDrawable::swap(void)
 {
-	_glXSwapBuffers(_dpy3D, glxDraw);
+	backend::swapBuffers(glxDraw);
+}
+
+
+bool VirtualDrawable::OGLDrawable::resize(int width_, int height_)
+{
+	if(isPixmap || !backend::resizePbuffer(glxDraw, width_, height_))
+		return false;
+	width = width_;  height = height_;
+	cleared = false;
+	return true;
 }
 
 
@@ -212,7 +237,7 @@ VirtualDrawable::~VirtualDrawable(void)
 {
 	mutex.lock(false);
 	if(oglDraw) { delete oglDraw;  oglDraw = NULL; }
-	if(ctx) { _glXDestroyContext(_dpy3D, ctx);  ctx = 0; }
+	if(ctx) { backend::destroyContext(ctx);  ctx = 0; }
 	mutex.unlock(false);
 }
 
@@ -226,6 +251,11 @@ int VirtualDrawable::init(int width, int height, GLXFBConfig config_)
 	if(oglDraw && oglDraw->getWidth() == width && oglDraw->getHeight() == height
 		&& _FBCID(oglDraw->getConfig()) == _FBCID(config_))
 		return 0;
+	// Resizing the existing drawable in place, if the back end supports it, is
+	// much cheaper than creating a new one.
+	if(oglDraw && _FBCID(oglDraw->getConfig()) == _FBCID(config_)
+		&& oglDraw->resize(width, height))
+		return 0;
 	if(fconfig.drawable == RRDRAWABLE_PIXMAP)
 	{
 		if(!alreadyPrintedDrawableType && fconfig.verbose)
@@ -246,7 +276,7 @@ int VirtualDrawable::init(int width, int height, GLXFBConfig config_)
 	}
 	if(config && _FBCID(config_) != _FBCID(config) && ctx)
 	{
-		_glXDestroyContext(_dpy3D, ctx);  ctx = 0;
+		backend::destroyContext(ctx);  ctx = 0;  compositor.reset();
 	}
 	config = config_;
 	return 1;
@@ -258,7 +288,7 @@ void VirtualDrawable::setDirect(Bool direct_)
 	if(direct_ != True && direct_ != False) return;
 	if(direct_ != direct && ctx)
 	{
-		_glXDestroyContext(_dpy3D, ctx);  ctx = 0;
+		backend::destroyContext(ctx);  ctx = 0;  compositor.reset();
 	}
 	direct = direct_;
 }
@@ -311,11 +341,12 @@ static const char *formatString(int glFormat)
 }
 
 
-void VirtualDrawable::readPixels(GLint x, GLint y, GLint width, GLint pitch,
+bool VirtualDrawable::readPixels(GLint x, GLint y, GLint width, GLint pitch,
 	GLint height, GLenum glFormat, PF *pf, GLubyte *bits, GLint readBuf,
-	bool stereo)
+	bool stereo, bool gamma)
 {
 	double t0 = 0.0, tRead, tTotal;
+	bool gammaApplied = false;
 	GLenum type = GL_UNSIGNED_BYTE;
 
 	// Compute OpenGL format from pixel format of frame
@@ -337,8 +368,8 @@ void VirtualDrawable::readPixels(GLint x, GLint y, GLint width, GLint pitch,
 	}
 	lastFormat = currentFormat;
 
-	GLXDrawable read = _glXGetCurrentDrawable();
-	GLXDrawable draw = _glXGetCurrentDrawable();
+	GLXDrawable read = backend::getCurrentDrawable();
+	GLXDrawable draw = backend::getCurrentDrawable();
 	if(read == 0 || readBuf == GL_BACK) read = getGLXDrawable();
 	if(draw == 0 || readBuf == GL_BACK) draw = getGLXDrawable();
 
@@ -365,20 +396,19 @@ void VirtualDrawable::readPixels(GLint x, GLint y, GLint width, GLint pitch,
 			vglout.println("[VGL] WARNING: One or more readbacks skipped because render mode != GL_RENDER.");
 			alreadyWarnedRenderMode = true;
 		}
-		return;
+		return false;
 	}
 
 	if(!ctx)
 	{
 		if(!isInit())
 			_throw("VirtualDrawable instance has not been fully initialized");
-		if((ctx = _glXCreateNewContext(_dpy3D, config, GLX_RGBA_TYPE, NULL,
-			direct)) == 0)
+		if((ctx = backend::createContext(config, NULL, direct, NULL)) == 0)
 			_throw("Could not create OpenGL context for readback");
 	}
-	TempContext tc(_dpy3D, draw, read, ctx, config, GLX_RGBA_TYPE);
+	TempContext tc(draw, read, ctx, config, GLX_RGBA_TYPE);
 
-	_glReadBuffer(readBuf);
+	backend::readBuffer(readBuf, true);
 
 	if(pitch % 8 == 0) _glPixelStorei(GL_PACK_ALIGNMENT, 8);
 	else if(pitch % 4 == 0) _glPixelStorei(GL_PACK_ALIGNMENT, 4);
@@ -428,6 +458,7 @@ void VirtualDrawable::readPixels(GLint x, GLint y, GLint width, GLint pitch,
 	int e = _glGetError();
 	while(e != GL_NO_ERROR) e = _glGetError();  // Clear previous error
 	profReadback.startFrame();
+	double traceStart = Tracer::isEnabled() ? getTime() : 0.;
 	if(usePBO) t0 = getTime();
 	_glReadPixels(x, y, width, height, glFormat, type, usePBO ? NULL : bits);
 
@@ -439,12 +470,25 @@ void VirtualDrawable::readPixels(GLint x, GLint y, GLint width, GLint pitch,
 		pboBits = (unsigned char *)_glMapBuffer(GL_PIXEL_PACK_BUFFER_EXT,
 			GL_READ_ONLY);
 		if(!pboBits) _throw("Could not map pixel buffer object");
-		memcpy(bits, pboBits, pitch * height);
+		if(gamma)
+		{
+			// The time spent applying gamma correction would make PBO readback
+			// appear to be asynchronous, so exclude it.
+			tTotal = getTime() - t0;
+			applyGamma(pboBits, bits, pitch, height, pf);
+			gammaApplied = true;
+		}
+		else
+		{
+			memcpy(bits, pboBits, pitch * height);
+			tTotal = getTime() - t0;
+		}
 		if(!_glUnmapBuffer(GL_PIXEL_PACK_BUFFER_EXT))
 			_throw("Could not unmap pixel buffer object");
 		_glBindBuffer(GL_PIXEL_PACK_BUFFER_EXT, 0);
-		#endif
+		#else
 		tTotal = getTime() - t0;
+		#endif
 		numFrames++;
 		if(tRead / tTotal > 0.5 && numFrames <= 10)
 		{
@@ -472,6 +516,7 @@ void VirtualDrawable::readPixels(GLint x, GLint y, GLint width, GLint pitch,
 	}
 
 	profReadback.endFrame(width * height, 0, stereo ? 0.5 : 1);
+	if(traceStart > 0.) Tracer::record("Readback", traceStart);
 	CHECKGL("Read Pixels");
 
 	// If automatic faker testing is enabled, store the FB color in an
@@ -517,6 +562,57 @@ void VirtualDrawable::readPixels(GLint x, GLint y, GLint width, GLint pitch,
 		snprintf(envValue, 10, "%d", autotestFrameCount);
 		setenv(envName, envValue, 1);
 	}
+
+	return gammaApplied;
+}
+
+
+bool VirtualDrawable::readComposite(GLint width, GLint pitch, GLint height,
+	GLenum glFormat, PF *pf, GLubyte *bits, GLint leftBuf, GLint rightBuf,
+	int stereoMode, bool gamma)
+{
+	if(!fconfig.gpucomposite) return false;
+
+	GLXDrawable read = backend::getCurrentDrawable();
+	GLXDrawable draw = backend::getCurrentDrawable();
+	if(read == 0) read = getGLXDrawable();
+	if(draw == 0) draw = getGLXDrawable();
+
+	// See the comments in readPixels() regarding the render mode.  Returning
+	// false causes the caller to fall back to readPixels(), which skips the
+	// readback.
+	int renderMode = 0;
+	_glGetIntegerv(GL_RENDER_MODE, &renderMode);
+	if(renderMode != GL_RENDER && renderMode != 0) return false;
+
+	if(!ctx)
+	{
+		if(!isInit())
+			_throw("VirtualDrawable instance has not been fully initialized");
+		if((ctx = backend::createContext(config, NULL, direct, NULL)) == 0)
+			_throw("Could not create OpenGL context for readback");
+	}
+	TempContext tc(draw, read, ctx, config, GLX_RGBA_TYPE);
+
+	double traceStart = Tracer::isEnabled() ? getTime() : 0.;
+	if(!compositor.compose(width, height, leftBuf, rightBuf, stereoMode, gamma,
+		pf->bpc == 10))
+		return false;
+	if(traceStart > 0.) Tracer::record("Compose", traceStart);
+
+	// The readback context is already current, so readPixels() reuses it and
+	// reads the composed image from the FBO.
+	try
+	{
+		readPixels(0, 0, width, pitch, height, glFormat, pf, bits,
+			GL_COLOR_ATTACHMENT0_EXT, false);
+	}
+	catch(...)
+	{
+		compositor.unbind();  throw;
+	}
+	compositor.unbind();
+	return true;
 }
 
 
@@ -527,14 +623,13 @@ void VirtualDrawable::copyPixels(GLint srcX, GLint srcY, GLint width,
 	{
 		if(!isInit())
 			_throw("VirtualDrawable instance has not been fully initialized");
-		if((ctx = _glXCreateNewContext(_dpy3D, config, GLX_RGBA_TYPE, NULL,
-			direct)) == 0)
+		if((ctx = backend::createContext(config, NULL, direct, NULL)) == 0)
 			_throw("Could not create OpenGL context for readback");
 	}
-	TempContext tc(_dpy3D, draw, getGLXDrawable(), ctx, config, GLX_RGBA_TYPE);
+	TempContext tc(draw, getGLXDrawable(), ctx, config, GLX_RGBA_TYPE);
 
-	_glReadBuffer(GL_FRONT);
-	_glDrawBuffer(GL_FRONT_AND_BACK);
+	backend::readBuffer(GL_FRONT, true);
+	backend::drawBuffer(GL_FRONT_AND_BACK);
 
 	_glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
 	_glPixelStorei(GL_PACK_ALIGNMENT, 1);
@@ -21,6 +21,7 @@
 #include "X11Trans.h"
 #include "fbx.h"
 #include "Frame.h"
+#include "GPUCompositor.h"
 
 
 namespace vglserver
@@ -69,6 +70,8 @@ namespace vglserver
 					GLXFBConfig getConfig(void) { return config; }
 					void clear(void);
 					void swap(void);
+					// Returns false if the drawable cannot be resized in place
+					bool resize(int width, int height);
 					bool isStereo(void) { return stereo; }
 					GLenum getFormat(void) { return glFormat; }
 					XVisualInfo *getVisual(void);
@@ -87,13 +90,29 @@ namespace vglserver
 					bool isPixmap;
 			};
 
-			void readPixels(GLint x, GLint y, GLint width, GLint pitch, GLint height,
-				GLenum glFormat, PF *pf, GLubyte *bits, GLint readBuf, bool stereo);
+			// If gamma is true and the pixels are read back using a PBO, then
+			// software gamma correction is applied while copying the pixels out of
+			// the PBO, and true is returned.
+			bool readPixels(GLint x, GLint y, GLint width, GLint pitch, GLint height,
+				GLenum glFormat, PF *pf, GLubyte *bits, GLint readBuf, bool stereo,
+				bool gamma = false);
+
+			// Compose the final image on the GPU (see GPUCompositor.h) from the
+			// left and right eye buffers (if stereoMode is an anaglyphic or passive
+			// stereo mode) or from leftBuf alone (if stereoMode is -1), applying
+			// gamma correction if gamma is true, then read back the composed image.
+			// Returns false, without reading back anything, if GPU composition is
+			// unavailable, in which case the caller should compose the image on the
+			// CPU.
+			bool readComposite(GLint width, GLint pitch, GLint height,
+				GLenum glFormat, PF *pf, GLubyte *bits, GLint leftBuf, GLint rightBuf,
+				int stereoMode, bool gamma);
 
 			vglutil::CriticalSection mutex;
 			Display *dpy;  Drawable x11Draw;
 			OGLDrawable *oglDraw;  GLXFBConfig config;
 			GLXContext ctx;
+			GPUCompositor compositor;
 			Bool direct;
 			X11Trans *x11Trans;
 			vglcommon::Profiler profReadback;
@@ -50,7 +50,7 @@ int VirtualPixmap::init(int width, int height, int depth, GLXFBConfig config_,
 	_newcheck(oglDraw = new OGLDrawable(width, height, depth, config_, attribs));
 	if(config && _FBCID(config_) != _FBCID(config) && ctx)
 	{
-		_glXDestroyContext(_dpy3D, ctx);  ctx = 0;
+		backend::destroyContext(ctx);  ctx = 0;  compositor.reset();
 	}
 	config = config_;
 	return 1;
@@ -17,9 +17,13 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include "backend.h"
 #include "fakerconfig.h"
+#include "gamma.h"
 #include "glxvisual.h"
 #include "vglutil.h"
+#include "Timer.h"
+#include "Tracer.h"
 
 using namespace vglutil;
 using namespace vglcommon;
@@ -44,10 +48,16 @@ static const int trans2pf[RRTRANS_FORMATOPT] =
 #define isPassive(mode) \
 	(mode >= RRSTEREO_INTERLEAVED && mode <= RRSTEREO_SIDEBYSIDE)
 
+static INLINE bool isGammaEnabled(void)
+{
+	return fconfig.gamma != 0.0 && fconfig.gamma != 1.0
+		&& fconfig.gamma != -1.0;
+}
+
 static INLINE int drawingToRight(void)
 {
 	GLint drawBuf = GL_LEFT;
-	_glGetIntegerv(GL_DRAW_BUFFER, &drawBuf);
+	backend::getIntegerv(GL_DRAW_BUFFER, &drawBuf);
 	return isRight(drawBuf);
 }
 
@@ -65,6 +75,7 @@ VirtualWin::VirtualWin(Display *dpy_, Window win) :
 	xvtrans = NULL;
 	#endif
 	vglconn = NULL;
+	lastPluginFrameValid = false;
 	profGamma.setName("Gamma     ");
 	profAnaglyph.setName("Anaglyph  ");
 	profPassive.setName("Stereo Gen");
@@ -77,6 +88,10 @@ VirtualWin::VirtualWin(Display *dpy_, Window win) :
 	doVGLWMDelete = false;
 	newConfig = false;
 	swapInterval = 0;
+	rbThread = NULL;  rbStereo = false;  deadYet = false;
+	#ifdef EGLBACKEND
+	rbFence = 0;
+	#endif
 	XWindowAttributes xwa;
 	XGetWindowAttributes(dpy, win, &xwa);
 	if(!fconfig.wm && !(xwa.your_event_mask & StructureNotifyMask))
@@ -95,6 +110,12 @@ VirtualWin::VirtualWin(Display *dpy_, Window win) :
 
 VirtualWin::~VirtualWin(void)
 {
+	if(rbThread)
+	{
+		rbIdle.wait();
+		deadYet = true;  rbStart.post();
+		rbThread->stop();  delete rbThread;  rbThread = NULL;
+	}
 	mutex.lock(false);
 	if(oldDraw) { delete oldDraw;  oldDraw = NULL; }
 	if(x11trans) { delete x11trans;  x11trans = NULL; }
@@ -217,6 +238,17 @@ void VirtualWin::checkResize(void)
 GLXDrawable VirtualWin::updateGLXDrawable(void)
 {
 	GLXDrawable retval = 0;
+	if(rbThread)
+	{
+		// Don't replace or resize the off-screen drawable while the readback
+		// thread is reading from it.
+		bool pending;
+		{
+			CriticalSection::SafeLock l(mutex);
+			pending = newConfig || (newWidth > 0 && newHeight > 0);
+		}
+		if(pending) waitReadback();
+	}
 	CriticalSection::SafeLock l(mutex);
 	if(doWMDelete) _throw("Window has been deleted by window manager");
 	if(newConfig)
@@ -238,12 +270,152 @@ GLXDrawable VirtualWin::updateGLXDrawable(void)
 
 void VirtualWin::swapBuffers(void)
 {
+	waitReadback();
 	CriticalSection::SafeLock l(mutex);
 	if(doWMDelete) _throw("Window has been deleted by window manager");
 	if(oglDraw) oglDraw->swap();
 }
 
 
+// With VGL_ASYNCREADBACK=1, glXSwapBuffers() calls this method instead of
+// reading back the back buffer and then swapping.  The buffers are swapped
+// first, and the front buffer (which now contains the frame that was just
+// rendered) is read back and sent by a dedicated readback thread, using the
+// readback context, while the application renders the next frame into the
+// back buffer.  The next swap waits for the readback thread to finish with the
+// front buffer.
+
+void VirtualWin::swapAndReadback(void)
+{
+	fconfig_reloadenv();
+	if(fconfig.readback == RRREAD_NONE || fconfig.sync
+		|| !backend::getCurrentContext()
+		|| !glxvisual::visAttrib3D(config, GLX_DOUBLEBUFFER))
+	{
+		readback(GL_BACK, false, fconfig.sync);
+		swapBuffers();
+		return;
+	}
+
+	if(!rbThread)
+	{
+		_newcheck(rbThread = new Thread(this));
+		rbThread->start();
+	}
+
+	rbIdle.wait();
+	try
+	{
+		rbThread->checkError();
+		CriticalSection::SafeLock l(mutex);
+		if(doWMDelete) _throw("Window has been deleted by window manager");
+
+		dirty = false;
+		rbStereo = false;
+		if(isStereo() && fconfig.stereo != RRSTEREO_LEYE
+			&& fconfig.stereo != RRSTEREO_REYE)
+		{
+			if(drawingToRight() || rdirty) rbStereo = true;
+			rdirty = false;
+		}
+		if(oglDraw) oglDraw->swap();
+
+		// The readback context must not read the front buffer until the GPU has
+		// finished rendering the frame.  With the EGL back end, the readback
+		// context shares sync objects with the application's contexts, so it
+		// can wait on the GPU.  Otherwise, we have to wait here.
+		#ifdef EGLBACKEND
+		if(fconfig.egl)
+		{
+			rbFence = _glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+			_glFlush();
+		}
+		else
+		#endif
+		_glFinish();
+	}
+	catch(...)
+	{
+		rbIdle.signal();  throw;
+	}
+	rbStart.post();
+}
+
+
+// Wait for the readback thread to finish reading back the previous frame
+
+void VirtualWin::waitReadback(void)
+{
+	if(!rbThread) return;
+	rbIdle.wait();  rbIdle.signal();
+	rbThread->checkError();
+}
+
+
+void VirtualWin::run(void)
+{
+	try
+	{
+		Tracer::setThreadName("Readback");
+		while(!deadYet)
+		{
+			rbStart.wait();  if(deadYet) return;
+			// The mutex is held only while checking the state of the window, so
+			// that the application can make a context current with the window
+			// (which some toolkits do for every frame) while the frame is being
+			// read back.  Everything that reads back, swaps, replaces, or resizes
+			// the off-screen drawable calls waitReadback() first.
+			bool doReadback;
+			{
+				CriticalSection::SafeLock l(mutex);
+				doReadback = !doWMDelete && oglDraw;
+			}
+			if(doReadback)
+			{
+				if(!ctx)
+				{
+					if((ctx = backend::createContext(config, NULL, direct, NULL)) == 0)
+						_throw("Could not create OpenGL context for readback");
+				}
+				// The readback context remains current while the frame is read back,
+				// so VirtualDrawable::readPixels() does not have to switch contexts.
+				GLXDrawable draw = oglDraw->getGLXDrawable();
+				if(!backend::makeCurrent(draw, draw, ctx))
+					_throw("Could not bind OpenGL context to window (window may have disappeared)");
+				#ifdef EGLBACKEND
+				if(rbFence)
+				{
+					_glWaitSync(rbFence, 0, GL_TIMEOUT_IGNORED);
+					_glDeleteSync(rbFence);  rbFence = 0;
+				}
+				#endif
+				send(GL_FRONT, false, false, rbStereo);
+				// The readback context cannot be used by the application's thread
+				// while it is current in this thread.
+				backend::makeCurrent(0, 0, 0);
+			}
+			rbIdle.signal();
+		}
+	}
+	catch(Error &e)
+	{
+		backend::makeCurrent(0, 0, 0);
+		if(rbThread) rbThread->setError(e);
+		rbIdle.signal();  throw;
+	}
+	catch(...)
+	{
+		// Thread only catches Error, so any other exception would terminate the
+		// process.  Report it the next time that the application waits for
+		// readback instead.
+		backend::makeCurrent(0, 0, 0);
+		Error e("VirtualWin::run", "Unknown exception in readback thread");
+		if(rbThread) rbThread->setError(e);
+		rbIdle.signal();
+	}
+}
+
+
 void VirtualWin::wmDelete(void)
 {
 	CriticalSection::SafeLock l(mutex);
@@ -261,23 +433,41 @@ void VirtualWin::vglWMDelete(void)
 void VirtualWin::readback(GLint drawBuf, bool spoilLast, bool sync)
 {
 	fconfig_reloadenv();
-	bool doStereo = false;  int stereoMode = fconfig.stereo;
+	bool doStereo = false;
 
 	if(fconfig.readback == RRREAD_NONE) return;
 
+	waitReadback();
 	CriticalSection::SafeLock l(mutex);
 	if(doWMDelete) _throw("Window has been deleted by window manager");
 
 	dirty = false;
 
+	if(isStereo() && fconfig.stereo != RRSTEREO_LEYE
+		&& fconfig.stereo != RRSTEREO_REYE)
+	{
+		if(drawingToRight() || rdirty) doStereo = true;
+		rdirty = false;
+	}
+
+	send(drawBuf, spoilLast, sync, doStereo);
+}
+
+
+// Read back the specified buffer and send it using the appropriate image
+// transport.  doStereo is true if the application has rendered to the right
+// eye buffer.
+
+void VirtualWin::send(GLint drawBuf, bool spoilLast, bool sync, bool doStereo)
+{
+	int stereoMode = fconfig.stereo;
+
 	int compress = fconfig.compress;
 	if(sync && strlen(fconfig.transport) == 0) compress = RRCOMP_PROXY;
 
-	if(isStereo() && stereoMode != RRSTEREO_LEYE && stereoMode != RRSTEREO_REYE)
+	if(doStereo)
 	{
-		if(drawingToRight() || rdirty) doStereo = true;
-		rdirty = false;
-		if(doStereo && compress == RRCOMP_YUV && strlen(fconfig.transport) == 0)
+		if(compress == RRCOMP_YUV && strlen(fconfig.transport) == 0)
 		{
 			static bool message3 = false;
 			if(!message3)
@@ -288,8 +478,8 @@ void VirtualWin::readback(GLint drawBuf, bool spoilLast, bool sync)
 			}
 			stereoMode = RRSTEREO_REDCYAN;
 		}
-		else if(doStereo && _Trans[compress] != RRTRANS_VGL
-			&& stereoMode == RRSTEREO_QUADBUF && strlen(fconfig.transport) == 0)
+		else if(_Trans[compress] != RRTRANS_VGL && stereoMode == RRSTEREO_QUADBUF
+			&& strlen(fconfig.transport) == 0)
 		{
 			static bool message = false;
 			if(!message)
@@ -300,7 +490,7 @@ void VirtualWin::readback(GLint drawBuf, bool spoilLast, bool sync)
 			}
 			stereoMode = RRSTEREO_REDCYAN;
 		}
-		else if(doStereo && !stereoVisual && stereoMode == RRSTEREO_QUADBUF
+		else if(!stereoVisual && stereoMode == RRSTEREO_QUADBUF
 			&& strlen(fconfig.transport) == 0)
 		{
 			static bool message2 = false;
@@ -329,6 +519,7 @@ void VirtualWin::readback(GLint drawBuf, bool spoilLast, bool sync)
 		case RRCOMP_JPEG:
 		case RRCOMP_RGB:
 		case RRCOMP_YUV:
+		case RRCOMP_LOSSLESS:
 			if(!vglconn)
 			{
 				_newcheck(vglconn = new VGLTrans());
@@ -337,7 +528,8 @@ void VirtualWin::readback(GLint drawBuf, bool spoilLast, bool sync)
 					fconfig.port);
 			}
 			sendVGL(drawBuf, spoilLast, doStereo, stereoMode, (int)compress,
-				fconfig.qual, fconfig.subsamp);
+				compress == RRCOMP_LOSSLESS ? fconfig.effort : fconfig.qual,
+				fconfig.subsamp);
 			break;
 		#ifdef USEXV
 		case RRCOMP_XV:
@@ -373,6 +565,7 @@ void VirtualWin::sendPlugin(GLint drawBuf, bool spoilLast, bool sync,
 	else if(oglDraw->getFormat() == GL_BGRA) desiredFormat = RRTRANS_BGRA;
 	else if(oglDraw->getFormat() == GL_RGBA) desiredFormat = RRTRANS_RGBA;
 
+	double captureTime = getTime();
 	rrframe = plugin->getFrame(w, h, desiredFormat,
 		doStereo && stereoMode == RRSTEREO_QUADBUF);
 	f.init(rrframe->bits, rrframe->w, rrframe->pitch, rrframe->h,
@@ -413,17 +606,89 @@ void VirtualWin::sendPlugin(GLint drawBuf, bool spoilLast, bool sync,
 	}
 	if(!syncdpy) { XSync(dpy, False);  syncdpy = true; }
 	if(fconfig.logo) f.addLogo();
+	if(plugin->getVersion() >= 2)
+	{
+		rrframe->timestamp = captureTime;
+		getPluginDirtyRects(f, rrframe);
+	}
 	plugin->sendFrame(rrframe, sync);
 }
 
 
+// Compare a frame that is about to be sent to a transport plugin with a copy
+// of the previous frame, tile by tile, in order to tell the plugin which
+// regions have changed.
+
+#define DIRTYTILESIZE  64
+
+void VirtualWin::getPluginDirtyRects(Frame &f, RRFrame *rrframe)
+{
+	rrframe->ndirty = RRTRANS_ALLDIRTY;
+	if(rrframe->rbits)
+	{
+		lastPluginFrameValid = false;  return;
+	}
+
+	rrframeheader h = f.hdr;
+	if(!lastPluginFrame.bits || lastPluginFrame.hdr.framew != h.framew
+		|| lastPluginFrame.hdr.frameh != h.frameh
+		|| lastPluginFrame.pf->id != f.pf->id)
+		lastPluginFrameValid = false;
+	h.size = 0;
+	lastPluginFrame.init(h, f.pf->id, f.flags);
+	lastPluginFrame.hdr = f.hdr;
+
+	int rowSize = f.pf->size * f.hdr.width;
+	if(!lastPluginFrameValid)
+	{
+		for(int j = 0; j < f.hdr.height; j++)
+			memcpy(&lastPluginFrame.bits[lastPluginFrame.pitch * j],
+				&f.bits[f.pitch * j], rowSize);
+		lastPluginFrameValid = true;
+		return;
+	}
+
+	f.nDirty = 0;  f.allDirty = false;
+	for(int y = 0; y < f.hdr.height; y += DIRTYTILESIZE)
+	{
+		int th = min(DIRTYTILESIZE, f.hdr.height - y);
+		// The frame is bottom-up.
+		int row = f.hdr.height - y - th;
+		for(int x = 0; x < f.hdr.width; x += DIRTYTILESIZE)
+		{
+			int tw = min(DIRTYTILESIZE, f.hdr.width - x);
+			if(f.tileEquals(&lastPluginFrame, x, y, tw, th)) continue;
+			f.addDirtyRect(x, y, tw, th);
+			for(int j = row; j < row + th; j++)
+				memcpy(&lastPluginFrame.bits[lastPluginFrame.pitch * j +
+					f.pf->size * x], &f.bits[f.pitch * j + f.pf->size * x],
+					f.pf->size * tw);
+		}
+	}
+	if(f.allDirty) return;
+	f.mergeDirtyRects();
+	if(f.nDirty > RRTRANS_MAXDIRTY) return;
+	for(int i = 0; i < f.nDirty; i++)
+	{
+		rrframe->dirty[i].x = f.dirty[i].x;
+		rrframe->dirty[i].y = f.dirty[i].y;
+		rrframe->dirty[i].w = f.dirty[i].width;
+		rrframe->dirty[i].h = f.dirty[i].height;
+	}
+	rrframe->ndirty = f.nDirty;
+}
+
+
 void VirtualWin::sendVGL(GLint drawBuf, bool spoilLast, bool doStereo,
 	int stereoMode, int compress, int qual, int subsamp)
 {
 	int w = oglDraw->getWidth(), h = oglDraw->getHeight();
 
-	if(spoilLast && fconfig.spoil && !vglconn->isReady())
-		return;
+	if(spoilLast && fconfig.spoil)
+	{
+		bool early = vglconn->isEarly();
+		if(early || !vglconn->isReady()) return;
+	}
 	Frame *f;
 
 	if(oglDraw->getRGBSize() != 24)
@@ -440,6 +705,7 @@ void VirtualWin::sendVGL(GLint drawBuf, bool spoilLast, bool doStereo,
 	if(!fconfig.spoil) vglconn->synchronize();
 	_errifnot(f = vglconn->getFrame(w, h, pixelFormat, FRAME_BOTTOMUP,
 		doStereo && stereoMode == RRSTEREO_QUADBUF));
+	f->captureTime = getTime();
 	if(doStereo && isAnaglyphic(stereoMode))
 	{
 		stereoFrame.deInit();
@@ -462,6 +728,8 @@ void VirtualWin::sendVGL(GLint drawBuf, bool spoilLast, bool doStereo,
 			readPixels(0, 0, f->hdr.framew, f->pitch, f->hdr.frameh, glFormat, f->pf,
 				f->rbits, reye(drawBuf), doStereo);
 	}
+	f->readbackTime = getTime();
+	vglconn->addReadbackTime(f->readbackTime - f->captureTime);
 	f->hdr.winid = x11Draw;
 	f->hdr.framew = f->hdr.width;
 	f->hdr.frameh = f->hdr.height;
@@ -483,10 +751,15 @@ void VirtualWin::sendX11(GLint drawBuf, bool spoilLast, bool sync,
 
 	FBXFrame *f;
 	if(!x11trans) _newcheck(x11trans = new X11Trans());
-	if(spoilLast && fconfig.spoil && !x11trans->isReady()) return;
+	if(spoilLast && fconfig.spoil)
+	{
+		bool early = x11trans->isEarly();
+		if(early || !x11trans->isReady()) return;
+	}
 	if(!fconfig.spoil) x11trans->synchronize();
 	_errifnot(f = x11trans->getFrame(dpy, x11Draw, width, height));
 	f->flags |= FRAME_BOTTOMUP;
+	double readbackStart = getTime();
 	if(doStereo && isAnaglyphic(stereoMode))
 	{
 		stereoFrame.deInit();
@@ -507,6 +780,7 @@ void VirtualWin::sendX11(GLint drawBuf, bool spoilLast, bool sync,
 				min(height, f->hdr.frameh), GL_NONE, f->pf, f->bits, readBuf, false);
 		}
 	}
+	x11trans->addReadbackTime(getTime() - readbackStart);
 	if(fconfig.logo) f->addLogo();
 	x11trans->sendFrame(f, sync);
 }
@@ -521,7 +795,11 @@ void VirtualWin::sendXV(GLint drawBuf, bool spoilLast, bool sync,
 
 	XVFrame *f;
 	if(!xvtrans) _newcheck(xvtrans = new XVTrans());
-	if(spoilLast && fconfig.spoil && !xvtrans->isReady()) return;
+	if(spoilLast && fconfig.spoil)
+	{
+		bool early = xvtrans->isEarly();
+		if(early || !xvtrans->isReady()) return;
+	}
 	if(!fconfig.spoil) xvtrans->synchronize();
 	_errifnot(f = xvtrans->getFrame(dpy, x11Draw, width, height));
 	rrframeheader hdr;
@@ -537,6 +815,7 @@ void VirtualWin::sendXV(GLint drawBuf, bool spoilLast, bool sync,
 	else if(glFormat == GL_BGRA) pixelFormat = PF_BGRX;
 
 	frame.init(hdr, pixelFormat, FRAME_BOTTOMUP, false);
+	double readbackStart = getTime();
 
 	if(doStereo && isAnaglyphic(stereoMode))
 	{
@@ -558,6 +837,7 @@ void VirtualWin::sendXV(GLint drawBuf, bool spoilLast, bool sync,
 			min(height, frame.hdr.frameh), glFormat, frame.pf, frame.bits, readBuf,
 			false);
 	}
+	xvtrans->addReadbackTime(getTime() - readbackStart);
 
 	if(fconfig.logo) frame.addLogo();
 
@@ -570,6 +850,13 @@ void VirtualWin::sendXV(GLint drawBuf, bool spoilLast, bool sync,
 
 void VirtualWin::makeAnaglyph(Frame *f, int drawBuf, int stereoMode)
 {
+	if(readComposite(f->hdr.framew, f->pitch, f->hdr.frameh, GL_NONE, f->pf,
+		f->bits, leye(drawBuf), reye(drawBuf), stereoMode, isGammaEnabled()))
+	{
+		rFrame.deInit();  gFrame.deInit();  bFrame.deInit();
+		return;
+	}
+
 	int rbuf = leye(drawBuf), gbuf = reye(drawBuf),  bbuf = reye(drawBuf);
 	if(stereoMode == RRSTEREO_GREENMAGENTA)
 	{
@@ -597,6 +884,13 @@ void VirtualWin::makeAnaglyph(Frame *f, int drawBuf, int stereoMode)
 void VirtualWin::makePassive(Frame *f, int drawBuf, GLenum glFormat,
 	int stereoMode)
 {
+	if(readComposite(f->hdr.framew, f->pitch, f->hdr.frameh, glFormat, f->pf,
+		f->bits, leye(drawBuf), reye(drawBuf), stereoMode, isGammaEnabled()))
+	{
+		stereoFrame.deInit();
+		return;
+	}
+
 	stereoFrame.init(f->hdr, f->pf->id, f->flags, true);
 	readPixels(0, 0, stereoFrame.hdr.framew, stereoFrame.pitch,
 		stereoFrame.hdr.frameh, glFormat, stereoFrame.pf, stereoFrame.bits,
@@ -613,13 +907,16 @@ void VirtualWin::makePassive(Frame *f, int drawBuf, GLenum glFormat,
 void VirtualWin::readPixels(GLint x, GLint y, GLint width, GLint pitch,
 	GLint height, GLenum glFormat, PF *pf, GLubyte *bits, GLint buf, bool stereo)
 {
-	VirtualDrawable::readPixels(x, y, width, pitch, height, glFormat, pf, bits,
-		buf, stereo);
+	bool gamma = isGammaEnabled();
+
+	// Gamma correction of a whole frame can also be performed on the GPU.
+	if(gamma && x == 0 && y == 0
+		&& readComposite(width, pitch, height, glFormat, pf, bits, buf, GL_NONE,
+			-1, true))
+		return;
 
-	// Gamma correction
-	if(fconfig.gamma != 0.0 && fconfig.gamma != 1.0 && fconfig.gamma != -1.0)
+	if(gamma)
 	{
-		profGamma.startFrame();
 		static bool first = true;
 		if(first)
 		{
@@ -628,37 +925,17 @@ void VirtualWin::readPixels(GLint x, GLint y, GLint width, GLint pitch,
 				vglout.println("[VGL] Using software gamma correction (correction factor=%f)\n",
 					fconfig.gamma);
 		}
-		if(pf->bpc == 10)
-		{
-			int h = height;
-			while(h--)
-			{
-				int w = width;
-				unsigned int *srcPixel = (unsigned int *)bits;
-				while(w--)
-				{
-					unsigned int r =
-						fconfig.gamma_lut10[(*srcPixel >> pf->rshift) & 1023];
-					unsigned int g =
-						fconfig.gamma_lut10[(*srcPixel >> pf->gshift) & 1023];
-					unsigned int b =
-						fconfig.gamma_lut10[(*srcPixel >> pf->bshift) & 1023];
-					*srcPixel++ =
-						(r << pf->rshift) | (g << pf->gshift) | (b << pf->bshift);
-				}
-				bits += pitch;
-			}
-		}
-		else
-		{
-			unsigned short *ptr1, *ptr2 = (unsigned short *)(&bits[pitch * height]);
-			for(ptr1 = (unsigned short *)bits; ptr1 < ptr2; ptr1++)
-				*ptr1 = fconfig.gamma_lut16[*ptr1];
-			if((pitch * height) % 2 != 0)
-				bits[pitch * height - 1] = fconfig.gamma_lut[bits[pitch * height - 1]];
-		}
-		profGamma.endFrame(width * height, 0, stereo ? 0.5 : 1);
 	}
+
+	// If PBOs are used, then gamma correction is performed while the pixels are
+	// copied out of the PBO, so the frame only has to be traversed once.
+	if(VirtualDrawable::readPixels(x, y, width, pitch, height, glFormat, pf,
+		bits, buf, stereo, gamma) || !gamma)
+		return;
+
+	profGamma.startFrame();
+	applyGamma(bits, bits, pitch, height, pf);
+	profGamma.endFrame(width * height, 0, stereo ? 0.5 : 1);
 }
 
 
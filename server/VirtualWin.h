@@ -22,11 +22,12 @@
 #include "XVTrans.h"
 #endif
 #include "TransPlugin.h"
+#include "Thread.h"
 
 
 namespace vglserver
 {
-	class VirtualWin : public VirtualDrawable
+	class VirtualWin : public VirtualDrawable, public vglutil::Runnable
 	{
 		public:
 
@@ -42,6 +43,8 @@ namespace vglserver
 			void initFromWindow(GLXFBConfig config);
 			void readback(GLint drawBuf, bool spoilLast, bool sync);
 			void swapBuffers(void);
+			void swapAndReadback(void);
+			void waitReadback(void);
 			bool isStereo(void);
 			void wmDelete(void);
 			void vglWMDelete(void);
@@ -50,9 +53,14 @@ namespace vglserver
 
 			bool dirty, rdirty;
 
+		protected:
+
+			void run(void);
+
 		private:
 
 			int init(int w, int h, GLXFBConfig config);
+			void send(GLint drawBuf, bool spoilLast, bool sync, bool doStereo);
 			void readPixels(GLint x, GLint y, GLint width, GLint pitch, GLint height,
 				GLenum glFormat, PF *pf, GLubyte *bits, GLint buf, bool stereo);
 			void makeAnaglyph(vglcommon::Frame *f, int drawBuf, int stereoMode);
@@ -64,6 +72,7 @@ namespace vglserver
 				int stereoMode);
 			void sendPlugin(GLint drawBuf, bool spoilLast, bool sync, bool doStereo,
 				int stereoMode);
+			void getPluginDirtyRects(vglcommon::Frame &f, RRFrame *rrframe);
 			#ifdef USEXV
 			void sendXV(GLint drawBuf, bool spoilLast, bool sync, bool doStereo,
 				int stereoMode);
@@ -80,12 +89,20 @@ namespace vglserver
 			vglcommon::Profiler profGamma, profAnaglyph, profPassive;
 			bool syncdpy;
 			TransPlugin *plugin;
+			vglcommon::Frame lastPluginFrame;  bool lastPluginFrameValid;
 			bool stereoVisual;
 			vglcommon::Frame rFrame, gFrame, bFrame, frame, stereoFrame;
 			bool doWMDelete;
 			bool doVGLWMDelete;
 			bool newConfig;
 			int swapInterval;
+			vglutil::Thread *rbThread;
+			vglutil::Semaphore rbStart;
+			vglutil::Event rbIdle;
+			bool rbStereo, deadYet;
+			#ifdef EGLBACKEND
+			GLsync rbFence;
+			#endif
 	};
 }
 
@@ -14,10 +14,10 @@
  */
 
 #include "X11Trans.h"
-#include "Timer.h"
 #include "fakerconfig.h"
 #include "vglutil.h"
 #include "Log.h"
+#include "Tracer.h"
 
 using namespace vglutil;
 using namespace vglcommon;
@@ -30,6 +30,7 @@ X11Trans::X11Trans(void) : thread(NULL), deadYet(false)
 	_newcheck(thread = new Thread(this));
 	thread->start();
 	profBlit.setName("Blit      ");
+	profBlitIssue.setName("Blit Issue");
 	profTotal.setName("Total     ");
 	if(fconfig.verbose) fbx_printwarnings(vglout.getFile());
 }
@@ -37,10 +38,9 @@ X11Trans::X11Trans(void) : thread(NULL), deadYet(false)
 
 void X11Trans::run(void)
 {
-	Timer timer, sleepTimer;  double err = 0.;  bool first = true;
-
 	try
 	{
+		Tracer::setThreadName("X11 Transport");
 		while(!deadYet)
 		{
 			FBXFrame *f;  void *ftemp = NULL;
@@ -48,36 +48,21 @@ void X11Trans::run(void)
 			q.get(&ftemp);  f = (FBXFrame *)ftemp;  if(deadYet) return;
 			if(!f) _throw("Queue has been shut down");
 			ready.signal();
-			profBlit.startFrame();
-			f->redraw();
-			profBlit.endFrame(f->hdr.width * f->hdr.height, 0, 1);
+			// The blit is asynchronous, so this measures only the time required to
+			// issue it.  The X server may still be reading the frame.
+			profBlitIssue.startFrame();
+			{
+				TraceScope trace("Blit");
+				f->redraw();
+			}
+			profBlitIssue.endFrame(f->hdr.width * f->hdr.height, 0, 1);
 
 			profTotal.endFrame(f->hdr.width * f->hdr.height, 0, 1);
 			profTotal.startFrame();
 
-			if(fconfig.flushdelay > 0.)
-			{
-				long usec = (long)(fconfig.flushdelay * 1000000.);
-				if(usec > 0) usleep(usec);
-			}
-			if(fconfig.fps > 0.)
-			{
-				double elapsed = timer.elapsed();
-				if(first) first = false;
-				else
-				{
-					if(elapsed < 1. / fconfig.fps)
-					{
-						sleepTimer.start();
-						long usec = (long)((1. / fconfig.fps - elapsed - err) * 1000000.);
-						if(usec > 0) usleep(usec);
-						double sleepTime = sleepTimer.elapsed();
-						err = sleepTime - (1. / fconfig.fps - elapsed - err);
-						if(err < 0.) err = 0.;
-					}
-				}
-				timer.start();
-			}
+			double interval = fconfig.fps > 0. ? 1. / fconfig.fps : 0.;
+			if(fconfig.flushdelay > interval) interval = fconfig.flushdelay;
+			pacer.wait(interval);
 
 			f->signalComplete();
 		}
@@ -99,11 +84,18 @@ FBXFrame *X11Trans::getFrame(Display *dpy, Window win, int width, int height)
 	{
 		CriticalSection::SafeLock l(mutex);
 
-		int index = -1;
+		// Blits are asynchronous, so prefer a buffer that the X server has
+		// finished reading.  That allows the X server to read one buffer while we
+		// read back the next frame into another.
+		int index = -1, idleIndex = -1;
 		for(int i = 0; i < NFRAMES; i++)
 			if(!frames[i] || (frames[i] && frames[i]->isComplete()))
+			{
 				index = i;
+				if(!frames[i] || !frames[i]->isBusy()) idleIndex = i;
+			}
 		if(index < 0) _throw("No free buffers in pool");
+		if(idleIndex >= 0) index = idleIndex;
 		if(!frames[index])
 			_newcheck(frames[index] = new FBXFrame(dpy, win));
 		f = frames[index];  f->waitUntilComplete();
@@ -132,9 +124,13 @@ void X11Trans::synchronize(void)
 }
 
 
-static void __X11Trans_spoilfct(void *f)
+static void __X11Trans_spoilfct(void *f, void *)
 {
-	if(f) ((FBXFrame *)f)->signalComplete();
+	if(f)
+	{
+		Tracer::instant("Spoil");
+		((FBXFrame *)f)->signalComplete();
+	}
 }
 
 
@@ -145,6 +141,7 @@ void X11Trans::sendFrame(FBXFrame *f, bool sync)
 	{
 		profBlit.startFrame();
 		f->redraw();
+		f->sync();
 		f->signalComplete();
 		profBlit.endFrame(f->hdr.width * f->hdr.height, 0, 1);
 		ready.signal();
@@ -20,6 +20,7 @@
 #include "Frame.h"
 #include "GenericQ.h"
 #include "Profiler.h"
+#include "FramePacer.h"
 
 
 namespace vglserver
@@ -43,6 +44,11 @@ namespace vglserver
 			}
 
 			bool isReady(void);
+			// These allow the caller to skip reading back a frame that would be
+			// spoiled before this transport is ready to send it (see
+			// vglutil::FramePacer.)
+			bool isEarly(void) { return pacer.isEarly(); }
+			void addReadbackTime(double seconds) { pacer.addLatency(seconds); }
 			void synchronize(void);
 			void sendFrame(vglcommon::FBXFrame *, bool sync = false);
 			void run(void);
@@ -58,7 +64,8 @@ namespace vglserver
 			vglutil::GenericQ q;
 			vglutil::Thread *thread;
 			bool deadYet;
-			vglcommon::Profiler profBlit, profTotal;
+			vglcommon::Profiler profBlit, profBlitIssue, profTotal;
+			vglutil::FramePacer pacer;
 	};
 }
 
@@ -15,9 +15,9 @@
 
 #include "XVTrans.h"
 #include "vglutil.h"
-#include "Timer.h"
 #include "fakerconfig.h"
 #include "Log.h"
+#include "Tracer.h"
 
 using namespace vglutil;
 using namespace vglcommon;
@@ -37,10 +37,9 @@ XVTrans::XVTrans(void) : thread(NULL), deadYet(false)
 
 void XVTrans::run(void)
 {
-	Timer timer, sleepTimer;  double err = 0.;  bool first = true;
-
 	try
 	{
+		Tracer::setThreadName("XV Transport");
 		while(!deadYet)
 		{
 			XVFrame *f;  void *ftemp = NULL;
@@ -49,35 +48,18 @@ void XVTrans::run(void)
 			if(!f) throw("Queue has been shut down");
 			ready.signal();
 			profXV.startFrame();
-			f->redraw();
+			{
+				TraceScope trace("Blit");
+				f->redraw();
+			}
 			profXV.endFrame(f->hdr.width * f->hdr.height, 0, 1);
 
 			profTotal.endFrame(f->hdr.width * f->hdr.height, 0, 1);
 			profTotal.startFrame();
 
-			if(fconfig.flushdelay > 0.)
-			{
-				long usec = (long)(fconfig.flushdelay * 1000000.);
-				if(usec > 0) usleep(usec);
-			}
-			if(fconfig.fps > 0.)
-			{
-				double elapsed = timer.elapsed();
-				if(first) first = false;
-				else
-				{
-					if(elapsed < 1. / fconfig.fps)
-					{
-						sleepTimer.start();
-						long usec = (long)((1. / fconfig.fps - elapsed - err) * 1000000.);
-						if(usec > 0) usleep(usec);
-						double sleepTime = sleepTimer.elapsed();
-						err = sleepTime - (1. / fconfig.fps - elapsed - err);
-						if(err < 0.) err = 0.;
-					}
-				}
-				timer.start();
-			}
+			double interval = fconfig.fps > 0. ? 1. / fconfig.fps : 0.;
+			if(fconfig.flushdelay > interval) interval = fconfig.flushdelay;
+			pacer.wait(interval);
 
 			f->signalComplete();
 		}
@@ -132,9 +114,13 @@ void XVTrans::synchronize(void)
 }
 
 
-static void __XVTrans_spoilfct(void *f)
+static void __XVTrans_spoilfct(void *f, void *)
 {
-	if(f) ((XVFrame *)f)->signalComplete();
+	if(f)
+	{
+		Tracer::instant("Spoil");
+		((XVFrame *)f)->signalComplete();
+	}
 }
 
 
@@ -0,0 +1,1749 @@
+/* Copyright (C)2018 D. R. Commander
+ *
+ * This library is free software and may be redistributed and/or modified under
+ * the terms of the wxWindows Library License, Version 3.1 or (at your option)
+ * any later version.  The full license is in the LICENSE.txt file included
+ * with this distribution.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * wxWindows Library License for more details.
+ */
+
+#include "backend.h"
+#include "faker.h"
+#ifdef EGLBACKEND
+#include <stdlib.h>
+#include "ContextHashEGL.h"
+#include "PbufferHashEGL.h"
+#include "threadlocal.h"
+#include "vglutil.h"
+#endif
+
+using namespace vglutil;
+
+
+#ifdef EGLBACKEND
+
+using namespace vglserver;
+
+#ifndef GLX_CONTEXT_OPENGL_NO_ERROR_ARB
+#define GLX_CONTEXT_OPENGL_NO_ERROR_ARB  0x31B3
+#endif
+
+#define MAXDEVICES  32
+
+
+namespace backend {
+
+static EGLDisplay edpy = EGL_NO_DISPLAY;
+static EGLContext rootCtx = EGL_NO_CONTEXT;
+static CriticalSection rootMutex;
+static bool initialized = false;
+
+static FBConfigEGL *eglConfigs = NULL;
+static int nEGLConfigs = 0;
+static GLint maxPbufferSize = 0;
+
+VGL_THREAD_LOCAL(CurrentStateEGL, ContextStateEGL *, NULL)
+
+
+// Return the state of the context that the EGL back end made current in this
+// thread, or NULL if the application has since made some other context
+// current (or released the context.)
+
+static ContextStateEGL *getCurrentState(void)
+{
+	ContextStateEGL *state = getCurrentStateEGL();
+	if(state && (GLXContext)_eglGetCurrentContext() != state->ctx) return NULL;
+	return state;
+}
+
+
+// The EGL back end synthesizes a set of FB configs that covers every
+// combination of color depth, Z/stencil buffer, double buffering, stereo, and
+// multisampling that can reasonably be emulated with renderbuffers.
+
+static void buildConfigs(GLint maxSamples)
+{
+	static const int colorSizes[][4] =
+		{ { 8, 8, 8, 0 }, { 8, 8, 8, 8 }, { 10, 10, 10, 0 }, { 10, 10, 10, 2 } };
+	static const int depthSizes[][2] = { { 0, 0 }, { 16, 0 }, { 24, 0 },
+		{ 24, 8 } };
+	static const int samples[] = { 0, 2, 4, 8, 16 };
+	int n = 0;
+
+	_newcheck(eglConfigs = new FBConfigEGL[4 * 4 * 2 * 2 * 5]);
+	for(int c = 0; c < 4; c++)
+		for(int d = 0; d < 4; d++)
+			for(int db = 0; db < 2; db++)
+				for(int stereo = 0; stereo < 2; stereo++)
+					for(int s = 0; s < 5; s++)
+					{
+						if(samples[s] > maxSamples) continue;
+						FBConfigEGL *config = &eglConfigs[n];
+						config->id = n + 1;
+						config->redSize = colorSizes[c][0];
+						config->greenSize = colorSizes[c][1];
+						config->blueSize = colorSizes[c][2];
+						config->alphaSize = colorSizes[c][3];
+						config->depthSize = depthSizes[d][0];
+						config->stencilSize = depthSizes[d][1];
+						config->samples = samples[s];
+						config->doubleBuffer = (db == 1);
+						config->stereo = (stereo == 1);
+						n++;
+					}
+	nEGLConfigs = n;
+}
+
+
+// VGL_DISPLAY=egl uses the first EGL device (or, if the EGL implementation
+// doesn't support device enumeration, Mesa's surfaceless platform),
+// VGL_DISPLAY=egl{n} uses EGL device n, and VGL_DISPLAY={DRI device path} uses
+// the EGL device with the specified DRM primary or render node.
+
+static EGLDisplay openDisplay(void)
+{
+	const char *dpyString = fconfig.localdpystring;
+	EGLDeviceEXT devices[MAXDEVICES];  EGLint nDevices = 0;
+	EGLDisplay display = EGL_NO_DISPLAY;
+	int index = -1;
+
+	if(!strnicmp(dpyString, "egl", 3))
+	{
+		char *end = NULL;
+		index = 0;
+		if(strlen(dpyString) > 3)
+		{
+			index = strtol(&dpyString[3], &end, 10);
+			if(!end || *end != 0 || index < 0)
+				_throw("Invalid EGL device index in VGL_DISPLAY");
+		}
+	}
+
+	CHECKSYM_NONFATAL(eglQueryDevicesEXT);
+	CHECKSYM_NONFATAL(eglQueryDeviceStringEXT);
+	if(__eglQueryDevicesEXT)
+		_eglQueryDevicesEXT(MAXDEVICES, devices, &nDevices);
+
+	if(index >= 0 && index < nDevices)
+		display = _eglGetPlatformDisplayEXT(EGL_PLATFORM_DEVICE_EXT,
+			devices[index], NULL);
+	else if(index < 0 && __eglQueryDeviceStringEXT)
+	{
+		for(int i = 0; i < nDevices; i++)
+		{
+			const char *drmDevice =
+				_eglQueryDeviceStringEXT(devices[i], EGL_DRM_DEVICE_FILE_EXT);
+			const char *renderNode = NULL;
+			#ifdef EGL_DRM_RENDER_NODE_FILE_EXT
+			renderNode =
+				_eglQueryDeviceStringEXT(devices[i], EGL_DRM_RENDER_NODE_FILE_EXT);
+			#endif
+			if((drmDevice && !strcmp(drmDevice, dpyString))
+				|| (renderNode && !strcmp(renderNode, dpyString)))
+			{
+				display = _eglGetPlatformDisplayEXT(EGL_PLATFORM_DEVICE_EXT,
+					devices[i], NULL);
+				break;
+			}
+		}
+	}
+	else if(index == 0)
+		display = _eglGetPlatformDisplayEXT(EGL_PLATFORM_SURFACELESS_MESA,
+			EGL_DEFAULT_DISPLAY, NULL);
+
+	if(display == EGL_NO_DISPLAY)
+		_throw("Could not find the EGL device specified in VGL_DISPLAY");
+	return display;
+}
+
+
+static EGLDisplay getEGLDisplay(void)
+{
+	if(__atomic_load_n(&initialized, __ATOMIC_ACQUIRE)) return edpy;
+
+	vglfaker::GlobalCriticalSection::SafeLock l(globalMutex);
+	if(initialized) return edpy;
+
+	if(fconfig.verbose)
+		vglout.println("[VGL] Opening EGL device %s", fconfig.localdpystring);
+	EGLDisplay display = openDisplay();
+	EGLint major = 0, minor = 0;
+	if(!_eglInitialize(display, &major, &minor))
+		_throw("Could not initialize EGL display");
+	const char *exts = _eglQueryString(display, EGL_EXTENSIONS);
+	if(!exts || !strstr(exts, "EGL_KHR_surfaceless_context"))
+		_throw("EGL implementation does not support EGL_KHR_surfaceless_context");
+	if(!_eglBindAPI(EGL_OPENGL_API))
+		_throw("Could not enable OpenGL API in EGL");
+
+	// Since all rendering is to renderbuffers, the EGL config of a context does
+	// not matter.
+	EGLConfig config = EGL_NO_CONFIG_KHR;
+	if(!strstr(exts, "EGL_KHR_no_config_context"))
+	{
+		EGLint attribs[] = { EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT, EGL_NONE };
+		EGLint n = 0;
+		if(!_eglChooseConfig(display, attribs, &config, 1, &n) || n < 1)
+			_throw("Could not find a suitable EGL config");
+	}
+
+	EGLContext ctx = _eglCreateContext(display, config, EGL_NO_CONTEXT, NULL);
+	if(ctx == EGL_NO_CONTEXT) _throw("Could not create EGL root context");
+	if(!_eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, ctx))
+		_throw("Could not make EGL root context current");
+	GLint maxSamples = 0;
+	_glGetIntegerv(GL_MAX_SAMPLES, &maxSamples);
+	_glGetIntegerv(GL_MAX_RENDERBUFFER_SIZE, &maxPbufferSize);
+	_eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+
+	buildConfigs(maxSamples);
+	ctxhashegl.add((GLXContext)ctx, (GLXFBConfig)&eglConfigs[0]);
+	if(fconfig.verbose)
+		vglout.println("[VGL] EGL %d.%d, %s", major, minor,
+			_eglQueryString(display, EGL_VENDOR));
+
+	edpy = display;  rootCtx = ctx;
+	__atomic_store_n(&initialized, true, __ATOMIC_RELEASE);
+	return edpy;
+}
+
+
+// Creating and destroying Pbuffers requires a current context from the share
+// group.  If one of our contexts isn't current in this thread, then this class
+// temporarily makes the root context current.
+
+class RootContext
+{
+	public:
+
+		RootContext(void) : bound(false), oldDpy(EGL_NO_DISPLAY),
+			oldDraw(EGL_NO_SURFACE), oldRead(EGL_NO_SURFACE),
+			oldCtx(EGL_NO_CONTEXT)
+		{
+			getEGLDisplay();
+			ContextStateEGL *state = getCurrentState();
+			if(state) { ctx = state->ctx;  return; }
+
+			rootMutex.lock(false);
+			oldDpy = _eglGetCurrentDisplay();
+			oldCtx = _eglGetCurrentContext();
+			oldDraw = _eglGetCurrentSurface(EGL_DRAW);
+			oldRead = _eglGetCurrentSurface(EGL_READ);
+			if(!_eglMakeCurrent(edpy, EGL_NO_SURFACE, EGL_NO_SURFACE, rootCtx))
+			{
+				rootMutex.unlock(false);
+				_throw("Could not make EGL root context current");
+			}
+			bound = true;  ctx = (GLXContext)rootCtx;
+			FakePbuffer::deleteOrphans(ctx);
+		}
+
+		~RootContext(void)
+		{
+			if(!bound) return;
+			if(oldCtx != EGL_NO_CONTEXT)
+				_eglMakeCurrent(oldDpy, oldDraw, oldRead, oldCtx);
+			else
+				_eglMakeCurrent(edpy, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+			rootMutex.unlock(false);
+		}
+
+		GLXContext ctx;
+
+	private:
+
+		bool bound;
+		EGLDisplay oldDpy;
+		EGLSurface oldDraw, oldRead;
+		EGLContext oldCtx;
+};
+
+
+static FBConfigEGL *validConfig(GLXFBConfig config)
+{
+	FBConfigEGL *c = (FBConfigEGL *)config;
+	getEGLDisplay();
+	if(!c || c < eglConfigs || c >= &eglConfigs[nEGLConfigs]) return NULL;
+	return c;
+}
+
+
+// glXChooseFBConfig() emulation
+
+// GLX_DONT_CARE is defined as an unsigned value, but attribute values are
+// ints.
+static const int DONTCARE = (int)GLX_DONT_CARE;
+
+typedef struct
+{
+	int redSize, greenSize, blueSize, alphaSize, depthSize, stencilSize,
+		sampleBuffers, samples, doubleBuffer, stereo;
+} ConfigRequest;
+
+static ConfigRequest *sortRequest = NULL;
+
+
+static int colorBits(FBConfigEGL *config, ConfigRequest *req)
+{
+	int bits = 0;
+	if(req->redSize > 0 && req->redSize != DONTCARE)
+		bits += config->redSize;
+	if(req->greenSize > 0 && req->greenSize != DONTCARE)
+		bits += config->greenSize;
+	if(req->blueSize > 0 && req->blueSize != DONTCARE)
+		bits += config->blueSize;
+	if(req->alphaSize > 0 && req->alphaSize != DONTCARE)
+		bits += config->alphaSize;
+	return bits;
+}
+
+
+// This implements the GLX sort order, except that 10-bit configs are sorted
+// after 8-bit configs (as most GLX implementations do), so that applications
+// don't accidentally end up with a 30-bit visual.
+
+static int compareConfigs(const void *arg1, const void *arg2)
+{
+	FBConfigEGL *c1 = *(FBConfigEGL **)arg1, *c2 = *(FBConfigEGL **)arg2;
+	int v1, v2;
+
+	#define COMPARE(a, b, largerFirst) \
+	{ \
+		v1 = (a);  v2 = (b); \
+		if(v1 != v2) return largerFirst ? v2 - v1 : v1 - v2; \
+	}
+
+	COMPARE(c1->redSize > 8, c2->redSize > 8, false);
+	COMPARE(colorBits(c1, sortRequest), colorBits(c2, sortRequest), true);
+	COMPARE(c1->redSize + c1->greenSize + c1->blueSize + c1->alphaSize,
+		c2->redSize + c2->greenSize + c2->blueSize + c2->alphaSize, false);
+	COMPARE(c1->doubleBuffer, c2->doubleBuffer, false);
+	COMPARE(c1->samples, c2->samples, false);
+	COMPARE(c1->depthSize, c2->depthSize, true);
+	COMPARE(c1->stencilSize, c2->stencilSize, false);
+	COMPARE(c1->id, c2->id, false);
+	return 0;
+}
+
+
+#define MINMATCH(value, req) \
+	(req == DONTCARE || value >= req)
+
+#define EXACTMATCH(value, req) \
+	(req == DONTCARE || value == req)
+
+static GLXFBConfig *chooseFBConfigEGL(const int *attribs, int *nElements)
+{
+	ConfigRequest req = { 0, 0, 0, 0, 0, 0, 0, 0, DONTCARE, False };
+	int level = 0, renderType = GLX_RGBA_BIT, drawableType = GLX_WINDOW_BIT,
+		visualType = DONTCARE, caveat = DONTCARE,
+		transparentType = GLX_NONE, fbcid = DONTCARE;
+	GLXFBConfig *configs = NULL;  int n = 0;
+
+	getEGLDisplay();
+	if(!nElements) return NULL;
+	*nElements = 0;
+
+	for(int i = 0; attribs && attribs[i] != None && i <= 254; i += 2)
+	{
+		int value = attribs[i + 1];
+		switch(attribs[i])
+		{
+			case GLX_RED_SIZE:  req.redSize = value;  break;
+			case GLX_GREEN_SIZE:  req.greenSize = value;  break;
+			case GLX_BLUE_SIZE:  req.blueSize = value;  break;
+			case GLX_ALPHA_SIZE:  req.alphaSize = value;  break;
+			case GLX_DEPTH_SIZE:  req.depthSize = value;  break;
+			case GLX_STENCIL_SIZE:  req.stencilSize = value;  break;
+			case GLX_SAMPLE_BUFFERS:  req.sampleBuffers = value;  break;
+			case GLX_SAMPLES:  req.samples = value;  break;
+			case GLX_DOUBLEBUFFER:  req.doubleBuffer = value;  break;
+			case GLX_STEREO:  req.stereo = value;  break;
+			case GLX_LEVEL:  level = value;  break;
+			case GLX_RENDER_TYPE:  renderType = value;  break;
+			case GLX_DRAWABLE_TYPE:  drawableType = value;  break;
+			case GLX_X_VISUAL_TYPE:  visualType = value;  break;
+			case GLX_CONFIG_CAVEAT:  caveat = value;  break;
+			case GLX_TRANSPARENT_TYPE:  transparentType = value;  break;
+			case GLX_FBCONFIG_ID:  fbcid = value;  break;
+		}
+	}
+
+	_newcheck(configs = (GLXFBConfig *)malloc(sizeof(GLXFBConfig) *
+		nEGLConfigs));
+	for(int i = 0; i < nEGLConfigs; i++)
+	{
+		FBConfigEGL *c = &eglConfigs[i];
+
+		if(fbcid != DONTCARE)
+		{
+			if(c->id == fbcid) configs[n++] = (GLXFBConfig)c;
+			continue;
+		}
+		if(!MINMATCH(c->redSize, req.redSize)
+			|| !MINMATCH(c->greenSize, req.greenSize)
+			|| !MINMATCH(c->blueSize, req.blueSize)
+			|| !MINMATCH(c->alphaSize, req.alphaSize)
+			|| !MINMATCH(c->depthSize, req.depthSize)
+			|| !MINMATCH(c->stencilSize, req.stencilSize)
+			|| !MINMATCH((c->samples > 0), req.sampleBuffers)
+			|| !MINMATCH(c->samples, req.samples)
+			|| !EXACTMATCH(c->doubleBuffer, req.doubleBuffer)
+			|| !EXACTMATCH(c->stereo, req.stereo)
+			|| !EXACTMATCH(0, level)
+			|| !EXACTMATCH(GLX_NONE, caveat)
+			|| !EXACTMATCH(GLX_NONE, transparentType))
+			continue;
+		if(renderType != DONTCARE && (renderType & GLX_RGBA_BIT) == 0)
+			continue;
+		if(drawableType != DONTCARE && (drawableType
+			& ~(GLX_WINDOW_BIT | GLX_PIXMAP_BIT | GLX_PBUFFER_BIT)) != 0)
+			continue;
+		// An FBO has no visual type, so DirectColor is as good as TrueColor.
+		if(visualType != DONTCARE && visualType != GLX_TRUE_COLOR
+			&& visualType != GLX_DIRECT_COLOR)
+			continue;
+		configs[n++] = (GLXFBConfig)c;
+	}
+
+	if(n < 1)
+	{
+		free(configs);  return NULL;
+	}
+	{
+		static CriticalSection sortMutex;
+		CriticalSection::SafeLock l(sortMutex);
+		sortRequest = &req;
+		qsort(configs, n, sizeof(GLXFBConfig), compareConfigs);
+		sortRequest = NULL;
+	}
+	*nElements = n;
+	return configs;
+}
+
+
+static GLXFBConfig *getFBConfigsEGL(int *nElements)
+{
+	GLXFBConfig *configs = NULL;
+
+	getEGLDisplay();
+	if(!nElements) return NULL;
+	*nElements = 0;
+
+	_newcheck(configs = (GLXFBConfig *)malloc(sizeof(GLXFBConfig) *
+		nEGLConfigs));
+	for(int i = 0; i < nEGLConfigs; i++)
+		configs[i] = (GLXFBConfig)&eglConfigs[i];
+	*nElements = nEGLConfigs;
+	return configs;
+}
+
+
+static int getFBConfigAttribEGL(GLXFBConfig config_, int attribute,
+	int *value)
+{
+	FBConfigEGL *config = validConfig(config_);
+
+	if(!config || !value) return GLX_BAD_VALUE;
+
+	switch(attribute)
+	{
+		case GLX_FBCONFIG_ID:  *value = config->id;  break;
+		case GLX_BUFFER_SIZE:
+			*value = config->redSize + config->greenSize + config->blueSize +
+				config->alphaSize;
+			break;
+		case GLX_LEVEL:  *value = 0;  break;
+		case GLX_DOUBLEBUFFER:  *value = config->doubleBuffer;  break;
+		case GLX_STEREO:  *value = config->stereo;  break;
+		case GLX_AUX_BUFFERS:  *value = 0;  break;
+		case GLX_RED_SIZE:  *value = config->redSize;  break;
+		case GLX_GREEN_SIZE:  *value = config->greenSize;  break;
+		case GLX_BLUE_SIZE:  *value = config->blueSize;  break;
+		case GLX_ALPHA_SIZE:  *value = config->alphaSize;  break;
+		case GLX_DEPTH_SIZE:  *value = config->depthSize;  break;
+		case GLX_STENCIL_SIZE:  *value = config->stencilSize;  break;
+		case GLX_ACCUM_RED_SIZE:
+		case GLX_ACCUM_GREEN_SIZE:
+		case GLX_ACCUM_BLUE_SIZE:
+		case GLX_ACCUM_ALPHA_SIZE:
+			*value = 0;  break;
+		case GLX_SAMPLE_BUFFERS:  *value = (config->samples > 0);  break;
+		case GLX_SAMPLES:  *value = config->samples;  break;
+		case GLX_RENDER_TYPE:  *value = GLX_RGBA_BIT;  break;
+		case GLX_DRAWABLE_TYPE:
+			*value = GLX_WINDOW_BIT | GLX_PIXMAP_BIT | GLX_PBUFFER_BIT;  break;
+		case GLX_X_RENDERABLE:  *value = True;  break;
+		case GLX_X_VISUAL_TYPE:  *value = GLX_TRUE_COLOR;  break;
+		case GLX_VISUAL_ID:  *value = 0;  break;
+		case GLX_CONFIG_CAVEAT:  *value = GLX_NONE;  break;
+		case GLX_TRANSPARENT_TYPE:  *value = GLX_NONE;  break;
+		case GLX_TRANSPARENT_INDEX_VALUE:
+		case GLX_TRANSPARENT_RED_VALUE:
+		case GLX_TRANSPARENT_GREEN_VALUE:
+		case GLX_TRANSPARENT_BLUE_VALUE:
+		case GLX_TRANSPARENT_ALPHA_VALUE:
+			*value = 0;  break;
+		case GLX_MAX_PBUFFER_WIDTH:
+		case GLX_MAX_PBUFFER_HEIGHT:
+			*value = maxPbufferSize;  break;
+		case GLX_MAX_PBUFFER_PIXELS:
+			*value = maxPbufferSize * maxPbufferSize;  break;
+		case GLX_SCREEN:  *value = 0;  break;
+		#ifdef GLX_FRAMEBUFFER_SRGB_CAPABLE_ARB
+		case GLX_FRAMEBUFFER_SRGB_CAPABLE_ARB:  *value = False;  break;
+		#endif
+		default:
+			return GLX_BAD_ATTRIBUTE;
+	}
+	return Success;
+}
+
+
+static XVisualInfo *getVisualFromFBConfigEGL(GLXFBConfig config_)
+{
+	FBConfigEGL *config = validConfig(config_);
+	XVisualInfo *vis = NULL;
+
+	if(!config) return NULL;
+	_newcheck(vis = (XVisualInfo *)malloc(sizeof(XVisualInfo)));
+	memset(vis, 0, sizeof(XVisualInfo));
+	vis->depth = config->redSize > 8 ? 30 : 24;
+	vis->c_class = TrueColor;
+	vis->bits_per_rgb = config->redSize;
+	vis->colormap_size = 1 << config->redSize;
+	return vis;
+}
+
+
+static GLXContext createContextEGL(GLXFBConfig config, GLXContext share,
+	const int *glxAttribs)
+{
+	EGLint attribs[256];  int j = 0;
+	EGLDisplay display = getEGLDisplay();
+
+	if(!validConfig(config)) return NULL;
+
+	for(int i = 0; glxAttribs && glxAttribs[i] != None && i <= 254; i += 2)
+	{
+		int value = glxAttribs[i + 1];
+		switch(glxAttribs[i])
+		{
+			case GLX_CONTEXT_MAJOR_VERSION_ARB:
+				attribs[j++] = EGL_CONTEXT_MAJOR_VERSION_KHR;
+				attribs[j++] = value;  break;
+			case GLX_CONTEXT_MINOR_VERSION_ARB:
+				attribs[j++] = EGL_CONTEXT_MINOR_VERSION_KHR;
+				attribs[j++] = value;  break;
+			case GLX_CONTEXT_FLAGS_ARB:
+				attribs[j++] = EGL_CONTEXT_FLAGS_KHR;
+				attribs[j++] = value;  break;
+			case GLX_CONTEXT_PROFILE_MASK_ARB:
+				// The EGL back end cannot create OpenGL ES contexts.
+				if(value != GLX_CONTEXT_CORE_PROFILE_BIT_ARB
+					&& value != GLX_CONTEXT_COMPATIBILITY_PROFILE_BIT_ARB)
+					return NULL;
+				attribs[j++] = EGL_CONTEXT_OPENGL_PROFILE_MASK_KHR;
+				attribs[j++] = value;  break;
+			case GLX_CONTEXT_RESET_NOTIFICATION_STRATEGY_ARB:
+				attribs[j++] = EGL_CONTEXT_OPENGL_RESET_NOTIFICATION_STRATEGY_KHR;
+				attribs[j++] = value == GLX_LOSE_CONTEXT_ON_RESET_ARB ?
+					EGL_LOSE_CONTEXT_ON_RESET_KHR : EGL_NO_RESET_NOTIFICATION_KHR;
+				break;
+			case GLX_CONTEXT_OPENGL_NO_ERROR_ARB:
+				attribs[j++] = EGL_CONTEXT_OPENGL_NO_ERROR_KHR;
+				attribs[j++] = value;  break;
+			case GLX_CONTEXT_RELEASE_BEHAVIOR_ARB:
+				attribs[j++] = EGL_CONTEXT_RELEASE_BEHAVIOR_KHR;
+				attribs[j++] = value == GLX_CONTEXT_RELEASE_BEHAVIOR_NONE_ARB ?
+					EGL_CONTEXT_RELEASE_BEHAVIOR_NONE_KHR :
+					EGL_CONTEXT_RELEASE_BEHAVIOR_FLUSH_KHR;
+				break;
+			case GLX_RENDER_TYPE:
+				if(value != GLX_RGBA_TYPE) return NULL;
+				break;
+		}
+	}
+	attribs[j] = EGL_NONE;
+
+	// All contexts are created in the same share group as the root context, so
+	// that the renderbuffers backing Pbuffers are accessible from all of them.
+	EGLConfig eglConfig = EGL_NO_CONFIG_KHR;
+	const char *exts = _eglQueryString(display, EGL_EXTENSIONS);
+	if(!exts || !strstr(exts, "EGL_KHR_no_config_context"))
+	{
+		EGLint configAttribs[] = { EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+			EGL_NONE };
+		EGLint n = 0;
+		_eglChooseConfig(display, configAttribs, &eglConfig, 1, &n);
+	}
+	EGLContext ctx = _eglCreateContext(display, eglConfig,
+		share ? (EGLContext)share : rootCtx, attribs);
+	if(ctx == EGL_NO_CONTEXT) return NULL;
+	ctxhashegl.add((GLXContext)ctx, config);
+	return (GLXContext)ctx;
+}
+
+
+static void destroyContextEGL(GLXContext ctx)
+{
+	EGLDisplay display = getEGLDisplay();
+
+	if(!ctx || (EGLContext)ctx == rootCtx || !ctxhashegl.find(ctx)) return;
+	_eglDestroyContext(display, (EGLContext)ctx);
+	pbhashegl.removeContext(ctx);
+	FakePbuffer::removeOrphans(ctx);
+	ctxhashegl.remove(ctx);
+}
+
+
+static int queryContextEGL(GLXContext ctx, int attribute, int *value)
+{
+	ContextStateEGL *state = ctxhashegl.find(ctx);
+
+	if(!state) return GLX_BAD_CONTEXT;
+	if(!value) return GLX_BAD_VALUE;
+	switch(attribute)
+	{
+		case GLX_FBCONFIG_ID:
+			*value = ((FBConfigEGL *)state->config)->id;  break;
+		case GLX_RENDER_TYPE:  *value = GLX_RGBA_TYPE;  break;
+		case GLX_SCREEN:  *value = 0;  break;
+		default:
+			return GLX_BAD_ATTRIBUTE;
+	}
+	return Success;
+}
+
+
+// Default framebuffer emulation
+
+// Translate the name of a default framebuffer color buffer into the
+// corresponding FBO attachments.  Returns the number of attachments, or 0 if
+// the buffer does not exist in the specified FB config.
+
+static int mapDrawBuffer(FBConfigEGL *config, GLenum buf, GLenum *attachments)
+{
+	int n = 0;
+	bool present[4] = { true, config->doubleBuffer, config->stereo,
+		config->doubleBuffer && config->stereo };
+	int mask = 0;
+
+	switch(buf)
+	{
+		case GL_NONE:
+			attachments[0] = GL_NONE;  return 1;
+		case GL_FRONT:  mask = 0x5;  break;
+		case GL_BACK:  mask = 0xA;  break;
+		case GL_LEFT:  mask = 0x3;  break;
+		case GL_RIGHT:  mask = 0xC;  break;
+		case GL_FRONT_AND_BACK:  mask = 0xF;  break;
+		case GL_FRONT_LEFT:  mask = 0x1;  break;
+		case GL_BACK_LEFT:  mask = 0x2;  break;
+		case GL_FRONT_RIGHT:  mask = 0x4;  break;
+		case GL_BACK_RIGHT:  mask = 0x8;  break;
+		default:
+			return 0;
+	}
+	// Names that refer to multiple buffers (GL_FRONT_AND_BACK, for instance)
+	// are valid as long as at least one of the buffers exists.
+	for(int i = 0; i < 4; i++)
+		if((mask & (1 << i)) && present[i])
+			attachments[n++] = GL_COLOR_ATTACHMENT0 + i;
+	return n;
+}
+
+
+// The inverse of mapDrawBuffer().  If more than one buffer name maps to the
+// specified attachments, then the most general name is returned.
+
+static GLenum unmapDrawBuffer(FBConfigEGL *config, const GLenum *attachments,
+	int nAttachments)
+{
+	static const GLenum names[] = { GL_NONE, GL_FRONT, GL_BACK, GL_FRONT_AND_BACK,
+		GL_LEFT, GL_RIGHT, GL_FRONT_LEFT, GL_BACK_LEFT, GL_FRONT_RIGHT,
+		GL_BACK_RIGHT };
+
+	for(int i = 0; i < (int)(sizeof(names) / sizeof(GLenum)); i++)
+	{
+		GLenum nameAttachments[4];
+		int n = mapDrawBuffer(config, names[i], nameAttachments);
+		if(n != nAttachments) continue;
+		if(!memcmp(nameAttachments, attachments, sizeof(GLenum) * n))
+			return names[i];
+	}
+	return 0;
+}
+
+
+static GLenum mapReadBuffer(FBConfigEGL *config, GLenum buf)
+{
+	int index = -1;
+
+	switch(buf)
+	{
+		case GL_NONE:  return GL_NONE;
+		case GL_FRONT:  case GL_LEFT:  case GL_FRONT_LEFT:  case GL_FRONT_AND_BACK:
+			index = 0;  break;
+		case GL_BACK:  case GL_BACK_LEFT:
+			index = 1;  break;
+		case GL_RIGHT:  case GL_FRONT_RIGHT:
+			index = 2;  break;
+		case GL_BACK_RIGHT:
+			index = 3;  break;
+		default:
+			return 0;
+	}
+	if(((index & 1) && !config->doubleBuffer)
+		|| ((index & 2) && !config->stereo))
+		return 0;
+	return GL_COLOR_ATTACHMENT0 + index;
+}
+
+
+// Returns true if the emulated default framebuffer is bound to the specified
+// target (GL_DRAW_FRAMEBUFFER or GL_READ_FRAMEBUFFER.)  If nothing is bound to
+// the target (for instance, because the application deleted the FBO that it
+// had bound), then the emulated default framebuffer is rebound.
+
+static bool defaultFBOBound(ContextStateEGL *state, GLenum target)
+{
+	GLint fbo = 0;
+
+	if(target == GL_READ_FRAMEBUFFER)
+	{
+		if(!state->readFBO) return false;
+		_glGetIntegerv(GL_READ_FRAMEBUFFER_BINDING, &fbo);
+		if(fbo == 0)
+		{
+			_glBindFramebuffer(GL_READ_FRAMEBUFFER, state->readFBO);
+			return true;
+		}
+		return (GLuint)fbo == state->readFBO
+			|| (state->resolveFBO && (GLuint)fbo == state->resolveFBO);
+	}
+	if(!state->drawFBO) return false;
+	_glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &fbo);
+	if(fbo == 0)
+	{
+		_glBindFramebuffer(GL_DRAW_FRAMEBUFFER, state->drawFBO);
+		return true;
+	}
+	return (GLuint)fbo == state->drawFBO;
+}
+
+
+// Apply the context's emulated draw buffer state to the FBO that is bound to
+// GL_DRAW_FRAMEBUFFER
+
+static void applyDrawBuffers(ContextStateEGL *state)
+{
+	GLenum attachments[4];  int n = 0;
+
+	for(int i = 0; i < state->nDrawBufs && n < 4; i++)
+	{
+		GLenum bufAttachments[4];
+		int nBuf = mapDrawBuffer(state->drawConfig, state->drawBufs[i],
+			bufAttachments);
+		// A single draw buffer can map to multiple attachments
+		// (GL_FRONT_AND_BACK, for instance.)
+		for(int j = 0; j < nBuf && n < 4; j++)
+			attachments[n++] = bufAttachments[j];
+	}
+	if(n < 1) { attachments[0] = GL_NONE;  n = 1; }
+	_glDrawBuffers(n, attachments);
+}
+
+
+static void applyReadBuffer(ContextStateEGL *state)
+{
+	GLenum attachment = mapReadBuffer(state->readConfig, state->readBuf);
+	_glReadBuffer(attachment ? attachment : GL_COLOR_ATTACHMENT0);
+}
+
+
+static Bool makeCurrentEGL(GLXDrawable draw, GLXDrawable read, GLXContext ctx)
+{
+	EGLDisplay display = getEGLDisplay();
+	ContextStateEGL *oldState = getCurrentStateEGL();
+
+	if(!ctx)
+	{
+		if(!_eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE,
+			EGL_NO_CONTEXT))
+			return False;
+		setCurrentStateEGL(NULL);
+		ctxhashegl.setCurrent(oldState, false);
+		return True;
+	}
+
+	ContextStateEGL *state = ctxhashegl.find(ctx);
+	FakePbuffer *drawPB = pbhashegl.find(draw), *readPB = pbhashegl.find(read);
+	if(!state || !drawPB || !readPB) return False;
+
+	if(!_eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE,
+		(EGLContext)ctx))
+		return False;
+	if(oldState != state)
+	{
+		ctxhashegl.setCurrent(state, true);
+		setCurrentStateEGL(state);
+		ctxhashegl.setCurrent(oldState, false);
+	}
+	FakePbuffer::deleteOrphans(ctx);
+
+	// If the application has bound its own FBO, then leave it bound.
+	GLint curDrawFBO = 0, curReadFBO = 0;
+	_glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &curDrawFBO);
+	_glGetIntegerv(GL_READ_FRAMEBUFFER_BINDING, &curReadFBO);
+	bool bindDraw = (curDrawFBO == 0 || (GLuint)curDrawFBO == state->drawFBO);
+	bool bindRead = (curReadFBO == 0 || (GLuint)curReadFBO == state->readFBO
+		|| (state->resolveFBO && (GLuint)curReadFBO == state->resolveFBO));
+
+	GLuint drawFBO = drawPB->getFBO(ctx), readFBO = readPB->getFBO(ctx);
+	bool drawChanged = (drawFBO != state->drawFBO),
+		readChanged = (readFBO != state->readFBO);
+	state->draw = draw;  state->drawConfig = drawPB->getConfig();
+	state->read = read;  state->readConfig = readPB->getConfig();
+	state->drawFBO = drawFBO;  state->readFBO = readFBO;
+	state->resolveFBO = 0;
+	if(state->nDrawBufs == 0)
+	{
+		// GLX initializes the draw and read buffers based on the first drawable
+		// to which the context is bound.
+		state->drawBufs[0] = state->readBuf =
+			state->drawConfig->doubleBuffer ? GL_BACK : GL_FRONT;
+		state->nDrawBufs = 1;
+	}
+
+	if(bindDraw)
+	{
+		_glBindFramebuffer(GL_DRAW_FRAMEBUFFER, drawFBO);
+		if(drawChanged) applyDrawBuffers(state);
+	}
+	else _glBindFramebuffer(GL_DRAW_FRAMEBUFFER, curDrawFBO);
+	if(bindRead)
+	{
+		_glBindFramebuffer(GL_READ_FRAMEBUFFER, readFBO);
+		if(readChanged || (GLuint)curReadFBO != readFBO) applyReadBuffer(state);
+	}
+	else _glBindFramebuffer(GL_READ_FRAMEBUFFER, curReadFBO);
+
+	return True;
+}
+
+
+static GLXPbuffer createPbufferEGL(GLXFBConfig config_, const int *attribs)
+{
+	FBConfigEGL *config = validConfig(config_);
+	int width = 0, height = 0;
+	bool largest = false;
+
+	if(!config) return 0;
+	for(int i = 0; attribs && attribs[i] != None && i <= 254; i += 2)
+	{
+		if(attribs[i] == GLX_PBUFFER_WIDTH) width = attribs[i + 1];
+		else if(attribs[i] == GLX_PBUFFER_HEIGHT) height = attribs[i + 1];
+		else if(attribs[i] == GLX_LARGEST_PBUFFER)
+			largest = (attribs[i + 1] != 0);
+	}
+	if(width > maxPbufferSize)
+	{
+		if(!largest) return 0;
+		width = maxPbufferSize;
+	}
+	if(height > maxPbufferSize)
+	{
+		if(!largest) return 0;
+		height = maxPbufferSize;
+	}
+	if(width < 1) width = 1;
+	if(height < 1) height = 1;
+
+	RootContext rc;
+	FakePbuffer *pb = NULL;
+	_newcheck(pb = new FakePbuffer(config, width, height));
+	pbhashegl.add(pb);
+	return pb->getID();
+}
+
+
+static void destroyPbufferEGL(GLXPbuffer pbuf)
+{
+	FakePbuffer *pb = pbhashegl.find(pbuf);
+
+	if(!pb) return;
+	pbhashegl.remove(pbuf);
+	RootContext rc;
+	delete pb;
+}
+
+
+static bool resizePbufferEGL(GLXPbuffer pbuf, int width, int height)
+{
+	FakePbuffer *pb = pbhashegl.find(pbuf);
+
+	if(!pb || width < 1 || height < 1 || width > maxPbufferSize
+		|| height > maxPbufferSize)
+		return false;
+	RootContext rc;
+	pb->resize(width, height);
+	// The current context may render into the Pbuffer without making it
+	// current again (for instance, if the Pbuffer is resized in response to
+	// glViewport()), so its FBO has to be updated immediately.
+	ContextStateEGL *state = getCurrentState();
+	if(state && (state->draw == pbuf || state->read == pbuf))
+	{
+		GLint oldDrawFBO = 0;
+		_glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &oldDrawFBO);
+		pb->getFBO(state->ctx);
+		_glBindFramebuffer(GL_DRAW_FRAMEBUFFER, oldDrawFBO);
+	}
+	return true;
+}
+
+}  // namespace backend
+
+#endif  // EGLBACKEND
+
+
+namespace backend {
+
+GLXFBConfig *chooseFBConfig(const int *attribs, int *nElements)
+{
+	#ifdef EGLBACKEND
+	if(fconfig.egl) return chooseFBConfigEGL(attribs, nElements);
+	#endif
+	return _glXChooseFBConfig(_dpy3D, DefaultScreen(_dpy3D), attribs,
+		nElements);
+}
+
+
+GLXFBConfig *getFBConfigs(int *nElements)
+{
+	#ifdef EGLBACKEND
+	if(fconfig.egl) return getFBConfigsEGL(nElements);
+	#endif
+	return _glXGetFBConfigs(_dpy3D, DefaultScreen(_dpy3D), nElements);
+}
+
+
+int getFBConfigAttrib(GLXFBConfig config, int attribute, int *value)
+{
+	#ifdef EGLBACKEND
+	if(fconfig.egl) return getFBConfigAttribEGL(config, attribute, value);
+	#endif
+	return _glXGetFBConfigAttrib(_dpy3D, config, attribute, value);
+}
+
+
+XVisualInfo *getVisualFromFBConfig(GLXFBConfig config)
+{
+	#ifdef EGLBACKEND
+	if(fconfig.egl) return getVisualFromFBConfigEGL(config);
+	#endif
+	return _glXGetVisualFromFBConfig(_dpy3D, config);
+}
+
+
+GLXContext createContext(GLXFBConfig config, GLXContext share, Bool direct,
+	const int *attribs)
+{
+	#ifdef EGLBACKEND
+	if(fconfig.egl) return createContextEGL(config, share, attribs);
+	#endif
+	if(!attribs)
+		return _glXCreateNewContext(_dpy3D, config, GLX_RGBA_TYPE, share,
+			direct);
+	return _glXCreateContextAttribsARB(_dpy3D, config, share, direct, attribs);
+}
+
+
+void copyContext(GLXContext src, GLXContext dst, unsigned long mask)
+{
+	#ifdef EGLBACKEND
+	// EGL has no equivalent of glXCopyContext().
+	if(fconfig.egl) return;
+	#endif
+	_glXCopyContext(_dpy3D, src, dst, mask);
+}
+
+
+void destroyContext(GLXContext ctx)
+{
+	#ifdef EGLBACKEND
+	if(fconfig.egl) { destroyContextEGL(ctx);  return; }
+	#endif
+	_glXDestroyContext(_dpy3D, ctx);
+}
+
+
+Bool isDirect(GLXContext ctx)
+{
+	#ifdef EGLBACKEND
+	if(fconfig.egl) return True;
+	#endif
+	return _glXIsDirect(_dpy3D, ctx);
+}
+
+
+int queryContext(GLXContext ctx, int attribute, int *value)
+{
+	#ifdef EGLBACKEND
+	if(fconfig.egl) return queryContextEGL(ctx, attribute, value);
+	#endif
+	return _glXQueryContext(_dpy3D, ctx, attribute, value);
+}
+
+
+Bool makeCurrent(GLXDrawable draw, GLXDrawable read, GLXContext ctx)
+{
+	#ifdef EGLBACKEND
+	if(fconfig.egl) return makeCurrentEGL(draw, read, ctx);
+	#endif
+	return _glXMakeContextCurrent(_dpy3D, draw, read, ctx);
+}
+
+
+GLXContext getCurrentContext(void)
+{
+	#ifdef EGLBACKEND
+	if(fconfig.egl)
+	{
+		ContextStateEGL *state = getCurrentState();
+		return state ? state->ctx : NULL;
+	}
+	#endif
+	return _glXGetCurrentContext();
+}
+
+
+GLXDrawable getCurrentDrawable(void)
+{
+	#ifdef EGLBACKEND
+	if(fconfig.egl)
+	{
+		ContextStateEGL *state = getCurrentState();
+		return state ? state->draw : 0;
+	}
+	#endif
+	return _glXGetCurrentDrawable();
+}
+
+
+GLXDrawable getCurrentReadDrawable(void)
+{
+	#ifdef EGLBACKEND
+	if(fconfig.egl)
+	{
+		ContextStateEGL *state = getCurrentState();
+		return state ? state->read : 0;
+	}
+	#endif
+	return _glXGetCurrentReadDrawable();
+}
+
+
+GLXPbuffer createPbuffer(GLXFBConfig config, const int *attribs)
+{
+	#ifdef EGLBACKEND
+	if(fconfig.egl) return createPbufferEGL(config, attribs);
+	#endif
+	return _glXCreatePbuffer(_dpy3D, config, attribs);
+}
+
+
+void destroyPbuffer(GLXPbuffer pbuf)
+{
+	#ifdef EGLBACKEND
+	if(fconfig.egl) { destroyPbufferEGL(pbuf);  return; }
+	#endif
+	_glXDestroyPbuffer(_dpy3D, pbuf);
+}
+
+
+bool resizePbuffer(GLXPbuffer pbuf, int width, int height)
+{
+	#ifdef EGLBACKEND
+	if(fconfig.egl) return resizePbufferEGL(pbuf, width, height);
+	#endif
+	return false;
+}
+
+
+void queryDrawable(GLXDrawable draw, int attribute, unsigned int *value)
+{
+	#ifdef EGLBACKEND
+	if(fconfig.egl)
+	{
+		FakePbuffer *pb = pbhashegl.find(draw);
+		if(!pb || !value) return;
+		switch(attribute)
+		{
+			case GLX_WIDTH:  *value = pb->getWidth();  break;
+			case GLX_HEIGHT:  *value = pb->getHeight();  break;
+			case GLX_PRESERVED_CONTENTS:  *value = True;  break;
+			case GLX_LARGEST_PBUFFER:  *value = False;  break;
+			case GLX_FBCONFIG_ID:  *value = pb->getConfig()->id;  break;
+		}
+		return;
+	}
+	#endif
+	_glXQueryDrawable(_dpy3D, draw, attribute, value);
+}
+
+
+void swapBuffers(GLXDrawable draw)
+{
+	#ifdef EGLBACKEND
+	if(fconfig.egl)
+	{
+		FakePbuffer *pb = pbhashegl.find(draw);
+		if(!pb) return;
+		RootContext rc;
+		pb->swap(rc.ctx);
+		return;
+	}
+	#endif
+	_glXSwapBuffers(_dpy3D, draw);
+}
+
+
+Bool queryExtension(int *errorBase, int *eventBase)
+{
+	#ifdef EGLBACKEND
+	if(fconfig.egl)
+	{
+		if(errorBase) *errorBase = 0;
+		if(eventBase) *eventBase = 0;
+		return True;
+	}
+	#endif
+	return _glXQueryExtension(_dpy3D, errorBase, eventBase);
+}
+
+
+Bool queryVersion(int *major, int *minor)
+{
+	#ifdef EGLBACKEND
+	if(fconfig.egl)
+	{
+		if(major) *major = 1;
+		if(minor) *minor = 4;
+		return True;
+	}
+	#endif
+	return _glXQueryVersion(_dpy3D, major, minor);
+}
+
+
+GLXContext importContext(GLXContextID contextID)
+{
+	#ifdef EGLBACKEND
+	if(fconfig.egl) return NULL;
+	#endif
+	return _glXImportContextEXT(_dpy3D, contextID);
+}
+
+
+void freeContext(GLXContext ctx)
+{
+	#ifdef EGLBACKEND
+	if(fconfig.egl) return;
+	#endif
+	_glXFreeContextEXT(_dpy3D, ctx);
+}
+
+
+int queryContextInfo(GLXContext ctx, int attribute, int *value)
+{
+	#ifdef EGLBACKEND
+	if(fconfig.egl)
+	{
+		if(attribute == GLX_SHARE_CONTEXT_EXT)
+			return GLX_BAD_ATTRIBUTE;
+		return queryContextEGL(ctx, attribute == GLX_VISUAL_ID_EXT ?
+			GLX_FBCONFIG_ID : attribute, value);
+	}
+	#endif
+	return _glXQueryContextInfoEXT(_dpy3D, ctx, attribute, value);
+}
+
+
+void getSelectedEvent(GLXDrawable draw, unsigned long *eventMask)
+{
+	#ifdef EGLBACKEND
+	if(fconfig.egl) { if(eventMask) *eventMask = 0;  return; }
+	#endif
+	_glXGetSelectedEvent(_dpy3D, draw, eventMask);
+}
+
+
+void selectEvent(GLXDrawable draw, unsigned long eventMask)
+{
+	#ifdef EGLBACKEND
+	if(fconfig.egl) return;
+	#endif
+	_glXSelectEvent(_dpy3D, draw, eventMask);
+}
+
+
+Bool joinSwapGroup(GLXDrawable drawable, GLuint group)
+{
+	#ifdef EGLBACKEND
+	if(fconfig.egl) return False;
+	#endif
+	return _glXJoinSwapGroupNV(_dpy3D, drawable, group);
+}
+
+
+Bool bindSwapBarrier(GLuint group, GLuint barrier)
+{
+	#ifdef EGLBACKEND
+	if(fconfig.egl) return False;
+	#endif
+	return _glXBindSwapBarrierNV(_dpy3D, group, barrier);
+}
+
+
+Bool querySwapGroup(GLXDrawable drawable, GLuint *group, GLuint *barrier)
+{
+	#ifdef EGLBACKEND
+	if(fconfig.egl) return False;
+	#endif
+	return _glXQuerySwapGroupNV(_dpy3D, drawable, group, barrier);
+}
+
+
+Bool queryMaxSwapGroups(GLuint *maxGroups, GLuint *maxBarriers)
+{
+	#ifdef EGLBACKEND
+	if(fconfig.egl) return False;
+	#endif
+	return _glXQueryMaxSwapGroupsNV(_dpy3D, DefaultScreen(_dpy3D), maxGroups,
+		maxBarriers);
+}
+
+
+Bool queryFrameCount(GLuint *count)
+{
+	#ifdef EGLBACKEND
+	if(fconfig.egl) return False;
+	#endif
+	return _glXQueryFrameCountNV(_dpy3D, DefaultScreen(_dpy3D), count);
+}
+
+
+Bool resetFrameCount(void)
+{
+	#ifdef EGLBACKEND
+	if(fconfig.egl) return False;
+	#endif
+	return _glXResetFrameCountNV(_dpy3D, DefaultScreen(_dpy3D));
+}
+
+
+#ifdef EGLBACKEND
+
+// With the GLX back end, the remaining functions are only called by
+// VirtualGL, so they can pass through to the real OpenGL functions without
+// any checks.  With the EGL back end, they are also called by the interposed
+// OpenGL functions.
+
+void bindFramebuffer(GLenum target, GLuint framebuffer, bool ext)
+{
+	if(fconfig.egl && framebuffer == 0)
+	{
+		ContextStateEGL *state = getCurrentState();
+		if(state)
+		{
+			if(target == GL_FRAMEBUFFER || target == GL_DRAW_FRAMEBUFFER)
+			{
+				_glBindFramebuffer(GL_DRAW_FRAMEBUFFER, state->drawFBO);
+				applyDrawBuffers(state);
+			}
+			if(target == GL_FRAMEBUFFER || target == GL_READ_FRAMEBUFFER)
+			{
+				_glBindFramebuffer(GL_READ_FRAMEBUFFER, state->readFBO);
+				applyReadBuffer(state);
+			}
+			if(target == GL_FRAMEBUFFER || target == GL_DRAW_FRAMEBUFFER
+				|| target == GL_READ_FRAMEBUFFER)
+				return;
+		}
+	}
+	if(ext) _glBindFramebufferEXT(target, framebuffer);
+	else _glBindFramebuffer(target, framebuffer);
+}
+
+
+void drawBuffer(GLenum mode)
+{
+	if(fconfig.egl)
+	{
+		ContextStateEGL *state = getCurrentState();
+		GLenum attachments[4];  int n;
+		if(state && defaultFBOBound(state, GL_DRAW_FRAMEBUFFER)
+			&& (n = mapDrawBuffer(state->drawConfig, mode, attachments)) > 0)
+		{
+			_glDrawBuffers(n, attachments);
+			state->drawBufs[0] = mode;  state->nDrawBufs = 1;
+			return;
+		}
+	}
+	_glDrawBuffer(mode);
+}
+
+
+void drawBuffers(GLsizei n, const GLenum *bufs)
+{
+	if(fconfig.egl && n > 0 && n <= 4 && bufs)
+	{
+		ContextStateEGL *state = getCurrentState();
+		if(state && defaultFBOBound(state, GL_DRAW_FRAMEBUFFER))
+		{
+			GLenum attachments[4];
+			for(int i = 0; i < n; i++)
+			{
+				GLenum bufAttachments[4];
+				// glDrawBuffers() only accepts the names of single buffers.
+				if(bufs[i] == GL_FRONT || bufs[i] == GL_BACK || bufs[i] == GL_LEFT
+					|| bufs[i] == GL_RIGHT || bufs[i] == GL_FRONT_AND_BACK
+					|| mapDrawBuffer(state->drawConfig, bufs[i], bufAttachments) != 1)
+				{
+					_glDrawBuffers(n, bufs);  return;
+				}
+				attachments[i] = bufAttachments[0];
+			}
+			_glDrawBuffers(n, attachments);
+			for(int i = 0; i < n; i++) state->drawBufs[i] = bufs[i];
+			state->nDrawBufs = n;
+			return;
+		}
+	}
+	_glDrawBuffers(n, bufs);
+}
+
+
+void readBuffer(GLenum mode, bool resolve)
+{
+	if(fconfig.egl)
+	{
+		ContextStateEGL *state = getCurrentState();
+		GLenum attachment;
+		if(state && defaultFBOBound(state, GL_READ_FRAMEBUFFER)
+			&& (attachment = mapReadBuffer(state->readConfig, mode)) != 0)
+		{
+			if(resolve && state->readConfig->samples > 0 && attachment != GL_NONE)
+			{
+				FakePbuffer *pb = pbhashegl.find(state->read);
+				if(pb)
+				{
+					state->resolveFBO =
+						pb->resolve(state->ctx, attachment - GL_COLOR_ATTACHMENT0);
+					return;
+				}
+			}
+			_glBindFramebuffer(GL_READ_FRAMEBUFFER, state->readFBO);
+			_glReadBuffer(attachment);
+			if(!resolve) state->readBuf = mode;
+			return;
+		}
+	}
+	_glReadBuffer(mode);
+}
+
+
+// OpenGL does not allow pixels to be read from a multisampled FBO, but GLX
+// allows pixels to be read from a multisampled drawable (the GLX
+// implementation resolves the read buffer implicitly.)  Thus, if the emulated
+// default framebuffer is bound to GL_READ_FRAMEBUFFER and is multisampled,
+// then the current read buffer is resolved into a single-sampled buffer, which
+// is bound to GL_READ_FRAMEBUFFER until endResolve() is called.  Returns the
+// context state if the buffer was resolved or NULL otherwise.
+
+static ContextStateEGL *beginResolve(void)
+{
+	if(!fconfig.egl) return NULL;
+	ContextStateEGL *state = getCurrentState();
+	GLenum attachment;
+	if(!state || !state->readConfig || state->readConfig->samples < 1
+		|| !defaultFBOBound(state, GL_READ_FRAMEBUFFER)
+		|| (attachment = mapReadBuffer(state->readConfig, state->readBuf)) == 0
+		|| attachment == GL_NONE)
+		return NULL;
+	FakePbuffer *pb = pbhashegl.find(state->read);
+	if(!pb) return NULL;
+	state->resolveFBO =
+		pb->resolve(state->ctx, attachment - GL_COLOR_ATTACHMENT0);
+	return state;
+}
+
+
+static void endResolve(ContextStateEGL *state)
+{
+	if(state) _glBindFramebuffer(GL_READ_FRAMEBUFFER, state->readFBO);
+}
+
+
+void blitFramebuffer(GLint srcX0, GLint srcY0, GLint srcX1, GLint srcY1,
+	GLint dstX0, GLint dstY0, GLint dstX1, GLint dstY1, GLbitfield mask,
+	GLenum filter)
+{
+	ContextStateEGL *state = getCurrentState();
+
+	// The resolved buffer has no depth or stencil attachment, and a
+	// multisampled buffer can be blitted into the emulated default framebuffer
+	// (which has the same format and sample count) without resolving it.
+	if(mask == GL_COLOR_BUFFER_BIT && state
+		&& !defaultFBOBound(state, GL_DRAW_FRAMEBUFFER))
+		state = beginResolve();
+	else state = NULL;
+	_glBlitFramebuffer(srcX0, srcY0, srcX1, srcY1, dstX0, dstY0, dstX1, dstY1,
+		mask, filter);
+	endResolve(state);
+}
+
+
+void copyTexImage2D(GLenum target, GLint level, GLenum internalFormat,
+	GLint x, GLint y, GLsizei width, GLsizei height, GLint border)
+{
+	ContextStateEGL *state = beginResolve();
+	_glCopyTexImage2D(target, level, internalFormat, x, y, width, height,
+		border);
+	endResolve(state);
+}
+
+
+void copyTexSubImage2D(GLenum target, GLint level, GLint xoffset,
+	GLint yoffset, GLint x, GLint y, GLsizei width, GLsizei height)
+{
+	ContextStateEGL *state = beginResolve();
+	_glCopyTexSubImage2D(target, level, xoffset, yoffset, x, y, width, height);
+	endResolve(state);
+}
+
+
+void readPixels(GLint x, GLint y, GLsizei width, GLsizei height,
+	GLenum format, GLenum type, GLvoid *pixels)
+{
+	ContextStateEGL *state = beginResolve();
+	_glReadPixels(x, y, width, height, format, type, pixels);
+	endResolve(state);
+}
+
+
+template<typename T> static bool getEGL(GLenum pname, T *data)
+{
+	if(!fconfig.egl || !data) return false;
+	ContextStateEGL *state = getCurrentState();
+	if(!state) return false;
+
+	switch(pname)
+	{
+		case GL_DRAW_BUFFER:
+		case GL_DRAW_BUFFER0:  case GL_DRAW_BUFFER1:
+		case GL_DRAW_BUFFER2:  case GL_DRAW_BUFFER3:
+		{
+			int index = pname == GL_DRAW_BUFFER ? 0 : pname - GL_DRAW_BUFFER0;
+			if(!defaultFBOBound(state, GL_DRAW_FRAMEBUFFER)) return false;
+			*data = (T)(index < state->nDrawBufs ? state->drawBufs[index] :
+				GL_NONE);
+			return true;
+		}
+		case GL_READ_BUFFER:
+			if(!defaultFBOBound(state, GL_READ_FRAMEBUFFER)) return false;
+			*data = (T)state->readBuf;
+			return true;
+		case GL_DRAW_FRAMEBUFFER_BINDING:
+		{
+			GLint fbo = 0;
+			_glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &fbo);
+			*data = (T)((GLuint)fbo == state->drawFBO ? 0 : fbo);
+			return true;
+		}
+		case GL_READ_FRAMEBUFFER_BINDING:
+		{
+			GLint fbo = 0;
+			_glGetIntegerv(GL_READ_FRAMEBUFFER_BINDING, &fbo);
+			*data = (T)((GLuint)fbo == state->readFBO
+				|| (state->resolveFBO && (GLuint)fbo == state->resolveFBO) ? 0 : fbo);
+			return true;
+		}
+		case GL_DOUBLEBUFFER:
+			if(!state->drawConfig) return false;
+			*data = (T)state->drawConfig->doubleBuffer;
+			return true;
+		case GL_STEREO:
+			if(!state->drawConfig) return false;
+			*data = (T)state->drawConfig->stereo;
+			return true;
+	}
+	return false;
+}
+
+
+// glPopAttrib() can restore the draw and read buffers, which OpenGL sees as
+// FBO attachments, so the emulated state has to be updated to match.
+
+void popAttrib(void)
+{
+	ContextStateEGL *state = fconfig.egl ? getCurrentState() : NULL;
+
+	_glPopAttrib();
+	if(!state) return;
+
+	GLint fbo = 0, buf = GL_NONE;
+	_glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &fbo);
+	if(fbo && (GLuint)fbo == state->drawFBO)
+	{
+		GLenum attachments[4], current[4];  int n = 0, nCurrent = 0;
+		for(int i = 0; i < 4; i++)
+		{
+			_glGetIntegerv(GL_DRAW_BUFFER0 + i, &buf);
+			if(buf != GL_NONE) n = i + 1;
+			attachments[i] = buf;
+		}
+		if(n < 1) n = 1;
+		for(int i = 0; i < state->nDrawBufs && nCurrent < 4; i++)
+		{
+			GLenum bufAttachments[4];
+			int nBuf = mapDrawBuffer(state->drawConfig, state->drawBufs[i],
+				bufAttachments);
+			for(int j = 0; j < nBuf && nCurrent < 4; j++)
+				current[nCurrent++] = bufAttachments[j];
+		}
+		if(n != nCurrent || memcmp(attachments, current, sizeof(GLenum) * n))
+		{
+			GLenum name = unmapDrawBuffer(state->drawConfig, attachments, n);
+			if(name)
+			{
+				state->drawBufs[0] = name;  state->nDrawBufs = 1;
+			}
+			else
+			{
+				for(int i = 0; i < n; i++)
+				{
+					state->drawBufs[i] =
+						unmapDrawBuffer(state->drawConfig, &attachments[i], 1);
+					if(!state->drawBufs[i]) state->drawBufs[i] = GL_NONE;
+				}
+				state->nDrawBufs = n;
+			}
+		}
+	}
+	_glGetIntegerv(GL_READ_FRAMEBUFFER_BINDING, &fbo);
+	if(fbo && (GLuint)fbo == state->readFBO)
+	{
+		_glGetIntegerv(GL_READ_BUFFER, &buf);
+		if((GLenum)buf != mapReadBuffer(state->readConfig, state->readBuf))
+		{
+			GLenum attachment = buf;
+			GLenum name = unmapDrawBuffer(state->readConfig, &attachment, 1);
+			if(name) state->readBuf = name;
+		}
+	}
+}
+
+
+void getBooleanv(GLenum pname, GLboolean *data)
+{
+	GLint value = 0;
+	if(getEGL(pname, &value)) { *data = value ? GL_TRUE : GL_FALSE;  return; }
+	_glGetBooleanv(pname, data);
+}
+
+
+void getDoublev(GLenum pname, GLdouble *data)
+{
+	if(getEGL(pname, data)) return;
+	_glGetDoublev(pname, data);
+}
+
+
+void getFloatv(GLenum pname, GLfloat *data)
+{
+	if(getEGL(pname, data)) return;
+	_glGetFloatv(pname, data);
+}
+
+
+void getIntegerv(GLenum pname, GLint *data)
+{
+	if(getEGL(pname, data)) return;
+	_glGetIntegerv(pname, data);
+}
+
+
+void getInteger64v(GLenum pname, GLint64 *data)
+{
+	if(getEGL(pname, data)) return;
+	_glGetInteger64v(pname, data);
+}
+
+
+void getFramebufferAttachmentParameteriv(GLenum target, GLenum attachment,
+	GLenum pname, GLint *params)
+{
+	if(fconfig.egl)
+	{
+		ContextStateEGL *state = getCurrentState();
+		GLenum fbTarget =
+			target == GL_READ_FRAMEBUFFER ? GL_READ_FRAMEBUFFER : GL_DRAW_FRAMEBUFFER;
+		if(state && defaultFBOBound(state, fbTarget))
+		{
+			FBConfigEGL *config = fbTarget == GL_READ_FRAMEBUFFER ?
+				state->readConfig : state->drawConfig;
+			GLenum fboAttachment = GL_NONE;
+			switch(attachment)
+			{
+				case GL_FRONT_LEFT:  case GL_BACK_LEFT:
+				case GL_FRONT_RIGHT:  case GL_BACK_RIGHT:
+					fboAttachment = mapReadBuffer(config, attachment);
+					break;
+				case GL_DEPTH:
+					fboAttachment = config->depthSize ? (config->stencilSize ?
+						GL_DEPTH_STENCIL_ATTACHMENT : GL_DEPTH_ATTACHMENT) : 0;
+					break;
+				case GL_STENCIL:
+					fboAttachment =
+						config->stencilSize ? GL_DEPTH_STENCIL_ATTACHMENT : 0;
+					break;
+			}
+			if(pname == GL_FRAMEBUFFER_ATTACHMENT_OBJECT_TYPE && params)
+			{
+				*params = fboAttachment ? GL_FRAMEBUFFER_DEFAULT : GL_NONE;
+				return;
+			}
+			if(fboAttachment)
+			{
+				if(attachment == GL_DEPTH)
+				{
+					// Querying the stencil size of a combined depth/stencil attachment
+					// would return a non-zero value, so use the appropriate attachment
+					// point.
+					if(pname == GL_FRAMEBUFFER_ATTACHMENT_STENCIL_SIZE && params)
+					{
+						*params = 0;  return;
+					}
+				}
+				else if(attachment == GL_STENCIL)
+				{
+					if(pname == GL_FRAMEBUFFER_ATTACHMENT_DEPTH_SIZE && params)
+					{
+						*params = 0;  return;
+					}
+				}
+				_glGetFramebufferAttachmentParameteriv(fbTarget, fboAttachment,
+					pname, params);
+				return;
+			}
+		}
+	}
+	_glGetFramebufferAttachmentParameteriv(target, attachment, pname, params);
+}
+
+
+void namedFramebufferDrawBuffer(GLuint framebuffer, GLenum buf)
+{
+	if(fconfig.egl && framebuffer == 0)
+	{
+		ContextStateEGL *state = getCurrentState();
+		GLenum attachments[4];  int n;
+		if(state && state->drawFBO
+			&& (n = mapDrawBuffer(state->drawConfig, buf, attachments)) > 0)
+		{
+			_glNamedFramebufferDrawBuffers(state->drawFBO, n, attachments);
+			state->drawBufs[0] = buf;  state->nDrawBufs = 1;
+			return;
+		}
+	}
+	_glNamedFramebufferDrawBuffer(framebuffer, buf);
+}
+
+
+void namedFramebufferDrawBuffers(GLuint framebuffer, GLsizei n,
+	const GLenum *bufs)
+{
+	if(fconfig.egl && framebuffer == 0 && n > 0 && n <= 4 && bufs)
+	{
+		ContextStateEGL *state = getCurrentState();
+		if(state && state->drawFBO)
+		{
+			GLenum attachments[4];
+			for(int i = 0; i < n; i++)
+			{
+				GLenum bufAttachments[4];
+				if(bufs[i] == GL_FRONT || bufs[i] == GL_BACK || bufs[i] == GL_LEFT
+					|| bufs[i] == GL_RIGHT || bufs[i] == GL_FRONT_AND_BACK
+					|| mapDrawBuffer(state->drawConfig, bufs[i], bufAttachments) != 1)
+				{
+					_glNamedFramebufferDrawBuffers(framebuffer, n, bufs);  return;
+				}
+				attachments[i] = bufAttachments[0];
+			}
+			_glNamedFramebufferDrawBuffers(state->drawFBO, n, attachments);
+			for(int i = 0; i < n; i++) state->drawBufs[i] = bufs[i];
+			state->nDrawBufs = n;
+			return;
+		}
+	}
+	_glNamedFramebufferDrawBuffers(framebuffer, n, bufs);
+}
+
+
+void namedFramebufferReadBuffer(GLuint framebuffer, GLenum mode)
+{
+	if(fconfig.egl && framebuffer == 0)
+	{
+		ContextStateEGL *state = getCurrentState();
+		GLenum attachment;
+		if(state && state->readFBO
+			&& (attachment = mapReadBuffer(state->readConfig, mode)) != 0)
+		{
+			_glNamedFramebufferReadBuffer(state->readFBO, attachment);
+			state->readBuf = mode;
+			return;
+		}
+	}
+	_glNamedFramebufferReadBuffer(framebuffer, mode);
+}
+
+#else
+
+void bindFramebuffer(GLenum target, GLuint framebuffer, bool ext)
+{
+	_glBindFramebuffer(target, framebuffer);
+}
+
+
+void drawBuffer(GLenum mode)
+{
+	_glDrawBuffer(mode);
+}
+
+
+void getIntegerv(GLenum pname, GLint *data)
+{
+	_glGetIntegerv(pname, data);
+}
+
+
+void popAttrib(void)
+{
+	_glPopAttrib();
+}
+
+
+void readBuffer(GLenum mode, bool resolve)
+{
+	_glReadBuffer(mode);
+}
+
+#endif  // EGLBACKEND
+
+}  // namespace backend
@@ -0,0 +1,164 @@
+/* Copyright (C)2018 D. R. Commander
+ *
+ * This library is free software and may be redistributed and/or modified under
+ * the terms of the wxWindows Library License, Version 3.1 or (at your option)
+ * any later version.  The full license is in the LICENSE.txt file included
+ * with this distribution.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * wxWindows Library License for more details.
+ */
+
+#ifndef __BACKEND_H__
+#define __BACKEND_H__
+
+#include "faker-sym.h"
+
+
+// These functions perform all of the GLX operations that VirtualGL needs to
+// perform on the "3D X server."  With the default (GLX) back end, they are
+// simply wrappers for the real GLX functions, which are called with the 3D X
+// server's display handle.  With the EGL back end (VGL_DISPLAY=egl or
+// VGL_DISPLAY={DRI device path}), there is no 3D X server.  The FB configs are
+// synthesized, contexts are EGL contexts, and Pbuffers (and thus all
+// off-screen drawables) are emulated using renderbuffer objects (see
+// FakePbuffer.h.)
+
+namespace backend
+{
+	GLXFBConfig *chooseFBConfig(const int *attribs, int *nElements);
+
+	GLXFBConfig *getFBConfigs(int *nElements);
+
+	int getFBConfigAttrib(GLXFBConfig config, int attribute, int *value);
+
+	XVisualInfo *getVisualFromFBConfig(GLXFBConfig config);
+
+	// If attribs is NULL, then this behaves like glXCreateNewContext() with
+	// render_type=GLX_RGBA_TYPE.  Otherwise, it behaves like
+	// glXCreateContextAttribsARB().
+	GLXContext createContext(GLXFBConfig config, GLXContext share, Bool direct,
+		const int *attribs);
+
+	void copyContext(GLXContext src, GLXContext dst, unsigned long mask);
+
+	void destroyContext(GLXContext ctx);
+
+	Bool isDirect(GLXContext ctx);
+
+	int queryContext(GLXContext ctx, int attribute, int *value);
+
+	Bool makeCurrent(GLXDrawable draw, GLXDrawable read, GLXContext ctx);
+
+	GLXContext getCurrentContext(void);
+
+	GLXDrawable getCurrentDrawable(void);
+
+	GLXDrawable getCurrentReadDrawable(void);
+
+	GLXPbuffer createPbuffer(GLXFBConfig config, const int *attribs);
+
+	void destroyPbuffer(GLXPbuffer pbuf);
+
+	// With the EGL back end, this resizes an emulated Pbuffer in place (see
+	// FakePbuffer::resize()) and returns true.  GLX Pbuffers cannot be resized,
+	// so with the GLX back end, this returns false, and the caller must create
+	// a new Pbuffer instead.
+	bool resizePbuffer(GLXPbuffer pbuf, int width, int height);
+
+	void queryDrawable(GLXDrawable draw, int attribute, unsigned int *value);
+
+	void swapBuffers(GLXDrawable draw);
+
+	Bool queryExtension(int *errorBase, int *eventBase);
+
+	Bool queryVersion(int *major, int *minor);
+
+	// GLX functions that have no EGL equivalent.  With the EGL back end, these
+	// do nothing (or return an error.)
+
+	GLXContext importContext(GLXContextID contextID);
+
+	void freeContext(GLXContext ctx);
+
+	int queryContextInfo(GLXContext ctx, int attribute, int *value);
+
+	void getSelectedEvent(GLXDrawable draw, unsigned long *eventMask);
+
+	void selectEvent(GLXDrawable draw, unsigned long eventMask);
+
+	Bool joinSwapGroup(GLXDrawable drawable, GLuint group);
+
+	Bool bindSwapBarrier(GLuint group, GLuint barrier);
+
+	Bool querySwapGroup(GLXDrawable drawable, GLuint *group, GLuint *barrier);
+
+	Bool queryMaxSwapGroups(GLuint *maxGroups, GLuint *maxBarriers);
+
+	Bool queryFrameCount(GLuint *count);
+
+	Bool resetFrameCount(void);
+
+	// OpenGL functions whose behavior depends on the back end.  With the EGL
+	// back end, the names of the default framebuffer's buffers (GL_FRONT,
+	// GL_BACK_LEFT, etc.) are translated into the corresponding attachments of
+	// the FBO that emulates the current drawable, and queries of the draw
+	// buffer, read buffer, and framebuffer bindings return the values that the
+	// application would expect from a window-system-provided framebuffer.
+
+	void bindFramebuffer(GLenum target, GLuint framebuffer, bool ext = false);
+
+	// With the EGL back end, these functions resolve the read buffer if the
+	// emulated default framebuffer is multisampled (see readBuffer() below.)
+
+	void blitFramebuffer(GLint srcX0, GLint srcY0, GLint srcX1, GLint srcY1,
+		GLint dstX0, GLint dstY0, GLint dstX1, GLint dstY1, GLbitfield mask,
+		GLenum filter);
+
+	void copyTexImage2D(GLenum target, GLint level, GLenum internalFormat,
+		GLint x, GLint y, GLsizei width, GLsizei height, GLint border);
+
+	void copyTexSubImage2D(GLenum target, GLint level, GLint xoffset,
+		GLint yoffset, GLint x, GLint y, GLsizei width, GLsizei height);
+
+	void drawBuffer(GLenum mode);
+
+	void drawBuffers(GLsizei n, const GLenum *bufs);
+
+	void getBooleanv(GLenum pname, GLboolean *data);
+
+	void getDoublev(GLenum pname, GLdouble *data);
+
+	void getFloatv(GLenum pname, GLfloat *data);
+
+	void getIntegerv(GLenum pname, GLint *data);
+
+	void getInteger64v(GLenum pname, GLint64 *data);
+
+	void getFramebufferAttachmentParameteriv(GLenum target, GLenum attachment,
+		GLenum pname, GLint *params);
+
+	void namedFramebufferDrawBuffer(GLuint framebuffer, GLenum buf);
+
+	void namedFramebufferDrawBuffers(GLuint framebuffer, GLsizei n,
+		const GLenum *bufs);
+
+	void namedFramebufferReadBuffer(GLuint framebuffer, GLenum mode);
+
+	void popAttrib(void);
+
+	// If resolve is true and the current read drawable is multisampled, then
+	// the specified buffer is also resolved into a single-sampled buffer, which
+	// is used as the source for subsequent pixel transfers.  (With the GLX back
+	// end, the GLX implementation does this implicitly.)  VirtualGL's readback
+	// code passes resolve=true.  The interposed glReadBuffer() function does
+	// not.
+	void readBuffer(GLenum mode, bool resolve = false);
+
+	void readPixels(GLint x, GLint y, GLsizei width, GLsizei height,
+		GLenum format, GLenum type, GLvoid *pixels);
+}
+
+#endif  // __BACKEND_H__
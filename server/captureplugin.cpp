@@ -0,0 +1,306 @@
+/* Copyright (C)2018 D. R. Commander
+ *
+ * This library is free software and may be redistributed and/or modified under
+ * the terms of the wxWindows Library License, Version 3.1 or (at your option)
+ * any later version.  The full license is in the LICENSE.txt file included
+ * with this distribution.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * wxWindows Library License for more details.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <X11/Xlib.h>
+#include "vglcapture.h"
+#include "Error.h"
+#include "Timer.h"
+
+using namespace vglutil;
+
+
+static Error err;
+char errStr[MAXSTR];
+
+
+/* This transport plugin records the frames that VirtualGL reads back into a
+   capture file (see vglcapture.h), so that vglreplay can later feed the same
+   frames through the VGL and X11 Transports without a 3D application or a
+   GPU.  The file name is taken from the VGL_CAPTURE environment variable, with
+   the window ID inserted before the extension (or defaults to vgl-{window}.vgc
+   in the current directory.) */
+
+class CaptureTrans
+{
+	public:
+
+		CaptureTrans(Window win) : file(NULL), nFrames(0), startTime(-1.),
+			bits(NULL), rbits(NULL), bufSize(0), callback(NULL), context(NULL)
+		{
+			char *env = getenv("VGL_CAPTURE");
+			if(env && strlen(env) > 0)
+			{
+				// Each window has its own capture file, so the window ID is inserted
+				// before the file extension (or appended if there is none.)
+				char *ext = strrchr(env, '.'), *slash = strrchr(env, '/');
+				if(!ext || ext == env || (slash && ext <= slash + 1))
+					ext = &env[strlen(env)];
+				snprintf(fileName, MAXSTR, "%.*s-%lx%s", (int)(ext - env), env,
+					(unsigned long)win, ext);
+			}
+			else snprintf(fileName, MAXSTR, "vgl-%lx.vgc", (unsigned long)win);
+			memset(&frame, 0, sizeof(RRFrame));
+
+			if((file = fopen(fileName, "wb")) == NULL)
+				throw(Error("CaptureTrans::CaptureTrans", strerror(errno)));
+			memset(&header, 0, sizeof(VGLCapHeader));
+			header.magic = VGLCAP_MAGIC;
+			header.version = VGLCAP_VERSION;
+			header.headerSize = VGLCAP_PAD(sizeof(VGLCapHeader));
+			write(&header, sizeof(VGLCapHeader));
+			pad(header.headerSize - sizeof(VGLCapHeader));
+		}
+
+		~CaptureTrans(void)
+		{
+			if(file)
+			{
+				// Record the number of frames, which tells vglreplay that the file was
+				// closed cleanly.
+				header.nFrames = nFrames;
+				if(fseek(file, 0, SEEK_SET) == 0)
+					fwrite(&header, sizeof(VGLCapHeader), 1, file);
+				fclose(file);  file = NULL;
+			}
+			if(bits) delete [] bits;
+			if(rbits) delete [] rbits;
+		}
+
+		void setCallback(RRTransCallback callback_, void *context_)
+		{
+			callback = callback_;  context = context_;
+		}
+
+		RRFrame *getFrame(int width, int height, int format, bool stereo)
+		{
+			if(width < 1 || height < 1 || format < 0 || format >= RRTRANS_FORMATOPT)
+				_throw("Invalid argument");
+
+			int pitch = (width * rrtrans_ps[format] + 3) & (~3);
+			size_t size = (size_t)pitch * height;
+			if(size > bufSize || (stereo && !rbits))
+			{
+				if(bits) { delete [] bits;  bits = NULL; }
+				if(rbits) { delete [] rbits;  rbits = NULL; }
+				bufSize = 0;
+				_newcheck(bits = new unsigned char[size]);
+				if(stereo) _newcheck(rbits = new unsigned char[size]);
+				bufSize = size;
+			}
+			memset(&frame, 0, sizeof(RRFrame));
+			frame.bits = bits;  frame.rbits = stereo ? rbits : NULL;
+			frame.format = format;
+			frame.w = width;  frame.h = height;  frame.pitch = pitch;
+			frame.opaque = (void *)this;
+			return &frame;
+		}
+
+		void sendFrame(RRFrame *f)
+		{
+			if(f != &frame) _throw("Invalid frame handle");
+
+			// Version 1 of the transport plugin API doesn't provide a timestamp,
+			// so in that case, use the time at which the frame was sent.
+			double timestamp = frame.timestamp > 0. ? frame.timestamp : getTime();
+			if(startTime < 0.) startTime = timestamp;
+
+			VGLCapRecord rec;
+			int nDirty = frame.ndirty > 0 ? frame.ndirty : 0;
+			unsigned long long frameSize =
+				VGLCAP_PAD((unsigned long long)frame.pitch * frame.h);
+			memset(&rec, 0, sizeof(VGLCapRecord));
+			rec.seq = frame.seq;
+			rec.width = frame.w;  rec.height = frame.h;
+			rec.pitch = frame.pitch;  rec.format = frame.format;
+			rec.stereo = frame.rbits ? 1 : 0;
+			rec.time = timestamp - startTime;
+			rec.nDirty = frame.ndirty;
+			rec.bitsOffset = VGLCAP_PAD(sizeof(VGLCapRecord) +
+				sizeof(RRRect) * nDirty);
+			rec.rbitsOffset = rec.stereo ? rec.bitsOffset + frameSize : 0;
+			rec.size = rec.bitsOffset + frameSize * (rec.stereo ? 2 : 1);
+
+			write(&rec, sizeof(VGLCapRecord));
+			if(nDirty > 0) write(frame.dirty, sizeof(RRRect) * nDirty);
+			pad(rec.bitsOffset - sizeof(VGLCapRecord) - sizeof(RRRect) * nDirty);
+			write(frame.bits, frame.pitch * frame.h);
+			pad(frameSize - frame.pitch * frame.h);
+			if(rec.stereo)
+			{
+				write(frame.rbits, frame.pitch * frame.h);
+				pad(frameSize - frame.pitch * frame.h);
+			}
+			nFrames++;
+
+			if(callback) callback(context, frame.seq);
+		}
+
+	private:
+
+		void write(const void *buf, size_t size)
+		{
+			if(size > 0 && fwrite(buf, size, 1, file) != 1)
+				throw(Error("CaptureTrans::write", strerror(errno)));
+		}
+
+		void pad(size_t size)
+		{
+			static const unsigned char zero[VGLCAP_ALIGN] = { 0 };
+			write(zero, size);
+		}
+
+		char fileName[MAXSTR];
+		FILE *file;
+		VGLCapHeader header;
+		unsigned int nFrames;
+		double startTime;
+		RRFrame frame;
+		unsigned char *bits, *rbits;
+		size_t bufSize;
+		RRTransCallback callback;
+		void *context;
+};
+
+
+extern "C" {
+
+void *RRTransInit(Display *dpy, Window win, FakerConfig *fconfig)
+{
+	void *handle = NULL;
+	try
+	{
+		_newcheck(handle = (void *)(new CaptureTrans(win)));
+	}
+	catch(Error &e)
+	{
+		err = e;  return NULL;
+	}
+	return handle;
+}
+
+
+int RRTransConnect(void *handle, char *receiverName, int port)
+{
+	if(!handle)
+	{
+		err = Error("RRTransConnect", "Invalid handle");  return -1;
+	}
+	return 0;
+}
+
+
+RRFrame *RRTransGetFrame(void *handle, int width, int height, int format,
+	int stereo)
+{
+	try
+	{
+		CaptureTrans *trans = (CaptureTrans *)handle;
+		if(!trans) _throw("Invalid handle");
+		return trans->getFrame(width, height, format, stereo != 0);
+	}
+	catch(Error &e)
+	{
+		err = e;  return NULL;
+	}
+}
+
+
+// Frames are written synchronously, so the plugin is always ready.
+
+int RRTransReady(void *handle)
+{
+	if(!handle)
+	{
+		err = Error("RRTransReady", "Invalid handle");  return -1;
+	}
+	return 1;
+}
+
+
+int RRTransSynchronize(void *handle)
+{
+	if(!handle)
+	{
+		err = Error("RRTransSynchronize", "Invalid handle");  return -1;
+	}
+	return 0;
+}
+
+
+int RRTransSendFrame(void *handle, RRFrame *frame, int sync)
+{
+	try
+	{
+		CaptureTrans *trans = (CaptureTrans *)handle;
+		if(!trans) _throw("Invalid handle");
+		trans->sendFrame(frame);
+	}
+	catch(Error &e)
+	{
+		err = e;  return -1;
+	}
+	return 0;
+}
+
+
+int RRTransDestroy(void *handle)
+{
+	try
+	{
+		CaptureTrans *trans = (CaptureTrans *)handle;
+		if(!trans) _throw("Invalid handle");
+		delete trans;
+	}
+	catch(Error &e)
+	{
+		err = e;  return -1;
+	}
+	return 0;
+}
+
+
+const char *RRTransGetError(void)
+{
+	snprintf(errStr, MAXSTR - 1, "Error in %s -- %s",
+		err.getMethod(), err.getMessage());
+	return errStr;
+}
+
+
+int RRTransGetVersion(void)
+{
+	return RRTRANS_VERSION;
+}
+
+
+int RRTransSetCallback(void *handle, RRTransCallback callback, void *context)
+{
+	try
+	{
+		CaptureTrans *trans = (CaptureTrans *)handle;
+		if(!trans || !callback) _throw("Invalid argument");
+		trans->setCallback(callback, context);
+	}
+	catch(Error &e)
+	{
+		err = e;  return -1;
+	}
+	return 1;
+}
+
+
+}  // extern "C"
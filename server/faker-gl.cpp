@@ -30,7 +30,7 @@ static void doGLReadback(bool spoilLast, bool sync)
 {
 	VirtualWin *vw;  GLXDrawable drawable;
 
-	drawable = _glXGetCurrentDrawable();
+	drawable = backend::getCurrentDrawable();
 	if(!drawable) return;
 
 	if(winhash.find(drawable, vw))
@@ -129,19 +129,19 @@ void glDrawBuffer(GLenum mode)
 
 	VirtualWin *vw = NULL;
 	int before = -1, after = -1, rbefore = -1, rafter = -1;
-	GLXDrawable drawable = _glXGetCurrentDrawable();
+	GLXDrawable drawable = backend::getCurrentDrawable();
 
 	if(drawable && winhash.find(drawable, vw))
 	{
 		before = drawingToFront();
 		rbefore = drawingToRight();
-		_glDrawBuffer(mode);
+		backend::drawBuffer(mode);
 		after = drawingToFront();
 		rafter = drawingToRight();
 		if(before && !after) vw->dirty = true;
 		if(rbefore && !rafter && vw->isStereo()) vw->rdirty = true;
 	}
-	else _glDrawBuffer(mode);
+	else backend::drawBuffer(mode);
 
 		stoptrace();
 		if(drawable && vw)
@@ -166,19 +166,19 @@ void glPopAttrib(void)
 
 	VirtualWin *vw = NULL;
 	int before = -1, after = -1, rbefore = -1, rafter = -1;
-	GLXDrawable drawable = _glXGetCurrentDrawable();
+	GLXDrawable drawable = backend::getCurrentDrawable();
 
 	if(drawable && winhash.find(drawable, vw))
 	{
 		before = drawingToFront();
 		rbefore = drawingToRight();
-		_glPopAttrib();
+		backend::popAttrib();
 		after = drawingToFront();
 		rafter = drawingToRight();
 		if(before && !after) vw->dirty = true;
 		if(rbefore && !rafter && vw->isStereo()) vw->rdirty = true;
 	}
-	else _glPopAttrib();
+	else backend::popAttrib();
 
 		stoptrace();
 		if(drawable && vw)
@@ -207,13 +207,12 @@ void glViewport(GLint x, GLint y, GLsizei width, GLsizei height)
 		opentrace(glViewport);  prargi(x);  prargi(y);  prargi(width);
 		prargi(height);  starttrace();
 
-	GLXContext ctx = _glXGetCurrentContext();
-	GLXDrawable draw = _glXGetCurrentDrawable();
-	GLXDrawable read = _glXGetCurrentReadDrawable();
-	Display *dpy = _glXGetCurrentDisplay();
+	GLXContext ctx = backend::getCurrentContext();
+	GLXDrawable draw = backend::getCurrentDrawable();
+	GLXDrawable read = backend::getCurrentReadDrawable();
 	GLXDrawable newRead = 0, newDraw = 0;
 
-	if(dpy && (draw || read) && ctx)
+	if((draw || read) && ctx)
 	{
 		newRead = read, newDraw = draw;
 		VirtualWin *drawVW = NULL, *readVW = NULL;
@@ -225,7 +224,7 @@ void glViewport(GLint x, GLint y, GLsizei width, GLsizei height)
 		if(readVW) newRead = readVW->updateGLXDrawable();
 		if(newRead != read || newDraw != draw)
 		{
-			_glXMakeContextCurrent(dpy, newDraw, newRead, ctx);
+			backend::makeCurrent(newDraw, newRead, ctx);
 			if(drawVW) { drawVW->clear();  drawVW->cleanup(); }
 			if(readVW) readVW->cleanup();
 		}
@@ -241,4 +240,362 @@ void glViewport(GLint x, GLint y, GLsizei width, GLsizei height)
 }
 
 
+#ifdef EGLBACKEND
+
+// With the EGL back end, these functions emulate the default framebuffer
+// (see backend.h.)  With the GLX back end, they are passed through.
+
+void glBindFramebuffer(GLenum target, GLuint framebuffer)
+{
+	if(!fconfig.egl || vglfaker::getExcludeCurrent())
+	{
+		_glBindFramebuffer(target, framebuffer);  return;
+	}
+
+	TRY();
+
+		opentrace(glBindFramebuffer);  prargx(target);  prargi(framebuffer);
+			starttrace();
+
+	backend::bindFramebuffer(target, framebuffer);
+
+		stoptrace();  closetrace();
+
+	CATCH();
+}
+
+
+void glBindFramebufferEXT(GLenum target, GLuint framebuffer)
+{
+	if(!fconfig.egl || vglfaker::getExcludeCurrent())
+	{
+		_glBindFramebufferEXT(target, framebuffer);  return;
+	}
+
+	TRY();
+
+		opentrace(glBindFramebufferEXT);  prargx(target);  prargi(framebuffer);
+			starttrace();
+
+	backend::bindFramebuffer(target, framebuffer, true);
+
+		stoptrace();  closetrace();
+
+	CATCH();
+}
+
+
+void glBlitFramebuffer(GLint srcX0, GLint srcY0, GLint srcX1, GLint srcY1,
+	GLint dstX0, GLint dstY0, GLint dstX1, GLint dstY1, GLbitfield mask,
+	GLenum filter)
+{
+	if(!fconfig.egl || vglfaker::getExcludeCurrent())
+	{
+		_glBlitFramebuffer(srcX0, srcY0, srcX1, srcY1, dstX0, dstY0, dstX1, dstY1,
+			mask, filter);
+		return;
+	}
+
+	TRY();
+
+		opentrace(glBlitFramebuffer);  prargi(srcX0);  prargi(srcY0);
+			prargi(srcX1);  prargi(srcY1);  prargi(dstX0);  prargi(dstY0);
+			prargi(dstX1);  prargi(dstY1);  prargx(mask);  prargx(filter);
+			starttrace();
+
+	backend::blitFramebuffer(srcX0, srcY0, srcX1, srcY1, dstX0, dstY0, dstX1,
+		dstY1, mask, filter);
+
+		stoptrace();  closetrace();
+
+	CATCH();
+}
+
+
+void glCopyTexImage2D(GLenum target, GLint level, GLenum internalformat,
+	GLint x, GLint y, GLsizei width, GLsizei height, GLint border)
+{
+	if(!fconfig.egl || vglfaker::getExcludeCurrent())
+	{
+		_glCopyTexImage2D(target, level, internalformat, x, y, width, height,
+			border);
+		return;
+	}
+
+	TRY();
+
+		opentrace(glCopyTexImage2D);  prargx(target);  prargi(level);
+			prargx(internalformat);  prargi(x);  prargi(y);  prargi(width);
+			prargi(height);  prargi(border);  starttrace();
+
+	backend::copyTexImage2D(target, level, internalformat, x, y, width, height,
+		border);
+
+		stoptrace();  closetrace();
+
+	CATCH();
+}
+
+
+void glCopyTexSubImage2D(GLenum target, GLint level, GLint xoffset,
+	GLint yoffset, GLint x, GLint y, GLsizei width, GLsizei height)
+{
+	if(!fconfig.egl || vglfaker::getExcludeCurrent())
+	{
+		_glCopyTexSubImage2D(target, level, xoffset, yoffset, x, y, width,
+			height);
+		return;
+	}
+
+	TRY();
+
+		opentrace(glCopyTexSubImage2D);  prargx(target);  prargi(level);
+			prargi(xoffset);  prargi(yoffset);  prargi(x);  prargi(y);
+			prargi(width);  prargi(height);  starttrace();
+
+	backend::copyTexSubImage2D(target, level, xoffset, yoffset, x, y, width,
+		height);
+
+		stoptrace();  closetrace();
+
+	CATCH();
+}
+
+
+void glDrawBuffers(GLsizei n, const GLenum *bufs)
+{
+	if(!fconfig.egl || vglfaker::getExcludeCurrent())
+	{
+		_glDrawBuffers(n, bufs);  return;
+	}
+
+	TRY();
+
+		opentrace(glDrawBuffers);  prargi(n);  starttrace();
+
+	backend::drawBuffers(n, bufs);
+
+		stoptrace();  closetrace();
+
+	CATCH();
+}
+
+
+void glDrawBuffersARB(GLsizei n, const GLenum *bufs)
+{
+	if(!fconfig.egl || vglfaker::getExcludeCurrent())
+	{
+		_glDrawBuffersARB(n, bufs);  return;
+	}
+
+	TRY();
+
+		opentrace(glDrawBuffersARB);  prargi(n);  starttrace();
+
+	backend::drawBuffers(n, bufs);
+
+		stoptrace();  closetrace();
+
+	CATCH();
+}
+
+
+void glGetBooleanv(GLenum pname, GLboolean *data)
+{
+	if(!fconfig.egl || vglfaker::getExcludeCurrent())
+	{
+		_glGetBooleanv(pname, data);  return;
+	}
+
+	TRY();
+
+	backend::getBooleanv(pname, data);
+
+	CATCH();
+}
+
+
+void glGetDoublev(GLenum pname, GLdouble *data)
+{
+	if(!fconfig.egl || vglfaker::getExcludeCurrent())
+	{
+		_glGetDoublev(pname, data);  return;
+	}
+
+	TRY();
+
+	backend::getDoublev(pname, data);
+
+	CATCH();
+}
+
+
+void glGetFloatv(GLenum pname, GLfloat *data)
+{
+	if(!fconfig.egl || vglfaker::getExcludeCurrent())
+	{
+		_glGetFloatv(pname, data);  return;
+	}
+
+	TRY();
+
+	backend::getFloatv(pname, data);
+
+	CATCH();
+}
+
+
+void glGetFramebufferAttachmentParameteriv(GLenum target, GLenum attachment,
+	GLenum pname, GLint *params)
+{
+	if(!fconfig.egl || vglfaker::getExcludeCurrent())
+	{
+		_glGetFramebufferAttachmentParameteriv(target, attachment, pname,
+			params);
+		return;
+	}
+
+	TRY();
+
+	backend::getFramebufferAttachmentParameteriv(target, attachment, pname,
+		params);
+
+	CATCH();
+}
+
+
+void glGetInteger64v(GLenum pname, GLint64 *data)
+{
+	if(!fconfig.egl || vglfaker::getExcludeCurrent())
+	{
+		_glGetInteger64v(pname, data);  return;
+	}
+
+	TRY();
+
+	backend::getInteger64v(pname, data);
+
+	CATCH();
+}
+
+
+void glGetIntegerv(GLenum pname, GLint *data)
+{
+	if(!fconfig.egl || vglfaker::getExcludeCurrent())
+	{
+		_glGetIntegerv(pname, data);  return;
+	}
+
+	TRY();
+
+	backend::getIntegerv(pname, data);
+
+	CATCH();
+}
+
+
+void glNamedFramebufferDrawBuffer(GLuint framebuffer, GLenum buf)
+{
+	if(!fconfig.egl || vglfaker::getExcludeCurrent())
+	{
+		_glNamedFramebufferDrawBuffer(framebuffer, buf);  return;
+	}
+
+	TRY();
+
+		opentrace(glNamedFramebufferDrawBuffer);  prargi(framebuffer);  prargx(buf);
+			starttrace();
+
+	backend::namedFramebufferDrawBuffer(framebuffer, buf);
+
+		stoptrace();  closetrace();
+
+	CATCH();
+}
+
+
+void glNamedFramebufferDrawBuffers(GLuint framebuffer, GLsizei n,
+	const GLenum *bufs)
+{
+	if(!fconfig.egl || vglfaker::getExcludeCurrent())
+	{
+		_glNamedFramebufferDrawBuffers(framebuffer, n, bufs);  return;
+	}
+
+	TRY();
+
+		opentrace(glNamedFramebufferDrawBuffers);  prargi(framebuffer);  prargi(n);
+			starttrace();
+
+	backend::namedFramebufferDrawBuffers(framebuffer, n, bufs);
+
+		stoptrace();  closetrace();
+
+	CATCH();
+}
+
+
+void glNamedFramebufferReadBuffer(GLuint framebuffer, GLenum src)
+{
+	if(!fconfig.egl || vglfaker::getExcludeCurrent())
+	{
+		_glNamedFramebufferReadBuffer(framebuffer, src);  return;
+	}
+
+	TRY();
+
+		opentrace(glNamedFramebufferReadBuffer);  prargi(framebuffer);  prargx(src);
+			starttrace();
+
+	backend::namedFramebufferReadBuffer(framebuffer, src);
+
+		stoptrace();  closetrace();
+
+	CATCH();
+}
+
+
+void glReadBuffer(GLenum mode)
+{
+	if(!fconfig.egl || vglfaker::getExcludeCurrent())
+	{
+		_glReadBuffer(mode);  return;
+	}
+
+	TRY();
+
+		opentrace(glReadBuffer);  prargx(mode);  starttrace();
+
+	backend::readBuffer(mode);
+
+		stoptrace();  closetrace();
+
+	CATCH();
+}
+
+
+void glReadPixels(GLint x, GLint y, GLsizei width, GLsizei height,
+	GLenum format, GLenum type, GLvoid *pixels)
+{
+	if(!fconfig.egl || vglfaker::getExcludeCurrent())
+	{
+		_glReadPixels(x, y, width, height, format, type, pixels);  return;
+	}
+
+	TRY();
+
+		opentrace(glReadPixels);  prargi(x);  prargi(y);  prargi(width);
+			prargi(height);  prargx(format);  prargx(type);  prargx(pixels);
+			starttrace();
+
+	backend::readPixels(x, y, width, height, format, type, pixels);
+
+		stoptrace();  closetrace();
+
+	CATCH();
+}
+
+#endif
+
+
 }  // extern "C"
@@ -34,7 +34,8 @@ using namespace vglutil;
 using namespace vglserver;
 
 
-#define dpy3DIsCurrent()  (_glXGetCurrentDisplay() == _dpy3D)
+#define dpy3DIsCurrent() \
+	(fconfig.egl || _glXGetCurrentDisplay() == _dpy3D)
 
 
 // This emulates the behavior of the nVidia drivers
@@ -136,16 +137,16 @@ static GLXFBConfig matchConfig(Display *dpy, XVisualInfo *vis,
 			free(str);
 		}
 
-		configs = glXChooseFBConfig(_dpy3D, DefaultScreen(_dpy3D), attribs, &n);
+		configs = backend::chooseFBConfig(attribs, &n);
 		if((!configs || n < 1) && attribs[11])
 		{
 			attribs[11] = 0;
-			configs = glXChooseFBConfig(_dpy3D, DefaultScreen(_dpy3D), attribs, &n);
+			configs = backend::chooseFBConfig(attribs, &n);
 		}
 		if((!configs || n < 1) && attribs[1])
 		{
 			attribs[1] = 0;
-			configs = glXChooseFBConfig(_dpy3D, DefaultScreen(_dpy3D), attribs, &n);
+			configs = backend::chooseFBConfig(attribs, &n);
 		}
 		if(!configs || n < 1) return 0;
 		config = configs[0];
@@ -172,27 +173,9 @@ static VisualID matchVisual(Display *dpy, GLXFBConfig config)
 	{
 		// If we get here, then the app is using an FB config that was not obtained
 		// through glXChooseFBConfig(), so we have no idea what attributes it is
-		// looking for.  We first try to match the FB config with a 2D X Server
-		// visual that has the same class, depth, and stereo properties.
-		XVisualInfo *vis = _glXGetVisualFromFBConfig(_dpy3D, config);
-		if(vis)
-		{
-			if(vis->depth >= 24
-				&& (vis->c_class == TrueColor || vis->c_class == DirectColor))
-				vid = glxvisual::matchVisual2D(dpy, screen, vis->depth, vis->c_class,
-					0, glxvisual::visAttrib3D(config, GLX_STEREO), 0);
-			XFree(vis);
-
-			// Failing that, we try to find a TrueColor visual with the same stereo
-			// properties, using the default depth of the 2D X server.
-			if(!vid)
-				vid = glxvisual::matchVisual2D(dpy, screen, DefaultDepth(dpy, screen),
-					TrueColor, 0, glxvisual::visAttrib3D(config, GLX_STEREO), 0);
-			// Failing that, we try to find a TrueColor mono visual.
-			if(!vid)
-				vid = glxvisual::matchVisual2D(dpy, screen, DefaultDepth(dpy, screen),
-					TrueColor, 0, 0, 0);
-		}
+		// looking for.  Thus, we match the FB config with a 2D X server visual
+		// that has the same class, depth, and stereo properties.
+		vid = glxvisual::matchVisual2D(dpy, screen, config);
 	}
 	if(vid) cfghash.add(dpy, config, vid);
 	return vid;
@@ -308,8 +291,7 @@ GLXFBConfig *glXChooseFBConfig(Display *dpy, int screen,
 	// is specified, ignore all other attributes.
 	if(!attrib_list || fbcidreq)
 	{
-		configs = _glXChooseFBConfig(_dpy3D, DefaultScreen(_dpy3D), attrib_list,
-			nelements);
+		configs = backend::chooseFBConfig(attrib_list, nelements);
 		goto done;
 	}
 
@@ -326,13 +308,10 @@ GLXFBConfig *glXChooseFBConfig(Display *dpy, int screen,
 		// config we just obtained.
 		for(int i = 0; i < *nelements; i++)
 		{
-			int d = depth;
-			XVisualInfo *vis = _glXGetVisualFromFBConfig(_dpy3D, configs[i]);
-			if(vis)
-			{
-				if(vis->depth > 24) d = vis->depth;
-				XFree(vis);
-			}
+			int d = depth, visDepth, visClass;
+			if(glxvisual::visInfo3D(configs[i], visDepth, visClass)
+				&& visDepth > 24)
+				d = visDepth;
 
 			// Find an appropriate matching visual on the 2D X server.
 			VisualID vid = glxvisual::matchVisual2D(dpy, screen, d, c_class, level,
@@ -419,7 +398,7 @@ XVisualInfo *glXChooseVisual(Display *dpy, int screen, int *attrib_list)
 	// server suitable for off-screen rendering
 	GLXFBConfig *configs = NULL, prevConfig;  int n = 0;
 	int depth = 24, c_class = TrueColor, level = 0, stereo = 0, trans = 0;
-	VisualID vid = 0;  XVisualInfo *vtemp = NULL;
+	VisualID vid = 0;  int visDepth, visClass;
 	if(!dpy || !attrib_list) goto done;
 	if(!(configs = glxvisual::configsFromVisAttribs(attrib_list, c_class, level,
 		stereo, trans, n)) || n < 1)
@@ -439,12 +418,8 @@ XVisualInfo *glXChooseVisual(Display *dpy, int screen, int *attrib_list)
 	}
 	config = configs[0];
 	XFree(configs);
-	vtemp = _glXGetVisualFromFBConfig(_dpy3D, config);
-	if(vtemp)
-	{
-		if(vtemp->depth > 24) depth = vtemp->depth;
-		XFree(vtemp);
-	}
+	if(glxvisual::visInfo3D(config, visDepth, visClass) && visDepth > 24)
+		depth = visDepth;
 
 	// Find an appropriate matching visual on the 2D X server.
 	vid = glxvisual::matchVisual2D(dpy, screen, depth, c_class, level, stereo,
@@ -496,7 +471,7 @@ void glXCopyContext(Display *dpy, GLXContext src, GLXContext dst,
 	}
 	else if(srcOverlay != dstOverlay)
 		_throw("glXCopyContext() cannot copy between overlay and non-overlay contexts");
-	_glXCopyContext(_dpy3D, src, dst, mask);
+	backend::copyContext(src, dst, mask);
 
 	CATCH();
 }
@@ -542,11 +517,10 @@ GLXContext glXCreateContext(Display *dpy, XVisualInfo *vis,
 	// to using a default FB config returned from matchConfig().
 	if(!(config = matchConfig(dpy, vis)))
 		_throw("Could not obtain RGB visual on the server suitable for off-screen rendering.");
-	ctx = _glXCreateNewContext(_dpy3D, config, GLX_RGBA_TYPE, share_list,
-		direct);
+	ctx = backend::createContext(config, share_list, direct, NULL);
 	if(ctx)
 	{
-		int newctxIsDirect = _glXIsDirect(_dpy3D, ctx);
+		int newctxIsDirect = backend::isDirect(ctx);
 		if(!newctxIsDirect && direct)
 		{
 			vglout.println("[VGL] WARNING: The OpenGL rendering context obtained on X display");
@@ -596,14 +570,12 @@ GLXContext glXCreateContextAttribsARB(Display *dpy, GLXFBConfig config,
 
 	CHECKSYM_NONFATAL(glXCreateContextAttribsARB)
 	if((!attribs || attribs[0] == None) && !__glXCreateContextAttribsARB)
-		ctx = _glXCreateNewContext(_dpy3D, config, GLX_RGBA_TYPE, share_context,
-			direct);
+		ctx = backend::createContext(config, share_context, direct, NULL);
 	else
-		ctx = _glXCreateContextAttribsARB(_dpy3D, config, share_context, direct,
-			attribs);
+		ctx = backend::createContext(config, share_context, direct, attribs);
 	if(ctx)
 	{
-		int newctxIsDirect = _glXIsDirect(_dpy3D, ctx);
+		int newctxIsDirect = backend::isDirect(ctx);
 		if(!newctxIsDirect && direct)
 		{
 			vglout.println("[VGL] WARNING: The OpenGL rendering context obtained on X display");
@@ -646,11 +618,10 @@ GLXContext glXCreateNewContext(Display *dpy, GLXFBConfig config,
 		opentrace(glXCreateNewContext);  prargd(dpy);  prargc(config);
 		prargi(render_type);  prargx(share_list);  prargi(direct);  starttrace();
 
-	ctx = _glXCreateNewContext(_dpy3D, config, GLX_RGBA_TYPE, share_list,
-		direct);
+	ctx = backend::createContext(config, share_list, direct, NULL);
 	if(ctx)
 	{
-		int newctxIsDirect = _glXIsDirect(_dpy3D, ctx);
+		int newctxIsDirect = backend::isDirect(ctx);
 		if(!newctxIsDirect && direct)
 		{
 			vglout.println("[VGL] WARNING: The OpenGL rendering context obtained on X display");
@@ -698,7 +669,7 @@ GLXPbuffer glXCreatePbuffer(Display *dpy, GLXFBConfig config,
 		opentrace(glXCreatePbuffer);  prargd(dpy);  prargc(config);
 		prargal13(attrib_list);  starttrace();
 
-	pb = _glXCreatePbuffer(_dpy3D, config, attrib_list);
+	pb = backend::createPbuffer(config, attrib_list);
 	if(dpy && pb) glxdhash.add(pb, dpy);
 
 		stoptrace();  prargx(pb);  closetrace();
@@ -886,7 +857,7 @@ void glXDestroyContext(Display *dpy, GLXContext ctx)
 		opentrace(glXDestroyContext);  prargd(dpy);  prargx(ctx);  starttrace();
 
 	ctxhash.remove(ctx);
-	_glXDestroyContext(_dpy3D, ctx);
+	backend::destroyContext(ctx);
 
 		stoptrace();  closetrace();
 
@@ -905,7 +876,7 @@ void glXDestroyPbuffer(Display *dpy, GLXPbuffer pbuf)
 
 		opentrace(glXDestroyPbuffer);  prargd(dpy);  prargx(pbuf);  starttrace();
 
-	_glXDestroyPbuffer(_dpy3D, pbuf);
+	backend::destroyPbuffer(pbuf);
 	if(pbuf) glxdhash.remove(pbuf);
 
 		stoptrace();  closetrace();
@@ -1002,7 +973,7 @@ void glXFreeContextEXT(Display *dpy, GLXContext ctx)
 	{
 		_glXFreeContextEXT(dpy, ctx);  return;
 	}
-	_glXFreeContextEXT(_dpy3D, ctx);
+	backend::freeContext(ctx);
 
 	CATCH();
 }
@@ -1019,7 +990,7 @@ static char glxextensions[1024] = VGL_GLX_EXTENSIONS;
 static const char *getGLXExtensions(void)
 {
 	CHECKSYM_NONFATAL(glXCreateContextAttribsARB)
-	if(__glXCreateContextAttribsARB
+	if((__glXCreateContextAttribsARB || fconfig.egl)
 		&& !strstr(glxextensions, "GLX_ARB_create_context"))
 		strncat(glxextensions,
 			" GLX_ARB_create_context GLX_ARB_create_context_profile",
@@ -1029,7 +1000,7 @@ static const char *getGLXExtensions(void)
 	CHECKSYM_NONFATAL(glXImportContextEXT)
 	CHECKSYM_NONFATAL(glXQueryContextInfoEXT)
 	if(__glXFreeContextEXT && __glXImportContextEXT && __glXQueryContextInfoEXT
-		&& !strstr(glxextensions, "GLX_EXT_import_context"))
+		&& !fconfig.egl && !strstr(glxextensions, "GLX_EXT_import_context"))
 		strncat(glxextensions, " GLX_EXT_import_context",
 			1023 - strlen(glxextensions));
 
@@ -1040,7 +1011,7 @@ static const char *getGLXExtensions(void)
 
 	CHECKSYM_NONFATAL(glXBindTexImageEXT)
 	CHECKSYM_NONFATAL(glXReleaseTexImageEXT)
-	if(__glXBindTexImageEXT && __glXReleaseTexImageEXT
+	if(__glXBindTexImageEXT && __glXReleaseTexImageEXT && !fconfig.egl
 		&& !strstr(glxextensions, "GLX_EXT_texture_from_pixmap"))
 		strncat(glxextensions, " GLX_EXT_texture_from_pixmap",
 			1023 - strlen(glxextensions));
@@ -1053,7 +1024,8 @@ static const char *getGLXExtensions(void)
 	CHECKSYM_NONFATAL(glXResetFrameCountNV)
 	if(__glXBindSwapBarrierNV && __glXJoinSwapGroupNV && __glXQueryFrameCountNV
 		&& __glXQueryMaxSwapGroupsNV && __glXQuerySwapGroupNV
-		&& __glXResetFrameCountNV && !strstr(glxextensions, "GLX_NV_swap_group"))
+		&& __glXResetFrameCountNV && !fconfig.egl
+		&& !strstr(glxextensions, "GLX_NV_swap_group"))
 		strncat(glxextensions, " GLX_NV_swap_group", 1023 - strlen(glxextensions));
 
 	CHECKSYM_NONFATAL(glXSwapIntervalSGI)
@@ -1144,7 +1116,7 @@ int glXGetConfig(Display *dpy, XVisualInfo *vis, int attrib, int *value)
 			*value = 1;
 		else *value = 0;
 	}
-	else retval = _glXGetFBConfigAttrib(_dpy3D, config, attrib, value);
+	else retval = backend::getFBConfigAttrib(config, attrib, value);
 
 		stoptrace();  if(value) { prargix(*value); }  else { prargx(value); }
 		closetrace();
@@ -1154,6 +1126,33 @@ int glXGetConfig(Display *dpy, XVisualInfo *vis, int attrib, int *value)
 }
 
 
+#ifdef EGLBACKEND
+
+// With the EGL back end, the application's contexts are really EGL contexts,
+// so the underlying GLX implementation doesn't know about them.
+
+GLXContext glXGetCurrentContext(void)
+{
+	GLXContext ctx = 0;
+
+	if(!fconfig.egl || vglfaker::getExcludeCurrent())
+		return _glXGetCurrentContext();
+
+	TRY();
+
+		opentrace(glXGetCurrentContext);  starttrace();
+
+	ctx = backend::getCurrentContext();
+
+		stoptrace();  prargx(ctx);  closetrace();
+
+	CATCH();
+	return ctx;
+}
+
+#endif
+
+
 // This returns the 2D X display handle associated with the current drawable,
 // that is, the 2D X display handle passed to whatever function (such as
 // XCreateWindow(), glXCreatePbuffer(), etc.) that was used to create the
@@ -1169,7 +1168,7 @@ Display *glXGetCurrentDisplay(void)
 
 		opentrace(glXGetCurrentDisplay);  starttrace();
 
-	GLXDrawable curdraw = _glXGetCurrentDrawable();
+	GLXDrawable curdraw = backend::getCurrentDrawable();
 	if(winhash.find(curdraw, vw)) dpy = vw->getX11Display();
 	else
 	{
@@ -1189,12 +1188,14 @@ Display *glXGetCurrentDisplay(void)
 
 GLXDrawable glXGetCurrentDrawable(void)
 {
-	VirtualWin *vw = NULL;  GLXDrawable draw = _glXGetCurrentDrawable();
+	VirtualWin *vw = NULL;  GLXDrawable draw = 0;
 
-	if(vglfaker::getExcludeCurrent()) return draw;
+	if(vglfaker::getExcludeCurrent()) return _glXGetCurrentDrawable();
 
 	TRY();
 
+	draw = backend::getCurrentDrawable();
+
 		opentrace(glXGetCurrentDrawable);  starttrace();
 
 	if(winhash.find(draw, vw)) draw = vw->getX11Drawable();
@@ -1207,12 +1208,14 @@ GLXDrawable glXGetCurrentDrawable(void)
 
 GLXDrawable glXGetCurrentReadDrawable(void)
 {
-	VirtualWin *vw = NULL;  GLXDrawable read = _glXGetCurrentReadDrawable();
+	VirtualWin *vw = NULL;  GLXDrawable read = 0;
 
-	if(vglfaker::getExcludeCurrent()) return read;
+	if(vglfaker::getExcludeCurrent()) return _glXGetCurrentReadDrawable();
 
 	TRY();
 
+	read = backend::getCurrentReadDrawable();
+
 		opentrace(glXGetCurrentReadDrawable);  starttrace();
 
 	if(winhash.find(read, vw)) read = vw->getX11Drawable();
@@ -1252,7 +1255,7 @@ int glXGetFBConfigAttrib(Display *dpy, GLXFBConfig config, int attribute,
 		goto done;
 	}
 
-	retval = _glXGetFBConfigAttrib(_dpy3D, config, attribute, value);
+	retval = backend::getFBConfigAttrib(config, attribute, value);
 
 	if(attribute == GLX_DRAWABLE_TYPE && retval == Success)
 	{
@@ -1331,7 +1334,7 @@ GLXFBConfig *glXGetFBConfigs(Display *dpy, int screen, int *nelements)
 		opentrace(glXGetFBConfigs);  prargd(dpy);  prargi(screen);
 		starttrace();
 
-	configs = _glXGetFBConfigs(_dpy3D, DefaultScreen(_dpy3D), nelements);
+	configs = backend::getFBConfigs(nelements);
 
 		stoptrace();  if(configs && nelements) prargi(*nelements);
 		closetrace();
@@ -1356,6 +1359,18 @@ void glXBindTexImageEXT(Display *dpy, GLXDrawable drawable, int buffer,
 	if(isExcluded(dpy))
 		return _glXBindTexImageEXT(dpy, drawable, buffer, attrib_list);
 
+	// The EGL back end has no 3D X server on which to store the pixmap.
+	if(fconfig.egl)
+	{
+		static bool alreadyWarned = false;
+		if(!alreadyWarned)
+		{
+			vglout.println("[VGL] WARNING: glXBindTexImageEXT() is not supported with the EGL back end.");
+			alreadyWarned = true;
+		}
+		return;
+	}
+
 		opentrace(glXBindTexImageEXT);  prargd(dpy);  prargx(drawable);
 		prargi(buffer);  prargal13(attrib_list);  starttrace();
 
@@ -1397,6 +1412,8 @@ void glXReleaseTexImageEXT(Display *dpy, GLXDrawable drawable, int buffer)
 	if(isExcluded(dpy))
 		return _glXReleaseTexImageEXT(dpy, drawable, buffer);
 
+	if(fconfig.egl) return;
+
 		opentrace(glXReleaseTexImageEXT);  prargd(dpy);  prargx(drawable);
 		prargi(buffer);  starttrace();
 
@@ -1451,6 +1468,9 @@ void (*glXGetProcAddressARB(const GLubyte *procName))(void)
 		checkfaked(glXDestroyContext)
 		checkfaked(glXDestroyGLXPixmap)
 		checkfaked(glXGetConfig)
+		#ifdef EGLBACKEND
+		checkfaked(glXGetCurrentContext)
+		#endif
 		checkfaked(glXGetCurrentDrawable)
 		checkfaked(glXIsDirect)
 		checkfaked(glXMakeCurrent)
@@ -1547,6 +1567,26 @@ void (*glXGetProcAddressARB(const GLubyte *procName))(void)
 		checkfaked(glViewport)
 		checkfaked(glDrawBuffer)
 		checkfaked(glPopAttrib)
+		#ifdef EGLBACKEND
+		checkfaked(glBindFramebuffer)
+		checkoptfaked(glBindFramebufferEXT)
+		checkfaked(glBlitFramebuffer)
+		checkfaked(glCopyTexImage2D)
+		checkfaked(glCopyTexSubImage2D)
+		checkfaked(glDrawBuffers)
+		checkoptfaked(glDrawBuffersARB)
+		checkfaked(glGetBooleanv)
+		checkfaked(glGetDoublev)
+		checkfaked(glGetFloatv)
+		checkfaked(glGetFramebufferAttachmentParameteriv)
+		checkoptfaked(glGetInteger64v)
+		checkfaked(glGetIntegerv)
+		checkoptfaked(glNamedFramebufferDrawBuffer)
+		checkoptfaked(glNamedFramebufferDrawBuffers)
+		checkoptfaked(glNamedFramebufferReadBuffer)
+		checkfaked(glReadBuffer)
+		checkfaked(glReadPixels)
+		#endif
 	}
 	if(!retval)
 	{
@@ -1577,7 +1617,7 @@ void glXGetSelectedEvent(Display *dpy, GLXDrawable draw,
 	if(isExcluded(dpy) || winhash.isOverlay(dpy, draw))
 		return _glXGetSelectedEvent(dpy, draw, event_mask);
 
-	_glXGetSelectedEvent(_dpy3D, ServerDrawable(dpy, draw), event_mask);
+	backend::getSelectedEvent(ServerDrawable(dpy, draw), event_mask);
 
 	CATCH();
 }
@@ -1637,7 +1677,7 @@ GLXContext glXImportContextEXT(Display *dpy, GLXContextID contextID)
 	if(isExcluded(dpy))
 		return _glXImportContextEXT(dpy, contextID);
 
-	return _glXImportContextEXT(_dpy3D, contextID);
+	return backend::importContext(contextID);
 
 	CATCH();
 	return 0;
@@ -1659,7 +1699,7 @@ Bool glXIsDirect(Display *dpy, GLXContext ctx)
 		opentrace(glXIsDirect);  prargd(dpy);  prargx(ctx);
 		starttrace();
 
-	direct = _glXIsDirect(_dpy3D, ctx);
+	direct = backend::isDirect(ctx);
 
 		stoptrace();  prargi(direct);  closetrace();
 
@@ -1703,8 +1743,8 @@ Bool glXMakeCurrent(Display *dpy, GLXDrawable drawable, GLXContext ctx)
 
 	// glXMakeCurrent() implies a glFinish() on the previous context, which is
 	// why we read back the front buffer here if it is dirty.
-	GLXDrawable curdraw = _glXGetCurrentDrawable();
-	if(_glXGetCurrentContext() && dpy3DIsCurrent()
+	GLXDrawable curdraw = backend::getCurrentDrawable();
+	if(backend::getCurrentContext() && dpy3DIsCurrent()
 		&& curdraw && winhash.find(curdraw, vw))
 	{
 		VirtualWin *newvw;
@@ -1747,7 +1787,7 @@ Bool glXMakeCurrent(Display *dpy, GLXDrawable drawable, GLXContext ctx)
 		}
 	}
 
-	retval = _glXMakeContextCurrent(_dpy3D, drawable, drawable, ctx);
+	retval = backend::makeCurrent(drawable, drawable, ctx);
 	if(fconfig.trace && retval)
 		renderer = (const char *)_glGetString(GL_RENDERER);
 	// The pixels in a new off-screen drawable are undefined, so we have to clear
@@ -1802,8 +1842,8 @@ Bool glXMakeContextCurrent(Display *dpy, GLXDrawable draw, GLXDrawable read,
 
 	// glXMakeContextCurrent() implies a glFinish() on the previous context,
 	// which is why we read back the front buffer here if it is dirty.
-	GLXDrawable curdraw = _glXGetCurrentDrawable();
-	if(_glXGetCurrentContext() && dpy3DIsCurrent() && curdraw
+	GLXDrawable curdraw = backend::getCurrentDrawable();
+	if(backend::getCurrentContext() && dpy3DIsCurrent() && curdraw
 		&& winhash.find(curdraw, vw))
 	{
 		VirtualWin *newvw;
@@ -1867,7 +1907,7 @@ Bool glXMakeContextCurrent(Display *dpy, GLXDrawable draw, GLXDrawable read,
 			}
 		}
 	}
-	retval = _glXMakeContextCurrent(_dpy3D, draw, read, ctx);
+	retval = backend::makeCurrent(draw, read, ctx);
 	if(fconfig.trace && retval)
 		renderer = (const char *)_glGetString(GL_RENDERER);
 	if(winhash.find(draw, drawVW)) { drawVW->clear();  drawVW->cleanup(); }
@@ -1910,7 +1950,7 @@ int glXQueryContext(Display *dpy, GLXContext ctx, int attribute, int *value)
 		opentrace(glXQueryContext);  prargd(dpy);  prargx(ctx);
 		prargix(attribute);  starttrace();
 
-	retval = _glXQueryContext(_dpy3D, ctx, attribute, value);
+	retval = backend::queryContext(ctx, attribute, value);
 
 		stoptrace();  if(value) prargix(*value);  closetrace();
 
@@ -1932,7 +1972,7 @@ int glXQueryContextInfoEXT(Display *dpy, GLXContext ctx, int attribute,
 		opentrace(glXQueryContextInfoEXT);  prargd(dpy);  prargx(ctx);
 		prargix(attribute);  starttrace();
 
-	retval = _glXQueryContextInfoEXT(_dpy3D, ctx, attribute, value);
+	retval = backend::queryContextInfo(ctx, attribute, value);
 
 		stoptrace();  if(value) prargix(*value);  closetrace();
 
@@ -1975,7 +2015,7 @@ void glXQueryDrawable(Display *dpy, GLXDrawable draw, int attribute,
 		goto done;
 	}
 
-	_glXQueryDrawable(_dpy3D, ServerDrawable(dpy, draw), attribute, value);
+	backend::queryDrawable(ServerDrawable(dpy, draw), attribute, value);
 
 	done:
 		stoptrace();  prargx(ServerDrawable(dpy, draw));
@@ -2002,7 +2042,7 @@ Bool glXQueryExtension(Display *dpy, int *error_base, int *event_base)
 	if(isExcluded(dpy))
 		return _glXQueryExtension(dpy, error_base, event_base);
 
-	return _glXQueryExtension(_dpy3D, error_base, event_base);
+	return backend::queryExtension(error_base, event_base);
 
 	CATCH();
 	return False;
@@ -2056,7 +2096,7 @@ Bool glXQueryVersion(Display *dpy, int *major, int *minor)
 	if(isExcluded(dpy))
 		return _glXQueryVersion(dpy, major, minor);
 
-	return _glXQueryVersion(_dpy3D, major, minor);
+	return backend::queryVersion(major, minor);
 
 	CATCH();
 	return False;
@@ -2073,7 +2113,7 @@ void glXSelectEvent(Display *dpy, GLXDrawable draw, unsigned long event_mask)
 	if(isExcluded(dpy) || winhash.isOverlay(dpy, draw))
 		return _glXSelectEvent(dpy, draw, event_mask);
 
-	_glXSelectEvent(_dpy3D, ServerDrawable(dpy, draw), event_mask);
+	backend::selectEvent(ServerDrawable(dpy, draw), event_mask);
 
 	CATCH();
 }
@@ -2090,8 +2130,7 @@ void glXSelectEventSGIX(Display *dpy, GLXDrawable drawable, unsigned long mask)
 void glXSwapBuffers(Display *dpy, GLXDrawable drawable)
 {
 	VirtualWin *vw = NULL;
-	static Timer timer;  Timer sleepTimer;
-	static double err = 0.;  static bool first = true;
+	static FramePacer pacer;
 
 	TRY();
 
@@ -2106,29 +2145,17 @@ void glXSwapBuffers(Display *dpy, GLXDrawable drawable)
 	fconfig.flushdelay = 0.;
 	if(winhash.find(dpy, drawable, vw))
 	{
-		vw->readback(GL_BACK, false, fconfig.sync);
-		vw->swapBuffers();
-		int interval = vw->getSwapInterval();
-		if(interval > 0)
+		if(fconfig.asyncreadback) vw->swapAndReadback();
+		else
 		{
-			double elapsed = timer.elapsed();
-			if(first) first = false;
-			else
-			{
-				double fps = fconfig.refreshrate / (double)interval;
-				if(fps > 0.0 && elapsed < 1. / fps)
-				{
-					sleepTimer.start();
-					long usec = (long)((1. / fps - elapsed - err) * 1000000.);
-					if(usec > 0) usleep(usec);
-					double sleepTime = sleepTimer.elapsed();
-					err = sleepTime - (1. / fps - elapsed - err);  if(err < 0.) err = 0.;
-				}
-			}
-			timer.start();
+			vw->readback(GL_BACK, false, fconfig.sync);
+			vw->swapBuffers();
 		}
+		int interval = vw->getSwapInterval();
+		if(interval > 0 && fconfig.refreshrate > 0.)
+			pacer.wait((double)interval / fconfig.refreshrate);
 	}
-	else _glXSwapBuffers(_dpy3D, drawable);
+	else backend::swapBuffers(drawable);
 
 		stoptrace();  if(vw) { prargx(vw->getGLXDrawable()); }
 		closetrace();
@@ -2187,7 +2214,7 @@ Bool glXJoinSwapGroupNV(Display *dpy, GLXDrawable drawable, GLuint group)
 	if(isExcluded(dpy))
 		return _glXJoinSwapGroupNV(dpy, drawable, group);
 
-	return _glXJoinSwapGroupNV(_dpy3D, ServerDrawable(dpy, drawable), group);
+	return backend::joinSwapGroup(ServerDrawable(dpy, drawable), group);
 
 	CATCH();
 	return False;
@@ -2203,7 +2230,7 @@ Bool glXBindSwapBarrierNV(Display *dpy, GLuint group, GLuint barrier)
 	if(isExcluded(dpy))
 		return _glXBindSwapBarrierNV(dpy, group, barrier);
 
-	return _glXBindSwapBarrierNV(_dpy3D, group, barrier);
+	return backend::bindSwapBarrier(group, barrier);
 
 	CATCH();
 	return False;
@@ -2221,7 +2248,7 @@ Bool glXQuerySwapGroupNV(Display *dpy, GLXDrawable drawable, GLuint *group,
 	if(isExcluded(dpy))
 		return _glXQuerySwapGroupNV(dpy, drawable, group, barrier);
 
-	return _glXQuerySwapGroupNV(_dpy3D, ServerDrawable(dpy, drawable), group,
+	return backend::querySwapGroup(ServerDrawable(dpy, drawable), group,
 		barrier);
 
 	CATCH();
@@ -2239,8 +2266,7 @@ Bool glXQueryMaxSwapGroupsNV(Display *dpy, int screen, GLuint *maxGroups,
 	if(isExcluded(dpy))
 		return _glXQueryMaxSwapGroupsNV(dpy, screen, maxGroups, maxBarriers);
 
-	return _glXQueryMaxSwapGroupsNV(_dpy3D, DefaultScreen(_dpy3D), maxGroups,
-		maxBarriers);
+	return backend::queryMaxSwapGroups(maxGroups, maxBarriers);
 
 	CATCH();
 	return False;
@@ -2256,7 +2282,7 @@ Bool glXQueryFrameCountNV(Display *dpy, int screen, GLuint *count)
 	if(isExcluded(dpy))
 		return _glXQueryFrameCountNV(dpy, screen, count);
 
-	return _glXQueryFrameCountNV(_dpy3D, DefaultScreen(_dpy3D), count);
+	return backend::queryFrameCount(count);
 
 	CATCH();
 	return False;
@@ -2272,7 +2298,7 @@ Bool glXResetFrameCountNV(Display *dpy, int screen)
 	if(isExcluded(dpy))
 		return _glXResetFrameCountNV(dpy, screen);
 
-	return _glXResetFrameCountNV(_dpy3D, DefaultScreen(_dpy3D));
+	return backend::resetFrameCount();
 
 	CATCH();
 	return False;
@@ -8,6 +8,9 @@
 		glXDestroyContext;
 		glXDestroyGLXPixmap;
 		glXGetConfig;
+		#ifdef EGLBACKEND
+		glXGetCurrentContext;
+		#endif
 		glXGetCurrentDrawable;
 		glXIsDirect;
 		glXMakeCurrent;
@@ -104,6 +107,26 @@
 		glViewport;
 		glDrawBuffer;
 		glPopAttrib;
+		#ifdef EGLBACKEND
+		glBindFramebuffer;
+		glBindFramebufferEXT;
+		glBlitFramebuffer;
+		glCopyTexImage2D;
+		glCopyTexSubImage2D;
+		glDrawBuffers;
+		glDrawBuffersARB;
+		glGetBooleanv;
+		glGetDoublev;
+		glGetFloatv;
+		glGetFramebufferAttachmentParameteriv;
+		glGetInteger64v;
+		glGetIntegerv;
+		glNamedFramebufferDrawBuffer;
+		glNamedFramebufferDrawBuffers;
+		glNamedFramebufferReadBuffer;
+		glReadBuffer;
+		glReadPixels;
+		#endif
 
 		/* X11 */
 		XCheckMaskEvent;
@@ -24,6 +24,10 @@ static void *gldllhnd = NULL;
 static void *loadGLSymbol(const char *, bool);
 static void *x11dllhnd = NULL;
 static void *loadX11Symbol(const char *, bool);
+#ifdef EGLBACKEND
+static void *egldllhnd = NULL;
+static void *loadEGLSymbol(const char *, bool);
+#endif
 #ifdef FAKEXCB
 static void *xcbdllhnd = NULL;
 static void *loadXCBSymbol(const char *, bool);
@@ -65,6 +69,10 @@ void *loadSymbol(const char *name, bool optional)
 	}
 	if(!strncmp(name, "gl", 2))
 		return loadGLSymbol(name, optional);
+	#ifdef EGLBACKEND
+	else if(!strncmp(name, "egl", 3))
+		return loadEGLSymbol(name, optional);
+	#endif
 	#ifdef FAKEXCB
 	else if(!strcmp(name, "XGetXCBConnection")
 		|| !strcmp(name, "XSetEventQueueOwner"))
@@ -207,6 +215,57 @@ static void *loadX11Symbol(const char *name, bool optional)
 }
 
 
+#ifdef EGLBACKEND
+
+typedef void *(*_eglGetProcAddressType)(const char *);
+static _eglGetProcAddressType __eglGetProcAddress = NULL;
+
+// EGL extension functions (eglQueryDevicesEXT(), etc.) are not necessarily
+// exported from libEGL, so we fall back to eglGetProcAddress() if dlsym()
+// doesn't find a function.
+
+static void *loadEGLSymbol(const char *name, bool optional)
+{
+	char *err = NULL;
+
+	if(!egldllhnd)
+	{
+		const char *libName = strlen(fconfig.egllib) > 0 ?
+			fconfig.egllib : "libEGL.so.1";
+		dlerror();  // Clear error state
+		void *dllhnd = _vgl_dlopen(libName, RTLD_LAZY);
+		err = dlerror();
+		if(!dllhnd)
+		{
+			vglout.print("[VGL] ERROR: Could not open %s\n", libName);
+			if(err) vglout.print("[VGL]    %s\n", err);
+			return NULL;
+		}
+		egldllhnd = dllhnd;
+		__eglGetProcAddress =
+			(_eglGetProcAddressType)dlsym(egldllhnd, "eglGetProcAddress");
+	}
+
+	dlerror();  // Clear error state
+	void *sym = dlsym(egldllhnd, (char *)name);
+	err = dlerror();
+	if(!sym && __eglGetProcAddress) sym = __eglGetProcAddress(name);
+
+	if(!sym && (fconfig.verbose || !optional))
+	{
+		vglout.print("[VGL] %s: Could not load function \"%s\"",
+			optional ? "WARNING" : "ERROR", name);
+		if(strlen(fconfig.egllib) > 0)
+			vglout.print(" from %s", fconfig.egllib);
+		vglout.print("\n");
+		if(err) vglout.print("[VGL]    %s\n", err);
+	}
+	return sym;
+}
+
+#endif
+
+
 #ifdef FAKEXCB
 
 #define LOAD_XCB_SYMBOL(ID, id, libid, minrev, maxrev) \
@@ -40,6 +40,10 @@ extern "C" {
 #endif
 }
 #endif
+#ifdef EGLBACKEND
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#endif
 
 
 namespace vglfaker
@@ -279,6 +283,19 @@ namespace vglfaker
 		ENABLE_FAKER(); \
 	}
 
+#define VFUNCDEF8(f, at1, a1, at2, a2, at3, a3, at4, a4, at5, a5, at6, a6, \
+	at7, a7, at8, a8, fake_f) \
+	typedef void (*_##f##Type)(at1, at2, at3, at4, at5, at6, at7, at8); \
+	SYMDEF(f); \
+	static INLINE void _##f(at1 a1, at2 a2, at3 a3, at4 a4, at5 a5, at6 a6, \
+		at7 a7, at8 a8) \
+	{ \
+		CHECKSYM(f, fake_f); \
+		DISABLE_FAKER(); \
+		__##f(a1, a2, a3, a4, a5, a6, a7, a8); \
+		ENABLE_FAKER(); \
+	}
+
 #define FUNCDEF8(RetType, f, at1, a1, at2, a2, at3, a3, at4, a4, at5, a5, \
 	at6, a6, at7, a7, at8, a8, fake_f) \
 	typedef RetType (*_##f##Type)(at1, at2, at3, at4, at5, at6, at7, at8); \
@@ -294,6 +311,19 @@ namespace vglfaker
 		return retval; \
 	}
 
+#define VFUNCDEF9(f, at1, a1, at2, a2, at3, a3, at4, a4, at5, a5, at6, a6, \
+	at7, a7, at8, a8, at9, a9, fake_f) \
+	typedef void (*_##f##Type)(at1, at2, at3, at4, at5, at6, at7, at8, at9); \
+	SYMDEF(f); \
+	static INLINE void _##f(at1 a1, at2 a2, at3 a3, at4 a4, at5 a5, at6 a6, \
+		at7 a7, at8 a8, at9 a9) \
+	{ \
+		CHECKSYM(f, fake_f); \
+		DISABLE_FAKER(); \
+		__##f(a1, a2, a3, a4, a5, a6, a7, a8, a9); \
+		ENABLE_FAKER(); \
+	}
+
 #define FUNCDEF9(RetType, f, at1, a1, at2, a2, at3, a3, at4, a4, at5, a5, \
 	at6, a6, at7, a7, at8, a8, at9, a9, fake_f) \
 	typedef RetType (*_##f##Type)(at1, at2, at3, at4, at5, at6, at7, at8, at9); \
@@ -325,6 +355,20 @@ namespace vglfaker
 		return retval; \
 	}
 
+#define VFUNCDEF10(f, at1, a1, at2, a2, at3, a3, at4, a4, at5, a5, at6, a6, \
+	at7, a7, at8, a8, at9, a9, at10, a10, fake_f) \
+	typedef void (*_##f##Type)(at1, at2, at3, at4, at5, at6, at7, at8, at9, \
+		at10); \
+	SYMDEF(f); \
+	static INLINE void _##f(at1 a1, at2 a2, at3 a3, at4 a4, at5 a5, at6 a6, \
+		at7 a7, at8 a8, at9 a9, at10 a10) \
+	{ \
+		CHECKSYM(f, fake_f); \
+		DISABLE_FAKER(); \
+		__##f(a1, a2, a3, a4, a5, a6, a7, a8, a9, a10); \
+		ENABLE_FAKER(); \
+	}
+
 #define FUNCDEF12(RetType, f, at1, a1, at2, a2, at3, a3, at4, a4, at5, a5, \
 	at6, a6, at7, a7, at8, a8, at9, a9, at10, a10, at11, a11, at12, a12, \
 	fake_f) \
@@ -569,6 +613,65 @@ VFUNCDEF1(glDrawBuffer, GLenum, drawbuf, glDrawBuffer);
 
 VFUNCDEF0(glPopAttrib, glPopAttrib);
 
+#ifdef EGLBACKEND
+
+// These are interposed only so that the EGL back end can emulate the default
+// framebuffer (see backend.h.)  With the GLX back end, they are passed through
+// unmodified.
+
+VFUNCDEF2(glBindFramebuffer, GLenum, target, GLuint, framebuffer,
+	glBindFramebuffer);
+
+VFUNCDEF2(glBindFramebufferEXT, GLenum, target, GLuint, framebuffer,
+	glBindFramebufferEXT);
+
+VFUNCDEF10(glBlitFramebuffer, GLint, srcX0, GLint, srcY0, GLint, srcX1,
+	GLint, srcY1, GLint, dstX0, GLint, dstY0, GLint, dstX1, GLint, dstY1,
+	GLbitfield, mask, GLenum, filter, glBlitFramebuffer);
+
+VFUNCDEF8(glCopyTexImage2D, GLenum, target, GLint, level,
+	GLenum, internalformat, GLint, x, GLint, y, GLsizei, width, GLsizei, height,
+	GLint, border, glCopyTexImage2D);
+
+VFUNCDEF8(glCopyTexSubImage2D, GLenum, target, GLint, level, GLint, xoffset,
+	GLint, yoffset, GLint, x, GLint, y, GLsizei, width, GLsizei, height,
+	glCopyTexSubImage2D);
+
+VFUNCDEF2(glDrawBuffers, GLsizei, n, const GLenum *, bufs, glDrawBuffers);
+
+VFUNCDEF2(glDrawBuffersARB, GLsizei, n, const GLenum *, bufs,
+	glDrawBuffersARB);
+
+VFUNCDEF2(glGetBooleanv, GLenum, pname, GLboolean *, data, glGetBooleanv);
+
+VFUNCDEF2(glGetDoublev, GLenum, pname, GLdouble *, data, glGetDoublev);
+
+VFUNCDEF2(glGetFloatv, GLenum, pname, GLfloat *, data, glGetFloatv);
+
+VFUNCDEF4(glGetFramebufferAttachmentParameteriv, GLenum, target,
+	GLenum, attachment, GLenum, pname, GLint *, params,
+	glGetFramebufferAttachmentParameteriv);
+
+VFUNCDEF2(glGetInteger64v, GLenum, pname, GLint64 *, data, glGetInteger64v);
+
+VFUNCDEF2(glGetIntegerv, GLenum, pname, GLint *, data, glGetIntegerv);
+
+VFUNCDEF2(glNamedFramebufferDrawBuffer, GLuint, framebuffer, GLenum, buf,
+	glNamedFramebufferDrawBuffer);
+
+VFUNCDEF3(glNamedFramebufferDrawBuffers, GLuint, framebuffer, GLsizei, n,
+	const GLenum *, bufs, glNamedFramebufferDrawBuffers);
+
+VFUNCDEF2(glNamedFramebufferReadBuffer, GLuint, framebuffer, GLenum, src,
+	glNamedFramebufferReadBuffer);
+
+VFUNCDEF1(glReadBuffer, GLenum, mode, glReadBuffer);
+
+VFUNCDEF7(glReadPixels, GLint, x, GLint, y, GLsizei, width, GLsizei, height,
+	GLenum, format, GLenum, type, GLvoid *, pixels, glReadPixels);
+
+#endif
+
 
 // X11 functions
 
@@ -710,9 +813,11 @@ VFUNCDEF3(glGetBufferParameteriv, GLenum, target, GLenum, value, GLint *, data,
 
 FUNCDEF0(GLenum, glGetError, NULL);
 
+#ifndef EGLBACKEND
 VFUNCDEF2(glGetFloatv, GLenum, pname, GLfloat *, params, NULL);
 
 VFUNCDEF2(glGetIntegerv, GLenum, pname, GLint *, params, NULL);
+#endif
 
 FUNCDEF1(const GLubyte *, glGetString, GLenum, name, NULL);
 
@@ -735,14 +840,167 @@ VFUNCDEF0(glPushMatrix, NULL);
 
 VFUNCDEF2(glRasterPos2i, GLint, x, GLint, y, NULL);
 
+#ifndef EGLBACKEND
 VFUNCDEF1(glReadBuffer, GLenum, mode, NULL);
+#endif
 
+#ifndef EGLBACKEND
 VFUNCDEF7(glReadPixels, GLint, x, GLint, y, GLsizei, width, GLsizei, height,
 	GLenum, format, GLenum, type, GLvoid *, pixels, NULL);
+#endif
 
 FUNCDEF1(GLboolean, glUnmapBuffer, GLenum, target, NULL);
 
+#ifdef EGLBACKEND
+FUNCDEF0(GLXContext, glXGetCurrentContext, glXGetCurrentContext);
+#else
 FUNCDEF0(GLXContext, glXGetCurrentContext, NULL);
+#endif
+
+// Functions used by the GPU composition stage (see GPUCompositor.h.)  These
+// are not called unless the readback context supports OpenGL 3.0, or OpenGL
+// 2.0 with GL_ARB_framebuffer_object.
+
+#ifdef GL_VERSION_3_0
+
+VFUNCDEF1(glActiveTexture, GLenum, texture, NULL);
+
+VFUNCDEF2(glAttachShader, GLuint, program, GLuint, shader, NULL);
+
+#ifndef EGLBACKEND
+VFUNCDEF2(glBindFramebuffer, GLenum, target, GLuint, framebuffer, NULL);
+#endif
+
+VFUNCDEF2(glBindTexture, GLenum, target, GLuint, texture, NULL);
+
+FUNCDEF1(GLenum, glCheckFramebufferStatus, GLenum, target, NULL);
+
+VFUNCDEF1(glCompileShader, GLuint, shader, NULL);
+
+#ifndef EGLBACKEND
+VFUNCDEF8(glCopyTexSubImage2D, GLenum, target, GLint, level, GLint, xoffset,
+	GLint, yoffset, GLint, x, GLint, y, GLsizei, width, GLsizei, height, NULL);
+#endif
+
+FUNCDEF0(GLuint, glCreateProgram, NULL);
+
+FUNCDEF1(GLuint, glCreateShader, GLenum, type, NULL);
+
+VFUNCDEF1(glDeleteShader, GLuint, shader, NULL);
+
+VFUNCDEF1(glDisable, GLenum, cap, NULL);
+
+VFUNCDEF5(glFramebufferTexture2D, GLenum, target, GLenum, attachment,
+	GLenum, textarget, GLuint, texture, GLint, level, NULL);
+
+VFUNCDEF2(glGenFramebuffers, GLsizei, n, GLuint *, framebuffers, NULL);
+
+VFUNCDEF2(glGenTextures, GLsizei, n, GLuint *, textures, NULL);
+
+VFUNCDEF3(glGetProgramiv, GLuint, program, GLenum, pname, GLint *, params,
+	NULL);
+
+VFUNCDEF3(glGetShaderiv, GLuint, shader, GLenum, pname, GLint *, params, NULL);
+
+FUNCDEF2(GLint, glGetUniformLocation, GLuint, program, const GLchar *, name,
+	NULL);
+
+VFUNCDEF1(glLinkProgram, GLuint, program, NULL);
+
+VFUNCDEF4(glRecti, GLint, x1, GLint, y1, GLint, x2, GLint, y2, NULL);
+
+VFUNCDEF4(glShaderSource, GLuint, shader, GLsizei, count,
+	const GLchar * const *, string, const GLint *, length, NULL);
+
+VFUNCDEF9(glTexImage2D, GLenum, target, GLint, level, GLint, internalformat,
+	GLsizei, width, GLsizei, height, GLint, border, GLenum, format,
+	GLenum, type, const GLvoid *, pixels, NULL);
+
+VFUNCDEF3(glTexParameteri, GLenum, target, GLenum, pname, GLint, param, NULL);
+
+VFUNCDEF2(glUniform1f, GLint, location, GLfloat, v0, NULL);
+
+VFUNCDEF2(glUniform1i, GLint, location, GLint, v0, NULL);
+
+VFUNCDEF3(glUniform2f, GLint, location, GLfloat, v0, GLfloat, v1, NULL);
+
+VFUNCDEF4(glUniform3f, GLint, location, GLfloat, v0, GLfloat, v1, GLfloat, v2,
+	NULL);
+
+VFUNCDEF1(glUseProgram, GLuint, program, NULL);
+
+#endif
+
+// Functions used by the EGL back end
+
+#ifdef EGLBACKEND
+
+VFUNCDEF2(glBindRenderbuffer, GLenum, target, GLuint, renderbuffer, NULL);
+
+VFUNCDEF2(glDeleteFramebuffers, GLsizei, n, const GLuint *, framebuffers,
+	NULL);
+
+VFUNCDEF2(glDeleteRenderbuffers, GLsizei, n, const GLuint *, renderbuffers,
+	NULL);
+
+VFUNCDEF1(glDeleteSync, GLsync, sync, NULL);
+
+VFUNCDEF1(glEnable, GLenum, cap, NULL);
+
+FUNCDEF2(GLsync, glFenceSync, GLenum, condition, GLbitfield, flags, NULL);
+
+VFUNCDEF4(glFramebufferRenderbuffer, GLenum, target, GLenum, attachment,
+	GLenum, renderbuffertarget, GLuint, renderbuffer, NULL);
+
+VFUNCDEF2(glGenRenderbuffers, GLsizei, n, GLuint *, renderbuffers, NULL);
+
+FUNCDEF1(GLboolean, glIsEnabled, GLenum, cap, NULL);
+
+VFUNCDEF5(glRenderbufferStorageMultisample, GLenum, target, GLsizei, samples,
+	GLenum, internalformat, GLsizei, width, GLsizei, height, NULL);
+
+VFUNCDEF3(glWaitSync, GLsync, sync, GLbitfield, flags, GLuint64, timeout,
+	NULL);
+
+FUNCDEF1(EGLBoolean, eglBindAPI, EGLenum, api, NULL);
+
+FUNCDEF5(EGLBoolean, eglChooseConfig, EGLDisplay, display,
+	const EGLint *, attrib_list, EGLConfig *, configs, EGLint, config_size,
+	EGLint *, num_config, NULL);
+
+FUNCDEF4(EGLContext, eglCreateContext, EGLDisplay, display, EGLConfig, config,
+	EGLContext, share_context, const EGLint *, attrib_list, NULL);
+
+FUNCDEF2(EGLBoolean, eglDestroyContext, EGLDisplay, display,
+	EGLContext, context, NULL);
+
+FUNCDEF0(EGLContext, eglGetCurrentContext, NULL);
+
+FUNCDEF0(EGLDisplay, eglGetCurrentDisplay, NULL);
+
+FUNCDEF1(EGLSurface, eglGetCurrentSurface, EGLint, readdraw, NULL);
+
+FUNCDEF0(EGLint, eglGetError, NULL);
+
+FUNCDEF3(EGLDisplay, eglGetPlatformDisplayEXT, EGLenum, platform,
+	void *, native_display, const EGLint *, attrib_list, NULL);
+
+FUNCDEF3(EGLBoolean, eglInitialize, EGLDisplay, display, EGLint *, major,
+	EGLint *, minor, NULL);
+
+FUNCDEF4(EGLBoolean, eglMakeCurrent, EGLDisplay, display, EGLSurface, draw,
+	EGLSurface, read, EGLContext, context, NULL);
+
+FUNCDEF3(EGLBoolean, eglQueryDevicesEXT, EGLint, max_devices,
+	EGLDeviceEXT *, devices, EGLint *, num_devices, NULL);
+
+FUNCDEF2(const char *, eglQueryDeviceStringEXT, EGLDeviceEXT, device,
+	EGLint, name, NULL);
+
+FUNCDEF2(const char *, eglQueryString, EGLDisplay, display, EGLint, name,
+	NULL);
+
+#endif
 
 // We load all XCB functions dynamically, so that the same VirtualGL binary
 // can be used to support systems with and without XCB libraries.
@@ -18,6 +18,7 @@
 #include "VisualHash.h"
 #include "WindowHash.h"
 #include "faker.h"
+#include "glxvisual.h"
 #include "vglconfigLauncher.h"
 #ifdef FAKEXCB
 #include "XCBConnHash.h"
@@ -70,6 +71,7 @@ int XCloseDisplay(Display *dpy)
 
 	winhash.remove(dpy);
 	dpyhash.remove(dpy);
+	glxvisual::removeDisplay(dpy);
 	retval = _XCloseDisplay(dpy);
 
 		stoptrace();  closetrace();
@@ -168,6 +170,8 @@ int XCopyArea(Display *dpy, Drawable src, Drawable dst, GC gc, int src_x,
 	{
 		glxsrc = srcVW->getGLXDrawable();
 		glxdst = dstVW->getGLXDrawable();
+		if(srcWin) ((VirtualWin *)srcVW)->waitReadback();
+		if(dstWin) ((VirtualWin *)dstVW)->waitReadback();
 		srcVW->copyPixels(src_x, src_y, width, height, dest_x, dest_y, glxdst);
 		if(triggerRB)
 			((VirtualWin *)dstVW)->readback(GL_FRONT, false, fconfig.sync);
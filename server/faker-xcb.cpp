@@ -47,9 +47,20 @@ const xcb_query_extension_reply_t *
 			opentrace(xcb_get_extension_data);  prargx(conn);  prargs(ext->name);
 			prargi(ext->global_id);  starttrace();
 
-		xcb_connection_t *conn3D = _XGetXCBConnection(_dpy3D);
-		if(conn3D != NULL)
-			reply = _xcb_get_extension_data(conn3D, _xcb_glx_id());
+		if(fconfig.egl)
+		{
+			// With the EGL back end, there is no 3D X server to query, so the
+			// extension is simply reported as present.
+			static xcb_query_extension_reply_t eglReply;
+			eglReply.present = 1;
+			reply = &eglReply;
+		}
+		else
+		{
+			xcb_connection_t *conn3D = _XGetXCBConnection(_dpy3D);
+			if(conn3D != NULL)
+				reply = _xcb_get_extension_data(conn3D, _xcb_glx_id());
+		}
 
 			stoptrace();
 			if(reply)
@@ -87,9 +98,14 @@ xcb_glx_query_version_cookie_t
 		opentrace(xcb_glx_query_version);  prargx(conn);  prargi(major_version);
 		prargi(minor_version);  starttrace();
 
-	xcb_connection_t *conn3D = _XGetXCBConnection(_dpy3D);
-	if(conn3D != NULL)
-		cookie = _xcb_glx_query_version(conn3D, major_version, minor_version);
+	// With the EGL back end, xcb_glx_query_version_reply() synthesizes the
+	// reply, so the cookie is unused.
+	if(!fconfig.egl)
+	{
+		xcb_connection_t *conn3D = _XGetXCBConnection(_dpy3D);
+		if(conn3D != NULL)
+			cookie = _xcb_glx_query_version(conn3D, major_version, minor_version);
+	}
 
 		stoptrace();  closetrace();
 
@@ -114,9 +130,23 @@ xcb_glx_query_version_reply_t *
 		opentrace(xcb_glx_query_version_reply);  prargx(conn);
 		starttrace();
 
-	xcb_connection_t *conn3D = _XGetXCBConnection(_dpy3D);
-	if(conn3D != NULL)
-		reply = _xcb_glx_query_version_reply(conn3D, cookie, error);
+	if(fconfig.egl)
+	{
+		// The reply is freed by the application, so it must be allocated with
+		// malloc().
+		if(error) *error = NULL;
+		if((reply = (xcb_glx_query_version_reply_t *)calloc(1,
+			sizeof(xcb_glx_query_version_reply_t))) != NULL)
+		{
+			reply->major_version = 1;  reply->minor_version = 4;
+		}
+	}
+	else
+	{
+		xcb_connection_t *conn3D = _XGetXCBConnection(_dpy3D);
+		if(conn3D != NULL)
+			reply = _xcb_glx_query_version_reply(conn3D, cookie, error);
+	}
 
 		stoptrace();
 		if(error)
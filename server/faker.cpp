@@ -24,8 +24,13 @@
 #include "ReverseConfigHash.h"
 #include "VisualHash.h"
 #include "WindowHash.h"
+#ifdef EGLBACKEND
+#include "ContextHashEGL.h"
+#include "PbufferHashEGL.h"
+#endif
 #include "fakerconfig.h"
 #include "threadlocal.h"
+#include "Tracer.h"
 #include <dlfcn.h>
 
 
@@ -52,6 +57,11 @@ static void cleanup(void)
 	if(GLXDrawableHash::isAlloc()) glxdhash.kill();
 	if(WindowHash::isAlloc()) winhash.kill();
 	if(DisplayHash::isAlloc()) dpyhash.kill();
+	#ifdef EGLBACKEND
+	if(PbufferHashEGL::isAlloc()) pbhashegl.kill();
+	if(ContextHashEGL::isAlloc()) ctxhashegl.kill();
+	#endif
+	glxvisual::cleanup();
 	unloadSymbols();
 }
 
@@ -129,6 +139,11 @@ void init(void)
 		fgetc(stdin);
 	}
 	if(fconfig.trapx11) XSetErrorHandler(xhandler);
+	// The readback threads (see VirtualWin::swapAndReadback()) use the 2D and
+	// 3D X server connections concurrently with the application's threads.
+	if(fconfig.asyncreadback) XInitThreads();
+	if(strlen(fconfig.tracefile) > 0)
+		vglcommon::Tracer::init(fconfig.tracefile);
 }
 
 
@@ -136,6 +151,9 @@ Display *init3D(void)
 {
 	init();
 
+	// With the EGL back end, there is no 3D X server.
+	if(fconfig.egl) return NULL;
+
 	if(!dpy3D)
 	{
 		GlobalCriticalSection::SafeLock l(globalMutex);
@@ -24,6 +24,8 @@
 #include "fakerconfig.h"
 #include "faker-sym.h"
 #include "Timer.h"
+#include "Tracer.h"
+#include "backend.h"
 
 
 namespace vglfaker
@@ -59,7 +61,7 @@ namespace vglfaker
 static INLINE int drawingToFront(void)
 {
 	GLint drawbuf = GL_BACK;
-	_glGetIntegerv(GL_DRAW_BUFFER, &drawbuf);
+	backend::getIntegerv(GL_DRAW_BUFFER, &drawbuf);
 	return isFront(drawbuf);
 }
 
@@ -67,7 +69,7 @@ static INLINE int drawingToFront(void)
 static INLINE int drawingToRight(void)
 {
 	GLint drawbuf = GL_LEFT;
-	_glGetIntegerv(GL_DRAW_BUFFER, &drawbuf);
+	backend::getIntegerv(GL_DRAW_BUFFER, &drawbuf);
 	return isRight(drawbuf);
 }
 
@@ -140,8 +142,13 @@ static INLINE int drawingToRight(void)
 }
 #endif
 
+// When VGL_TRACE=1, each interposed call is printed along with its arguments
+// and the time it took.  When VGL_TRACEFILE is set, the calls are instead
+// recorded by the binary tracer (see Tracer.h), which is much less intrusive.
+
 #define opentrace(f) \
 	double vglTraceTime = 0.; \
+	const char *vglTraceName = #f; \
 	if(fconfig.trace) \
 	{ \
 		if(vglfaker::getTraceLevel() > 0) \
@@ -156,9 +163,11 @@ static INLINE int drawingToRight(void)
 
 #define starttrace() \
 		vglTraceTime = getTime(); \
-	}
+	} \
+	else if(vglcommon::Tracer::isEnabled()) vglTraceTime = getTime();
 
 #define stoptrace() \
+	if(vglTraceTime > 0.) vglcommon::Tracer::record(vglTraceName, vglTraceTime); \
 	if(fconfig.trace) \
 	{ \
 		vglTraceTime = getTime() - vglTraceTime;
@@ -19,6 +19,7 @@
 #include "Log.h"
 #include "Mutex.h"
 #include "fakerconfig.h"
+#include "lossless.h"
 #include <stdio.h>
 #include <X11/keysym.h>
 #if FCONFIG_USESHM == 1
@@ -159,11 +160,14 @@ static void fconfig_init(void)
 	CriticalSection::SafeLock l(fcmutex);
 	memset(&fconfig, 0, sizeof(FakerConfig));
 	memset(&fconfig_env, 0, sizeof(FakerConfig));
+	fconfig.adaptive = 1;
 	fconfig.compress = -1;
 	strncpy(fconfig.config, VGLCONFIG_PATH, MAXSTR);
+	fconfig.copyrect = 1;
 	#if sun
 	fconfig.dlsymloader = true;
 	#endif
+	fconfig.effort = LL_DEFEFFORT;
 	#ifdef FAKEXCB
 	fconfig.fakeXCB = 1;
 	#endif
@@ -180,13 +184,16 @@ static void fconfig_init(void)
 	fconfig.probeglx = 1;
 	fconfig.qual = DEFQUAL;
 	fconfig.readback = RRREAD_PBO;
+	fconfig.refinequal = 0;
 	fconfig.refreshrate = 60.0;
 	fconfig.samples = -1;
 	fconfig.spoil = 1;
 	fconfig.spoillast = 1;
 	fconfig.stereo = RRSTEREO_QUADBUF;
+	fconfig.stereodelta = 1;
 	fconfig.subsamp = -1;
 	fconfig.tilesize = RR_DEFAULTTILESIZE;
+	fconfig.mintilesize = RR_DEFAULTMINTILESIZE;
 	fconfig.transpixel = -1;
 	fconfig_reloadenv();
 }
@@ -271,7 +278,9 @@ void fconfig_reloadenv(void)
 
 	CriticalSection::SafeLock l(fcmutex);
 
+	fetchenv_bool("VGL_ADAPTIVE", adaptive);
 	fetchenv_bool("VGL_ALLOWINDIRECT", allowindirect);
+	fetchenv_bool("VGL_ASYNCREADBACK", asyncreadback);
 	fetchenv_bool("VGL_AUTOTEST", autotest);
 	fetchenv_str("VGL_CLIENT", client);
 	if((env = getenv("VGL_SUBSAMP")) != NULL && strlen(env) > 0)
@@ -307,6 +316,7 @@ void fconfig_reloadenv(void)
 			compress = itemp;
 		else if(!strnicmp(env, "p", 1)) compress = RRCOMP_PROXY;
 		else if(!strnicmp(env, "j", 1)) compress = RRCOMP_JPEG;
+		else if(!strnicmp(env, "l", 1)) compress = RRCOMP_LOSSLESS;
 		else if(!strnicmp(env, "r", 1)) compress = RRCOMP_RGB;
 		else if(!strnicmp(env, "x", 1)) compress = RRCOMP_XV;
 		else if(!strnicmp(env, "y", 1)) compress = RRCOMP_YUV;
@@ -317,6 +327,7 @@ void fconfig_reloadenv(void)
 		}
 	}
 	fetchenv_str("VGL_CONFIG", config);
+	fetchenv_bool("VGL_COPYRECT", copyrect);
 	fetchenv_str("VGL_DEFAULTFBCONFIG", defaultfbconfig);
 	if((env = getenv("VGL_DISPLAY")) != NULL && strlen(env) > 0)
 	{
@@ -326,6 +337,10 @@ void fconfig_reloadenv(void)
 			strncpy(fconfig_env.localdpystring, env, MAXSTR - 1);
 		}
 	}
+	#ifdef EGLBACKEND
+	fconfig.egl = !strnicmp(fconfig.localdpystring, "egl", 3)
+		|| !strncmp(fconfig.localdpystring, "/dev/dri/", 9);
+	#endif
 	fetchenv_bool("VGL_DLSYM", dlsymloader);
 	if((env = getenv("VGL_DRAWABLE")) != NULL && strlen(env) > 0)
 	{
@@ -341,6 +356,10 @@ void fconfig_reloadenv(void)
 		if(drawable >= 0 && (!fconfig_envset || fconfig_env.drawable != drawable))
 			fconfig.drawable = fconfig_env.drawable = drawable;
 	}
+	fetchenv_int("VGL_EFFORT", effort, 0, LL_MAXEFFORT);
+	#ifdef EGLBACKEND
+	fetchenv_str("VGL_EGLLIB", egllib);
+	#endif
 	fetchenv_str("VGL_EXCLUDE", excludeddpys);
 	#ifdef FAKEXCB
 	fetchenv_bool("VGL_FAKEXCB", fakeXCB);
@@ -377,6 +396,7 @@ void fconfig_reloadenv(void)
 		}
 	}
 	fetchenv_bool("VGL_GLFLUSHTRIGGER", glflushtrigger);
+	fetchenv_bool("VGL_GPUCOMPOSITE", gpucomposite);
 	fetchenv_str("VGL_GLLIB", gllib);
 	fetchenv_str("VGL_GLXVENDOR", glxvendor);
 	fetchenv_str("VGL_GUI", guikeyseq);
@@ -410,6 +430,7 @@ void fconfig_reloadenv(void)
 	fetchenv_bool("VGL_INTERFRAME", interframe);
 	fetchenv_str("VGL_LOG", log);
 	fetchenv_bool("VGL_LOGO", logo);
+	fetchenv_int("VGL_MINTILESIZE", mintilesize, 8, 1024);
 	fetchenv_int("VGL_NPROCS", np, 1, min(numprocs(), MAXPROCS));
 	fetchenv_int("VGL_PORT", port, 0, 65535);
 	fetchenv_bool("VGL_PROBEGLX", probeglx);
@@ -429,6 +450,20 @@ void fconfig_reloadenv(void)
 		if(readback >= 0 && (!fconfig_envset || fconfig_env.readback != readback))
 			fconfig.readback = fconfig_env.readback = readback;
 	}
+	fetchenv_dbl("VGL_REFINE", refine, 0.0, 1000000.0);
+	if((env = getenv("VGL_REFINEQUAL")) != NULL && strlen(env) > 0)
+	{
+		int refinequal = -1;
+		if(!strnicmp(env, "L", 1)) refinequal = 0;
+		else
+		{
+			char *t = NULL;  int itemp = strtol(env, &t, 10);
+			if(t && t != env && itemp >= 1 && itemp <= 100) refinequal = itemp;
+		}
+		if(refinequal >= 0
+			&& (!fconfig_envset || fconfig_env.refinequal != refinequal))
+			fconfig.refinequal = fconfig_env.refinequal = refinequal;
+	}
 	fetchenv_dbl("VGL_REFRESHRATE", refreshrate, 0.0, 1000000.0);
 	fetchenv_int("VGL_SAMPLES", samples, 0, 64);
 	fetchenv_bool("VGL_SPOIL", spoil);
@@ -456,13 +491,16 @@ void fconfig_reloadenv(void)
 				fconfig.stereo = fconfig_env.stereo = stereo;
 		}
 	}
+	fetchenv_bool("VGL_STEREODELTA", stereodelta);
 	fetchenv_bool("VGL_SYNC", sync);
 	fetchenv_int("VGL_TILESIZE", tilesize, 8, 1024);
 	fetchenv_bool("VGL_TRACE", trace);
+	fetchenv_str("VGL_TRACEFILE", tracefile);
 	fetchenv_int("VGL_TRANSPIXEL", transpixel, 0, 255);
 	fetchenv_bool("VGL_TRAPX11", trapx11);
 	fetchenv_str("VGL_XVENDOR", vendor);
 	fetchenv_bool("VGL_VERBOSE", verbose);
+	fetchenv_str("VGL_VISUALCACHE", visualcache);
 	fetchenv_bool("VGL_WM", wm);
 	fetchenv_str("VGL_X11LIB", x11lib);
 	#ifdef FAKEXCB
@@ -592,13 +630,19 @@ void fconfig_setcompress(FakerConfig &fc, int i)
 
 void fconfig_print(FakerConfig &fc)
 {
+	prconfint(adaptive);
 	prconfint(allowindirect);
+	prconfint(asyncreadback);
 	prconfstr(client);
 	prconfint(compress);
 	prconfstr(config);
+	prconfint(copyrect);
 	prconfstr(defaultfbconfig);
 	prconfint(dlsymloader);
 	prconfint(drawable);
+	prconfint(effort);
+	prconfint(egl);
+	prconfstr(egllib);
 	prconfstr(excludeddpys);
 	prconfdbl(fps);
 	prconfdbl(flushdelay);
@@ -607,6 +651,7 @@ void fconfig_print(FakerConfig &fc)
 	prconfint(glflushtrigger);
 	prconfstr(gllib);
 	prconfstr(glxvendor);
+	prconfint(gpucomposite);
 	prconfint(gui);
 	prconfint(guikey);
 	prconfstr(guikeyseq);
@@ -615,19 +660,24 @@ void fconfig_print(FakerConfig &fc)
 	prconfstr(localdpystring);
 	prconfstr(log);
 	prconfint(logo);
+	prconfint(mintilesize);
 	prconfint(np);
 	prconfint(port);
 	prconfint(qual);
 	prconfint(readback);
+	prconfdbl(refine);
+	prconfint(refinequal);
 	prconfint(samples);
 	prconfint(spoil);
 	prconfint(spoillast);
 	prconfint(ssl);
 	prconfint(stereo);
+	prconfint(stereodelta);
 	prconfint(subsamp);
 	prconfint(sync);
 	prconfint(tilesize);
 	prconfint(trace);
+	prconfstr(tracefile);
 	prconfint(transpixel);
 	prconfint(transvalid[RRTRANS_X11]);
 	prconfint(transvalid[RRTRANS_VGL]);
@@ -635,6 +685,7 @@ void fconfig_print(FakerConfig &fc)
 	prconfint(trapx11);
 	prconfstr(vendor);
 	prconfint(verbose);
+	prconfstr(visualcache);
 	prconfint(wm);
 	prconfstr(x11lib);
 	#ifdef FAKEXCB
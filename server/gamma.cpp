@@ -0,0 +1,186 @@
+/* Copyright (C)2018 D. R. Commander
+ *
+ * This library is free software and may be redistributed and/or modified under
+ * the terms of the wxWindows Library License, Version 3.1 or (at your option)
+ * any later version.  The full license is in the LICENSE.txt file included
+ * with this distribution.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * wxWindows Library License for more details.
+ */
+
+#include "gamma.h"
+#include <string.h>
+#include "fakerconfig.h"
+
+#if (defined(__x86_64__) || defined(__i386__)) \
+	&& (defined(__clang__) || __GNUC__ > 4 || \
+		(__GNUC__ == 4 && __GNUC_MINOR__ >= 9))
+#define GAMMA_SIMD
+#include <immintrin.h>
+#endif
+
+
+#ifdef GAMMA_SIMD
+
+// The SIMD kernels use the same instruction set as the pixel format
+// conversion routines, so VGL_SIMD also affects them.
+
+enum { SIMD_UNKNOWN = -1, SIMD_NONE, SIMD_SSSE3, SIMD_AVX2 };
+static int simdLevel = SIMD_UNKNOWN;
+
+static int getSIMDLevel(void)
+{
+	if(simdLevel == SIMD_UNKNOWN)
+	{
+		const char *simd = pf_getsimd();
+		if(!strcmp(simd, "AVX2")) simdLevel = SIMD_AVX2;
+		else if(!strcmp(simd, "SSSE3")) simdLevel = SIMD_SSSE3;
+		else simdLevel = SIMD_NONE;
+	}
+	return simdLevel;
+}
+
+
+// 8-bit gamma correction without gathers.  The 256-entry lookup table is split
+// into 16 slices of 16 entries, each of which fits into a vector register and
+// can be indexed with a byte shuffle.  Subtracting 16 * k from a byte and then
+// adding 0x70 with unsigned saturation leaves the high bit of the result clear
+// (in which case the shuffle uses the low 4 bits as an index into slice k) if
+// and only if the byte falls within slice k.  Otherwise, the high bit is set,
+// and the shuffle returns 0.  Thus, ORing the results of the 16 shuffles
+// yields the table entry for each byte.
+
+__attribute__((target("ssse3")))
+static size_t gamma8_SSSE3(unsigned char *srcBits, unsigned char *dstBits,
+	size_t size)
+{
+	__m128i lut[16], offset = _mm_set1_epi8(0x70), step = _mm_set1_epi8(16);
+	size_t i;
+
+	for(int k = 0; k < 16; k++)
+		lut[k] = _mm_loadu_si128((__m128i *)&fconfig.gamma_lut[k * 16]);
+
+	for(i = 0; i + 16 <= size; i += 16)
+	{
+		__m128i v = _mm_loadu_si128((__m128i *)&srcBits[i]);
+		__m128i result = _mm_setzero_si128();
+		for(int k = 0; k < 16; k++)
+		{
+			result = _mm_or_si128(result,
+				_mm_shuffle_epi8(lut[k], _mm_adds_epu8(v, offset)));
+			v = _mm_sub_epi8(v, step);
+		}
+		_mm_storeu_si128((__m128i *)&dstBits[i], result);
+	}
+	return i;
+}
+
+
+__attribute__((target("avx2")))
+static size_t gamma8_AVX2(unsigned char *srcBits, unsigned char *dstBits,
+	size_t size)
+{
+	__m256i lut[16], offset = _mm256_set1_epi8(0x70),
+		step = _mm256_set1_epi8(16);
+	size_t i;
+
+	for(int k = 0; k < 16; k++)
+		lut[k] = _mm256_broadcastsi128_si256(
+			_mm_loadu_si128((__m128i *)&fconfig.gamma_lut[k * 16]));
+
+	for(i = 0; i + 32 <= size; i += 32)
+	{
+		__m256i v = _mm256_loadu_si256((__m256i *)&srcBits[i]);
+		__m256i result = _mm256_setzero_si256();
+		for(int k = 0; k < 16; k++)
+		{
+			result = _mm256_or_si256(result,
+				_mm256_shuffle_epi8(lut[k], _mm256_adds_epu8(v, offset)));
+			v = _mm256_sub_epi8(v, step);
+		}
+		_mm256_storeu_si256((__m256i *)&dstBits[i], result);
+	}
+	return i;
+}
+
+
+// 10-bit gamma correction.  The 1024-entry lookup table is too large for byte
+// shuffles, so each component of 8 pixels is looked up with a gather.  The
+// gathers read 32 bits at a time from the 16-bit table, and the upper 16 bits
+// are discarded.  (When looking up the last entry, those bits come from the
+// padding entry at the end of gamma_lut10.)
+
+__attribute__((target("avx2")))
+static size_t gamma10_AVX2(unsigned char *srcBits, unsigned char *dstBits,
+	size_t nPixels, PF *pf)
+{
+	__m128i rshift = _mm_cvtsi32_si128(pf->rshift);
+	__m128i gshift = _mm_cvtsi32_si128(pf->gshift);
+	__m128i bshift = _mm_cvtsi32_si128(pf->bshift);
+	__m256i mask = _mm256_set1_epi32(1023);
+	const int *lut = (const int *)fconfig.gamma_lut10;
+	size_t i;
+
+	for(i = 0; i + 8 <= nPixels; i += 8)
+	{
+		__m256i v = _mm256_loadu_si256((__m256i *)&srcBits[i * 4]);
+		__m256i r = _mm256_and_si256(_mm256_srl_epi32(v, rshift), mask);
+		__m256i g = _mm256_and_si256(_mm256_srl_epi32(v, gshift), mask);
+		__m256i b = _mm256_and_si256(_mm256_srl_epi32(v, bshift), mask);
+		r = _mm256_and_si256(_mm256_i32gather_epi32(lut, r, 2), mask);
+		g = _mm256_and_si256(_mm256_i32gather_epi32(lut, g, 2), mask);
+		b = _mm256_and_si256(_mm256_i32gather_epi32(lut, b, 2), mask);
+		v = _mm256_or_si256(_mm256_or_si256(_mm256_sll_epi32(r, rshift),
+			_mm256_sll_epi32(g, gshift)), _mm256_sll_epi32(b, bshift));
+		_mm256_storeu_si256((__m256i *)&dstBits[i * 4], v);
+	}
+	return i;
+}
+
+#endif  // GAMMA_SIMD
+
+
+void vglserver::applyGamma(unsigned char *srcBits, unsigned char *dstBits,
+	int pitch, int height, PF *pf)
+{
+	size_t size = (size_t)pitch * height, done = 0;
+
+	if(pf->bpc == 10)
+	{
+		size_t nPixels = size / 4;
+
+		#ifdef GAMMA_SIMD
+		if(getSIMDLevel() >= SIMD_AVX2)
+			done = gamma10_AVX2(srcBits, dstBits, nPixels, pf);
+		#endif
+
+		unsigned int *srcPixel = (unsigned int *)srcBits + done;
+		unsigned int *dstPixel = (unsigned int *)dstBits + done;
+		for(size_t i = done; i < nPixels; i++, srcPixel++, dstPixel++)
+		{
+			unsigned int r = fconfig.gamma_lut10[(*srcPixel >> pf->rshift) & 1023];
+			unsigned int g = fconfig.gamma_lut10[(*srcPixel >> pf->gshift) & 1023];
+			unsigned int b = fconfig.gamma_lut10[(*srcPixel >> pf->bshift) & 1023];
+			*dstPixel = (r << pf->rshift) | (g << pf->gshift) | (b << pf->bshift);
+		}
+	}
+	else
+	{
+		#ifdef GAMMA_SIMD
+		if(getSIMDLevel() >= SIMD_AVX2)
+			done = gamma8_AVX2(srcBits, dstBits, size);
+		else if(getSIMDLevel() >= SIMD_SSSE3)
+			done = gamma8_SSSE3(srcBits, dstBits, size);
+		#endif
+
+		unsigned short *srcPtr = (unsigned short *)&srcBits[done];
+		unsigned short *dstPtr = (unsigned short *)&dstBits[done];
+		for(size_t i = done; i + 2 <= size; i += 2)
+			*dstPtr++ = fconfig.gamma_lut16[*srcPtr++];
+		if((size - done) % 2 != 0)
+			dstBits[size - 1] = fconfig.gamma_lut[srcBits[size - 1]];
+	}
+}
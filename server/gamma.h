@@ -0,0 +1,32 @@
+/* Copyright (C)2018 D. R. Commander
+ *
+ * This library is free software and may be redistributed and/or modified under
+ * the terms of the wxWindows Library License, Version 3.1 or (at your option)
+ * any later version.  The full license is in the LICENSE.txt file included
+ * with this distribution.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * wxWindows Library License for more details.
+ */
+
+#ifndef __GAMMA_H__
+#define __GAMMA_H__
+
+#include "pf.h"
+
+
+namespace vglserver
+{
+	// Apply software gamma correction (using the lookup tables in fconfig) to a
+	// block of pixels and store the result in dstBits.  srcBits and dstBits can
+	// be the same, in which case the pixels are corrected in place.  Otherwise,
+	// the pixels are corrected while they are copied (for instance, from a
+	// mapped PBO), so that the frame is only traversed once.  The whole block
+	// (pitch * height bytes), including any padding, is processed.
+	void applyGamma(unsigned char *srcBits, unsigned char *dstBits, int pitch,
+		int height, PF *pf);
+}
+
+#endif  // __GAMMA_H__
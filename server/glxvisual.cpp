@@ -19,6 +19,10 @@
 #include "glxvisual.h"
 #include <stdio.h>
 #include <stdlib.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include "Error.h"
 #include "Mutex.h"
 #include "faker.h"
@@ -34,37 +38,290 @@ typedef struct
 	int transIndex, transRed, transGreen, transBlue, transAlpha;
 } VisAttrib;
 
-static Display *vaDisplay = NULL;
-static int vaScreen = -1, vaEntries = 0;
+// The attributes of the visuals on one screen of a 2D X server.  These tables
+// are built the first time that a particular display/screen is accessed, and
+// they are never modified afterward, so they can be read without holding a
+// lock.  The tables form a singly-linked list to which new tables are
+// prepended.  When a display is closed, its tables are unlinked from the list
+// but not freed, since another thread may be traversing them.
+
+typedef struct _VisAttribTable
+{
+	Display *dpy;  int screen;
+	VisAttrib *va;  int nVisuals;
+	VisAttrib *vaByID;  // Same as va, but sorted by visual ID
+	struct _VisAttribTable *next, *nextRetired;
+} VisAttribTable;
+
+static VisAttribTable *vaTables = NULL, *retiredTables = NULL;
 static CriticalSection vaMutex;
-static VisAttrib *va;
 
 
-static void buildVisAttribTable(Display *dpy, int screen)
+// The attributes of the 3D X server's FB configs that VirtualGL queries most
+// often, along with the depth and class of the X visual associated with each
+// FB config.  This table is built the first time that any FB config attribute
+// is requested, and it is sorted by FB config handle.
+
+static const int configAttribs[] =
 {
-	int clientGLX = 0, majorOpcode = -1, firstEvent = -1, firstError = -1,
-		nVisuals = 0;
-	XVisualInfo *visuals = NULL, vtemp;
+	GLX_FBCONFIG_ID, GLX_RED_SIZE, GLX_GREEN_SIZE, GLX_BLUE_SIZE,
+	GLX_ALPHA_SIZE, GLX_STEREO, GLX_DOUBLEBUFFER, GLX_RENDER_TYPE,
+	GLX_DRAWABLE_TYPE, GLX_X_VISUAL_TYPE, GLX_VISUAL_ID
+};
+#define NCONFIGATTRIBS  (int)(sizeof(configAttribs) / sizeof(int))
+
+typedef struct
+{
+	GLXFBConfig config;
+	int attribs[NCONFIGATTRIBS];
+	int depth, c_class;
+} ConfigAttrib;
+
+typedef struct
+{
+	ConfigAttrib *ca;  int nConfigs;
+} ConfigAttribTable;
+
+static ConfigAttribTable *caTable = NULL;
+
+
+static int compareVisualIDs(const void *arg1, const void *arg2)
+{
+	VisualID vid1 = ((VisAttrib *)arg1)->visualID,
+		vid2 = ((VisAttrib *)arg2)->visualID;
+	return vid1 < vid2 ? -1 : (vid1 > vid2 ? 1 : 0);
+}
+
+
+static void freeVisAttribTable(VisAttribTable *table)
+{
+	if(!table) return;
+	delete [] table->va;
+	delete [] table->vaByID;
+	delete table;
+}
+
+
+// Read the overlay and GLX attributes of the 2D X server's visuals, which
+// requires several round trips to the 2D X server (including the
+// initialization of GLX on the 2D X server, if it hasn't already been
+// initialized.)
+
+static void probeVisAttribs(Display *dpy, int screen, XVisualInfo *visuals,
+	VisAttrib *va, int nVisuals)
+{
+	int clientGLX = 0, majorOpcode = -1, firstEvent = -1, firstError = -1;
 	Atom atom = 0;
 	int len = 10000;
 
-	try
+	if(fconfig.probeglx
+		&& _XQueryExtension(dpy, "GLX", &majorOpcode, &firstEvent, &firstError)
+		&& majorOpcode >= 0 && firstEvent >= 0 && firstError >= 0)
+		clientGLX = 1;
+
+	if((atom = XInternAtom(dpy, "SERVER_OVERLAY_VISUALS", True)) != None)
+	{
+		struct overlay_info
+		{
+			unsigned long visualID;
+			long transType, transPixel, level;
+		} *olprop = NULL;
+		unsigned long nop = 0, bytesLeft = 0;
+		int actualFormat = 0;
+		Atom actualType = 0;
+
+		do
+		{
+			nop = 0;  actualFormat = 0;  actualType = 0;
+			unsigned char *olproptemp = NULL;
+			if(XGetWindowProperty(dpy, RootWindow(dpy, screen), atom, 0, len,
+				False, atom, &actualType, &actualFormat, &nop, &bytesLeft,
+				&olproptemp) != Success || nop < 4 || actualFormat != 32
+				|| actualType != atom)
+				goto done;
+			olprop = (struct overlay_info *)olproptemp;
+			len += (bytesLeft + 3) / 4;
+			if(bytesLeft && olprop) { XFree(olprop);  olprop = NULL; }
+		} while(bytesLeft);
+
+		for(unsigned long i = 0; i < nop / 4; i++)
+		{
+			for(int j = 0; j < nVisuals; j++)
+			{
+				if(olprop[i].visualID == va[j].visualID)
+				{
+					va[j].isTrans = 1;
+					if(olprop[i].transType == 1)  // Transparent pixel
+						va[j].transIndex = olprop[i].transPixel;
+					else if(olprop[i].transType == 2)  // Transparent mask
+					{
+						// Is this right??
+						va[j].transRed = olprop[i].transPixel & 0xFF;
+						va[j].transGreen = olprop[i].transPixel & 0x00FF;
+						va[j].transBlue = olprop[i].transPixel & 0x0000FF;
+						va[j].transAlpha = olprop[i].transPixel & 0x000000FF;
+					}
+					va[j].level = olprop[i].level;
+				}
+			}
+		}
+
+		done:
+		if(olprop) { XFree(olprop);  olprop = NULL; }
+	}
+
+	for(int i = 0; i < nVisuals; i++)
 	{
-		CriticalSection::SafeLock l(vaMutex);
+		if(clientGLX)
+		{
+			_glXGetConfig(dpy, &visuals[i], GLX_DOUBLEBUFFER, &va[i].isDB);
+			_glXGetConfig(dpy, &visuals[i], GLX_USE_GL, &va[i].isGL);
+			_glXGetConfig(dpy, &visuals[i], GLX_STEREO, &va[i].isStereo);
+		}
+	}
+}
+
 
-		if(dpy == vaDisplay && screen == vaScreen) return;
-		if(fconfig.probeglx
-			&& _XQueryExtension(dpy, "GLX", &majorOpcode, &firstEvent, &firstError)
-			&& majorOpcode >= 0 && firstEvent >= 0 && firstError >= 0)
-			clientGLX = 1;
+// If VGL_VISUALCACHE is set, then the probed visual attributes for each 2D X
+// server screen are stored in a file under the specified directory, so that
+// subsequent VirtualGL processes can skip the probing round trips.  The cache
+// is validated against the display name, the X server vendor and release, and
+// the ID, depth, and class of every visual on the screen, all of which Xlib
+// obtains when the display is opened.  Thus, loading the cache requires no
+// round trips to the 2D X server.
+
+#define VACACHE_MAGIC  "VGLVA001"
+
+typedef struct
+{
+	char magic[8];
+	int entrySize, vendorRelease, screen, probeGLX, nVisuals;
+	char dpyString[256], vendor[256];
+} VisAttribCacheHeader;
+
+
+static bool getVisAttribCacheHeader(Display *dpy, int screen, int nVisuals,
+	VisAttribCacheHeader &header, char *fileName, int fileNameLen)
+{
+	const char *vendor = ServerVendor(dpy);
+	unsigned int hash = 2166136261U;
+
+	if(strlen(fconfig.visualcache) < 1) return false;
+
+	memset(&header, 0, sizeof(VisAttribCacheHeader));
+	memcpy(header.magic, VACACHE_MAGIC, 8);
+	header.entrySize = sizeof(VisAttrib);
+	header.vendorRelease = VendorRelease(dpy);
+	header.screen = screen;
+	header.probeGLX = fconfig.probeglx;
+	header.nVisuals = nVisuals;
+	strncpy(header.dpyString, DisplayString(dpy), 255);
+	if(vendor) strncpy(header.vendor, vendor, 255);
+
+	// The file name is derived from an FNV-1a hash of the display name and
+	// screen number.
+	for(char *ptr = header.dpyString; *ptr; ptr++)
+		hash = (hash ^ (unsigned char)*ptr) * 16777619U;
+	hash = (hash ^ (unsigned int)screen) * 16777619U;
+	snprintf(fileName, fileNameLen, "%s/visattribs-%.8x", fconfig.visualcache,
+		hash);
+	return true;
+}
+
+
+static bool loadVisAttribCache(Display *dpy, int screen, VisAttrib *va,
+	int nVisuals)
+{
+	VisAttribCacheHeader header;  char fileName[MAXSTR + 32];
+	size_t size = sizeof(VisAttribCacheHeader) + sizeof(VisAttrib) * nVisuals;
+	struct stat sb;
+	bool retval = true;
+
+	if(!getVisAttribCacheHeader(dpy, screen, nVisuals, header, fileName,
+		MAXSTR + 32))
+		return false;
+
+	int fd = open(fileName, O_RDONLY);
+	if(fd == -1) return false;
+	if(fstat(fd, &sb) == -1 || (size_t)sb.st_size != size)
+	{
+		close(fd);  return false;
+	}
+	void *map = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if(map == MAP_FAILED) return false;
+
+	VisAttrib *cachedVA =
+		(VisAttrib *)((char *)map + sizeof(VisAttribCacheHeader));
+	if(memcmp(map, &header, sizeof(VisAttribCacheHeader))) retval = false;
+	for(int i = 0; i < nVisuals && retval; i++)
+	{
+		if(cachedVA[i].visualID != va[i].visualID
+			|| cachedVA[i].depth != va[i].depth
+			|| cachedVA[i].c_class != va[i].c_class)
+			retval = false;
+	}
+	if(retval) memcpy(va, cachedVA, sizeof(VisAttrib) * nVisuals);
+	munmap(map, size);
+
+	if(retval && fconfig.verbose)
+		vglout.println("[VGL] Using cached visual attributes for %s, screen %d",
+			DisplayString(dpy), screen);
+	return retval;
+}
+
+
+static void saveVisAttribCache(Display *dpy, int screen, VisAttrib *va,
+	int nVisuals)
+{
+	VisAttribCacheHeader header;
+	char fileName[MAXSTR + 32], tempName[MAXSTR + 40];
+
+	if(!getVisAttribCacheHeader(dpy, screen, nVisuals, header, fileName,
+		MAXSTR + 32))
+		return;
+
+	// Write the cache to a temporary file and then rename it, so other
+	// processes never see a partially-written cache.
+	mkdir(fconfig.visualcache, 0700);
+	snprintf(tempName, MAXSTR + 40, "%s.XXXXXX", fileName);
+	int fd = mkstemp(tempName);
+	if(fd == -1) return;
+	bool success =
+		write(fd, &header, sizeof(VisAttribCacheHeader))
+			== (ssize_t)sizeof(VisAttribCacheHeader)
+		&& write(fd, va, sizeof(VisAttrib) * nVisuals)
+			== (ssize_t)(sizeof(VisAttrib) * nVisuals);
+	close(fd);
+	if(!success || rename(tempName, fileName) == -1)
+	{
+		unlink(tempName);
+		if(fconfig.verbose)
+			vglout.println("[VGL] WARNING: Could not write visual attribute cache %s",
+				fileName);
+	}
+}
+
+
+static VisAttribTable *buildVisAttribTable(Display *dpy, int screen)
+{
+	int nVisuals = 0;
+	XVisualInfo *visuals = NULL, vtemp;
+	VisAttribTable *table = NULL;
+	VisAttrib *va = NULL;
+
+	try
+	{
 		vtemp.screen = screen;
 		if(!(visuals = XGetVisualInfo(dpy, VisualScreenMask, &vtemp, &nVisuals))
 			|| nVisuals == 0)
 			_throw("No visuals found on display");
 
-		if(va) { delete [] va;  va = NULL; }
-		_newcheck(va = new VisAttrib[nVisuals]);
-		vaEntries = nVisuals;
+		_newcheck(table = new VisAttribTable);
+		memset(table, 0, sizeof(VisAttribTable));
+		table->dpy = dpy;  table->screen = screen;
+		_newcheck(va = table->va = new VisAttrib[nVisuals]);
+		table->nVisuals = nVisuals;
 		memset(va, 0, sizeof(VisAttrib) * nVisuals);
 
 		for(int i = 0; i < nVisuals; i++)
@@ -74,76 +331,132 @@ static void buildVisAttribTable(Display *dpy, int screen)
 			va[i].c_class = visuals[i].c_class;
 		}
 
-		if((atom = XInternAtom(dpy, "SERVER_OVERLAY_VISUALS", True)) != None)
+		if(!loadVisAttribCache(dpy, screen, va, nVisuals))
 		{
-			struct overlay_info
-			{
-				unsigned long visualID;
-				long transType, transPixel, level;
-			} *olprop = NULL;
-			unsigned long nop = 0, bytesLeft = 0;
-			int actualFormat = 0;
-			Atom actualType = 0;
-
-			do
-			{
-				nop = 0;  actualFormat = 0;  actualType = 0;
-				unsigned char *olproptemp = NULL;
-				if(XGetWindowProperty(dpy, RootWindow(dpy, screen), atom, 0, len,
-					False, atom, &actualType, &actualFormat, &nop, &bytesLeft,
-					&olproptemp) != Success || nop < 4 || actualFormat != 32
-					|| actualType != atom)
-					goto done;
-				olprop = (struct overlay_info *)olproptemp;
-				len += (bytesLeft + 3) / 4;
-				if(bytesLeft && olprop) { XFree(olprop);  olprop = NULL; }
-			} while(bytesLeft);
-
-			for(unsigned long i = 0; i < nop / 4; i++)
-			{
-				for(int j = 0; j < nVisuals; j++)
-				{
-					if(olprop[i].visualID == va[j].visualID)
-					{
-						va[j].isTrans = 1;
-						if(olprop[i].transType == 1)  // Transparent pixel
-							va[j].transIndex = olprop[i].transPixel;
-						else if(olprop[i].transType == 2)  // Transparent mask
-						{
-							// Is this right??
-							va[j].transRed = olprop[i].transPixel & 0xFF;
-							va[j].transGreen = olprop[i].transPixel & 0x00FF;
-							va[j].transBlue = olprop[i].transPixel & 0x0000FF;
-							va[j].transAlpha = olprop[i].transPixel & 0x000000FF;
-						}
-						va[j].level = olprop[i].level;
-					}
-				}
-			}
-
-			done:
-			if(olprop) { XFree(olprop);  olprop = NULL; }
+			probeVisAttribs(dpy, screen, visuals, va, nVisuals);
+			saveVisAttribCache(dpy, screen, va, nVisuals);
 		}
+		XFree(visuals);  visuals = NULL;
 
-		for(int i = 0; i < nVisuals; i++)
+		// The visuals are kept in the order in which the X server returned them,
+		// since matchVisual2D() returns the first match.
+		_newcheck(table->vaByID = new VisAttrib[nVisuals]);
+		memcpy(table->vaByID, va, sizeof(VisAttrib) * nVisuals);
+		qsort(table->vaByID, nVisuals, sizeof(VisAttrib), compareVisualIDs);
+	}
+	catch(...)
+	{
+		if(visuals) XFree(visuals);
+		freeVisAttribTable(table);
+		throw;
+	}
+	return table;
+}
+
+
+// Return the visual attribute table for the given display and screen, building
+// it if necessary.  Only the first call for a particular display/screen will
+// result in a round trip to the 2D X server.
+
+static VisAttribTable *getVisAttribTable(Display *dpy, int screen)
+{
+	VisAttribTable *table;
+
+	for(table = __atomic_load_n(&vaTables, __ATOMIC_ACQUIRE); table;
+		table = __atomic_load_n(&table->next, __ATOMIC_ACQUIRE))
+	{
+		if(table->dpy == dpy && table->screen == screen) return table;
+	}
+
+	CriticalSection::SafeLock l(vaMutex);
+
+	for(table = vaTables; table; table = table->next)
+	{
+		if(table->dpy == dpy && table->screen == screen) return table;
+	}
+	table = buildVisAttribTable(dpy, screen);
+	table->next = vaTables;
+	__atomic_store_n(&vaTables, table, __ATOMIC_RELEASE);
+	return table;
+}
+
+
+static VisAttrib *findVisAttrib(VisAttribTable *table, VisualID vid)
+{
+	VisAttrib key;
+
+	key.visualID = vid;
+	return (VisAttrib *)bsearch(&key, table->vaByID, table->nVisuals,
+		sizeof(VisAttrib), compareVisualIDs);
+}
+
+
+static int compareConfigs(const void *arg1, const void *arg2)
+{
+	GLXFBConfig config1 = ((ConfigAttrib *)arg1)->config,
+		config2 = ((ConfigAttrib *)arg2)->config;
+	return config1 < config2 ? -1 : (config1 > config2 ? 1 : 0);
+}
+
+
+static ConfigAttribTable *getConfigAttribTable(void)
+{
+	ConfigAttribTable *table = __atomic_load_n(&caTable, __ATOMIC_ACQUIRE);
+	GLXFBConfig *configs = NULL;  int nConfigs = 0;
+
+	if(table) return table;
+
+	CriticalSection::SafeLock l(vaMutex);
+
+	if(caTable) return caTable;
+	try
+	{
+		_newcheck(table = new ConfigAttribTable);
+		memset(table, 0, sizeof(ConfigAttribTable));
+		configs = backend::getFBConfigs(&nConfigs);
+		if(configs && nConfigs > 0)
 		{
-			if(clientGLX)
+			_newcheck(table->ca = new ConfigAttrib[nConfigs]);
+			memset(table->ca, 0, sizeof(ConfigAttrib) * nConfigs);
+			table->nConfigs = nConfigs;
+			for(int i = 0; i < nConfigs; i++)
 			{
-				_glXGetConfig(dpy, &visuals[i], GLX_DOUBLEBUFFER, &va[i].isDB);
-				_glXGetConfig(dpy, &visuals[i], GLX_USE_GL, &va[i].isGL);
-				_glXGetConfig(dpy, &visuals[i], GLX_STEREO, &va[i].isStereo);
+				ConfigAttrib *ca = &table->ca[i];
+				ca->config = configs[i];
+				for(int j = 0; j < NCONFIGATTRIBS; j++)
+					backend::getFBConfigAttrib(configs[i], configAttribs[j],
+						&ca->attribs[j]);
+				XVisualInfo *vis = backend::getVisualFromFBConfig(configs[i]);
+				if(vis)
+				{
+					ca->depth = vis->depth;  ca->c_class = vis->c_class;
+					XFree(vis);
+				}
 			}
+			qsort(table->ca, nConfigs, sizeof(ConfigAttrib), compareConfigs);
 		}
-
-		vaDisplay = dpy;  vaScreen = screen;
+		if(configs) { XFree(configs);  configs = NULL; }
 	}
 	catch(...)
 	{
-		if(visuals) XFree(visuals);
-		if(va) { delete [] va;  va = NULL; }
-		vaDisplay = NULL;  vaScreen = -1;  vaEntries = 0;
+		if(configs) XFree(configs);
+		if(table) { delete [] table->ca;  delete table; }
 		throw;
 	}
+	__atomic_store_n(&caTable, table, __ATOMIC_RELEASE);
+	return table;
+}
+
+
+static ConfigAttrib *findConfigAttrib(GLXFBConfig config)
+{
+	ConfigAttribTable *table = getConfigAttribTable();
+	ConfigAttrib key;
+
+	if(!config || !table->nConfigs) return NULL;
+	key.config = config;
+	return (ConfigAttrib *)bsearch(&key, table->ca, table->nConfigs,
+		sizeof(ConfigAttrib), compareConfigs);
 }
 
 
@@ -277,70 +590,59 @@ GLXFBConfig *configsFromVisAttribs(const int attribs[], int &c_class,
 
 	if(fconfig.trace) prargal13(glxattribs);
 
-	return _glXChooseFBConfig(_dpy3D, DefaultScreen(_dpy3D), glxattribs,
-		&nElements);
+	return backend::chooseFBConfig(glxattribs, &nElements);
 }
 
 
 int visAttrib2D(Display *dpy, int screen, VisualID vid, int attribute)
 {
-	buildVisAttribTable(dpy, screen);
+	VisAttrib *va = findVisAttrib(getVisAttribTable(dpy, screen), vid);
 
-	for(int i = 0; i < vaEntries; i++)
+	if(va)
 	{
-		if(va[i].visualID == vid)
+		if(attribute == GLX_LEVEL) return va->level;
+		if(attribute == GLX_TRANSPARENT_TYPE)
 		{
-			if(attribute == GLX_LEVEL) return va[i].level;
-			if(attribute == GLX_TRANSPARENT_TYPE)
-			{
-				if(va[i].isTrans)
-				{
-					if(va[i].c_class == TrueColor || va[i].c_class == DirectColor)
-						return GLX_TRANSPARENT_RGB;
-					else return GLX_TRANSPARENT_INDEX;
-				}
-				else return GLX_NONE;
-			}
-			if(attribute == GLX_TRANSPARENT_INDEX_VALUE)
-			{
-				if(fconfig.transpixel >= 0) return fconfig.transpixel;
-				else return va[i].transIndex;
-			}
-			if(attribute == GLX_TRANSPARENT_RED_VALUE) return va[i].transRed;
-			if(attribute == GLX_TRANSPARENT_GREEN_VALUE) return va[i].transGreen;
-			if(attribute == GLX_TRANSPARENT_BLUE_VALUE) return va[i].transBlue;
-			if(attribute == GLX_TRANSPARENT_ALPHA_VALUE) return va[i].transAlpha;
-			if(attribute == GLX_STEREO)
+			if(va->isTrans)
 			{
-				return va[i].isStereo && va[i].isGL && va[i].isDB;
+				if(va->c_class == TrueColor || va->c_class == DirectColor)
+					return GLX_TRANSPARENT_RGB;
+				else return GLX_TRANSPARENT_INDEX;
 			}
-			if(attribute == GLX_X_VISUAL_TYPE) return va[i].c_class;
+			else return GLX_NONE;
+		}
+		if(attribute == GLX_TRANSPARENT_INDEX_VALUE)
+		{
+			if(fconfig.transpixel >= 0) return fconfig.transpixel;
+			else return va->transIndex;
 		}
+		if(attribute == GLX_TRANSPARENT_RED_VALUE) return va->transRed;
+		if(attribute == GLX_TRANSPARENT_GREEN_VALUE) return va->transGreen;
+		if(attribute == GLX_TRANSPARENT_BLUE_VALUE) return va->transBlue;
+		if(attribute == GLX_TRANSPARENT_ALPHA_VALUE) return va->transAlpha;
+		if(attribute == GLX_STEREO)
+		{
+			return va->isStereo && va->isGL && va->isDB;
+		}
+		if(attribute == GLX_X_VISUAL_TYPE) return va->c_class;
 	}
 	return 0;
 }
 
 
-int visAttrib3D(GLXFBConfig config, int attribute)
-{
-	int value = 0;
-	_glXGetFBConfigAttrib(_dpy3D, config, attribute, &value);
-	return value;
-}
-
-
 VisualID matchVisual2D(Display *dpy, int screen, int depth, int c_class,
 	int level, int stereo, int trans)
 {
 	int i, tryStereo;
 	if(!dpy) return 0;
 
-	buildVisAttribTable(dpy, screen);
+	VisAttribTable *table = getVisAttribTable(dpy, screen);
+	VisAttrib *va = table->va;
 
 	// Try to find an exact match
 	for(tryStereo = 1; tryStereo >= 0; tryStereo--)
 	{
-		for(i = 0; i < vaEntries; i++)
+		for(i = 0; i < table->nVisuals; i++)
 		{
 			int match = 1;
 			if(va[i].c_class != c_class) match = 0;
@@ -364,6 +666,110 @@ VisualID matchVisual2D(Display *dpy, int screen, int depth, int c_class,
 }
 
 
+VisualID matchVisual2D(Display *dpy, int screen, GLXFBConfig config)
+{
+	VisualID vid = 0;
+	int depth = 0, c_class = 0;
+
+	if(!dpy || !config || !visInfo3D(config, depth, c_class)) return 0;
+	int stereo = visAttrib3D(config, GLX_STEREO);
+
+	// We first try to match the FB config with a 2D X Server visual that has
+	// the same class, depth, and stereo properties.
+	if(depth >= 24 && (c_class == TrueColor || c_class == DirectColor))
+		vid = matchVisual2D(dpy, screen, depth, c_class, 0, stereo, 0);
+	// Failing that, we try to find a TrueColor visual with the same stereo
+	// properties, using the default depth of the 2D X server.
+	if(!vid)
+		vid = matchVisual2D(dpy, screen, DefaultDepth(dpy, screen), TrueColor, 0,
+			stereo, 0);
+	// Failing that, we try to find a TrueColor mono visual.
+	if(!vid)
+		vid = matchVisual2D(dpy, screen, DefaultDepth(dpy, screen), TrueColor, 0,
+			0, 0);
+	return vid;
+}
+
+
+int visAttrib3D(GLXFBConfig config, int attribute)
+{
+	ConfigAttrib *ca = findConfigAttrib(config);
+	int value = 0;
+
+	if(ca)
+	{
+		for(int i = 0; i < NCONFIGATTRIBS; i++)
+			if(configAttribs[i] == attribute) return ca->attribs[i];
+	}
+	backend::getFBConfigAttrib(config, attribute, &value);
+	return value;
+}
+
+
+bool visInfo3D(GLXFBConfig config, int &depth, int &c_class)
+{
+	ConfigAttrib *ca = findConfigAttrib(config);
+
+	depth = c_class = 0;
+	if(ca)
+	{
+		depth = ca->depth;  c_class = ca->c_class;
+	}
+	else if(config)
+	{
+		XVisualInfo *vis = backend::getVisualFromFBConfig(config);
+		if(vis)
+		{
+			depth = vis->depth;  c_class = vis->c_class;
+			XFree(vis);
+		}
+	}
+	return depth > 0;
+}
+
+
+void removeDisplay(Display *dpy)
+{
+	CriticalSection::SafeLock l(vaMutex);
+	VisAttribTable **prev = &vaTables;
+
+	while(*prev)
+	{
+		VisAttribTable *table = *prev;
+		if(table->dpy == dpy)
+		{
+			// Another thread may be traversing the list, so leave table->next
+			// intact.
+			__atomic_store_n(prev, table->next, __ATOMIC_RELEASE);
+			table->nextRetired = retiredTables;
+			retiredTables = table;
+		}
+		else prev = &table->next;
+	}
+}
+
+
+void cleanup(void)
+{
+	CriticalSection::SafeLock l(vaMutex);
+	VisAttribTable *table = vaTables, *next;
+
+	for(; table; table = next)
+	{
+		next = table->next;  freeVisAttribTable(table);
+	}
+	for(table = retiredTables; table; table = next)
+	{
+		next = table->nextRetired;  freeVisAttribTable(table);
+	}
+	vaTables = retiredTables = NULL;
+	if(caTable)
+	{
+		delete [] caTable->ca;  delete caTable;  caTable = NULL;
+	}
+}
+
+
 XVisualInfo *visualFromID(Display *dpy, int screen, VisualID vid)
 {
 	XVisualInfo vtemp;  int n = 0;
@@ -31,8 +31,9 @@ namespace glxvisual
 
 	// These functions return attributes for visuals on the 2D X server (those
 	// attributes are read from the 2D X server and cached on first access, so
-	// only the first call to any of these will result in a round trip to the
-	// 2D X server.)
+	// only the first call to any of these for a given display and screen will
+	// result in a round trip to the 2D X server.  Subsequent calls do not
+	// acquire any locks.)
 	int visAttrib2D(Display *dpy, int screen, VisualID vid, int attribute);
 
 	// This function finds a 2D X server visual that matches the given
@@ -42,9 +43,24 @@ namespace glxvisual
 	VisualID matchVisual2D(Display *dpy, int screen, int depth, int c_class,
 		int level, int stereo, int trans);
 
-	// Simple helper function that obtains an attribute for a GLXFBConfig on the
-	// 3D X server.
+	// This function finds a 2D X server visual with the same class, depth, and
+	// stereo properties as the given FB config on the 3D X server (or the
+	// closest approximation thereof.)
+	VisualID matchVisual2D(Display *dpy, int screen, GLXFBConfig config);
+
+	// These functions obtain an attribute for a GLXFBConfig on the 3D X server
+	// and the depth and class of the X visual associated with a GLXFBConfig
+	// (visInfo3D() returns false if there is no such visual.)  The most
+	// commonly-used attributes of all FB configs are read and cached on first
+	// access.
 	int visAttrib3D(GLXFBConfig config, int attribute);
+	bool visInfo3D(GLXFBConfig config, int &depth, int &c_class);
+
+	// Discard the cached visual attributes for a display that is being closed
+	void removeDisplay(Display *dpy);
+
+	// Free all cached attributes
+	void cleanup(void);
 
 	// This is just a convenience wrapper for XGetVisualInfo()
 	XVisualInfo *visualFromID(Display *dpy, int screen, VisualID vid);
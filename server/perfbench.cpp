@@ -0,0 +1,672 @@
+/* Copyright (C)2018 D. R. Commander
+ *
+ * This library is free software and may be redistributed and/or modified under
+ * the terms of the wxWindows Library License, Version 3.1 or (at your option)
+ * any later version.  The full license is in the LICENSE.txt file included
+ * with this distribution.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * wxWindows Library License for more details.
+ */
+
+/* This program measures the throughput of the CPU-bound kernels in VirtualGL's
+   image pipeline (pixel format conversion, gamma correction, stereo
+   generation, inter-frame comparison, encoding and decoding, queueing, and
+   sending), optionally writes the results as JSON, and optionally compares
+   the results against a baseline JSON file written by a previous run, so
+   that performance regressions can be detected automatically.  All results
+   are rates, so higher is better. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <X11/Xlib.h>
+#include "Frame.h"
+#include "GenericQ.h"
+#include "Socket.h"
+#include "Thread.h"
+#include "Timer.h"
+#include "fakerconfig.h"
+#include "gamma.h"
+#include "vglutil.h"
+
+using namespace vglutil;
+using namespace vglcommon;
+using namespace vglserver;
+
+
+#define MAXRESULTS  256
+#define NAMELEN  64
+
+int benchWidth = 1920, benchHeight = 1080;
+double benchTime = 1.0, threshold = 10.;
+const char *filter = NULL;
+Display *dpy = NULL;  Window win = 0;
+
+typedef struct
+{
+	char name[NAMELEN];
+	const char *unit;
+	double value;
+} Result;
+
+Result results[MAXRESULTS], baseline[MAXRESULTS];
+int nResults = 0, nBaseline = 0, nRegressions = 0;
+
+
+// Each benchmark runs one iteration of a kernel in run() and returns the
+// amount of work (pixels or bytes) that the iteration performed.
+
+class Bench
+{
+	public:
+
+		Bench(const char *name_, const char *unit_) : name(name_), unit(unit_) {}
+		virtual ~Bench(void) {}
+		virtual double run(void) = 0;
+
+		// Run the kernel repeatedly for benchTime seconds (after one warm-up
+		// iteration) and return the amount of work per second, in millions
+		double measure(void)
+		{
+			double work = 0., start, elapsed;
+
+			run();
+			start = getTime();
+			do
+			{
+				work += run();
+			} while((elapsed = getTime() - start) < benchTime);
+			return work / 1000000. / elapsed;
+		}
+
+		const char *name, *unit;
+};
+
+
+void report(const char *name, const char *unit, double value)
+{
+	printf("%-36s %10.2f %-10s", name, value, unit);
+	for(int i = 0; i < nBaseline; i++)
+	{
+		if(strcmp(baseline[i].name, name) || baseline[i].value <= 0.) continue;
+		double change = (value - baseline[i].value) / baseline[i].value * 100.;
+		printf(" %+7.1f%%", change);
+		if(change < -threshold)
+		{
+			printf("  REGRESSION");  nRegressions++;
+		}
+		break;
+	}
+	printf("\n");
+	if(nResults < MAXRESULTS)
+	{
+		snprintf(results[nResults].name, NAMELEN, "%s", name);
+		results[nResults].unit = unit;
+		results[nResults++].value = value;
+	}
+}
+
+
+void runBench(Bench &bench)
+{
+	if(filter && !strstr(bench.name, filter)) return;
+	try
+	{
+		report(bench.name, bench.unit, bench.measure());
+	}
+	catch(Error &e)
+	{
+		printf("%-36s FAILED: %s\n", bench.name, e.getMessage());
+	}
+}
+
+
+void skipBench(const char *name, const char *reason)
+{
+	if(filter && !strstr(name, filter)) return;
+	printf("%-36s skipped (%s)\n", name, reason);
+}
+
+
+// Fill a buffer with a pattern that is somewhat representative of 3D
+// application output (smooth gradients with a small amount of noise), so that
+// the encoders do a realistic amount of work
+
+void initBuf(unsigned char *buf, int width, int pitch, int height, PF *pf)
+{
+	unsigned int seed = 1;
+
+	for(int y = 0; y < height; y++)
+	{
+		unsigned char *pixel = &buf[pitch * y];
+		for(int x = 0; x < width; x++, pixel += pf->size)
+		{
+			seed = seed * 1103515245 + 12345;
+			int noise = (seed >> 16) & 15;
+			int maxval = (1 << pf->bpc) - 1;
+			pf->setRGB(pixel, (x * maxval / width + noise) & maxval,
+				(y * maxval / height + noise) & maxval,
+				((x + y) * maxval / (width + height)) & maxval);
+		}
+	}
+}
+
+
+void initFrame(Frame &f, int pixelFormat, bool stereo = false)
+{
+	rrframeheader hdr;
+
+	memset(&hdr, 0, sizeof(rrframeheader));
+	hdr.width = hdr.framew = benchWidth;
+	hdr.height = hdr.frameh = benchHeight;
+	hdr.qual = fconfig.qual;  hdr.subsamp = fconfig.subsamp;
+	f.init(hdr, pixelFormat, FRAME_BOTTOMUP, stereo);
+	if(pixelFormat == PF_COMP)
+		memset(f.bits, 0x80, f.pitch * benchHeight);
+	else
+	{
+		initBuf(f.bits, benchWidth, f.pitch, benchHeight, f.pf);
+		if(stereo) initBuf(f.rbits, benchWidth, f.pitch, benchHeight, f.pf);
+	}
+}
+
+
+class ConvertBench : public Bench
+{
+	public:
+
+		ConvertBench(int srcFormat, int dstFormat) :
+			Bench(name, "Mpixels/s"), srcpf(pf_get(srcFormat)),
+			dstpf(pf_get(dstFormat))
+		{
+			snprintf(name, NAMELEN, "convert/%s->%s", srcpf->name, dstpf->name);
+			srcPitch = benchWidth * srcpf->size;
+			dstPitch = benchWidth * dstpf->size;
+			_newcheck(src = new unsigned char[srcPitch * benchHeight]);
+			_newcheck(dst = new unsigned char[dstPitch * benchHeight]);
+			initBuf(src, benchWidth, srcPitch, benchHeight, srcpf);
+		}
+
+		~ConvertBench(void) { delete [] src;  delete [] dst; }
+
+		double run(void)
+		{
+			srcpf->convert(src, benchWidth, srcPitch, benchHeight, dst, dstPitch,
+				dstpf);
+			return (double)benchWidth * benchHeight;
+		}
+
+	private:
+
+		char name[NAMELEN];
+		PF *srcpf, *dstpf;
+		unsigned char *src, *dst;
+		int srcPitch, dstPitch;
+};
+
+
+// If copy is true, then this measures gamma correction fused with copying the
+// frame (as happens when the frame is read back using a PBO.)
+
+class GammaBench : public Bench
+{
+	public:
+
+		GammaBench(const char *name, int pixelFormat, bool copy_ = false) :
+			Bench(name, "Mpixels/s"), copy(copy_)
+		{
+			initFrame(f, pixelFormat);
+			if(copy) initFrame(dst, pixelFormat);
+		}
+
+		double run(void)
+		{
+			applyGamma(f.bits, copy ? dst.bits : f.bits, f.pitch, benchHeight,
+				f.pf);
+			return (double)benchWidth * benchHeight;
+		}
+
+	private:
+
+		Frame f, dst;
+		bool copy;
+};
+
+
+class AnaglyphBench : public Bench
+{
+	public:
+
+		AnaglyphBench(void) : Bench("stereo/anaglyph", "Mpixels/s")
+		{
+			initFrame(f, PF_BGRX);
+			initFrame(r, PF_COMP);  initFrame(g, PF_COMP);  initFrame(b, PF_COMP);
+		}
+
+		double run(void)
+		{
+			f.makeAnaglyph(r, g, b);
+			return (double)benchWidth * benchHeight;
+		}
+
+	private:
+
+		Frame f, r, g, b;
+};
+
+
+class PassiveBench : public Bench
+{
+	public:
+
+		PassiveBench(const char *name, int mode_) : Bench(name, "Mpixels/s"),
+			mode(mode_)
+		{
+			initFrame(f, PF_BGRX);  initFrame(stf, PF_BGRX, true);
+		}
+
+		double run(void)
+		{
+			f.makePassive(stf, mode);
+			return (double)benchWidth * benchHeight;
+		}
+
+	private:
+
+		Frame f, stf;
+		int mode;
+};
+
+
+// Compare every tile of two identical frames, which is the worst case for
+// tileEquals(), since it has to read every pixel of both frames
+
+class TileEqualsBench : public Bench
+{
+	public:
+
+		TileEqualsBench(void) : Bench("tileEquals", "Mpixels/s")
+		{
+			initFrame(f, PF_BGRX);  initFrame(last, PF_BGRX);
+		}
+
+		double run(void)
+		{
+			int tileSize = fconfig.tilesize;
+			for(int y = 0; y < benchHeight; y += tileSize)
+			{
+				int height = min(tileSize, benchHeight - y);
+				for(int x = 0; x < benchWidth; x += tileSize)
+				{
+					int width = min(tileSize, benchWidth - x);
+					if(!f.tileEquals(&last, x, y, width, height))
+						_throw("Tiles should be equal");
+				}
+			}
+			return (double)benchWidth * benchHeight;
+		}
+
+	private:
+
+		Frame f, last;
+};
+
+
+class EncodeBench : public Bench
+{
+	public:
+
+		EncodeBench(const char *name, int compress) : Bench(name, "Mpixels/s")
+		{
+			initFrame(f, PF_BGRX);
+			f.hdr.compress = compress;
+		}
+
+		double run(void)
+		{
+			cf = f;
+			return (double)benchWidth * benchHeight;
+		}
+
+	private:
+
+		Frame f;
+		CompressedFrame cf;
+};
+
+
+class DecodeBench : public Bench
+{
+	public:
+
+		DecodeBench(const char *name, int compress) : Bench(name, "Mpixels/s"),
+			fb(dpy, win)
+		{
+			initFrame(f, PF_BGRX);
+			f.hdr.compress = compress;
+			cf = f;
+		}
+
+		double run(void)
+		{
+			fb = cf;
+			return (double)benchWidth * benchHeight;
+		}
+
+	private:
+
+		Frame f;
+		CompressedFrame cf;
+		FBXFrame fb;
+};
+
+
+// Pass items from one thread to another through a GenericQ
+
+class QueueBench : public Bench
+{
+	public:
+
+		QueueBench(void) : Bench("GenericQ", "Mitems/s"), consumer(q) {}
+
+		double run(void)
+		{
+			Thread thread(&consumer);
+			thread.start();
+			for(int i = 0; i < NITEMS; i++) q.add((void *)this);
+			thread.stop();
+			thread.checkError();
+			return (double)NITEMS;
+		}
+
+	private:
+
+		static const int NITEMS = 100000;
+
+		class Consumer : public Runnable
+		{
+			public:
+
+				Consumer(GenericQ &q_) : q(q_) {}
+
+			private:
+
+				void run(void)
+				{
+					for(int i = 0; i < NITEMS; i++)
+					{
+						void *item = NULL;
+						q.get(&item);
+						if(!item) _throw("Queue was released");
+					}
+				}
+
+				GenericQ &q;
+		};
+
+		GenericQ q;
+		Consumer consumer;
+};
+
+
+// Send data to another thread through a loopback TCP connection, using the
+// same buffer size that the VGL Transport uses for a 64x64 BGRX tile
+
+class SocketBench : public Bench
+{
+	public:
+
+		SocketBench(void) : Bench("socket/loopback", "MB/s"),
+			thread(&receiver), client(false, false)
+		{
+			unsigned short port = receiver.listener.listen(0);
+			thread.start();
+			client.connect((char *)"127.0.0.1", port);
+			memset(buf, 0x80, BUFSIZE);
+		}
+
+		~SocketBench(void)
+		{
+			client.close();
+			thread.stop();
+		}
+
+		double run(void)
+		{
+			for(int i = 0; i < 64; i++) client.send(buf, BUFSIZE);
+			return 64. * BUFSIZE;
+		}
+
+	private:
+
+		static const int BUFSIZE = 64 * 64 * 4;
+
+		class Receiver : public Runnable
+		{
+			public:
+
+				Receiver(void) : listener(false, false) {}
+
+				Socket listener;
+
+			private:
+
+				// Receive until the sender closes the connection
+				void run(void)
+				{
+					Socket *sd = listener.accept();
+					try
+					{
+						for(;;) sd->recv(buf, BUFSIZE);
+					}
+					catch(...) {}
+					delete sd;
+				}
+
+				char buf[BUFSIZE];
+		};
+
+		Receiver receiver;
+		Thread thread;
+		Socket client;
+		char buf[BUFSIZE];
+};
+
+
+// The baseline is read from a JSON file written by a previous run, which has
+// one result per line.
+
+void readBaseline(const char *fileName)
+{
+	FILE *file;  char line[1024];
+
+	if((file = fopen(fileName, "r")) == NULL)
+		_throw("Could not open baseline file");
+	while(fgets(line, 1024, file) && nBaseline < MAXRESULTS)
+	{
+		char *ptr = strstr(line, "{\"name\": \"");
+		if(!ptr) continue;
+		if(sscanf(ptr, "{\"name\": \"%63[^\"]\", \"value\": %lf",
+			baseline[nBaseline].name, &baseline[nBaseline].value) == 2)
+			nBaseline++;
+	}
+	fclose(file);
+	if(nBaseline < 1) _throw("Baseline file contains no results");
+}
+
+
+void writeResults(const char *fileName)
+{
+	FILE *file;
+
+	if((file = fopen(fileName, "w")) == NULL)
+		_throw("Could not open JSON output file");
+	fprintf(file, "{\"perfbench\": 1, \"width\": %d, \"height\": %d, \"results\": [\n",
+		benchWidth, benchHeight);
+	for(int i = 0; i < nResults; i++)
+		fprintf(file, "{\"name\": \"%s\", \"value\": %.3f, \"unit\": \"%s\"}%s\n",
+			results[i].name, results[i].value, results[i].unit,
+			i < nResults - 1 ? "," : "");
+	fprintf(file, "]}\n");
+	fclose(file);
+}
+
+
+void usage(char **argv)
+{
+	fprintf(stderr, "\nUSAGE: %s [options]\n\n", argv[0]);
+	fprintf(stderr, "Options:\n");
+	fprintf(stderr, "-size <w>x<h> = Image size to use (default: %dx%d)\n",
+		benchWidth, benchHeight);
+	fprintf(stderr, "-time <t> = Run each benchmark for <t> seconds (default: %.1f)\n",
+		benchTime);
+	fprintf(stderr, "-filter <s> = Run only the benchmarks whose names contain <s>\n");
+	fprintf(stderr, "-json <file> = Write the results to <file> in JSON format\n");
+	fprintf(stderr, "-baseline <file> = Compare the results against a JSON file written by a\n");
+	fprintf(stderr, "                   previous run, and exit with an error if any result\n");
+	fprintf(stderr, "                   has regressed by more than the threshold\n");
+	fprintf(stderr, "-threshold <p> = Regression threshold, in percent (default: %.0f)\n\n",
+		threshold);
+	exit(1);
+}
+
+
+int main(int argc, char **argv)
+{
+	const char *jsonFile = NULL, *baselineFile = NULL;
+
+	for(int i = 1; i < argc; i++)
+	{
+		if(!strcasecmp(argv[i], "-size") && i < argc - 1)
+		{
+			if(sscanf(argv[++i], "%dx%d", &benchWidth, &benchHeight) != 2
+				|| benchWidth < 1 || benchHeight < 1)
+				usage(argv);
+		}
+		else if(!strcasecmp(argv[i], "-time") && i < argc - 1)
+		{
+			if((benchTime = atof(argv[++i])) <= 0.) usage(argv);
+		}
+		else if(!strcasecmp(argv[i], "-filter") && i < argc - 1)
+			filter = argv[++i];
+		else if(!strcasecmp(argv[i], "-json") && i < argc - 1)
+			jsonFile = argv[++i];
+		else if(!strcasecmp(argv[i], "-baseline") && i < argc - 1)
+			baselineFile = argv[++i];
+		else if(!strcasecmp(argv[i], "-threshold") && i < argc - 1)
+		{
+			if((threshold = atof(argv[++i])) <= 0.) usage(argv);
+		}
+		else usage(argv);
+	}
+
+	try
+	{
+		if(baselineFile) readBaseline(baselineFile);
+
+		// Use the same JPEG quality and subsampling defaults as the faker
+		fconfig_setcompress(fconfig, RRCOMP_JPEG);
+
+		printf("Image size: %d x %d\n\n", benchWidth, benchHeight);
+
+		static const int conversions[][2] =
+		{
+			{ PF_RGB, PF_BGRX }, { PF_RGBX, PF_BGRX }, { PF_BGRX, PF_RGB },
+			{ PF_BGRX, PF_BGR }, { PF_BGRX, PF_RGBX }, { PF_XRGB, PF_RGB },
+			{ PF_XBGR, PF_BGRX }, { PF_BGR10_X2, PF_BGRX },
+			{ PF_BGRX, PF_RGB10_X2 }, { PF_X2_RGB10, PF_BGR10_X2 }
+		};
+		for(unsigned int i = 0; i < sizeof(conversions) / sizeof(conversions[0]);
+			i++)
+		{
+			ConvertBench bench(conversions[i][0], conversions[i][1]);
+			runBench(bench);
+		}
+
+		fconfig_setgamma(fconfig, 2.22);
+		{
+			GammaBench bench("gamma/BGRX", PF_BGRX);  runBench(bench);
+		}
+		{
+			GammaBench bench("gamma/BGRX+copy", PF_BGRX, true);  runBench(bench);
+		}
+		{
+			GammaBench bench("gamma/BGR10_X2", PF_BGR10_X2);  runBench(bench);
+		}
+		fconfig_setgamma(fconfig, 1.0);
+
+		{
+			AnaglyphBench bench;  runBench(bench);
+		}
+		{
+			PassiveBench bench("stereo/interleaved", RRSTEREO_INTERLEAVED);
+			runBench(bench);
+		}
+		{
+			PassiveBench bench("stereo/topbottom", RRSTEREO_TOPBOTTOM);
+			runBench(bench);
+		}
+		{
+			PassiveBench bench("stereo/sidebyside", RRSTEREO_SIDEBYSIDE);
+			runBench(bench);
+		}
+		{
+			TileEqualsBench bench;  runBench(bench);
+		}
+
+		{
+			EncodeBench bench("encode/JPEG", RRCOMP_JPEG);  runBench(bench);
+		}
+		{
+			EncodeBench bench("encode/RGB", RRCOMP_RGB);  runBench(bench);
+		}
+
+		// Decoding requires an X display, since FBXFrame draws into a window.
+		// The window is never mapped, so that the results are not affected by
+		// the X server's rendering.
+		if((dpy = XOpenDisplay(NULL)) != NULL)
+		{
+			win = XCreateSimpleWindow(dpy, DefaultRootWindow(dpy), 0, 0, benchWidth,
+				benchHeight, 0, 0, 0);
+			{
+				DecodeBench bench("decode/JPEG", RRCOMP_JPEG);  runBench(bench);
+			}
+			{
+				DecodeBench bench("decode/RGB", RRCOMP_RGB);  runBench(bench);
+			}
+			XDestroyWindow(dpy, win);
+			XCloseDisplay(dpy);  dpy = NULL;
+		}
+		else
+		{
+			skipBench("decode/JPEG", "no X display");
+			skipBench("decode/RGB", "no X display");
+		}
+
+		{
+			QueueBench bench;  runBench(bench);
+		}
+		if(!filter || strstr("socket/loopback", filter))
+		{
+			SocketBench bench;  runBench(bench);
+		}
+
+		if(jsonFile) writeResults(jsonFile);
+	}
+	catch(Error &e)
+	{
+		fprintf(stderr, "ERROR: %s\n%s\n", e.getMethod(), e.getMessage());
+		return -1;
+	}
+
+	if(nRegressions)
+	{
+		printf("\n%d result(s) regressed by more than %.0f%%\n", nRegressions,
+			threshold);
+		return 1;
+	}
+	return 0;
+}
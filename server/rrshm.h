@@ -0,0 +1,127 @@
+/* Copyright (C)2018 D. R. Commander
+ *
+ * This library is free software and may be redistributed and/or modified under
+ * the terms of the wxWindows Library License, Version 3.1 or (at your option)
+ * any later version.  The full license is in the LICENSE.txt file included
+ * with this distribution.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * wxWindows Library License for more details.
+ */
+
+/* This describes the layout of the POSIX shared memory segment used by the
+   shared memory transport plugin (libvgltrans_shm.so, VGL_TRANSPORT=shm.)
+   That plugin publishes the frames rendered by a 3D application into a ring
+   of frame buffers in the segment, and a consumer process running on the same
+   host can map the segment and read the frames in place, without any
+   encoding or copying.  server/shmconsumer.cpp in the VirtualGL source
+   distribution is a reference implementation of a consumer.
+
+   The segment consists of an RRShmHeader structure followed by the pixels of
+   each frame buffer.  There is one producer (the plugin) and at most one
+   consumer per segment.  The protocol is as follows:
+
+   -- The producer never writes to the frame buffer identified by
+      RRShmHeader::latestSlot (the most recently published frame) or to the
+      frame buffer identified by RRShmHeader::consumerSlot (the frame that the
+      consumer is reading.)  Since there are RRSHM_NSLOTS (3) frame buffers,
+      the producer never has to wait for the consumer.
+
+   -- To publish a frame, the producer fills in the RRShmSlot structure and
+      the pixels of a free frame buffer, sets RRShmHeader::latestSlot to the
+      index of that frame buffer, increments RRShmHeader::latestSeq, and wakes
+      any process that is waiting on RRShmHeader::latestSeq (using the Linux
+      futex() system call with FUTEX_WAKE.)
+
+   -- To acquire the most recent frame, the consumer reads
+      RRShmHeader::latestSlot, stores that value in RRShmHeader::consumerSlot,
+      and then re-reads RRShmHeader::latestSlot.  If the value has changed,
+      then the consumer must repeat the process.  Otherwise, it can read the
+      frame buffer until it stores a new value in RRShmHeader::consumerSlot
+      (-1 if it no longer needs any frame buffer.)  All of these accesses must
+      be sequentially consistent (for instance, using
+      __atomic_load_n()/__atomic_store_n() with __ATOMIC_SEQ_CST.)
+
+   -- To wait for a new frame, the consumer waits on RRShmHeader::latestSeq
+      (using futex() with FUTEX_WAIT and the last value of
+      RRShmHeader::latestSeq that it observed.)
+
+   -- If the frames become too large for the segment, then the producer
+      creates a new segment with the same name, and it sets
+      RRShmHeader::closed in the old segment and wakes the consumer.  The
+      producer also sets RRShmHeader::closed when the 3D application exits.
+      The consumer should then unmap the old segment and try to open the
+      segment again.
+
+   The name of the segment is "/vgl-{uid}-{window}", where {uid} is the
+   numeric user ID of the 3D application and {window} is the X window ID (in
+   hexadecimal) of the window into which the frame was rendered, or the value
+   of the VGL_SHMNAME environment variable, if it is set.  The segment is
+   created with read/write permissions for the user only. */
+
+#ifndef __RRSHM_H__
+#define __RRSHM_H__
+
+#include "rrtransport.h"
+
+
+#define RRSHM_MAGIC  0x53474C56  /* "VGLS" */
+#define RRSHM_VERSION  1
+#define RRSHM_NSLOTS  3
+
+
+typedef struct _RRShmSlot
+{
+  /* The sequence number of the frame (see RRFrame::seq.)  0 = this frame
+     buffer has never been published */
+  unsigned int seq;
+
+  /* The dimensions of the frame, in pixels, the number of bytes in each pixel
+     row, and the pixel format (RRTRANS_RGB, RRTRANS_RGBA, etc.)  Pixel rows
+     are always stored in bottom-up order. */
+  int width, height, pitch, format;
+
+  /* The offset of the frame buffer, in bytes, from the start of the segment
+     and the size of the frame buffer, in bytes */
+  unsigned long long offset, size;
+
+  /* The time at which VirtualGL began reading back the frame (see
+     RRFrame::timestamp) */
+  double timestamp;
+
+  /* The regions of the frame that have changed since the previous frame
+     (that is, the frame whose sequence number is seq - 1.)  If the consumer
+     did not read the previous frame, then it must consider the entire frame
+     to be dirty.  See RRFrame::ndirty and RRFrame::dirty. */
+  int ndirty;
+  RRRect dirty[RRTRANS_MAXDIRTY];
+} RRShmSlot;
+
+
+typedef struct _RRShmHeader
+{
+  /* RRSHM_MAGIC and RRSHM_VERSION */
+  unsigned int magic, version;
+
+  /* The total size of the segment, in bytes */
+  unsigned long long size;
+
+  /* Non-zero if the producer has closed or replaced the segment */
+  volatile int closed;
+
+  /* The index of the most recently published frame buffer, or -1 if no frames
+     have been published */
+  volatile int latestSlot;
+
+  /* Incremented each time a frame is published (futex word) */
+  volatile unsigned int latestSeq;
+
+  /* The index of the frame buffer that the consumer is reading, or -1 */
+  volatile int consumerSlot;
+
+  RRShmSlot slots[RRSHM_NSLOTS];
+} RRShmHeader;
+
+#endif  /* __RRSHM_H__ */
@@ -19,6 +19,14 @@
 #include "rr.h"
 
 
+/* Version of the transport plugin API implemented by this header.  Plugins
+   that implement version 2 or later of the API must export
+   RRTransGetVersion() and RRTransSetCallback() (see below), in addition to
+   the functions from version 1 of the API.  Plugins that don't export
+   RRTransGetVersion() are assumed to implement version 1. */
+#define RRTRANS_VERSION  2
+
+
 /* Pixel formats */
 #define RRTRANS_FORMATOPT  6
 enum { RRTRANS_RGB, RRTRANS_RGBA, RRTRANS_BGR, RRTRANS_BGRA, RRTRANS_ABGR,
@@ -29,10 +37,25 @@ static const int rrtrans_bgr[RRTRANS_FORMATOPT] = { 0, 0, 1, 1, 1, 0 };
 static const int rrtrans_afirst[RRTRANS_FORMATOPT] = { 0, 0, 0, 0, 1, 1 };
 
 
+/* Maximum number of dirty rectangles that can be reported for a frame */
+#define RRTRANS_MAXDIRTY  256
+
+/* Value of RRFrame::ndirty if the entire frame should be considered dirty */
+#define RRTRANS_ALLDIRTY  -1
+
+
 #if !defined(__SUNPRO_CC) && !defined(__SUNPRO_C)
 #pragma pack(1)
 #endif
 
+typedef struct _RRRect
+{
+  /* The offset of the rectangle, in pixels, relative to the upper left corner
+     of the frame (even though the pixels are delivered in bottom-up order),
+     and the dimensions of the rectangle */
+  int x, y, w, h;
+} RRRect;
+
 typedef struct _RRFrame
 {
   /* A pointer to the pixels in the framebuffer allocated by the transport
@@ -58,8 +81,45 @@ typedef struct _RRFrame
      framebuffer.  No user serviceable parts inside. */
   void *opaque;
 
+  /* The remaining fields are available only in version 2 and later of the
+     API.  They are set by VirtualGL before it calls RRTransSendFrame(). */
+
+  /* The sequence number of the frame.  VirtualGL numbers the frames sent to
+     each plugin instance consecutively, starting at 1. */
+  unsigned int seq;
+
+  /* The time (in seconds, relative to an arbitrary starting point) at which
+     VirtualGL began reading back the frame */
+  double timestamp;
+
+  /* The number of rectangles in the dirty array.  The dirty rectangles
+     describe the regions of the frame that have changed since the previous
+     frame that VirtualGL sent to this plugin instance.  If the plugin discards
+     frames, then it must combine their dirty rectangles with those of the
+     next frame that it processes.  0 = the frame is identical to the previous
+     frame.  RRTRANS_ALLDIRTY = the entire frame should be considered dirty
+     (this is always the case for the first frame, for frames whose size or
+     pixel format has changed, and for stereo frames.) */
+  int ndirty;
+  RRRect dirty[RRTRANS_MAXDIRTY];
+
 } RRFrame;
 
+
+/* Completion callback (version 2 and later of the API)
+
+   The plugin calls this function, using the function pointer and context
+   argument passed to RRTransSetCallback(), once it has finished processing a
+   frame (that is, once it has delivered the frame to the receiver or
+   discarded it.)  The plugin must call the callback exactly once for each
+   frame passed to RRTransSendFrame(), but it may do so from any thread,
+   including from within RRTransSendFrame().
+
+   context (IN) = the context argument passed to RRTransSetCallback()
+   seq (IN) = the sequence number of the frame (see RRFrame::seq)
+*/
+typedef void (*RRTransCallback)(void *context, unsigned int seq);
+
 #if !defined(__SUNPRO_CC) && !defined(__SUNPRO_C)
 #pragma pack()
 #endif
@@ -225,6 +285,45 @@ int RRTransDestroy(void *handle);
 const char *RRTransGetError(void);
 
 
+/*
+   Return the version of the transport plugin API that the plugin implements
+   (normally RRTRANS_VERSION.)  This function is optional.  If the plugin
+   doesn't export it, then VirtualGL assumes that the plugin implements
+   version 1 of the API.
+*/
+int RRTransGetVersion(void);
+
+
+/*
+   Register a completion callback with an instance of the transport plugin
+   (version 2 and later of the API.)  VirtualGL calls this function once,
+   immediately after RRTransInit().  Thereafter, VirtualGL tracks the number of
+   frames that are in flight (frames that have been passed to
+   RRTransSendFrame() but for which the callback has not yet been called.)
+   Rather than calling RRTransReady(), VirtualGL considers the plugin to be
+   ready if fewer than the maximum number of frames are in flight, and rather
+   than calling RRTransSynchronize(), VirtualGL waits until no frames are in
+   flight.  Plugins must still export RRTransReady() and RRTransSynchronize(),
+   so they can be used with older versions of VirtualGL.
+
+   PARAMETERS:
+   handle (IN) = instance handle (returned from a previous call to
+                 RRTransInit())
+   callback (IN) = function that the plugin must call when it has finished
+                   processing a frame
+   context (IN) = argument that the plugin must pass to the callback
+
+   RETURN VALUE:
+   This function returns the maximum number of frames that the plugin can
+   hold in flight (which must be at least 1), or -1 on failure.
+   RRTransGetError() can be called to determine the cause of the failure.
+   Note that the plugin must be able to supply a frame buffer from
+   RRTransGetFrame() for each frame that is in flight.
+*/
+int RRTransSetCallback(void *handle, RRTransCallback callback,
+  void *context);
+
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,348 @@
+/* Copyright (C)2018 D. R. Commander
+ *
+ * This library is free software and may be redistributed and/or modified under
+ * the terms of the wxWindows Library License, Version 3.1 or (at your option)
+ * any later version.  The full license is in the LICENSE.txt file included
+ * with this distribution.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * wxWindows Library License for more details.
+ */
+
+/* This is a reference implementation of a consumer for the shared memory
+   transport plugin (see rrshm.h), as well as a benchmark that measures the
+   throughput of the plugin. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/wait.h>
+#include <linux/futex.h>
+#include "rrshm.h"
+#include "Error.h"
+#include "Timer.h"
+#include "vglutil.h"
+
+using namespace vglutil;
+
+
+#define BENCHTIME  5.0
+
+double benchTime = BENCHTIME;
+int benchWidth = 1920, benchHeight = 1080;
+volatile bool deadYet = false;
+volatile unsigned long long checksum = 0;
+
+
+void handler(int sig)
+{
+	deadYet = true;
+}
+
+
+// Map the segment with the specified name.  Returns NULL if the segment
+// doesn't exist (yet.)
+
+RRShmHeader *openSegment(const char *name)
+{
+	int fd;  struct stat st;  void *ptr;
+
+	if((fd = shm_open(name, O_RDWR, 0)) == -1)
+	{
+		if(errno == ENOENT) return NULL;
+		_throwunix();
+	}
+	if(fstat(fd, &st) == -1 || st.st_size < (off_t)sizeof(RRShmHeader))
+	{
+		close(fd);  return NULL;
+	}
+	ptr = mmap(NULL, st.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	close(fd);
+	if(ptr == MAP_FAILED) _throwunix();
+
+	RRShmHeader *hdr = (RRShmHeader *)ptr;
+	if(hdr->magic != RRSHM_MAGIC || hdr->version != RRSHM_VERSION
+		|| hdr->size != (unsigned long long)st.st_size)
+	{
+		munmap(ptr, st.st_size);
+		_throw("Segment is not a compatible VirtualGL shared memory segment");
+	}
+	return hdr;
+}
+
+
+// Acquire the most recently published frame buffer, so the producer won't
+// overwrite it while we're reading it.  Returns -1 if no frames have been
+// published.
+
+int acquire(RRShmHeader *hdr)
+{
+	while(true)
+	{
+		int slot = __atomic_load_n(&hdr->latestSlot, __ATOMIC_SEQ_CST);
+		__atomic_store_n(&hdr->consumerSlot, slot, __ATOMIC_SEQ_CST);
+		if(slot < 0
+			|| __atomic_load_n(&hdr->latestSlot, __ATOMIC_SEQ_CST) == slot)
+			return slot;
+	}
+}
+
+
+void release(RRShmHeader *hdr)
+{
+	__atomic_store_n(&hdr->consumerSlot, -1, __ATOMIC_SEQ_CST);
+}
+
+
+// Wait (for no more than 100 ms) until the producer publishes a frame other
+// than lastSeq or closes the segment
+
+void waitForFrame(RRShmHeader *hdr, unsigned int lastSeq)
+{
+	struct timespec timeout = { 0, 100000000 };
+
+	syscall(SYS_futex, &hdr->latestSeq, FUTEX_WAIT, lastSeq, &timeout, NULL, 0);
+}
+
+
+// Read every pixel in the frame (a real consumer would copy the pixels to a
+// texture or an encoder at this point) and make sure that the frame wasn't
+// modified while we were reading it.  The benchmark fills each frame with the
+// low-order byte of its sequence number.
+
+bool consume(RRShmHeader *hdr, RRShmSlot *slot, bool check)
+{
+	unsigned char *bits = (unsigned char *)hdr + slot->offset;
+	int rowSize = slot->width * rrtrans_ps[slot->format];
+	unsigned long long sum = 0;
+	unsigned char expected = slot->seq & 0xFF;
+
+	for(int y = 0; y < slot->height; y++)
+	{
+		unsigned char *row = &bits[slot->pitch * y];
+		int x = 0;
+		for(; x < rowSize - 7; x += 8) sum += *(unsigned long long *)&row[x];
+		for(; x < rowSize; x++) sum += row[x];
+		if(check && (row[0] != expected || row[rowSize - 1] != expected))
+			return false;
+	}
+	checksum += sum;
+	return true;
+}
+
+
+// Consume frames from the segment with the specified name until interrupted
+// (or, in benchmark mode, until the producer closes the segment)
+
+int runConsumer(const char *name, bool bench)
+{
+	RRShmHeader *hdr = NULL;
+	unsigned int lastSeq = 0, lastFrameSeq = 0;
+	unsigned long long frames = 0, skipped = 0, bytes = 0, errors = 0;
+	double latency = 0., start = getTime(), lastReport = start;
+
+	while(!deadYet)
+	{
+		if(!hdr)
+		{
+			if((hdr = openSegment(name)) == NULL)
+			{
+				if(bench && getTime() - start > 10.)
+					_throw("Producer did not create the segment");
+				usleep(10000);  continue;
+			}
+			lastSeq = 0;
+		}
+
+		unsigned int seq = __atomic_load_n(&hdr->latestSeq, __ATOMIC_SEQ_CST);
+		if(__atomic_load_n(&hdr->closed, __ATOMIC_SEQ_CST))
+		{
+			// The producer has either exited or replaced the segment with a
+			// larger one.
+			munmap(hdr, hdr->size);  hdr = NULL;
+			if(bench) break;
+			continue;
+		}
+		if(seq == lastSeq)
+		{
+			waitForFrame(hdr, lastSeq);  continue;
+		}
+		lastSeq = seq;
+
+		int s = acquire(hdr);
+		if(s < 0) continue;
+		RRShmSlot *slot = &hdr->slots[s];
+		if(slot->seq != lastFrameSeq)
+		{
+			if(!consume(hdr, slot, bench)) errors++;
+			if(lastFrameSeq != 0 && slot->seq > lastFrameSeq + 1)
+				skipped += slot->seq - lastFrameSeq - 1;
+			lastFrameSeq = slot->seq;
+			latency += getTime() - slot->timestamp;
+			bytes += (unsigned long long)slot->width * rrtrans_ps[slot->format] *
+				slot->height;
+			frames++;
+			if(!bench)
+			{
+				if(slot->ndirty == RRTRANS_ALLDIRTY)
+					printf("Frame %u: %d x %d, entire frame is dirty\n", slot->seq,
+						slot->width, slot->height);
+				else
+					printf("Frame %u: %d x %d, %d dirty rectangles\n", slot->seq,
+						slot->width, slot->height, slot->ndirty);
+			}
+		}
+		release(hdr);
+
+		double now = getTime();
+		if(!bench && now - lastReport >= 1.0 && frames > 0)
+		{
+			printf("%f frames/sec, %f Mbytes/sec, average latency %f ms, %llu frames skipped\n",
+				(double)frames / (now - lastReport),
+				(double)bytes / 1000000. / (now - lastReport),
+				latency / (double)frames * 1000., skipped);
+			frames = skipped = bytes = 0;  latency = 0.;  lastReport = now;
+		}
+	}
+	if(hdr) munmap(hdr, hdr->size);
+
+	if(bench)
+	{
+		double elapsed = getTime() - start;
+		printf("Consumer:  %f frames/sec, %f Mbytes/sec\n",
+			(double)frames / elapsed, (double)bytes / 1000000. / elapsed);
+		printf("           average latency %f ms, %llu frames skipped\n",
+			frames ? latency / (double)frames * 1000. : 0., skipped);
+		if(errors)
+		{
+			printf("           %llu frames were modified while being read\n", errors);
+			return -1;
+		}
+	}
+	return 0;
+}
+
+
+// Publish frames as quickly as possible using the shared memory transport
+// plugin
+
+int runProducer(void)
+{
+	void *handle = NULL;  int retval = 0;
+
+	try
+	{
+		if(!(handle = RRTransInit(NULL, 0, NULL))) _throw(RRTransGetError());
+		if(RRTransConnect(handle, NULL, 0) == -1) _throw(RRTransGetError());
+
+		unsigned long long frames = 0;
+		double start = getTime(), elapsed;
+		do
+		{
+			RRFrame *frame;
+			double t = getTime();
+			if(!(frame = RRTransGetFrame(handle, benchWidth, benchHeight,
+				RRTRANS_BGRA, 0)))
+				_throw(RRTransGetError());
+			frame->seq = (unsigned int)(++frames);
+			// Simulate readback
+			memset(frame->bits, frame->seq & 0xFF, frame->pitch * frame->h);
+			frame->timestamp = t;
+			frame->ndirty = RRTRANS_ALLDIRTY;
+			if(RRTransSendFrame(handle, frame, 0) == -1) _throw(RRTransGetError());
+		} while((elapsed = getTime() - start) < benchTime);
+		printf("Producer:  %f frames/sec, %f Mbytes/sec\n",
+			(double)frames / elapsed, (double)frames * benchWidth * benchHeight * 4. /
+				1000000. / elapsed);
+	}
+	catch(Error &e)
+	{
+		fprintf(stderr, "Producer: %s\n", e.getMessage());  retval = -1;
+	}
+	if(handle) RRTransDestroy(handle);
+	return retval;
+}
+
+
+void usage(char **argv)
+{
+	fprintf(stderr, "\nUSAGE: %s <segment name> [options]\n", argv[0]);
+	fprintf(stderr, "       %s -bench [options]\n\n", argv[0]);
+	fprintf(stderr, "Consume frames published by the shared memory transport plugin\n");
+	fprintf(stderr, "(VGL_TRANSPORT=shm) in the specified segment, or benchmark the plugin.\n\n");
+	fprintf(stderr, "Options:\n");
+	fprintf(stderr, "-time <t> = Run the benchmark for <t> seconds (default: %.1f)\n",
+		BENCHTIME);
+	fprintf(stderr, "-size <w>x<h> = Size of the frames published by the benchmark\n");
+	fprintf(stderr, "                (default: %d x %d)\n\n", benchWidth,
+		benchHeight);
+	exit(1);
+}
+
+
+int main(int argc, char **argv)
+{
+	char *name = NULL, benchName[MAXSTR], segName[MAXSTR];
+	bool bench = false;
+	int retval = 0;
+
+	for(int i = 1; i < argc; i++)
+	{
+		if(!stricmp(argv[i], "-h") || !strcmp(argv[i], "-?")) usage(argv);
+		else if(!stricmp(argv[i], "-bench")) bench = true;
+		else if(!stricmp(argv[i], "-time") && i < argc - 1)
+		{
+			benchTime = atof(argv[++i]);
+			if(benchTime <= 0.0) usage(argv);
+		}
+		else if(!stricmp(argv[i], "-size") && i < argc - 1)
+		{
+			if(sscanf(argv[++i], "%dx%d", &benchWidth, &benchHeight) != 2
+				|| benchWidth < 1 || benchHeight < 1)
+				usage(argv);
+		}
+		else if(argv[i][0] != '-' && !name) name = argv[i];
+		else usage(argv);
+	}
+	if(!bench && !name) usage(argv);
+
+	signal(SIGINT, handler);
+	signal(SIGTERM, handler);
+
+	try
+	{
+		if(bench)
+		{
+			// The producer uses a window ID of 0, and the plugin appends the window
+			// ID to VGL_SHMNAME.
+			snprintf(benchName, MAXSTR, "/vgl-bench-%d", (int)getpid());
+			snprintf(segName, MAXSTR, "%s-0", benchName);
+			setenv("VGL_SHMNAME", benchName, 1);
+			pid_t pid = fork();
+			if(pid == -1) _throwunix();
+			if(pid == 0) exit(runProducer() == 0 ? 0 : 1);
+			retval = runConsumer(segName, true);
+			int status = 0;
+			waitpid(pid, &status, 0);
+			if(!WIFEXITED(status) || WEXITSTATUS(status) != 0) retval = -1;
+		}
+		else retval = runConsumer(name, false);
+	}
+	catch(Error &e)
+	{
+		fprintf(stderr, "ERROR in %s--\n%s\n", e.getMethod(), e.getMessage());
+		retval = -1;
+	}
+
+	return retval;
+}
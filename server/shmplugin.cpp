@@ -0,0 +1,328 @@
+/* Copyright (C)2018 D. R. Commander
+ *
+ * This library is free software and may be redistributed and/or modified under
+ * the terms of the wxWindows Library License, Version 3.1 or (at your option)
+ * any later version.  The full license is in the LICENSE.txt file included
+ * with this distribution.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * wxWindows Library License for more details.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+#include <X11/Xlib.h>
+#include "rrshm.h"
+#include "Error.h"
+
+using namespace vglutil;
+
+
+static Error err;
+char errStr[MAXSTR];
+
+
+#define PAGESIZE  4096
+#define PAD(v, p)  (((v) + (p) - 1) & (~((unsigned long long)(p) - 1)))
+
+
+/* This transport plugin publishes frames into a POSIX shared memory segment
+   that can be mapped by a consumer process running on the same host (see
+   rrshm.h for a description of the segment and the protocol.)  VirtualGL
+   reads back the pixels directly into the segment, and the consumer can read
+   them in place, so there is no encoding and no copying. */
+
+class ShmTrans
+{
+	public:
+
+		ShmTrans(Window win) : hdr(NULL), fd(-1), slot(-1), callback(NULL),
+			context(NULL)
+		{
+			char *env = getenv("VGL_SHMNAME");
+			// The window ID is always part of the name, since each window has its
+			// own segment.
+			if(env && strlen(env) > 0)
+				snprintf(name, MAXSTR, "%s%s-%lx", env[0] == '/' ? "" : "/", env,
+					(unsigned long)win);
+			else
+				snprintf(name, MAXSTR, "/vgl-%d-%lx", (int)getuid(),
+					(unsigned long)win);
+			memset(&frame, 0, sizeof(RRFrame));
+		}
+
+		~ShmTrans(void)
+		{
+			close();
+			shm_unlink(name);
+		}
+
+		void setCallback(RRTransCallback callback_, void *context_)
+		{
+			callback = callback_;  context = context_;
+		}
+
+		RRFrame *getFrame(int width, int height, int format)
+		{
+			if(width < 1 || height < 1 || format < 0 || format >= RRTRANS_FORMATOPT)
+				_throw("Invalid argument");
+			if(slot >= 0) _throw("A frame is already in flight");
+
+			int pitch = PAD(width * rrtrans_ps[format], 4);
+			unsigned long long frameSize = (unsigned long long)pitch * height;
+			if(!hdr || frameSize > hdr->slots[0].size) create(frameSize);
+
+			// There are three frame buffers, so at least one of them is neither the
+			// most recently published frame nor the frame that the consumer is
+			// reading.
+			int latestSlot = __atomic_load_n(&hdr->latestSlot, __ATOMIC_SEQ_CST);
+			int consumerSlot = __atomic_load_n(&hdr->consumerSlot, __ATOMIC_SEQ_CST);
+			for(int i = 0; i < RRSHM_NSLOTS; i++)
+			{
+				if(i != latestSlot && i != consumerSlot)
+				{
+					slot = i;  break;
+				}
+			}
+			if(slot < 0) _throw("No free buffers in segment");
+
+			memset(&frame, 0, sizeof(RRFrame));
+			frame.bits = (unsigned char *)hdr + hdr->slots[slot].offset;
+			frame.format = format;
+			frame.w = width;  frame.h = height;  frame.pitch = pitch;
+			frame.opaque = (void *)this;
+			return &frame;
+		}
+
+		void sendFrame(RRFrame *f)
+		{
+			if(f != &frame || slot < 0) _throw("Invalid frame handle");
+
+			RRShmSlot *s = &hdr->slots[slot];
+			s->seq = frame.seq;
+			s->width = frame.w;  s->height = frame.h;
+			s->pitch = frame.pitch;  s->format = frame.format;
+			s->timestamp = frame.timestamp;
+			s->ndirty = frame.ndirty;
+			if(frame.ndirty > 0)
+				memcpy(s->dirty, frame.dirty, sizeof(RRRect) * frame.ndirty);
+
+			__atomic_store_n(&hdr->latestSlot, slot, __ATOMIC_SEQ_CST);
+			__atomic_add_fetch(&hdr->latestSeq, 1, __ATOMIC_SEQ_CST);
+			wake();
+			slot = -1;
+			if(callback) callback(context, frame.seq);
+		}
+
+	private:
+
+		// Create a new segment that can hold frames of the specified size,
+		// replacing the existing segment (if any)
+
+		void create(unsigned long long frameSize)
+		{
+			close();
+			shm_unlink(name);
+
+			unsigned long long slotSize = PAD(frameSize, PAGESIZE),
+				hdrSize = PAD(sizeof(RRShmHeader), PAGESIZE),
+				size = hdrSize + slotSize * RRSHM_NSLOTS;
+			if((fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0600)) == -1)
+				_throwunix();
+			_unix(ftruncate(fd, size));
+			void *ptr;
+			if((ptr = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd,
+				0)) == MAP_FAILED)
+				_throwunix();
+			hdr = (RRShmHeader *)ptr;
+
+			memset(hdr, 0, sizeof(RRShmHeader));
+			hdr->magic = RRSHM_MAGIC;
+			hdr->version = RRSHM_VERSION;
+			hdr->size = size;
+			hdr->latestSlot = -1;
+			hdr->consumerSlot = -1;
+			for(int i = 0; i < RRSHM_NSLOTS; i++)
+			{
+				hdr->slots[i].offset = hdrSize + slotSize * i;
+				hdr->slots[i].size = slotSize;
+			}
+		}
+
+		// Tell the consumer (if any) that the segment is no longer in use, and
+		// unmap it
+
+		void close(void)
+		{
+			if(hdr)
+			{
+				__atomic_store_n(&hdr->closed, 1, __ATOMIC_SEQ_CST);
+				__atomic_add_fetch(&hdr->latestSeq, 1, __ATOMIC_SEQ_CST);
+				wake();
+				munmap(hdr, hdr->size);
+				hdr = NULL;
+			}
+			if(fd >= 0)
+			{
+				::close(fd);  fd = -1;
+			}
+			slot = -1;
+		}
+
+		void wake(void)
+		{
+			syscall(SYS_futex, &hdr->latestSeq, FUTEX_WAKE, INT_MAX, NULL, NULL, 0);
+		}
+
+		char name[MAXSTR];
+		RRShmHeader *hdr;
+		int fd, slot;
+		RRFrame frame;
+		RRTransCallback callback;
+		void *context;
+};
+
+
+extern "C" {
+
+void *RRTransInit(Display *dpy, Window win, FakerConfig *fconfig)
+{
+	void *handle = NULL;
+	try
+	{
+		_newcheck(handle = (void *)(new ShmTrans(win)));
+	}
+	catch(Error &e)
+	{
+		err = e;  return NULL;
+	}
+	return handle;
+}
+
+
+int RRTransConnect(void *handle, char *receiverName, int port)
+{
+	// The consumer finds the segment by name, so there is nothing to connect
+	// to.
+	if(!handle)
+	{
+		err = Error("RRTransConnect", "Invalid handle");  return -1;
+	}
+	return 0;
+}
+
+
+RRFrame *RRTransGetFrame(void *handle, int width, int height, int format,
+	int stereo)
+{
+	try
+	{
+		ShmTrans *trans = (ShmTrans *)handle;
+		if(!trans) _throw("Invalid handle");
+		// Stereo frames are not supported.  If stereo is requested, then
+		// VirtualGL will fall back to anaglyphic stereo, because rbits is NULL.
+		return trans->getFrame(width, height, format);
+	}
+	catch(Error &e)
+	{
+		err = e;  return NULL;
+	}
+}
+
+
+// Frames are published as soon as they are sent, so the plugin is always
+// ready.
+
+int RRTransReady(void *handle)
+{
+	if(!handle)
+	{
+		err = Error("RRTransReady", "Invalid handle");  return -1;
+	}
+	return 1;
+}
+
+
+int RRTransSynchronize(void *handle)
+{
+	if(!handle)
+	{
+		err = Error("RRTransSynchronize", "Invalid handle");  return -1;
+	}
+	return 0;
+}
+
+
+int RRTransSendFrame(void *handle, RRFrame *frame, int sync)
+{
+	try
+	{
+		ShmTrans *trans = (ShmTrans *)handle;
+		if(!trans) _throw("Invalid handle");
+		trans->sendFrame(frame);
+	}
+	catch(Error &e)
+	{
+		err = e;  return -1;
+	}
+	return 0;
+}
+
+
+int RRTransDestroy(void *handle)
+{
+	try
+	{
+		ShmTrans *trans = (ShmTrans *)handle;
+		if(!trans) _throw("Invalid handle");
+		delete trans;
+	}
+	catch(Error &e)
+	{
+		err = e;  return -1;
+	}
+	return 0;
+}
+
+
+const char *RRTransGetError(void)
+{
+	snprintf(errStr, MAXSTR - 1, "Error in %s -- %s",
+		err.getMethod(), err.getMessage());
+	return errStr;
+}
+
+
+int RRTransGetVersion(void)
+{
+	return RRTRANS_VERSION;
+}
+
+
+int RRTransSetCallback(void *handle, RRTransCallback callback, void *context)
+{
+	try
+	{
+		ShmTrans *trans = (ShmTrans *)handle;
+		if(!trans || !callback) _throw("Invalid argument");
+		trans->setCallback(callback, context);
+	}
+	catch(Error &e)
+	{
+		err = e;  return -1;
+	}
+	return 1;
+}
+
+
+}  // extern "C"
@@ -26,7 +26,6 @@ static Error err;
 char errStr[MAXSTR];
 
 static FakerConfig *fconfig = NULL;
-static Window win = 0;
 
 static const int trans2pf[RRTRANS_FORMATOPT] =
 {
@@ -43,20 +42,116 @@ static const int pf2trans[PIXELFORMATS] =
 FakerConfig *fconfig_getinstance(void) { return fconfig; }
 
 
+// The maximum number of frames that can be in flight.  VGLTrans can compress
+// one frame while another is queued.
+#define MAXINFLIGHT  2
+
+
+// Each plugin instance wraps its own VGLTrans instance.  VGLTrans tells us
+// when it has finished with a frame (see VGLTrans::setFrameCallback()), and we
+// pass that on to VirtualGL's completion callback using the sequence number
+// of the corresponding RRFrame.
+
+class TestTrans
+{
+	public:
+
+		TestTrans(Window win_) : vglconn(NULL), win(win_), callback(NULL),
+			context(NULL)
+		{
+			memset(inFlight, 0, sizeof(InFlight) * MAXINFLIGHT);
+			_newcheck(vglconn = new VGLTrans());
+		}
+
+		~TestTrans(void)
+		{
+			// This stops the VGLTrans thread, so the callback cannot be called
+			// after this instance has been destroyed.
+			if(vglconn) { delete vglconn;  vglconn = NULL; }
+		}
+
+		VGLTrans *getConn(void) { return vglconn; }
+		Window getWindow(void) { return win; }
+
+		void setCallback(RRTransCallback callback_, void *context_)
+		{
+			callback = callback_;  context = context_;
+			vglconn->setFrameCallback(frameDone, this);
+		}
+
+		void sendFrame(Frame *f, unsigned int seq)
+		{
+			if(callback)
+			{
+				CriticalSection::SafeLock l(mutex);
+				int i;
+				for(i = 0; i < MAXINFLIGHT; i++)
+					if(!inFlight[i].f) break;
+				if(i >= MAXINFLIGHT) _throw("Too many frames in flight");
+				inFlight[i].f = f;  inFlight[i].seq = seq;
+			}
+			try
+			{
+				vglconn->sendFrame(f);
+			}
+			catch(...)
+			{
+				// VirtualGL doesn't expect a callback for a frame that the plugin
+				// failed to accept.
+				unsigned int dummy;
+				remove(f, dummy);
+				throw;
+			}
+		}
+
+	private:
+
+		static void frameDone(void *context, Frame *f)
+		{
+			TestTrans *trans = (TestTrans *)context;
+			unsigned int seq = 0;
+			if(trans && trans->remove(f, seq))
+				trans->callback(trans->context, seq);
+		}
+
+		bool remove(Frame *f, unsigned int &seq)
+		{
+			CriticalSection::SafeLock l(mutex);
+			for(int i = 0; i < MAXINFLIGHT; i++)
+			{
+				if(inFlight[i].f == f)
+				{
+					seq = inFlight[i].seq;  inFlight[i].f = NULL;
+					return true;
+				}
+			}
+			return false;
+		}
+
+		typedef struct { Frame *f;  unsigned int seq; } InFlight;
+
+		VGLTrans *vglconn;
+		Window win;
+		RRTransCallback callback;
+		void *context;
+		InFlight inFlight[MAXINFLIGHT];
+		CriticalSection mutex;
+};
+
+
 /* This just wraps the VGLTrans class in order to demonstrate how to build a
    custom transport plugin for VGL and also to serve as a sanity check for the
    plugin API */
 
 extern "C" {
 
-void *RRTransInit(Display *dpy, Window win_, FakerConfig *fconfig_)
+void *RRTransInit(Display *dpy, Window win, FakerConfig *fconfig_)
 {
 	void *handle = NULL;
 	try
 	{
 		fconfig = fconfig_;
-		win = win_;
-		_newcheck(handle = (void *)(new VGLTrans()));
+		_newcheck(handle = (void *)(new TestTrans(win)));
 	}
 	catch(Error &e)
 	{
@@ -71,8 +166,9 @@ int RRTransConnect(void *handle, char *receiverName, int port)
 	int ret = 0;
 	try
 	{
-		VGLTrans *vglconn = (VGLTrans *)handle;
-		if(!vglconn) _throw("Invalid handle");
+		TestTrans *trans = (TestTrans *)handle;
+		if(!trans) _throw("Invalid handle");
+		VGLTrans *vglconn = trans->getConn();
 		vglconn->connect(receiverName, port);
 	}
 	catch(Error &e)
@@ -88,8 +184,9 @@ RRFrame *RRTransGetFrame(void *handle, int width, int height, int format,
 {
 	try
 	{
-		VGLTrans *vglconn = (VGLTrans *)handle;
-		if(!vglconn) _throw("Invalid handle");
+		TestTrans *trans = (TestTrans *)handle;
+		if(!trans) _throw("Invalid handle");
+		VGLTrans *vglconn = trans->getConn();
 		RRFrame *frame;
 		_newcheck(frame = new RRFrame);
 		memset(frame, 0, sizeof(RRFrame));
@@ -123,8 +220,9 @@ int RRTransReady(void *handle)
 	int ret = -1;
 	try
 	{
-		VGLTrans *vglconn = (VGLTrans *)handle;
-		if(!vglconn) _throw("Invalid handle");
+		TestTrans *trans = (TestTrans *)handle;
+		if(!trans) _throw("Invalid handle");
+		VGLTrans *vglconn = trans->getConn();
 		ret = (int)vglconn->isReady();
 	}
 	catch(Error &e)
@@ -140,8 +238,9 @@ int RRTransSynchronize(void *handle)
 	int ret = 0;
 	try
 	{
-		VGLTrans *vglconn = (VGLTrans *)handle;
-		if(!vglconn) _throw("Invalid handle");
+		TestTrans *trans = (TestTrans *)handle;
+		if(!trans) _throw("Invalid handle");
+		VGLTrans *vglconn = trans->getConn();
 		vglconn->synchronize();
 	}
 	catch(Error &e)
@@ -157,15 +256,15 @@ int RRTransSendFrame(void *handle, RRFrame *frame, int sync)
 	int ret = 0;
 	try
 	{
-		VGLTrans *vglconn = (VGLTrans *)handle;
-		if(!vglconn) _throw("Invalid handle");
+		TestTrans *trans = (TestTrans *)handle;
+		if(!trans) _throw("Invalid handle");
 		Frame *f;
 		if(!frame || (f = (Frame *)frame->opaque) == NULL)
 			_throw("Invalid frame handle");
 		f->hdr.qual = fconfig->qual;
 		f->hdr.subsamp = fconfig->subsamp;
-		f->hdr.winid = win;
-		vglconn->sendFrame(f);
+		f->hdr.winid = trans->getWindow();
+		trans->sendFrame(f, frame->seq);
 		delete frame;
 	}
 	catch(Error &e)
@@ -181,9 +280,9 @@ int RRTransDestroy(void *handle)
 	int ret = 0;
 	try
 	{
-		VGLTrans *vglconn = (VGLTrans *)handle;
-		if(!vglconn) _throw("Invalid handle");
-		delete vglconn;
+		TestTrans *trans = (TestTrans *)handle;
+		if(!trans) _throw("Invalid handle");
+		delete trans;
 	}
 	catch(Error &e)
 	{
@@ -201,4 +300,26 @@ const char *RRTransGetError(void)
 }
 
 
+int RRTransGetVersion(void)
+{
+	return RRTRANS_VERSION;
+}
+
+
+int RRTransSetCallback(void *handle, RRTransCallback callback, void *context)
+{
+	try
+	{
+		TestTrans *trans = (TestTrans *)handle;
+		if(!trans || !callback) _throw("Invalid argument");
+		trans->setCallback(callback, context);
+	}
+	catch(Error &e)
+	{
+		err = e;  return -1;
+	}
+	return MAXINFLIGHT;
+}
+
+
 }  // extern "C"
@@ -0,0 +1,90 @@
+/* Copyright (C)2018 D. R. Commander
+ *
+ * This library is free software and may be redistributed and/or modified under
+ * the terms of the wxWindows Library License, Version 3.1 or (at your option)
+ * any later version.  The full license is in the LICENSE.txt file included
+ * with this distribution.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * wxWindows Library License for more details.
+ */
+
+/* This describes the format of the capture files written by the capture
+   transport plugin (libvgltrans_capture.so) and read by vglreplay.
+
+   A capture file consists of a VGLCapHeader structure followed by one record
+   for each frame that VirtualGL read back.  Each record consists of a
+   VGLCapRecord structure, the dirty rectangles of the frame, and the pixels
+   of the frame (followed by the pixels of the right eye image, if the frame
+   is a stereo frame.)  Pixel rows are stored in bottom-up order, exactly as
+   VirtualGL read them back.  The header, the records, and the pixels are all
+   aligned on VGLCAP_ALIGN-byte boundaries, so the file can be mapped into
+   memory and the pixels can be used in place.  All values are stored in the
+   native byte order of the host that captured the frames. */
+
+#ifndef __VGLCAPTURE_H__
+#define __VGLCAPTURE_H__
+
+#include "rrtransport.h"
+
+
+#define VGLCAP_MAGIC  0x43474C56  /* "VGLC" */
+#define VGLCAP_VERSION  1
+#define VGLCAP_ALIGN  64
+#define VGLCAP_PAD(v)  (((v) + VGLCAP_ALIGN - 1) & (~(VGLCAP_ALIGN - 1ULL)))
+
+
+typedef struct
+{
+	// VGLCAP_MAGIC and VGLCAP_VERSION
+	unsigned int magic, version;
+
+	// The number of records in the file, or 0 if the plugin did not close the
+	// file cleanly (in which case, the reader should read records until it
+	// encounters an incomplete record or the end of the file)
+	unsigned int nFrames;
+
+	unsigned int reserved;
+
+	// The size of this structure, padded to VGLCAP_ALIGN bytes (the offset of
+	// the first record)
+	unsigned long long headerSize;
+
+	unsigned char pad[40];
+} VGLCapHeader;
+
+
+typedef struct
+{
+	// The sequence number of the frame (see RRFrame::seq)
+	unsigned int seq;
+
+	// The dimensions of the frame, the number of bytes in each pixel row, and
+	// the pixel format (RRTRANS_RGB, RRTRANS_RGBA, etc.)
+	int width, height, pitch, format;
+
+	// Non-zero if the record includes a right eye image
+	int stereo;
+
+	// The time (in seconds) at which VirtualGL began reading back the frame,
+	// relative to the first frame in the file
+	double time;
+
+	// The number of dirty rectangles (see RRFrame::ndirty)
+	int nDirty;
+
+	unsigned int reserved;
+
+	// The size of the record, including this structure, the dirty rectangles,
+	// the pixels, and padding (the offset of the next record relative to this
+	// one)
+	unsigned long long size;
+
+	// The offsets of the left/mono and right eye pixels, relative to the start
+	// of the record
+	unsigned long long bitsOffset, rbitsOffset;
+} VGLCapRecord;
+
+#endif  // __VGLCAPTURE_H__
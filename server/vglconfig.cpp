@@ -148,7 +148,7 @@ void setIF(void)
 	if(!ifButton) return;
 	ifButton->value(fconfig.interframe);
 	if(strlen(fconfig.transport) > 0 || fconfig.compress == RRCOMP_JPEG
-		|| fconfig.compress == RRCOMP_RGB)
+		|| fconfig.compress == RRCOMP_RGB || fconfig.compress == RRCOMP_LOSSLESS)
 		ifButton->activate();
 	else ifButton->deactivate();
 }
@@ -273,6 +273,7 @@ Fl_Menu_Item compMenu[] =
 	{ "RGB (VGL Transport)", 0, compCB, (void *)RRCOMP_RGB },
 	{ "YUV (XV Transport)", 0, compCB, (void *)RRCOMP_XV },
 	{ "YUV (VGL Transport)", 0, compCB, (void *)RRCOMP_YUV },
+	{ "Lossless (VGL Transport)", 0, compCB, (void *)RRCOMP_LOSSLESS },
 	{ 0, 0, 0, 0 }
 };
 
@@ -0,0 +1,325 @@
+/* Copyright (C)2018 D. R. Commander
+ *
+ * This library is free software and may be redistributed and/or modified under
+ * the terms of the wxWindows Library License, Version 3.1 or (at your option)
+ * any later version.  The full license is in the LICENSE.txt file included
+ * with this distribution.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * wxWindows Library License for more details.
+ */
+
+// This program feeds the frames in a capture file (written by the capture
+// transport plugin) through the VGL Transport or the X11 Transport, so the
+// performance of the image pipeline can be measured reproducibly without a
+// 3D application or a GPU.
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "VGLTrans.h"
+#include "X11Trans.h"
+#include "vglcapture.h"
+#include "vglutil.h"
+#include "Timer.h"
+#include "Tracer.h"
+#include "fakerconfig.h"
+
+using namespace vglutil;
+using namespace vglcommon;
+using namespace vglserver;
+
+
+static const int trans2pf[RRTRANS_FORMATOPT] =
+{
+	PF_RGB, PF_RGBX, PF_BGR, PF_BGRX, PF_XBGR, PF_XRGB
+};
+
+enum { REPLAY_VGL, REPLAY_X11 };
+
+
+void usage(char **argv)
+{
+	fprintf(stderr, "\nUSAGE: %s <capture file> [options]\n\n", argv[0]);
+	fprintf(stderr, "Replay the frames in a capture file (recorded with VGL_TRANSPORT=capture)\n");
+	fprintf(stderr, "through the VGL Transport or the X11 Transport.\n\n");
+	fprintf(stderr, "Options:\n");
+	fprintf(stderr, "-x11 = Use the X11 Transport (default is the VGL Transport)\n");
+	fprintf(stderr, "-client <hostname or IP> = Hostname or IP address where the video should be\n");
+	fprintf(stderr, "                           sent (VGL client must be running on that machine)\n");
+	fprintf(stderr, "                           (default: %s)\n",
+		strlen(fconfig.client) > 0 ?
+		fconfig.client : "read from DISPLAY environment");
+	fprintf(stderr, "-port <p> = TCP port on which the VGL client is listening (default: %d)\n",
+		fconfig.port < 0 ? (fconfig.ssl ? RR_DEFAULTSSLPORT : RR_DEFAULTPORT) :
+		fconfig.port);
+	fprintf(stderr, "-samp <s> = JPEG chrominance subsampling factor: 0 (gray), 1, 2, or 4\n");
+	fprintf(stderr, "            (default: %d)\n", fconfig.subsamp);
+	fprintf(stderr, "-qual <q> = JPEG quality, 1 <= <q> <= 100 (default: %d)\n",
+		fconfig.qual);
+	fprintf(stderr, "-rgb = Use RGB (uncompressed) encoding (default is JPEG)\n");
+	#ifdef USESSL
+	fprintf(stderr, "-ssl = Use SSL tunnel (default: %s)\n",
+		fconfig.ssl ? "On" : "Off");
+	#endif
+	fprintf(stderr, "-np <n> = Number of processors to use for compression (default: %d)\n",
+		fconfig.np);
+	fprintf(stderr, "-max = Send frames as quickly as possible, rather than at the recorded\n");
+	fprintf(stderr, "       frame rate\n");
+	fprintf(stderr, "-nospoil = Wait for each frame to be delivered before sending the next\n");
+	fprintf(stderr, "-loop <n> = Replay the capture file <n> times (default: 1)\n\n");
+	fprintf(stderr, "The VGL_TILESIZE, VGL_MINTILESIZE, VGL_REFINE, VGL_INTERFRAME, and\n");
+	fprintf(stderr, "VGL_COPYRECT environment variables are honored as well.\n\n");
+	exit(1);
+}
+
+
+class CaptureFile
+{
+	public:
+
+		CaptureFile(const char *fileName) : base(NULL), size(0), nFrames(0)
+		{
+			int fd = -1;  struct stat st;
+
+			try
+			{
+				if((fd = open(fileName, O_RDONLY)) == -1) _throwunix();
+				if(fstat(fd, &st) == -1) _throwunix();
+				size = st.st_size;
+				if(size < sizeof(VGLCapHeader)) _throw("Capture file is truncated");
+				if((base = (unsigned char *)mmap(NULL, size, PROT_READ, MAP_SHARED,
+					fd, 0)) == MAP_FAILED)
+				{
+					base = NULL;  _throwunix();
+				}
+				close(fd);  fd = -1;
+
+				VGLCapHeader *hdr = (VGLCapHeader *)base;
+				if(hdr->magic != VGLCAP_MAGIC || hdr->version != VGLCAP_VERSION
+					|| hdr->headerSize < sizeof(VGLCapHeader) || hdr->headerSize > size)
+					_throw("Not a VirtualGL capture file");
+
+				// Index the records.  If the file wasn't closed cleanly, then stop at
+				// the first incomplete record.
+				unsigned long long offset = hdr->headerSize;
+				while(offset + sizeof(VGLCapRecord) <= size
+					&& (hdr->nFrames == 0 || nFrames < hdr->nFrames))
+				{
+					VGLCapRecord *rec = (VGLCapRecord *)&base[offset];
+					unsigned long long frameSize =
+						(unsigned long long)rec->pitch * rec->height;
+					if(rec->size < sizeof(VGLCapRecord) || offset + rec->size > size
+						|| rec->width < 1 || rec->height < 1 || rec->format < 0
+						|| rec->format >= RRTRANS_FORMATOPT
+						|| rec->pitch < rec->width * rrtrans_ps[rec->format]
+						|| rec->bitsOffset + frameSize > rec->size
+						|| (rec->stereo && rec->rbitsOffset + frameSize > rec->size))
+						break;
+					offset += rec->size;  nFrames++;
+				}
+				if(nFrames == 0) _throw("Capture file contains no frames");
+				if(hdr->nFrames != 0 && nFrames < hdr->nFrames)
+					_throw("Capture file is corrupt");
+				if(hdr->nFrames == 0)
+					fprintf(stderr, "WARNING: Capture file was not closed cleanly\n");
+			}
+			catch(...)
+			{
+				if(fd >= 0) close(fd);
+				if(base) munmap(base, size);
+				throw;
+			}
+		}
+
+		~CaptureFile(void)
+		{
+			if(base) munmap(base, size);
+		}
+
+		VGLCapRecord *first(void)
+		{
+			return (VGLCapRecord *)&base[((VGLCapHeader *)base)->headerSize];
+		}
+
+		VGLCapRecord *next(VGLCapRecord *rec)
+		{
+			return (VGLCapRecord *)((unsigned char *)rec + rec->size);
+		}
+
+		double duration(void)
+		{
+			VGLCapRecord *rec = first();
+			for(unsigned int n = 1; n < nFrames; n++) rec = next(rec);
+			return rec->time;
+		}
+
+		unsigned char *bits(VGLCapRecord *rec, bool right = false)
+		{
+			return (unsigned char *)rec + (right ? rec->rbitsOffset :
+				rec->bitsOffset);
+		}
+
+		unsigned char *base;
+		size_t size;
+		unsigned int nFrames;
+};
+
+
+int main(int argc, char **argv)
+{
+	Display *dpy = NULL;  Window win = 0;
+	int i, retval = 0, trans = REPLAY_VGL, loops = 1;
+	bool maxSpeed = false;
+	VGLTrans *vglconn = NULL;  X11Trans *x11trans = NULL;
+	CaptureFile *cap = NULL;
+
+	try
+	{
+		fconfig_setcompress(fconfig, RRCOMP_JPEG);
+
+		if(argc < 2) usage(argv);
+		if(!stricmp(argv[1], "-h") || !strcmp(argv[1], "-?")) usage(argv);
+
+		for(i = 2; i < argc; i++)
+		{
+			if(!stricmp(argv[i], "-h") || !strcmp(argv[i], "-?")) usage(argv);
+			#ifdef USESSL
+			else if(!stricmp(argv[i], "-ssl")) fconfig.ssl = 1;
+			#endif
+			else if(!stricmp(argv[i], "-x11"))
+			{
+				trans = REPLAY_X11;  fconfig_setcompress(fconfig, RRCOMP_PROXY);
+			}
+			else if(!stricmp(argv[i], "-client") && i < argc - 1)
+				strncpy(fconfig.client, argv[++i], MAXSTR - 1);
+			else if(!stricmp(argv[i], "-port") && i < argc - 1)
+				fconfig.port = atoi(argv[++i]);
+			else if(!stricmp(argv[i], "-samp") && i < argc - 1)
+				fconfig.subsamp = atoi(argv[++i]);
+			else if(!stricmp(argv[i], "-qual") && i < argc - 1)
+				fconfig.qual = atoi(argv[++i]);
+			else if(!stricmp(argv[i], "-np") && i < argc - 1)
+				fconfig.np = atoi(argv[++i]);
+			else if(!stricmp(argv[i], "-rgb"))
+				fconfig_setcompress(fconfig, RRCOMP_RGB);
+			else if(!stricmp(argv[i], "-max")) maxSpeed = true;
+			else if(!stricmp(argv[i], "-nospoil")) fconfig.spoil = 0;
+			else if(!stricmp(argv[i], "-loop") && i < argc - 1)
+			{
+				if((loops = atoi(argv[++i])) < 1) usage(argv);
+			}
+			else usage(argv);
+		}
+
+		Tracer::init(fconfig.tracefile);
+		Tracer::setThreadName("Replay");
+
+		_newcheck(cap = new CaptureFile(argv[1]));
+		VGLCapRecord *rec = cap->first();
+		printf("Capture file: %u frames, %d x %d, %.3f seconds\n", cap->nFrames,
+			rec->width, rec->height, cap->duration());
+
+		if(!XInitThreads()) _throw("Could not initialize X threads");
+		if((dpy = XOpenDisplay(0)) == NULL) _throw("Could not open display");
+		if((win = XCreateSimpleWindow(dpy, DefaultRootWindow(dpy), 0, 0,
+			rec->width, rec->height, 0, WhitePixel(dpy, DefaultScreen(dpy)),
+			BlackPixel(dpy, DefaultScreen(dpy)))) == 0)
+			_throw("Could not create window");
+		_errifnot(XMapRaised(dpy, win));
+		XSync(dpy, False);
+
+		if(trans == REPLAY_VGL)
+		{
+			if(strlen(fconfig.client) == 0)
+				strncpy(fconfig.client, DisplayString(dpy), MAXSTR - 1);
+			fconfig_setdefaultsfromdpy(dpy);
+			_newcheck(vglconn = new VGLTrans());
+			vglconn->connect(fconfig.client, fconfig.port);
+		}
+		else _newcheck(x11trans = new X11Trans());
+
+		unsigned long long frames = 0, pixels = 0;
+		double start = getTime(), blockTime = 0.;
+		for(int loop = 0; loop < loops; loop++)
+		{
+			double loopStart = getTime();
+			rec = cap->first();
+			for(unsigned int n = 0; n < cap->nFrames; n++, rec = cap->next(rec))
+			{
+				if(!maxSpeed)
+				{
+					double delay = loopStart + rec->time - getTime();
+					if(delay > 0.) usleep((useconds_t)(delay * 1000000.));
+				}
+
+				PF *srcpf = pf_get(trans2pf[rec->format]);
+				double t = getTime();
+				if(trans == REPLAY_VGL)
+				{
+					Frame *f;
+					int pixelFormat = fconfig.compress == RRCOMP_RGB ? PF_RGB :
+						srcpf->id;
+					bool stereo = rec->stereo && fconfig.compress != RRCOMP_RGB;
+
+					if(!fconfig.spoil) vglconn->synchronize();
+					_errifnot(f = vglconn->getFrame(rec->width, rec->height,
+						pixelFormat, FRAME_BOTTOMUP, stereo));
+					blockTime += getTime() - t;
+					srcpf->convert(cap->bits(rec), rec->width, rec->pitch, rec->height,
+						f->bits, f->pitch, f->pf);
+					if(stereo && f->rbits)
+						srcpf->convert(cap->bits(rec, true), rec->width, rec->pitch,
+							rec->height, f->rbits, f->pitch, f->pf);
+					f->hdr.winid = win;
+					f->hdr.framew = f->hdr.width;
+					f->hdr.frameh = f->hdr.height;
+					f->hdr.x = 0;
+					f->hdr.y = 0;
+					f->hdr.qual = fconfig.qual;
+					f->hdr.subsamp = fconfig.subsamp;
+					f->hdr.compress = (unsigned char)fconfig.compress;
+					vglconn->sendFrame(f);
+				}
+				else
+				{
+					FBXFrame *f;
+
+					if(!fconfig.spoil) x11trans->synchronize();
+					_errifnot(f = x11trans->getFrame(dpy, win, rec->width,
+						rec->height));
+					blockTime += getTime() - t;
+					srcpf->convert(cap->bits(rec), min(rec->width, f->hdr.framew),
+						rec->pitch, min(rec->height, f->hdr.frameh), f->bits, f->pitch,
+						f->pf);
+					f->flags |= FRAME_BOTTOMUP;
+					x11trans->sendFrame(f, !fconfig.spoil);
+				}
+				frames++;
+				pixels += (unsigned long long)rec->width * rec->height;
+			}
+		}
+		if(vglconn) vglconn->synchronize();
+		if(x11trans) x11trans->synchronize();
+		double elapsed = getTime() - start;
+
+		printf("%f frames/sec, %f Megapixels/sec\n", (double)frames / elapsed,
+			(double)pixels / 1000000. / elapsed);
+		printf("Average time waiting for a free frame buffer: %f ms\n",
+			blockTime / (double)frames * 1000.);
+	}
+	catch(Error &e)
+	{
+		fprintf(stderr, "%s--\n%s\n", e.getMethod(), e.getMessage());
+		retval = -1;
+	}
+
+	if(vglconn) delete vglconn;
+	if(x11trans) delete x11trans;
+	if(cap) delete cap;
+	if(win) XDestroyWindow(dpy, win);
+	if(dpy) XCloseDisplay(dpy);
+	return retval;
+}
@@ -44,7 +44,12 @@ void usage(char **argv)
 	fprintf(stderr, "-tilesize <n> = Width/height of each inter-frame difference tile\n");
 	fprintf(stderr, "                (default: %d x %d pixels)\n",
 		fconfig.tilesize, fconfig.tilesize);
+	fprintf(stderr, "-mintilesize <n> = Minimum width/height of each tile when subdividing\n");
+	fprintf(stderr, "                   changed tiles (default: %d x %d pixels)\n",
+		fconfig.mintilesize, fconfig.mintilesize);
 	fprintf(stderr, "-rgb = Use RGB (uncompressed) encoding (default is JPEG)\n");
+	fprintf(stderr, "-refine <s> = Losslessly re-send tiles that have been static for <s> seconds\n");
+	fprintf(stderr, "              (default: %.2f = disabled)\n", fconfig.refine);
 	#ifdef USESSL
 	fprintf(stderr, "-ssl = Use SSL tunnel (default: %s)\n",
 		fconfig.ssl ? "On" : "Off");
@@ -100,12 +105,20 @@ int main(int argc, char **argv)
 			{
 				fconfig.tilesize = atoi(argv[++i]);
 			}
+			else if(!stricmp(argv[i], "-mintilesize") && i < argc - 1)
+			{
+				fconfig.mintilesize = atoi(argv[++i]);
+			}
 			else if(!stricmp(argv[i], "-np") && i < argc - 1)
 			{
 				fconfig.np = atoi(argv[++i]);
 			}
 			else if(!stricmp(argv[i], "-rgb"))
 				fconfig_setcompress(fconfig, RRCOMP_RGB);
+			else if(!stricmp(argv[i], "-refine") && i < argc - 1)
+			{
+				fconfig.refine = atof(argv[++i]);
+			}
 			else usage(argv);
 		}
 		if(fconfig.compress == RRCOMP_RGB) bgr = 0;
@@ -139,7 +152,8 @@ int main(int argc, char **argv)
 			fconfig_setdefaultsfromdpy(dpy);
 		}
 
-		printf("Tile size = %d x %d pixels\n", fconfig.tilesize, fconfig.tilesize);
+		printf("Tile size = %d x %d pixels (minimum %d x %d)\n", fconfig.tilesize,
+			fconfig.tilesize, fconfig.mintilesize, fconfig.mintilesize);
 
 		VGLTrans vglconn;
 		if(!localtest) vglconn.connect(fconfig.client, fconfig.port);
@@ -130,7 +130,7 @@ Fake_glXUseXFont(Font font, int first, int count, int listbase)
 
    try {
 
-   GLXDrawable draw = _glXGetCurrentDrawable();
+   GLXDrawable draw = backend::getCurrentDrawable();
    if (!draw) return;
    if (winhash.find(draw, pbw)) {
       /* Current drawable is a virtualized Window */
@@ -0,0 +1,130 @@
+/* Copyright (C)2018 D. R. Commander
+ *
+ * This library is free software and may be redistributed and/or modified under
+ * the terms of the wxWindows Library License, Version 3.1 or (at your option)
+ * any later version.  The full license is in the LICENSE.txt file included
+ * with this distribution.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * wxWindows Library License for more details.
+ */
+
+// Frame pacing: limits the rate at which frames are delivered by scheduling
+// them on absolute deadlines
+#include <errno.h>
+#ifndef _WIN32
+#include <time.h>
+#include <unistd.h>
+#endif
+#include "FramePacer.h"
+#include "Timer.h"
+
+using namespace vglutil;
+
+
+// Weight given to each new sample in the running averages of the frame
+// latency and the interval between frames
+#define SAMPLE_WEIGHT  0.25
+
+// Intervals between frames longer than this (in seconds) are assumed to be
+// pauses in the application's rendering and are not averaged.
+#define MAX_ARRIVAL_INTERVAL  1.0
+
+
+FramePacer::FramePacer(void) : deadline(0.), latency(0.),
+	arrivalInterval(0.), lastArrival(0.)
+{
+}
+
+
+void FramePacer::wait(double interval)
+{
+	double target;
+
+	{
+		CriticalSection::SafeLock l(mutex);
+
+		if(interval <= 0.)
+		{
+			deadline = 0.;  return;
+		}
+		double now = time();
+		if(deadline <= 0. || now - deadline > interval) deadline = now;
+		deadline += interval;
+		target = deadline;
+	}
+
+	sleepUntil(target);
+}
+
+
+bool FramePacer::isEarly(void)
+{
+	CriticalSection::SafeLock l(mutex);
+
+	double now = time();
+	if(lastArrival > 0.)
+	{
+		double interval = now - lastArrival;
+		if(interval < MAX_ARRIVAL_INTERVAL)
+			arrivalInterval = arrivalInterval > 0. ?
+				arrivalInterval * (1. - SAMPLE_WEIGHT) + interval * SAMPLE_WEIGHT :
+				interval;
+	}
+	lastArrival = now;
+
+	if(deadline <= 0. || arrivalInterval <= 0.) return false;
+	return now + arrivalInterval + latency < deadline;
+}
+
+
+void FramePacer::addLatency(double seconds)
+{
+	CriticalSection::SafeLock l(mutex);
+
+	if(seconds < 0.) return;
+	latency = latency > 0. ?
+		latency * (1. - SAMPLE_WEIGHT) + seconds * SAMPLE_WEIGHT : seconds;
+}
+
+
+double FramePacer::time(void)
+{
+	#if defined(_WIN32) || defined(__APPLE__)
+
+	return getTime();
+
+	#else
+
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (double)ts.tv_sec + (double)ts.tv_nsec * 0.000000001;
+
+	#endif
+}
+
+
+void FramePacer::sleepUntil(double t)
+{
+	#if defined(_WIN32) || defined(__APPLE__)
+
+	double now = time();
+	if(t <= now) return;
+	#ifdef _WIN32
+	Sleep((DWORD)((t - now) * 1000.));
+	#else
+	usleep((useconds_t)((t - now) * 1000000.));
+	#endif
+
+	#else
+
+	struct timespec ts;
+	ts.tv_sec = (time_t)t;
+	ts.tv_nsec = (long)((t - (double)ts.tv_sec) * 1000000000.);
+	if(ts.tv_nsec > 999999999) ts.tv_nsec = 999999999;
+	while(clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR) {}
+
+	#endif
+}
@@ -52,7 +52,8 @@ void GenericQ::release(void)
 }
 
 
-void GenericQ::spoil(void *item, SpoilCallback spoilCallback)
+void GenericQ::spoil(void *item, SpoilCallback spoilCallback,
+	void *context)
 {
 	if(deadYet) return;
 	if(item == NULL) _throw("NULL argument in GenericQ::spoil()");
@@ -62,7 +63,7 @@ void GenericQ::spoil(void *item, SpoilCallback spoilCallback)
 	while(1)
 	{
 		get(&dummy, true);   if(!dummy) break;
-		spoilCallback(dummy);
+		spoilCallback(dummy, context);
 	}
 	add(item);
 }
@@ -109,6 +110,27 @@ void GenericQ::get(void **item, bool nonBlocking)
 }
 
 
+// This will block until there is something in the queue or until the timeout
+// (in seconds) expires.  Returns false if the timeout expired.
+bool GenericQ::timedGet(void **item, double timeout)
+{
+	if(item == NULL) _throw("NULL argument in GenericQ::timedGet()");
+	*item = NULL;
+	if(deadYet) return true;
+	if(!hasItem.timedWait(timeout)) return false;
+	if(!deadYet)
+	{
+		CriticalSection::SafeLock l(mutex);
+		if(deadYet) return true;
+		if(start == NULL) _throw("Nothing in the queue");
+		*item = start->item;
+		Entry *temp = start->next;
+		delete start;  start = temp;
+	}
+	return true;
+}
+
+
 int GenericQ::items(void)
 {
 	int retval = 0;
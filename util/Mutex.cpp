@@ -16,6 +16,8 @@
 #include "Mutex.h"
 #ifndef _WIN32
 #include <string.h>
+#include <sys/time.h>
+#include <unistd.h>
 #endif
 #include "Error.h"
 
@@ -323,6 +325,61 @@ bool Semaphore::tryWait()
 }
 
 
+// Returns false if the semaphore could not be decremented within the given
+// number of seconds
+bool Semaphore::timedWait(double seconds)
+{
+	if(seconds < 0.) seconds = 0.;
+
+	#ifdef _WIN32
+
+	DWORD err = WaitForSingleObject(sem, (DWORD)(seconds * 1000.));
+	if(err == WAIT_FAILED) throw(W32Error("Semaphore::timedWait()"));
+	else if(err == WAIT_TIMEOUT) return false;
+
+	#elif defined(__APPLE__)
+
+	// OS X does not implement sem_timedwait(), so poll with a resolution of 1
+	// ms.
+	struct timeval tv;
+	gettimeofday(&tv, NULL);
+	double deadline = (double)tv.tv_sec + (double)tv.tv_usec * 0.000001 +
+		seconds;
+	while(!tryWait())
+	{
+		gettimeofday(&tv, NULL);
+		if((double)tv.tv_sec + (double)tv.tv_usec * 0.000001 >= deadline)
+			return false;
+		usleep(1000);
+	}
+
+	#else
+
+	struct timeval tv;
+	struct timespec ts;
+	gettimeofday(&tv, NULL);
+	double deadline = (double)tv.tv_sec + (double)tv.tv_usec * 0.000001 +
+		seconds;
+	ts.tv_sec = (time_t)deadline;
+	ts.tv_nsec = (long)((deadline - (double)ts.tv_sec) * 1000000000.);
+	if(ts.tv_nsec > 999999999) ts.tv_nsec = 999999999;
+	int err = 0;
+	do
+	{
+		err = sem_timedwait(&sem, &ts);
+	} while(err < 0 && errno == EINTR);
+	if(err < 0)
+	{
+		if(errno == ETIMEDOUT) return false;
+		else throw(UnixError("Semaphore::timedWait()"));
+	}
+
+	#endif
+
+	return true;
+}
+
+
 void Semaphore::post(void)
 {
 	#ifdef _WIN32
@@ -118,6 +118,30 @@ static int xhandler(Display *dpy, XErrorEvent *e)
 	if(prevHandler && prevHandler != xhandler) return prevHandler(dpy, e);
 	else return 0;
 }
+
+
+static Bool isCompletion(Display *dpy, XEvent *e, XPointer arg)
+{
+	fbx_struct *fb = (fbx_struct *)arg;
+
+	return e->type == fb->completionType
+		&& ((XShmCompletionEvent *)e)->shmseg == fb->shminfo.shmseg;
+}
+
+
+/* Remove any XShmCompletionEvents for the buffer from the event queue, without
+   blocking.  If synced is non-zero, then the caller has already synchronized
+   with the X server, so any write for which no event was received must have
+   failed. */
+
+static void checkCompletion(fbx_struct *fb, int synced)
+{
+	XEvent e;
+
+	while(XCheckIfEvent(fb->wh.dpy, &e, isCompletion, (XPointer)fb))
+		if(fb->pending > 0) fb->pending--;
+	if(synced) fb->pending = 0;
+}
 #endif
 
 #endif
@@ -148,7 +172,8 @@ int fbx_init(fbx_struct *fb, fbx_wh wh, int width_, int height_, int useShm)
 	#ifdef _WIN32
 	BMINFO bminfo;  HBITMAP hmembmp = 0;  RECT rect;  HDC hdc = NULL;
 	#else
-	XWindowAttributes xwa;  int shmok = 1, pixmap = 0;
+	XWindowAttributes xwa;  int shmok = 1, pixmap = 0,
+		async = (useShm == FBX_ASYNCSHM);
 	#endif
 
 	if(!fb) _throw("Invalid argument");
@@ -341,6 +366,11 @@ int fbx_init(fbx_struct *fb, fbx_wh wh, int width_, int height_, int useShm)
 			shmctl(fb->shminfo.shmid, IPC_RMID, 0);  goto noshm;
 		}
 		fb->xattach = 1;  fb->shm = 1;
+		if(async && !fb->pm)
+		{
+			fb->async = 1;
+			fb->completionType = XShmGetEventBase(fb->wh.dpy) + ShmCompletion;
+		}
 	}
 	else if(useShm)
 	{
@@ -513,6 +543,9 @@ int fbx_write(fbx_struct *fb, int srcX_, int srcY_, int dstX_, int dstY_,
 	}
 	XFlush(fb->wh.dpy);
 	XSync(fb->wh.dpy, False);
+	#ifdef USESHM
+	if(fb->async) checkCompletion(fb, 1);
+	#endif
 	return 0;
 
 	#endif
@@ -587,13 +620,19 @@ int fbx_awrite(fbx_struct *fb, int srcX_, int srcY_, int dstX_, int dstY_,
 			_x11(XShmAttach(fb->wh.dpy, &fb->shminfo));  fb->xattach = 1;
 		}
 		_x11(XShmPutImage(fb->wh.dpy, fb->wh.d, fb->xgc, fb->xi, srcX, srcY, dstX,
-			dstY, width, height, False));
+			dstY, width, height, fb->async ? True : False));
+		if(fb->async) fb->pending++;
 	}
 	else
 	#endif
 	{
 		Drawable draw = fb->pixmap ? fb->wh.d : fb->pm;
-		if(draw == fb->pm) dstX = dstY = 0;
+		/* The back buffer pixmap mirrors the frame buffer, so fbx_sync() and
+		   fbx_write() can copy any region of it to the window. */
+		if(draw == fb->pm)
+		{
+			dstX = srcX;  dstY = srcY;
+		}
 		XPutImage(fb->wh.dpy, draw, fb->xgc, fb->xi, srcX, srcY, dstX, dstY, width,
 			height);
 	}
@@ -622,8 +661,91 @@ int fbx_sync(fbx_struct *fb)
 	}
 	XFlush(fb->wh.dpy);
 	XSync(fb->wh.dpy, False);
+	#ifdef USESHM
+	if(fb->async) checkCompletion(fb, 1);
+	#endif
+	return 0;
+
+	finally:
+	return -1;
+
+	#endif
+}
+
+
+int fbx_flush(fbx_struct *fb)
+{
+	#ifdef _WIN32
+
+	return 0;
+
+	#else
+
+	if(!fb) _throw("Invalid argument");
+	#ifdef USESHM
+	if(fb->async)
+	{
+		XFlush(fb->wh.dpy);
+		return 0;
+	}
+	#endif
+	return fbx_sync(fb);
+
+	finally:
+	return -1;
+
+	#endif
+}
+
+
+int fbx_wait(fbx_struct *fb)
+{
+	#ifdef _WIN32
+
+	return 0;
+
+	#else
+
+	if(!fb) _throw("Invalid argument");
+	#ifdef USESHM
+	if(fb->pending > 0)
+	{
+		checkCompletion(fb, 0);
+		/* Synchronizing, rather than waiting for the remaining events, ensures
+		   that we can't block forever if a write failed (if the window
+		   disappeared, for instance.) */
+		if(fb->pending > 0)
+		{
+			XSync(fb->wh.dpy, False);
+			checkCompletion(fb, 1);
+		}
+	}
+	#endif
+	return 0;
+
+	finally:
+	return -1;
+
+	#endif
+}
+
+
+int fbx_busy(fbx_struct *fb)
+{
+	#ifdef _WIN32
+
 	return 0;
 
+	#else
+
+	if(!fb) _throw("Invalid argument");
+	#ifdef USESHM
+	if(fb->pending > 0) checkCompletion(fb, 0);
+	return fb->pending > 0;
+	#else
+	return 0;
+	#endif
+
 	finally:
 	return -1;
 
@@ -655,6 +777,10 @@ int fbx_term(fbx_struct *fb)
 		XDestroyImage(fb->xi);
 	}
 	#ifdef USESHM
+	if(fb->async && fb->wh.dpy)
+	{
+		XSync(fb->wh.dpy, False);  checkCompletion(fb, 1);
+	}
 	if(fb->shm)
 	{
 		if(fb->xattach)
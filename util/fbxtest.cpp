@@ -142,10 +142,11 @@ void clearFB(void)
 // Platform-specific write test
 void nativeWrite(bool useShm)
 {
-	fbx_struct fb;  int i = 0;  double drawTime;
+	fbx_struct fb, afb[2];  int i = 0;  double drawTime;
 	Timer timer, timer2;
 
 	memset(&fb, 0, sizeof(fb));
+	memset(afb, 0, sizeof(afb));
 
 	try
 	{
@@ -231,6 +232,48 @@ void nativeWrite(bool useShm)
 		}
 		else fprintf(stderr, " (no errors)\n");
 
+		#ifndef _WIN32
+		if(useShm)
+		{
+			// Alternate between two buffers, so that we can fill one while the X
+			// server is reading the other.
+			for(int j = 0; j < 2; j++)
+				_fbx(fbx_init(&afb[j], wh, 0, 0, FBX_ASYNCSHM));
+			clearFB();
+			fprintf(stderr, "FBX async top-down write [SHM]:");
+			i = 0;  drawTime = 0.;  timer2.start();
+			do
+			{
+				fbx_struct *cur = &afb[i % 2];
+				timer.start();
+				_fbx(fbx_wait(cur));
+				drawTime += timer.elapsed();
+				initBuf(0, 0, cur->width, cur->pitch, cur->height, cur->pf,
+					(unsigned char *)cur->bits, i);
+				timer.start();
+				_fbx(fbx_awrite(cur, 0, 0, 0, 0, 0, 0));
+				_fbx(fbx_flush(cur));
+				drawTime += timer.elapsed();
+				i++;
+			} while(timer2.elapsed() < benchTime);
+			timer.start();
+			_fbx(fbx_sync(&afb[(i - 1) % 2]));
+			drawTime += timer.elapsed();
+			fprintf(stderr, " %f Mpixels/sec",
+				(double)i * (double)(fb.width * fb.height) /
+					((double)1000000. * drawTime));
+			memset(fb.bits, 0, fb.pitch * fb.height);
+			_fbx(fbx_read(&fb, 0, 0));
+			if(!cmpBuf(0, 0, fb.width, fb.pitch, fb.height, fb.pf,
+				(unsigned char *)fb.bits, i - 1))
+			{
+				fprintf(stderr, " (ERROR CHECK FAILED)\n");
+				retCode = -1;
+			}
+			else fprintf(stderr, " (no errors)\n");
+		}
+		#endif
+
 		clearFB();
 		if(useShm)
 			fprintf(stderr, "FBX top-down write [SHM]:      ");
@@ -274,6 +317,7 @@ void nativeWrite(bool useShm)
 
 	pixelOffset = i - 1;
 
+	fbx_term(&afb[0]);  fbx_term(&afb[1]);
 	fbx_term(&fb);
 }
 
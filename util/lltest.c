@@ -0,0 +1,334 @@
+/* Copyright (C)2018 D. R. Commander
+ *
+ * This library is free software and may be redistributed and/or modified under
+ * the terms of the wxWindows Library License, Version 3.1 or (at your option)
+ * any later version.  The full license is in the LICENSE.txt file included
+ * with this distribution.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * wxWindows Library License for more details.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "lossless.h"
+#include "vglutil.h"
+#include "Timer.h"
+
+
+#define BENCHTIME  2.0
+
+#define _throw(m) \
+{ \
+	printf("\n   ERROR: %s\n", m);  retval = -1;  goto bailout; \
+}
+#define _ll(f) \
+{ \
+	if((f) == -1) _throw(ll_geterr()); \
+}
+
+
+enum { PATTERN_FLAT = 0, PATTERN_GRADIENT, PATTERN_NOISE, NUMPATTERNS };
+static const char *patternName[NUMPATTERNS] = { "flat", "gradient", "noise" };
+
+double testTime = BENCHTIME;
+
+
+void initBuf(unsigned char *buf, int width, int pitch, int height, PF *pf,
+	int pattern)
+{
+	int i, j;
+
+	srand(width * height);
+	for(j = 0; j < height; j++)
+	{
+		for(i = 0; i < width; i++)
+		{
+			int r, g, b;
+			memset(&buf[j * pitch + i * pf->size], 0, pf->size);
+			switch(pattern)
+			{
+				case PATTERN_FLAT:
+					r = 64;  g = i < width / 2 ? 128 : 32;  b = j < height / 2 ? 192 : 16;
+					break;
+				case PATTERN_GRADIENT:
+					r = (i * 256 / width) % 256;  g = (j * 256 / height) % 256;
+					b = (j * 256 / height + i * 256 / width) % 256;
+					break;
+				default:
+					r = rand() % 256;  g = rand() % 256;  b = rand() % 256;
+			}
+			pf->setRGB(&buf[j * pitch + i * pf->size], r, g, b);
+		}
+	}
+}
+
+
+int cmpBuf(unsigned char *buf, int pitch, unsigned char *buf2, int pitch2,
+	int width, int height, PF *pf, PF *pf2)
+{
+	int i, j;
+
+	for(j = 0; j < height; j++)
+	{
+		for(i = 0; i < width; i++)
+		{
+			int r, g, b, r2, g2, b2;
+			pf->getRGB(&buf[j * pitch + i * pf->size], &r, &g, &b);
+			pf2->getRGB(&buf2[j * pitch2 + i * pf2->size], &r2, &g2, &b2);
+			if(r != r2 || g != g2 || b != b2) return 0;
+		}
+	}
+	return 1;
+}
+
+
+int doTest(int width, int height, PF *srcpf, PF *dstpf, int pattern,
+	int effort, int bench)
+{
+	int retval = 0, iter = 0, srcPitch = width * srcpf->size,
+		dstPitch = width * dstpf->size;
+	unsigned char *srcBuf = NULL, *dstBuf = NULL, *llBuf = NULL;
+	unsigned long llSize = 0;
+	double tStart, encodeTime = 0., decodeTime = 0.;
+
+	if((srcBuf = (unsigned char *)malloc(srcPitch * height)) == NULL
+		|| (dstBuf = (unsigned char *)malloc(dstPitch * height)) == NULL
+		|| (llBuf = (unsigned char *)malloc(ll_bufsize(width, height))) == NULL)
+		_throw("Could not allocate memory");
+	initBuf(srcBuf, width, srcPitch, height, srcpf, pattern);
+	memset(dstBuf, 0, dstPitch * height);
+
+	if(bench)
+		printf("%-8s --> %-8s %-8s effort %d:  ", srcpf->name, dstpf->name,
+			patternName[pattern], effort);
+
+	tStart = getTime();
+	do
+	{
+		_ll(ll_encode(&srcBuf[srcPitch * (height - 1)], width, -srcPitch, height,
+			NULL, 0, srcpf, llBuf, &llSize, effort));
+		iter++;
+	} while(bench && (encodeTime = getTime() - tStart) < testTime);
+	if(llSize > ll_bufsize(width, height)) _throw("Buffer overrun");
+	if(bench) encodeTime /= (double)iter;
+
+	iter = 0;  tStart = getTime();
+	do
+	{
+		_ll(ll_decode(llBuf, llSize, width, height, &dstBuf[dstPitch * (height - 1)],
+			-dstPitch, dstpf));
+		iter++;
+	} while(bench && (decodeTime = getTime() - tStart) < testTime);
+	if(bench) decodeTime /= (double)iter;
+
+	if(!cmpBuf(srcBuf, srcPitch, dstBuf, dstPitch, width, height, srcpf, dstpf))
+		_throw("Pixel data is bogus");
+	if(bench && pattern == PATTERN_FLAT
+		&& llSize * 10 > (unsigned long)(width * height * 3))
+		_throw("Flat image was not compressed");
+
+	if(bench)
+		printf("ratio %7.2f:1  enc %8.2f  dec %8.2f Mpixels/sec\n",
+			(double)(width * height * 3) / (double)llSize,
+			(double)(width * height) / 1000000. / encodeTime,
+			(double)(width * height) / 1000000. / decodeTime);
+
+	bailout:
+	if(srcBuf) free(srcBuf);
+	if(dstBuf) free(dstBuf);
+	if(llBuf) free(llBuf);
+	return retval;
+}
+
+
+/* Make sure that an image that differs only slightly from the reference image
+   (the previous frame) is reconstructed correctly and compressed well, even
+   if the reference image itself is incompressible */
+
+int doPrevTest(PF *srcpf, PF *dstpf, int effort)
+{
+	int retval = 0, width = 256, height = 256, srcPitch = width * srcpf->size,
+		dstPitch = width * dstpf->size, i, j;
+	unsigned char *srcBuf = NULL, *refBuf = NULL, *dstBuf = NULL,
+		*rgbBuf = NULL, *llBuf = NULL;
+	unsigned long llSize = 0;
+	PF *rgbpf = pf_get(PF_RGB);
+
+	if((srcBuf = (unsigned char *)malloc(srcPitch * height)) == NULL
+		|| (refBuf = (unsigned char *)malloc(srcPitch * height)) == NULL
+		|| (dstBuf = (unsigned char *)malloc(dstPitch * height)) == NULL
+		|| (rgbBuf = (unsigned char *)malloc(width * 3 * height)) == NULL
+		|| (llBuf = (unsigned char *)malloc(ll_bufsize(width, height))) == NULL)
+		_throw("Could not allocate memory");
+	initBuf(refBuf, width, srcPitch, height, srcpf, PATTERN_NOISE);
+	memcpy(srcBuf, refBuf, srcPitch * height);
+	for(j = 32; j < 48; j++)
+	{
+		for(i = 64; i < 96; i++)
+			srcpf->setRGB(&srcBuf[j * srcPitch + i * srcpf->size], i, j, 255 - i);
+	}
+	/* The decoder uses the contents of the destination buffer as the reference
+	   image. */
+	srcpf->convert(refBuf, width, srcPitch, height, dstBuf, dstPitch, dstpf);
+
+	_ll(ll_encode(&srcBuf[srcPitch * (height - 1)], width, -srcPitch, height,
+		&refBuf[srcPitch * (height - 1)], -srcPitch, srcpf, llBuf, &llSize,
+		effort));
+	if(llSize > ll_bufsize(width, height)) _throw("Buffer overrun");
+	_ll(ll_decode(llBuf, llSize, width, height, &dstBuf[dstPitch * (height - 1)],
+		-dstPitch, dstpf));
+
+	dstpf->convert(dstBuf, width, dstPitch, height, rgbBuf, width * 3, rgbpf);
+	if(!cmpBuf(srcBuf, srcPitch, rgbBuf, width * 3, width, height, srcpf, rgbpf))
+		_throw("Pixel data is bogus");
+	if(llSize * 10 > (unsigned long)(width * height * 3))
+		_throw("Previous-frame filter was not used");
+
+	bailout:
+	if(srcBuf) free(srcBuf);
+	if(refBuf) free(refBuf);
+	if(dstBuf) free(dstBuf);
+	if(rgbBuf) free(rgbBuf);
+	if(llBuf) free(llBuf);
+	return retval;
+}
+
+
+/* Make sure that the decoder rejects (rather than overruns its buffers when
+   given) truncated or corrupt input */
+
+int doCorruptTest(void)
+{
+	int retval = 0, width = 37, height = 23, i;
+	PF *pf = pf_get(PF_RGB);
+	unsigned char *srcBuf = NULL, *dstBuf = NULL, *llBuf = NULL;
+	unsigned long llSize = 0;
+
+	printf("Corrupt input test:  ");
+	if((srcBuf = (unsigned char *)malloc(width * height * 3)) == NULL
+		|| (dstBuf = (unsigned char *)malloc(width * height * 3)) == NULL
+		|| (llBuf = (unsigned char *)malloc(ll_bufsize(width, height))) == NULL)
+		_throw("Could not allocate memory");
+	initBuf(srcBuf, width, width * 3, height, pf, PATTERN_GRADIENT);
+	_ll(ll_encode(srcBuf, width, width * 3, height, NULL, 0, pf, llBuf, &llSize,
+		LL_MAXEFFORT));
+
+	if(ll_decode(llBuf, llSize - 1, width, height, dstBuf, width * 3, pf) != -1)
+		_throw("Truncated image was not rejected");
+	if(ll_decode(llBuf, llSize, width - 1, height, dstBuf, width * 3, pf) != -1)
+		_throw("Image with wrong dimensions was not rejected");
+	for(i = 0; i < 1000; i++)
+	{
+		unsigned long j;
+		for(j = 0; j < llSize; j++) llBuf[j] = rand() % 256;
+		ll_decode(llBuf, llSize, width, height, dstBuf, width * 3, pf);
+	}
+	printf("Passed.\n");
+
+	bailout:
+	if(srcBuf) free(srcBuf);
+	if(dstBuf) free(dstBuf);
+	if(llBuf) free(llBuf);
+	return retval;
+}
+
+
+void usage(char **argv)
+{
+	fprintf(stderr, "\nUSAGE: %s [options]\n\n", argv[0]);
+	fprintf(stderr, "Options:\n");
+	fprintf(stderr, "-time <t> = Set benchmark time to <t> seconds (default: %.1f)\n\n",
+		BENCHTIME);
+	exit(1);
+}
+
+
+int main(int argc, char **argv)
+{
+	int retval = 0, srcFormat, dstFormat, pattern, effort, i, w, h;
+	static const int sizes[] = { 1, 2, 3, 7, 48, 129 };
+	#define NSIZES  (int)(sizeof(sizes) / sizeof(int))
+
+	if(argc > 1) for(i = 1; i < argc; i++)
+	{
+		if(!stricmp(argv[i], "-h") || !strcmp(argv[i], "-?")) usage(argv);
+		else if(!stricmp(argv[i], "-time") && i < argc - 1)
+		{
+			testTime = atof(argv[++i]);
+			if(testTime <= 0.0) usage(argv);
+		}
+		else usage(argv);
+	}
+
+	printf("Round-trip test:  ");
+	for(srcFormat = 0; srcFormat < PIXELFORMATS - 1; srcFormat++)
+	{
+		PF *pf = pf_get(srcFormat);
+		if(pf->bpc != 8) continue;
+		for(pattern = 0; pattern < NUMPATTERNS; pattern++)
+		{
+			for(effort = 0; effort <= LL_MAXEFFORT; effort++)
+			{
+				for(w = 0; w < NSIZES; w++)
+				{
+					for(h = 0; h < NSIZES; h++)
+					{
+						if(doTest(sizes[w], sizes[h], pf, pf, pattern, effort, 0) == -1)
+						{
+							retval = -1;  goto bailout;
+						}
+					}
+				}
+			}
+		}
+	}
+	printf("Passed.\n");
+
+	printf("Previous-frame test:  ");
+	for(srcFormat = 0; srcFormat < PIXELFORMATS - 1; srcFormat++)
+	{
+		PF *srcpf = pf_get(srcFormat);
+		if(srcpf->bpc != 8) continue;
+		for(dstFormat = 0; dstFormat < PIXELFORMATS - 1; dstFormat++)
+		{
+			for(effort = 0; effort <= LL_MAXEFFORT; effort++)
+			{
+				if(doPrevTest(srcpf, pf_get(dstFormat), effort) == -1)
+				{
+					retval = -1;  goto bailout;
+				}
+			}
+		}
+	}
+	printf("Passed.\n");
+
+	if(doCorruptTest() == -1)
+	{
+		retval = -1;  goto bailout;
+	}
+	printf("\n");
+
+	for(srcFormat = 0; srcFormat < PIXELFORMATS - 1; srcFormat++)
+	{
+		PF *srcpf = pf_get(srcFormat);
+		if(srcpf->bpc != 8) continue;
+		for(pattern = 0; pattern < NUMPATTERNS; pattern++)
+		{
+			for(effort = 0; effort <= LL_MAXEFFORT; effort++)
+			{
+				if(doTest(1024, 768, srcpf, pf_get(PF_RGB), pattern, effort, 1) == -1)
+				{
+					retval = -1;  goto bailout;
+				}
+			}
+		}
+		printf("\n");
+	}
+
+	bailout:
+	return retval;
+}
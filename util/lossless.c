@@ -0,0 +1,329 @@
+/* Copyright (C)2018 D. R. Commander
+ *
+ * This library is free software and may be redistributed and/or modified under
+ * the terms of the wxWindows Library License, Version 3.1 or (at your option)
+ * any later version.  The full license is in the LICENSE.txt file included
+ * with this distribution.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * wxWindows Library License for more details.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "lossless.h"
+
+
+/* Encoded stream format:
+
+   The image is first transformed into a sequence of filtered RGB rows.  The
+   stream begins with a one-byte filter type for each row, and the filtered
+   pixels follow, run-length encoded (without regard to row boundaries) as a
+   series of packets.  A packet header byte n in the range 0-127 is followed by
+   n + 1 literal pixels (3 bytes each), and a packet header byte n in the range
+   128-255 is followed by a single pixel that is repeated n - 126 times (2-129
+   times.)  Operating on whole pixels rather than bytes allows flat regions of
+   any color to be encoded as runs.
+
+   FILTER_PREV predicts each pixel from the pixel at the same position in the
+   destination buffer, so an image encoded with a reference image must be
+   decoded into a buffer that already contains that reference image. */
+
+enum
+{
+	FILTER_NONE = 0, FILTER_LEFT, FILTER_UP, FILTER_AVERAGE, FILTER_PREV,
+	NUMFILTERS
+};
+
+#define MAXLITERAL  128
+#define MINRUN  2
+#define MAXRUN  129
+
+#define SAMEPIXEL(a, b)  ((a)[0] == (b)[0] && (a)[1] == (b)[1] \
+	&& (a)[2] == (b)[2])
+
+
+static const char *errorStr = "No error";
+
+
+#define _throw(m) \
+{ \
+	errorStr = m;  ret = -1;  goto finally; \
+}
+
+
+unsigned long ll_bufsize(int width, int height)
+{
+	unsigned long nPixels;
+
+	if(width < 1 || height < 1) return 0;
+	nPixels = (unsigned long)width * (unsigned long)height;
+	return (unsigned long)height + nPixels * 3 +
+		(nPixels + MAXLITERAL - 1) / MAXLITERAL + 1;
+}
+
+
+static void toRGB(unsigned char *dst, unsigned char *src, int width, PF *pf)
+{
+	int i;
+
+	if(pf->id == PF_RGB) memcpy(dst, src, width * 3);
+	else
+	{
+		for(i = 0; i < width; i++, src += pf->size, dst += 3)
+		{
+			dst[0] = src[pf->rindex];
+			dst[1] = src[pf->gindex];
+			dst[2] = src[pf->bindex];
+		}
+	}
+}
+
+
+static void filterRow(unsigned char *dst, unsigned char *cur,
+	unsigned char *prev, unsigned char *ref, int rowSize, int filter)
+{
+	int i;
+
+	switch(filter)
+	{
+		case FILTER_LEFT:
+			for(i = 0; i < 3 && i < rowSize; i++) dst[i] = cur[i];
+			for(; i < rowSize; i++) dst[i] = cur[i] - cur[i - 3];
+			break;
+		case FILTER_UP:
+			for(i = 0; i < rowSize; i++) dst[i] = cur[i] - prev[i];
+			break;
+		case FILTER_AVERAGE:
+			for(i = 0; i < 3 && i < rowSize; i++) dst[i] = cur[i] - (prev[i] >> 1);
+			for(; i < rowSize; i++)
+				dst[i] = cur[i] - (unsigned char)(((int)cur[i - 3] + prev[i]) >> 1);
+			break;
+		case FILTER_PREV:
+			for(i = 0; i < rowSize; i++) dst[i] = cur[i] - ref[i];
+			break;
+		default:
+			memcpy(dst, cur, rowSize);
+	}
+}
+
+
+static void unfilterRow(unsigned char *row, unsigned char *prev,
+	unsigned char *ref, int rowSize, int filter)
+{
+	int i;
+
+	switch(filter)
+	{
+		case FILTER_LEFT:
+			for(i = 3; i < rowSize; i++) row[i] += row[i - 3];
+			break;
+		case FILTER_UP:
+			for(i = 0; i < rowSize; i++) row[i] += prev[i];
+			break;
+		case FILTER_AVERAGE:
+			for(i = 0; i < 3 && i < rowSize; i++) row[i] += prev[i] >> 1;
+			for(; i < rowSize; i++)
+				row[i] += (unsigned char)(((int)row[i - 3] + prev[i]) >> 1);
+			break;
+		case FILTER_PREV:
+			for(i = 0; i < rowSize; i++) row[i] += ref[i];
+			break;
+	}
+}
+
+
+/* The number of pixels in the filtered row that differ from their left
+   neighbor.  Since the filtered pixels are run-length encoded, this
+   approximates the encoded size of the row more closely than the sum of
+   absolute residuals that PNG encoders use. */
+
+static unsigned long rowCost(unsigned char *row, int rowSize)
+{
+	unsigned long cost = 1;
+	int i;
+
+	for(i = 3; i < rowSize; i += 3)
+		if(!SAMEPIXEL(&row[i], &row[i - 3])) cost++;
+	return cost;
+}
+
+
+static unsigned long packPixels(unsigned char *src, unsigned long nPixels,
+	unsigned char *dst)
+{
+	unsigned long i = 0, literalStart = 0, dstSize = 0;
+
+	while(i < nPixels)
+	{
+		unsigned char *pixel = &src[i * 3];
+		unsigned long run = 1;
+		while(i + run < nPixels && run < MAXRUN
+			&& SAMEPIXEL(&pixel[run * 3], pixel))
+			run++;
+		if(run >= MINRUN)
+		{
+			while(literalStart < i)
+			{
+				unsigned long n = i - literalStart;
+				if(n > MAXLITERAL) n = MAXLITERAL;
+				dst[dstSize++] = (unsigned char)(n - 1);
+				memcpy(&dst[dstSize], &src[literalStart * 3], n * 3);
+				dstSize += n * 3;  literalStart += n;
+			}
+			dst[dstSize++] = (unsigned char)(run + 126);
+			memcpy(&dst[dstSize], pixel, 3);
+			dstSize += 3;
+			i += run;  literalStart = i;
+		}
+		else i += run;
+	}
+	while(literalStart < nPixels)
+	{
+		unsigned long n = nPixels - literalStart;
+		if(n > MAXLITERAL) n = MAXLITERAL;
+		dst[dstSize++] = (unsigned char)(n - 1);
+		memcpy(&dst[dstSize], &src[literalStart * 3], n * 3);
+		dstSize += n * 3;  literalStart += n;
+	}
+	return dstSize;
+}
+
+
+int ll_encode(unsigned char *srcBuf, int width, int srcStride, int height,
+	unsigned char *refBuf, int refStride, PF *pf, unsigned char *dstBuf,
+	unsigned long *dstSize, int effort)
+{
+	int j, f, rowSize = width * 3, ret = 0;
+	unsigned char *work = NULL, *cur, *prev, *ref, *trial, *filtered, *temp;
+
+	if(!srcBuf || width < 1 || height < 1 || !pf || !dstBuf || !dstSize
+		|| effort < 0 || effort > LL_MAXEFFORT)
+		_throw("Invalid argument");
+	if(pf->bpc != 8 || pf->size < 3)
+		_throw("Lossless encoding requires 8 bits per component");
+
+	if((work = (unsigned char *)malloc(rowSize * height + rowSize * 4)) == NULL)
+		_throw("Memory allocation error");
+	filtered = work;
+	cur = &work[rowSize * height];  prev = &cur[rowSize];
+	ref = &prev[rowSize];  trial = &ref[rowSize];
+
+	for(j = 0; j < height; j++, srcBuf += srcStride)
+	{
+		int filter = FILTER_NONE;
+
+		toRGB(cur, srcBuf, width, pf);
+
+		if(effort == 0)
+		{
+			/* Effort 0 doesn't search for the best prediction filter, but rows
+			   that are unchanged from the reference image are cheap to detect. */
+			if(refBuf && !memcmp(srcBuf, refBuf, width * pf->size))
+			{
+				memcpy(ref, cur, rowSize);  filter = FILTER_PREV;
+			}
+		}
+		else
+		{
+			unsigned long bestCost = 0, cost;
+			if(refBuf) toRGB(ref, refBuf, width, pf);
+			for(f = effort >= 2 ? FILTER_NONE : FILTER_LEFT; f < NUMFILTERS; f++)
+			{
+				if((j == 0 && (f == FILTER_UP || f == FILTER_AVERAGE))
+					|| (!refBuf && f == FILTER_PREV)
+					|| (effort < 2 && f == FILTER_AVERAGE))
+					continue;
+				filterRow(trial, cur, prev, ref, rowSize, f);
+				cost = rowCost(trial, rowSize);
+				if(f == (effort >= 2 ? FILTER_NONE : FILTER_LEFT) || cost < bestCost)
+				{
+					bestCost = cost;  filter = f;
+				}
+				if(bestCost == 1) break;
+			}
+		}
+		dstBuf[j] = (unsigned char)filter;
+		filterRow(&filtered[rowSize * j], cur, prev, ref, rowSize, filter);
+		temp = prev;  prev = cur;  cur = temp;
+		if(refBuf) refBuf += refStride;
+	}
+
+	*dstSize = (unsigned long)height +
+		packPixels(filtered, (unsigned long)width * height, &dstBuf[height]);
+
+	finally:
+	if(work) free(work);
+	return ret;
+}
+
+
+int ll_decode(unsigned char *srcBuf, unsigned long srcSize, int width,
+	int height, unsigned char *dstBuf, int dstStride, PF *dstpf)
+{
+	int j, rowSize = width * 3, ret = 0;
+	unsigned long i, size = 0, workSize;
+	unsigned char *work = NULL, *row, *prev = NULL, *ref;
+
+	if(!srcBuf || srcSize < 1 || width < 1 || height < 1 || !dstBuf || !dstpf)
+		_throw("Invalid argument");
+	if(dstpf->bpc < 8)
+		_throw("Destination frame has the wrong pixel format");
+	if(srcSize < (unsigned long)height) _throw("Corrupt lossless image");
+
+	workSize = (unsigned long)rowSize * height;
+	if((work = (unsigned char *)malloc(workSize + rowSize)) == NULL)
+		_throw("Memory allocation error");
+	ref = &work[workSize];
+
+	i = (unsigned long)height;
+	while(i < srcSize)
+	{
+		unsigned long n = srcBuf[i++];
+		if(n < MAXLITERAL)
+		{
+			n = (n + 1) * 3;
+			if(i + n > srcSize || size + n > workSize)
+				_throw("Corrupt lossless image");
+			memcpy(&work[size], &srcBuf[i], n);
+			i += n;  size += n;
+		}
+		else
+		{
+			n -= 126;
+			if(i + 3 > srcSize || size + n * 3 > workSize)
+				_throw("Corrupt lossless image");
+			for(; n > 0; n--, size += 3) memcpy(&work[size], &srcBuf[i], 3);
+			i += 3;
+		}
+	}
+	if(size != workSize) _throw("Corrupt lossless image");
+
+	for(j = 0, row = work; j < height; j++, row += rowSize)
+	{
+		int filter = srcBuf[j];
+		if(filter >= NUMFILTERS || (!prev && (filter == FILTER_UP
+			|| filter == FILTER_AVERAGE)))
+			_throw("Corrupt lossless image");
+		if(filter == FILTER_PREV)
+			dstpf->convert(&dstBuf[dstStride * j], width, dstStride, 1, ref,
+				rowSize, pf_get(PF_RGB));
+		unfilterRow(row, prev, ref, rowSize, filter);
+		prev = row;
+	}
+
+	pf_get(PF_RGB)->convert(work, width, rowSize, height, dstBuf, dstStride,
+		dstpf);
+
+	finally:
+	if(work) free(work);
+	return ret;
+}
+
+
+const char *ll_geterr(void)
+{
+	return errorStr;
+}
@@ -464,6 +464,346 @@ static INLINE void convert_X2_RGB10(unsigned char *srcBuf, int width,
 }
 
 
+/* SIMD pixel conversion
+
+   The SIMD kernels convert groups of 4 (or, with AVX2, 8) pixels using the
+   same algorithm for all pairs of pixel formats.  If both pixel formats have 8
+   bits per component, then each group is converted with a single byte
+   shuffle.  Otherwise, 3-byte pixels are expanded to 4 bytes, each component
+   is masked and shifted into place, and the pixels are then compressed to 3
+   bytes if necessary.  The kernels never read or write past the end of a row,
+   so they leave a few pixels at the end of each row to the scalar code.  The
+   kernels produce exactly the same output as the 64-bit scalar code,
+   including the padding bytes of 4-byte pixels (which are zeroed, except when
+   converting from a 3-byte to a 4-byte pixel format, in which case they are
+   preserved.) */
+
+#if !defined(BOOST_BIG_ENDIAN) && (defined(__x86_64__) || defined(__i386__)) \
+	&& (defined(__clang__) || __GNUC__ > 4 || \
+		(__GNUC__ == 4 && __GNUC_MINOR__ >= 9))
+#define PF_SIMD
+#define PF_SIMD_X86
+#include <cpuid.h>
+#include <immintrin.h>
+#endif
+
+#ifdef PF_SIMD
+
+#include <stdlib.h>
+
+enum { SIMD_NONE = 0, SIMD_SSSE3, SIMD_AVX2 };
+static const char *simdName[] = { "None", "SSSE3", "AVX2" };
+
+typedef int (*SIMDConvert)(PF *srcpf, unsigned char *srcBuf, int width,
+	int srcStride, int height, unsigned char *dstBuf, int dstStride,
+	PF *dstpf);
+
+static int simdLevel = -1;
+static SIMDConvert simdConvert = NULL;
+
+
+typedef struct
+{
+	int srcSize, dstSize;
+	/* 0 = both pixel formats have 8 bits per component, so the pre-shuffle
+	   does all of the work */
+	int shift;
+	/* Non-zero if the padding bytes of the destination pixels should be
+	   preserved */
+	int keepX;
+	/* Byte shuffles applied before and after the shift stage */
+	unsigned char pre[16], post[16];
+	/* Destination bytes to preserve (if keepX is non-zero) */
+	unsigned char keep[16];
+	/* Each component is computed as ((pixel >> rshift) & mask) << lshift. */
+	int rshift[3], lshift[3];
+	unsigned int mask;
+} SIMDParams;
+
+
+/* Returns the bit position of component c (0 = red, 1 = green, 2 = blue)
+   within a pixel of the specified format, if the pixel is loaded into a
+   32-bit little-endian integer */
+
+static INLINE int simdPos(PF *pf, int c)
+{
+	if(pf->size == 3)
+		return (c == 0 ? pf->rindex : c == 1 ? pf->gindex : pf->bindex) * 8;
+	return c == 0 ? pf->rshift : c == 1 ? pf->gshift : pf->bshift;
+}
+
+
+static int simdGetParams(PF *srcpf, PF *dstpf, SIMDParams *p)
+{
+	int i, c;
+
+	if(!dstpf || srcpf->id == dstpf->id || srcpf->id >= PF_COMP
+		|| dstpf->id >= PF_COMP)
+		return 0;
+
+	p->srcSize = srcpf->size;  p->dstSize = dstpf->size;
+	p->shift = (srcpf->bpc != 8 || dstpf->bpc != 8);
+	p->keepX = (!p->shift && p->srcSize == 3 && p->dstSize == 4);
+	for(i = 0; i < 16; i++)
+	{
+		p->pre[i] = p->post[i] = i;  p->keep[i] = 0xFF;
+	}
+	for(c = 0; c < 3; c++)
+	{
+		p->rshift[c] = simdPos(srcpf, c) + (srcpf->bpc > dstpf->bpc ? 2 : 0);
+		p->lshift[c] = simdPos(dstpf, c) + (dstpf->bpc > srcpf->bpc ? 2 : 0);
+	}
+	p->mask = (srcpf->bpc == 10 && dstpf->bpc == 10) ? 0x3FF : 0xFF;
+
+	if(!p->shift)
+	{
+		memset(p->pre, 0x80, 16);
+		for(i = 0; i < 4; i++)
+		{
+			for(c = 0; c < 3; c++)
+			{
+				int dstByte = i * p->dstSize + simdPos(dstpf, c) / 8;
+				p->pre[dstByte] = i * p->srcSize + simdPos(srcpf, c) / 8;
+				p->keep[dstByte] = 0;
+			}
+		}
+	}
+	else
+	{
+		if(p->srcSize == 3)
+			for(i = 0; i < 16; i++)
+				p->pre[i] = (i & 3) == 3 ? 0x80 : (i >> 2) * 3 + (i & 3);
+		if(p->dstSize == 3)
+			for(i = 0; i < 16; i++)
+				p->post[i] = i < 12 ? (i / 3) * 4 + i % 3 : 0x80;
+	}
+	return 1;
+}
+
+
+/* Returns the number of groups of n pixels in a row of the specified width
+   that can be converted without reading or writing past the end of the row.
+   Converting a group reads and writes (n - 4) * size + 16 bytes. */
+
+static INLINE int simdGroups(SIMDParams *p, int width, int n)
+{
+	int size = min(p->srcSize, p->dstSize);
+	int minWidth = ((n - 4) * size + 16 + size - 1) / size;
+
+	if(width < minWidth) return 0;
+	return (width - minWidth) / n + 1;
+}
+
+
+#ifdef PF_SIMD_X86
+
+#define SIMD_SHIFT_SSE2(v) \
+	_mm_or_si128(_mm_or_si128( \
+		_mm_sll_epi32(_mm_and_si128(_mm_srl_epi32(v, rshift0), mask), lshift0), \
+		_mm_sll_epi32(_mm_and_si128(_mm_srl_epi32(v, rshift1), mask), \
+			lshift1)), \
+		_mm_sll_epi32(_mm_and_si128(_mm_srl_epi32(v, rshift2), mask), lshift2))
+
+#define SIMD_SETUP_SSE2() \
+	__m128i rshift0 = _mm_cvtsi32_si128(p.rshift[0]); \
+	__m128i rshift1 = _mm_cvtsi32_si128(p.rshift[1]); \
+	__m128i rshift2 = _mm_cvtsi32_si128(p.rshift[2]); \
+	__m128i lshift0 = _mm_cvtsi32_si128(p.lshift[0]); \
+	__m128i lshift1 = _mm_cvtsi32_si128(p.lshift[1]); \
+	__m128i lshift2 = _mm_cvtsi32_si128(p.lshift[2]); \
+	__m128i mask = _mm_set1_epi32(p.mask); \
+	__m128i pre = _mm_loadu_si128((__m128i *)p.pre); \
+	__m128i post = _mm_loadu_si128((__m128i *)p.post); \
+	__m128i keep = _mm_loadu_si128((__m128i *)p.keep); \
+	(void)pre;  (void)post;  (void)keep;
+
+#define SIMD_CONVERT4_SSSE3() \
+{ \
+	__m128i v = _mm_shuffle_epi8(_mm_loadu_si128((__m128i *)srcPixel), pre); \
+	if(p.shift) \
+		v = _mm_shuffle_epi8(SIMD_SHIFT_SSE2(v), post); \
+	if(p.keepX) \
+		v = _mm_or_si128(v, \
+			_mm_and_si128(_mm_loadu_si128((__m128i *)dstPixel), keep)); \
+	_mm_storeu_si128((__m128i *)dstPixel, v); \
+	srcPixel += 4 * p.srcSize;  dstPixel += 4 * p.dstSize; \
+}
+
+
+/* Conversions between 4-byte pixel formats with different numbers of bits per
+   component require only shifts and masks.  The compiler already vectorizes
+   the scalar code for those conversions, using constant shift counts, so the
+   SSSE3 kernel leaves them to the scalar code. */
+
+__attribute__((target("ssse3")))
+static int convert_SSSE3(PF *srcpf, unsigned char *srcBuf, int width,
+	int srcStride, int height, unsigned char *dstBuf, int dstStride,
+	PF *dstpf)
+{
+	SIMDParams p;  int groups;
+
+	if(!simdGetParams(srcpf, dstpf, &p)
+		|| (p.shift && p.srcSize == 4 && p.dstSize == 4)
+		|| (groups = simdGroups(&p, width, 4)) < 1)
+		return 0;
+
+	{
+		SIMD_SETUP_SSE2()
+		while(height--)
+		{
+			unsigned char *srcPixel = srcBuf, *dstPixel = dstBuf;
+			int i;
+			for(i = 0; i < groups; i++) SIMD_CONVERT4_SSSE3()
+			srcBuf += srcStride;  dstBuf += dstStride;
+		}
+	}
+	return groups * 4;
+}
+
+
+/* The AVX2 kernel converts groups of 8 pixels, each 128-bit lane holding 4 of
+   them, and then converts as many of the remaining pixels as possible in
+   groups of 4 using SSSE3 instructions. */
+
+#define SIMD_LOAD_AVX2(ptr, size) \
+	_mm256_inserti128_si256( \
+		_mm256_castsi128_si256(_mm_loadu_si128((__m128i *)(ptr))), \
+		_mm_loadu_si128((__m128i *)((ptr) + 4 * (size))), 1)
+
+__attribute__((target("avx2")))
+static int convert_AVX2(PF *srcpf, unsigned char *srcBuf, int width,
+	int srcStride, int height, unsigned char *dstBuf, int dstStride,
+	PF *dstpf)
+{
+	SIMDParams p;  int groups8, groups4;
+
+	if(!simdGetParams(srcpf, dstpf, &p)) return 0;
+	groups8 = simdGroups(&p, width, 8);
+	groups4 = simdGroups(&p, width - groups8 * 8, 4);
+	if(groups8 + groups4 < 1) return 0;
+
+	{
+		SIMD_SETUP_SSE2()
+		__m256i mask8 = _mm256_set1_epi32(p.mask);
+		__m256i pre8 = _mm256_broadcastsi128_si256(pre);
+		__m256i post8 = _mm256_broadcastsi128_si256(post);
+		__m256i keep8 = _mm256_broadcastsi128_si256(keep);
+
+		while(height--)
+		{
+			unsigned char *srcPixel = srcBuf, *dstPixel = dstBuf;
+			int i;
+			for(i = 0; i < groups8; i++)
+			{
+				__m256i v = _mm256_shuffle_epi8(SIMD_LOAD_AVX2(srcPixel, p.srcSize),
+					pre8);
+				if(p.shift)
+				{
+					v = _mm256_or_si256(_mm256_or_si256(
+						_mm256_sll_epi32(_mm256_and_si256(
+							_mm256_srl_epi32(v, rshift0), mask8), lshift0),
+						_mm256_sll_epi32(_mm256_and_si256(
+							_mm256_srl_epi32(v, rshift1), mask8), lshift1)),
+						_mm256_sll_epi32(_mm256_and_si256(
+							_mm256_srl_epi32(v, rshift2), mask8), lshift2));
+					v = _mm256_shuffle_epi8(v, post8);
+				}
+				if(p.keepX)
+					v = _mm256_or_si256(v,
+						_mm256_and_si256(SIMD_LOAD_AVX2(dstPixel, p.dstSize), keep8));
+				_mm_storeu_si128((__m128i *)dstPixel, _mm256_castsi256_si128(v));
+				_mm_storeu_si128((__m128i *)(dstPixel + 4 * p.dstSize),
+					_mm256_extracti128_si256(v, 1));
+				srcPixel += 8 * p.srcSize;  dstPixel += 8 * p.dstSize;
+			}
+			for(i = 0; i < groups4; i++) SIMD_CONVERT4_SSSE3()
+			srcBuf += srcStride;  dstBuf += dstStride;
+		}
+	}
+	return groups8 * 8 + groups4 * 4;
+}
+
+
+static int simdDetect(void)
+{
+	unsigned int eax, ebx, ecx, edx;  int level = SIMD_NONE;
+
+	if(!__get_cpuid(1, &eax, &ebx, &ecx, &edx)) return SIMD_NONE;
+	if(ecx & bit_SSSE3) level = SIMD_SSSE3;
+	/* AVX2 also requires the O/S to save the upper halves of the YMM
+	   registers. */
+	if(level == SIMD_SSSE3 && (ecx & bit_OSXSAVE) && (ecx & bit_AVX)
+		&& __get_cpuid_max(0, NULL) >= 7)
+	{
+		unsigned int xcr0, xcr0High;
+		__asm__ (".byte 0x0f, 0x01, 0xd0" : "=a" (xcr0), "=d" (xcr0High)
+			: "c" (0));
+		__cpuid_count(7, 0, eax, ebx, ecx, edx);
+		if((xcr0 & 6) == 6 && (ebx & bit_AVX2)) level = SIMD_AVX2;
+	}
+	return level;
+}
+
+#endif  /* PF_SIMD_X86 */
+
+
+/* Select the SIMD kernels to use, based on the capabilities of the CPU.  The
+   VGL_SIMD environment variable can be set to none, ssse3, or avx2 in
+   order to disable SIMD acceleration or to limit the instruction set that is
+   used (mainly for testing purposes.) */
+
+static void simdInit(void)
+{
+	int level = SIMD_NONE;
+	char *env = getenv("VGL_SIMD");
+
+	level = simdDetect();
+	if(env && strlen(env) > 0)
+	{
+		int i, maxLevel = SIMD_AVX2;
+		for(i = SIMD_NONE; i <= SIMD_AVX2; i++)
+			if(!stricmp(env, simdName[i])) maxLevel = i;
+		level = min(level, maxLevel);
+	}
+	switch(level)
+	{
+		case SIMD_SSSE3:  simdConvert = convert_SSSE3;  break;
+		case SIMD_AVX2:  simdConvert = convert_AVX2;  break;
+	}
+
+	simdLevel = level;
+}
+
+#define DEFINE_SIMD(id, bpc, rmask, gmask, bmask, rshift, gshift, bshift, \
+	getRGB) \
+static void convert_##id##_SIMD(unsigned char *srcBuf, int width, \
+	int srcStride, int height, unsigned char *dstBuf, int dstStride, \
+	PF *dstpf) \
+{ \
+	int done; \
+	if(!dstpf) return; \
+	done = simdConvert(&__format_##id, srcBuf, width, srcStride, height, \
+		dstBuf, dstStride, dstpf); \
+	if(done < width) \
+		convert_##id(srcBuf + done * PF_##id##_SIZE, width - done, srcStride, \
+			height, dstBuf + done * dstpf->size, dstStride, dstpf); \
+} \
+\
+static PF __format_##id##_SIMD = \
+{ \
+	PF_##id, #id, PF_##id##_SIZE, bpc, rmask, gmask, bmask, rshift, gshift, \
+		bshift, PF_##id##_RINDEX, PF_##id##_GINDEX, PF_##id##_BINDEX, getRGB, \
+		setRGB_##id, convert_##id##_SIMD \
+};
+
+#else
+
+#define DEFINE_SIMD(id, bpc, rmask, gmask, bmask, rshift, gshift, bshift, \
+	getRGB)
+
+#endif  /* PF_SIMD */
+
+
 #define DEFINE_PF4C(id) \
 static INLINE void getRGB_##id(unsigned char *pixel, int *r, int *g, int *b) \
 { \
@@ -484,7 +824,10 @@ static PF __format_##id = \
 		PF_##id##_BMASK, PF_##id##_RSHIFT, PF_##id##_GSHIFT, PF_##id##_BSHIFT, \
 		PF_##id##_RINDEX, PF_##id##_GINDEX, PF_##id##_BINDEX, getRGB_##id, \
 		setRGB_##id, convert_##id \
-};
+}; \
+\
+DEFINE_SIMD(id, 8, PF_##id##_RMASK, PF_##id##_GMASK, PF_##id##_BMASK, \
+	PF_##id##_RSHIFT, PF_##id##_GSHIFT, PF_##id##_BSHIFT, getRGB_##id)
 
 DEFINE_PF4C(RGBX)
 DEFINE_PF4C(BGRX)
@@ -514,7 +857,10 @@ static PF __format_##id = \
 		PF_##id##_BMASK, PF_##id##_RSHIFT, PF_##id##_GSHIFT, PF_##id##_BSHIFT, \
 		PF_##id##_RINDEX, PF_##id##_GINDEX, PF_##id##_BINDEX, getRGB_##id, \
 		setRGB_##id, convert_##id \
-};
+}; \
+\
+DEFINE_SIMD(id, 10, PF_##id##_RMASK, PF_##id##_GMASK, PF_##id##_BMASK, \
+	PF_##id##_RSHIFT, PF_##id##_GSHIFT, PF_##id##_BSHIFT, getRGB_##id)
 
 DEFINE_PF4(RGB10_X2)
 DEFINE_PF4(BGR10_X2)
@@ -533,7 +879,9 @@ static PF __format_##id = \
 { \
 	PF_##id, #id, 3, 8, 0, 0, 0, 0, 0, 0, PF_##id##_RINDEX, PF_##id##_GINDEX, \
 		PF_##id##_BINDEX, getRGB_##id##X, setRGB_##id, convert_##id \
-};
+}; \
+\
+DEFINE_SIMD(id, 8, 0, 0, 0, 0, 0, 0, getRGB_##id##X)
 
 DEFINE_PF3(RGB)
 DEFINE_PF3(BGR)
@@ -571,6 +919,23 @@ static PF __format_NONE =
 
 PF *pf_get(int id)
 {
+	#ifdef PF_SIMD
+	if(simdLevel < 0) simdInit();
+	if(simdConvert) switch(id)
+	{
+		case PF_RGB:  return &__format_RGB_SIMD;
+		case PF_RGBX:  return &__format_RGBX_SIMD;
+		case PF_RGB10_X2:  return &__format_RGB10_X2_SIMD;
+		case PF_BGR:  return &__format_BGR_SIMD;
+		case PF_BGRX:  return &__format_BGRX_SIMD;
+		case PF_BGR10_X2:  return &__format_BGR10_X2_SIMD;
+		case PF_XBGR:  return &__format_XBGR_SIMD;
+		case PF_X2_BGR10:  return &__format_X2_BGR10_SIMD;
+		case PF_XRGB:  return &__format_XRGB_SIMD;
+		case PF_X2_RGB10:  return &__format_X2_RGB10_SIMD;
+	}
+	#endif
+
 	switch(id)
 	{
 		case PF_RGB:  return &__format_RGB;
@@ -587,3 +952,14 @@ PF *pf_get(int id)
 		default:  return &__format_NONE;
 	}
 }
+
+
+const char *pf_getsimd(void)
+{
+	#ifdef PF_SIMD
+	if(simdLevel < 0) simdInit();
+	return simdName[simdLevel];
+	#else
+	return "None";
+	#endif
+}
@@ -82,6 +82,74 @@ int cmpBuf(unsigned char *buf, int width, int pitch, int height, PF *srcpf,
 }
 
 
+/* Verify that convert() produces exactly the same pixels as getRGB() and
+   setRGB() for random pixel values and a range of widths, so that both the
+   SIMD kernels and the scalar code that converts the remainder of each row are
+   exercised, and that convert() does not write past the end of a row. */
+
+#define MAXCHECKWIDTH  67
+#define CHECKHEIGHT  3
+#define GUARD  0xA5
+
+int checkExact(PF *srcpf, PF *dstpf)
+{
+	int retval = 0, width, i, j, k;
+	int srcPitch = BMPPAD(MAXCHECKWIDTH * srcpf->size) + 8;
+	int dstPitch = BMPPAD(MAXCHECKWIDTH * dstpf->size) + 8;
+	unsigned char *srcBuf = NULL, *dstBuf = NULL;
+
+	if((srcBuf = (unsigned char *)malloc(srcPitch * CHECKHEIGHT)) == NULL
+		|| (dstBuf = (unsigned char *)malloc(dstPitch * CHECKHEIGHT)) == NULL)
+		_throw("Could not allocate memory");
+	for(i = 0; i < srcPitch * CHECKHEIGHT; i++) srcBuf[i] = rand();
+
+	for(width = 1; width <= MAXCHECKWIDTH; width++)
+	{
+		memset(dstBuf, GUARD, dstPitch * CHECKHEIGHT);
+		srcpf->convert(srcBuf, width, srcPitch, CHECKHEIGHT, dstBuf, dstPitch,
+			dstpf);
+		for(j = 0; j < CHECKHEIGHT; j++)
+		{
+			for(i = 0; i < width; i++)
+			{
+				int r, g, b, dr, dg, db;
+				srcpf->getRGB(&srcBuf[j * srcPitch + i * srcpf->size], &r, &g, &b);
+				if(srcpf->bpc == 10 && dstpf->bpc == 8)
+				{
+					r >>= 2;  g >>= 2;  b >>= 2;
+				}
+				else if(srcpf->bpc == 8 && dstpf->bpc == 10)
+				{
+					r <<= 2;  g <<= 2;  b <<= 2;
+				}
+				dstpf->getRGB(&dstBuf[j * dstPitch + i * dstpf->size], &dr, &dg,
+					&db);
+				if(r != dr || g != dg || b != db)
+				{
+					printf("\n   Pixel (%d, %d) is incorrect when width = %d\n", i, j,
+						width);
+					_throw("SIMD and scalar conversion do not match");
+				}
+			}
+			for(k = width * dstpf->size; k < dstPitch; k++)
+			{
+				if(dstBuf[j * dstPitch + k] != GUARD)
+				{
+					printf("\n   Byte %d of row %d was overwritten when width = %d\n",
+						k, j, width);
+					_throw("Conversion wrote past the end of a row");
+				}
+			}
+		}
+	}
+
+	bailout:
+	if(srcBuf) free(srcBuf);
+	if(dstBuf) free(dstBuf);
+	return retval;
+}
+
+
 int doTest(int width, int height, PF *srcpf, PF *dstpf)
 {
 	int retval = 0, iter = 0, srcPitch = BMPPAD(width * srcpf->size),
@@ -174,9 +242,15 @@ int doTest(int width, int height, PF *srcpf, PF *dstpf)
 		printf("Pixel data is bogus\n");
 		retval = -1;  goto bailout;
 	}
+	if(!getSetRGB && checkExact(srcpf, dstpf) == -1)
+	{
+		retval = -1;  goto bailout;
+	}
 
-	printf("%f Mpixels/sec\n",
-		(double)(width * height) / 1000000. * (double)iter / elapsed);
+	printf("%10.2f Mpixels/sec  %6.2f GB/sec\n",
+		(double)(width * height) / 1000000. * (double)iter / elapsed,
+		(double)(width * height) * (srcpf->size + dstpf->size) / 1000000000. *
+			(double)iter / elapsed);
 
 	bailout:
 	if(srcBuf) free(srcBuf);
@@ -192,6 +266,8 @@ void usage(char **argv)
 	fprintf(stderr, "-time <t> = Set benchmark time to <t> seconds (default: %.1f)\n",
 		BENCHTIME);
 	fprintf(stderr, "-getsetrgb = Use pixel format getRGB/setRGB methods for conversion\n\n");
+	fprintf(stderr, "Set the VGL_SIMD environment variable to none, ssse3, or avx2 in order to\n");
+	fprintf(stderr, "disable SIMD acceleration or to limit the instruction set that is used.\n\n");
 	exit(1);
 }
 
@@ -212,6 +288,8 @@ int main(int argc, char **argv)
 		else usage(argv);
 	}
 
+	if(!getSetRGB) printf("SIMD instruction set: %s\n\n", pf_getsimd());
+
 	for(srcFormat = 0; srcFormat < PIXELFORMATS - 1; srcFormat++)
 	{
 		PF *srcpf = pf_get(srcFormat);
@@ -219,7 +297,9 @@ int main(int argc, char **argv)
 		{
 			PF *dstpf = pf_get(dstFormat);
 			if(doTest(width, height, srcpf, dstpf) == -1)
-				goto bailout;
+			{
+				retval = -1;  goto bailout;
+			}
 		}
 		printf("\n");
 	}